@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lr-wpan-alloc-counter.h"
+
+#include <cstdlib>
+#include <new>
+
+uint64_t g_allocations = 0;
+
+void *
+operator new (std::size_t size)
+{
+  g_allocations++;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void *
+operator new[] (std::size_t size)
+{
+  return operator new (size);
+}
+
+// All deallocation functions are replaced along with the allocation ones, so
+// that no memory obtained from malloc is released by the library's operators.
+void
+operator delete (void *p) throw ()
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void *p) throw ()
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t size) throw ()
+{
+  std::free (p);
+}
+
+void
+operator delete[] (void *p, std::size_t size) throw ()
+{
+  std::free (p);
+}
@@ -19,6 +19,7 @@
  */
 #include <ns3/packet.h>
 #include <ns3/uinteger.h>
+#include <ns3/boolean.h>
 #include <ns3/simulator.h>
 #include <ns3/nstime.h>
 #include <ns3/log.h>
@@ -39,11 +40,20 @@ NS_LOG_COMPONENT_DEFINE ("LrWpanErrorModelPlot");
 
 //
 // Plot 802.15.4 BER curve (compare against Figure E.2 of IEEE-802.15.4-2006)
+// Optionally, the curve of the tabulated error model is added to the plot.
 //
 int main (int argc, char *argv[])
 {
+  bool tabulated = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("tabulated", "Also plot the BER of the tabulated error model", tabulated);
+  cmd.Parse (argc, argv);
+
   std::ofstream berfile ("802.15.4-ber.plt");
   Ptr<LrWpanErrorModel>  lrWpanError = CreateObject<LrWpanErrorModel> ();
+  Ptr<LrWpanErrorModel>  lrWpanTabulatedError = CreateObject<LrWpanErrorModel> ();
+  lrWpanTabulatedError->SetAttribute ("Tabulated", BooleanValue (true));
 
   double increment = 0.1;
   double minSnr = -10;  //dB
@@ -51,15 +61,24 @@ int main (int argc, char *argv[])
 
   Gnuplot berplot = Gnuplot ("802.15.4-ber.eps");
   Gnuplot2dDataset berdataset ("802.15.4");
+  Gnuplot2dDataset tabulatedBerdataset ("802.15.4 (tabulated)");
 
   for (double snr = minSnr; snr <= maxSnr; snr += increment)
     {
       double ber = 1.0 - lrWpanError->GetChunkSuccessRate (pow (10.0,snr / 10.0), 1);
       NS_LOG_DEBUG (snr << "(dB) " << ber << " (BER)");
       berdataset.Add (snr, ber);
+
+      double tabulatedBer = 1.0 - lrWpanTabulatedError->GetChunkSuccessRate (pow (10.0,snr / 10.0), 1);
+      NS_LOG_DEBUG (snr << "(dB) " << tabulatedBer << " (tabulated BER)");
+      tabulatedBerdataset.Add (snr, tabulatedBer);
     }
 
   berplot.AddDataset (berdataset);
+  if (tabulated)
+    {
+      berplot.AddDataset (tabulatedBerdataset);
+    }
 
   berplot.SetTerminal ("postscript eps color enh \"Times-BoldItalic\"");
   berplot.SetLegend ("SNR (dB)", "Bit Error Rate (BER)");
@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * A microbenchmark of the LrWpanMac data path. A number of sender and
+ * receiver pairs exchange back-to-back acknowledged frames, and the wall
+ * clock time, the number of scheduled events and the number of heap
+ * allocations per packet are reported.
+ * Comparing the runs with and without --directDispatch shows the events
+ * saved by running the zero-delay MAC state changes from the work queue.
+ *
+ * ./waf --run "lr-wpan-mac-benchmark --packets=10000 --pairs=10"
+ * ./waf --run "lr-wpan-mac-benchmark --packets=10000 --pairs=10 --directDispatch=1"
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/propagation-module.h>
+#include <ns3/map-scheduler.h>
+#include <ns3/system-wall-clock-ms.h>
+
+#include "lr-wpan-alloc-counter.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * A MapScheduler counting the inserted events.
+ */
+class CountingScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CountingScheduler")
+      .SetParent<MapScheduler> ()
+      .AddConstructor<CountingScheduler> ()
+    ;
+    return tid;
+  }
+  virtual void Insert (const Event &ev)
+  {
+    g_events++;
+    MapScheduler::Insert (ev);
+  }
+  static uint64_t g_events;
+};
+
+uint64_t CountingScheduler::g_events = 0;
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+/**
+ * The state of a sender.
+ */
+struct Sender
+{
+  Ptr<LrWpanNetDevice> dev; //!< The sending device.
+  Mac16Address dst;         //!< The address of the receiver.
+  uint32_t remaining;       //!< The number of packets left to send.
+};
+
+static uint32_t g_packetSize = 20;
+static uint32_t g_delivered = 0;
+
+static void
+SendPacket (Sender *sender)
+{
+  McpsDataRequestParams params;
+  params.m_dstAddr = sender->dst;
+  params.m_dstPanId = 0;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_txOptions = TX_OPTION_ACK;
+  sender->dev->GetMac ()->McpsDataRequest (params, Create<Packet> (g_packetSize));
+}
+
+static void
+DataConfirm (Sender *sender, McpsDataConfirmParams params)
+{
+  if (--sender->remaining > 0)
+    {
+      Simulator::ScheduleNow (&SendPacket, sender);
+    }
+}
+
+static void
+DataIndication (McpsDataIndicationParams params, Ptr<Packet> p)
+{
+  g_delivered++;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t packets = 1000;
+  uint32_t pairs = 1;
+  bool directDispatch = false;
+
+  CommandLine cmd;
+  cmd.AddValue ("packets", "Number of transmitted packets per sender", packets);
+  cmd.AddValue ("pairs", "Number of sender and receiver pairs", pairs);
+  cmd.AddValue ("size", "Packet size in bytes", g_packetSize);
+  cmd.AddValue ("directDispatch", "Run the zero-delay MAC state changes from the work queue", directDispatch);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::LrWpanMac::DirectDispatch", BooleanValue (directDispatch));
+
+  ObjectFactory scheduler;
+  scheduler.SetTypeId ("ns3::CountingScheduler");
+  Simulator::SetScheduler (scheduler);
+
+  Ptr<LrWpanSpectrumChannel> channel = CreateObject<LrWpanSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  // The pairs are far enough from each other not to interfere.
+  std::vector<Sender> senders (pairs);
+  std::vector<Ptr<LrWpanNetDevice> > allDevs;
+  for (uint32_t i = 0; i < pairs; i++)
+    {
+      Ptr<LrWpanNetDevice> devs[2];
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          Ptr<Node> node = CreateObject<Node> ();
+          devs[j] = CreateObject<LrWpanNetDevice> ();
+          devs[j]->SetAddress (Mac16Address::Allocate ());
+          devs[j]->SetChannel (channel);
+          node->AddDevice (devs[j]);
+          allDevs.push_back (devs[j]);
+          Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+          mobility->SetPosition (Vector (10000.0 * i, 10.0 * j, 0.0));
+          devs[j]->GetPhy ()->SetMobility (mobility);
+        }
+      senders[i].dev = devs[0];
+      senders[i].dst = Mac16Address::ConvertFrom (devs[1]->GetAddress ());
+      senders[i].remaining = packets;
+      devs[0]->GetMac ()->SetMcpsDataConfirmCallback (MakeBoundCallback (&DataConfirm, &senders[i]));
+      devs[1]->GetMac ()->SetMcpsDataIndicationCallback (MakeCallback (&DataIndication));
+      Simulator::Schedule (Seconds (1.0), &SendPacket, &senders[i]);
+    }
+
+  uint64_t setupEvents = CountingScheduler::g_events;
+  uint64_t setupAllocations = g_allocations;
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+  int64_t elapsed = clock.End ();
+  uint64_t allocations = g_allocations - setupAllocations;
+
+  uint64_t total = static_cast<uint64_t> (packets) * pairs;
+  uint64_t events = CountingScheduler::g_events - setupEvents;
+  uint64_t dispatched = 0;
+  for (uint32_t i = 0; i < allDevs.size (); i++)
+    {
+      dispatched += allDevs[i]->GetMac ()->GetDispatchedTransitions ();
+    }
+  std::cout << "packets: " << total
+            << " delivered: " << g_delivered
+            << " direct dispatch: " << (directDispatch ? "on" : "off")
+            << " wall clock: " << elapsed << " ms"
+            << " (" << 1000.0 * elapsed / total << " us/packet)"
+            << " events: " << events
+            << " (" << static_cast<double> (events) / total << " per packet)"
+            << " allocations: " << allocations
+            << " (" << static_cast<double> (allocations) / total << " per packet)"
+            << " dispatched: " << dispatched
+            << " (" << static_cast<double> (dispatched) / total << " per packet)"
+            << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * A microbenchmark of the LrWpanPhy transmit path. A sender transmits
+ * back-to-back frames to a number of receivers, and the wall clock time, the
+ * number of scheduled events and the number of heap allocations per
+ * transmission are reported.
+ *
+ * ./waf --run "lr-wpan-phy-benchmark --packets=100000 --receivers=10"
+ */
+
+#include <ns3/core-module.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/propagation-module.h>
+#include <ns3/map-scheduler.h>
+#include <ns3/system-wall-clock-ms.h>
+
+#include "lr-wpan-alloc-counter.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+/**
+ * A MapScheduler counting the inserted events.
+ */
+class CountingScheduler : public MapScheduler
+{
+public:
+  static TypeId GetTypeId (void)
+  {
+    static TypeId tid = TypeId ("ns3::CountingScheduler")
+      .SetParent<MapScheduler> ()
+      .AddConstructor<CountingScheduler> ()
+    ;
+    return tid;
+  }
+  virtual void Insert (const Event &ev)
+  {
+    g_events++;
+    MapScheduler::Insert (ev);
+  }
+  static uint64_t g_events;
+};
+
+uint64_t CountingScheduler::g_events = 0;
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+static uint32_t g_remaining = 0;
+static uint32_t g_packetSize = 20;
+
+static void
+SendPacket (Ptr<LrWpanPhy> sender)
+{
+  Ptr<Packet> p = Create<Packet> (g_packetSize);
+  sender->PdDataRequest (p->GetSize (), p);
+}
+
+static void
+DataConfirm (Ptr<LrWpanPhy> sender, LrWpanPhyEnumeration status)
+{
+  if (--g_remaining > 0)
+    {
+      // The transceiver returns to TX_ON after the confirm.
+      Simulator::ScheduleNow (&SendPacket, sender);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t packets = 10000;
+  uint32_t receivers = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("packets", "Number of transmitted packets", packets);
+  cmd.AddValue ("receivers", "Number of receiving PHYs", receivers);
+  cmd.AddValue ("size", "Packet size in bytes", g_packetSize);
+  cmd.Parse (argc, argv);
+
+  ObjectFactory scheduler;
+  scheduler.SetTypeId ("ns3::CountingScheduler");
+  Simulator::SetScheduler (scheduler);
+
+  Ptr<LrWpanSpectrumChannel> channel = CreateObject<LrWpanSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  Ptr<LrWpanPhy> sender = CreateObject<LrWpanPhy> ();
+  Ptr<ConstantPositionMobilityModel> senderMobility = CreateObject<ConstantPositionMobilityModel> ();
+  sender->SetMobility (senderMobility);
+  sender->SetChannel (channel);
+  channel->AddRx (sender);
+  sender->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+  sender->SetPdDataConfirmCallback (MakeBoundCallback (&DataConfirm, sender));
+
+  for (uint32_t i = 0; i < receivers; i++)
+    {
+      Ptr<LrWpanPhy> receiver = CreateObject<LrWpanPhy> ();
+      Ptr<ConstantPositionMobilityModel> receiverMobility = CreateObject<ConstantPositionMobilityModel> ();
+      receiverMobility->SetPosition (Vector (10.0, i, 0.0));
+      receiver->SetMobility (receiverMobility);
+      receiver->SetChannel (channel);
+      channel->AddRx (receiver);
+      receiver->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
+    }
+
+  g_remaining = packets;
+  Simulator::Schedule (Seconds (1.0), &SendPacket, sender);
+
+  uint64_t setupEvents = CountingScheduler::g_events;
+  uint64_t setupAllocations = g_allocations;
+  SystemWallClockMs clock;
+  clock.Start ();
+  Simulator::Run ();
+  int64_t elapsed = clock.End ();
+  uint64_t allocations = g_allocations - setupAllocations;
+
+  uint64_t events = CountingScheduler::g_events - setupEvents;
+  std::cout << "packets: " << packets
+            << " receivers: " << receivers
+            << " wall clock: " << elapsed << " ms"
+            << " (" << 1000.0 * elapsed / packets << " us/packet)"
+            << " events: " << events
+            << " (" << static_cast<double> (events) / packets << " per packet)"
+            << " allocations: " << allocations
+            << " (" << static_cast<double> (allocations) / packets << " per packet)"
+            << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -31,7 +31,7 @@
 #include <ns3/propagation-loss-model.h>
 #include <ns3/propagation-delay-model.h>
 #include <ns3/simulator.h>
-#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/lr-wpan-spectrum-channel.h>
 #include <ns3/packet.h>
 
 #include "ns3/mobility-module.h"
@@ -83,7 +83,8 @@ int main (int argc, char *argv[])
   // Enable calculation of FCS in the trailers. Only necessary when interacting with real devices or wireshark.
   // GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
 
-  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  // All nodes are static, let the channel cache the link budgets.
+  Ptr<LrWpanSpectrumChannel> channel = CreateObject<LrWpanSpectrumChannel> ();
   // Ptr<LogDistancePropagationLossModel> propModel = CreateObject<LogDistancePropagationLossModel> ();
   // Ptr<FriisPropagationLossModel> propModel = CreateObjectWithAttributes<FriisPropagationLossModel>
   //                                             ("Frequency", DoubleValue (2.4e9),
@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-beacon-header.h"
+#include <ns3/address-utils.h>
+#include <ns3/assert.h>
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LrWpanBeaconHeader);
+
+TypeId
+LrWpanBeaconHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanBeaconHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<LrWpanBeaconHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+LrWpanBeaconHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+LrWpanBeaconHeader::LrWpanBeaconHeader (void)
+  : m_beaconOrder (15),
+    m_superframeOrder (15),
+    m_finalCapSlot (15),
+    m_panCoordinator (false)
+{
+}
+
+uint32_t
+LrWpanBeaconHeader::GetSerializedSize (void) const
+{
+  // Superframe specification, GTS specification and pending address
+  // specification. The GTS directions and list only follow with GTSs.
+  uint32_t size = 2 + 1 + 1;
+  if (!m_gtsList.empty ())
+    {
+      size += 1 + 3 * m_gtsList.size ();
+    }
+  return size;
+}
+
+void
+LrWpanBeaconHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+
+  uint16_t superframeSpec = (m_beaconOrder & 0x0f)
+    | ((m_superframeOrder & 0x0f) << 4)
+    | ((m_finalCapSlot & 0x0f) << 8);
+  if (m_panCoordinator)
+    {
+      superframeSpec |= (1 << 14);
+    }
+  i.WriteHtolsbU16 (superframeSpec);
+
+  i.WriteU8 (m_gtsList.size () & 0x07);
+  if (!m_gtsList.empty ())
+    {
+      // All GTSs are in the transmit direction.
+      i.WriteU8 (0);
+      for (std::vector<GtsDescriptor>::const_iterator it = m_gtsList.begin (); it != m_gtsList.end (); it++)
+        {
+          WriteTo (i, it->m_address);
+          i.WriteU8 ((it->m_startSlot & 0x0f) | ((it->m_length & 0x0f) << 4));
+        }
+    }
+
+  // No pending addresses.
+  i.WriteU8 (0);
+}
+
+uint32_t
+LrWpanBeaconHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+
+  uint16_t superframeSpec = i.ReadLsbtohU16 ();
+  m_beaconOrder = superframeSpec & 0x0f;
+  m_superframeOrder = (superframeSpec >> 4) & 0x0f;
+  m_finalCapSlot = (superframeSpec >> 8) & 0x0f;
+  m_panCoordinator = (superframeSpec >> 14) & 0x01;
+
+  m_gtsList.clear ();
+  uint8_t gtsCount = i.ReadU8 () & 0x07;
+  if (gtsCount > 0)
+    {
+      i.ReadU8 ();
+      for (uint8_t n = 0; n < gtsCount; n++)
+        {
+          GtsDescriptor gts;
+          ReadFrom (i, gts.m_address);
+          uint8_t slots = i.ReadU8 ();
+          gts.m_startSlot = slots & 0x0f;
+          gts.m_length = (slots >> 4) & 0x0f;
+          m_gtsList.push_back (gts);
+        }
+    }
+
+  // Skip the pending addresses, short ones first.
+  uint8_t pendingSpec = i.ReadU8 ();
+  i.Next (2 * (pendingSpec & 0x07) + 8 * ((pendingSpec >> 4) & 0x07));
+
+  return i.GetDistanceFrom (start);
+}
+
+void
+LrWpanBeaconHeader::Print (std::ostream &os) const
+{
+  os << "Beacon Order = " << static_cast<uint32_t> (m_beaconOrder)
+     << ", Superframe Order = " << static_cast<uint32_t> (m_superframeOrder)
+     << ", Final CAP Slot = " << static_cast<uint32_t> (m_finalCapSlot)
+     << ", PAN Coordinator = " << m_panCoordinator;
+  for (std::vector<GtsDescriptor>::const_iterator it = m_gtsList.begin (); it != m_gtsList.end (); it++)
+    {
+      os << ", GTS = " << it->m_address
+         << " [" << static_cast<uint32_t> (it->m_startSlot)
+         << ", " << static_cast<uint32_t> (it->m_length) << "]";
+    }
+}
+
+void
+LrWpanBeaconHeader::SetBeaconOrder (uint8_t beaconOrder)
+{
+  m_beaconOrder = beaconOrder;
+}
+
+uint8_t
+LrWpanBeaconHeader::GetBeaconOrder (void) const
+{
+  return m_beaconOrder;
+}
+
+void
+LrWpanBeaconHeader::SetSuperframeOrder (uint8_t superframeOrder)
+{
+  m_superframeOrder = superframeOrder;
+}
+
+uint8_t
+LrWpanBeaconHeader::GetSuperframeOrder (void) const
+{
+  return m_superframeOrder;
+}
+
+void
+LrWpanBeaconHeader::SetFinalCapSlot (uint8_t finalCapSlot)
+{
+  m_finalCapSlot = finalCapSlot;
+}
+
+uint8_t
+LrWpanBeaconHeader::GetFinalCapSlot (void) const
+{
+  return m_finalCapSlot;
+}
+
+void
+LrWpanBeaconHeader::SetPanCoordinator (bool panCoordinator)
+{
+  m_panCoordinator = panCoordinator;
+}
+
+bool
+LrWpanBeaconHeader::IsPanCoordinator (void) const
+{
+  return m_panCoordinator;
+}
+
+void
+LrWpanBeaconHeader::AddGts (const GtsDescriptor &gts)
+{
+  NS_ASSERT_MSG (m_gtsList.size () < MAX_GTS, "Too many GTS descriptors");
+  m_gtsList.push_back (gts);
+}
+
+const std::vector<LrWpanBeaconHeader::GtsDescriptor> &
+LrWpanBeaconHeader::GetGtsList (void) const
+{
+  return m_gtsList;
+}
+
+} // namespace ns3
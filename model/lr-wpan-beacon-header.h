@@ -0,0 +1,138 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_BEACON_HEADER_H
+#define LR_WPAN_BEACON_HEADER_H
+
+#include <ns3/header.h>
+#include <ns3/mac16-address.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief The payload of a beacon frame.
+ *
+ * The superframe specification, the GTS fields and the pending address
+ * fields of a beacon, see IEEE 802.15.4-2006, section 7.2.2.1. Only GTSs
+ * in the transmit direction, from the device to the coordinator, are
+ * supported, and no pending addresses are sent.
+ */
+class LrWpanBeaconHeader : public Header
+{
+public:
+  /**
+   * The maximum number of GTS descriptors in a beacon.
+   */
+  static const uint32_t MAX_GTS = 7;
+
+  /**
+   * A GTS descriptor, see IEEE 802.15.4-2006, section 7.2.2.1.6.
+   */
+  struct GtsDescriptor
+  {
+    Mac16Address m_address; //!< The device owning the GTS
+    uint8_t m_startSlot;    //!< The first superframe slot of the GTS
+    uint8_t m_length;       //!< The number of superframe slots of the GTS
+  };
+
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * Create a beacon of a nonbeacon-enabled PAN, without GTSs.
+   */
+  LrWpanBeaconHeader (void);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \param beaconOrder the beacon order, 0 - 15
+   */
+  void SetBeaconOrder (uint8_t beaconOrder);
+
+  /**
+   * \return the beacon order
+   */
+  uint8_t GetBeaconOrder (void) const;
+
+  /**
+   * \param superframeOrder the superframe order, 0 - 15
+   */
+  void SetSuperframeOrder (uint8_t superframeOrder);
+
+  /**
+   * \return the superframe order
+   */
+  uint8_t GetSuperframeOrder (void) const;
+
+  /**
+   * \param finalCapSlot the last superframe slot of the CAP, 0 - 15
+   */
+  void SetFinalCapSlot (uint8_t finalCapSlot);
+
+  /**
+   * \return the last superframe slot of the CAP
+   */
+  uint8_t GetFinalCapSlot (void) const;
+
+  /**
+   * \param panCoordinator true, if the beacon is sent by the PAN coordinator
+   */
+  void SetPanCoordinator (bool panCoordinator);
+
+  /**
+   * \return true, if the beacon is sent by the PAN coordinator
+   */
+  bool IsPanCoordinator (void) const;
+
+  /**
+   * Add a GTS descriptor. At most MAX_GTS descriptors are sent.
+   *
+   * \param gts the descriptor
+   */
+  void AddGts (const GtsDescriptor &gts);
+
+  /**
+   * \return the GTS descriptors
+   */
+  const std::vector<GtsDescriptor> &GetGtsList (void) const;
+
+private:
+  uint8_t m_beaconOrder;      //!< The beacon order
+  uint8_t m_superframeOrder;  //!< The superframe order
+  uint8_t m_finalCapSlot;     //!< The last superframe slot of the CAP
+  bool m_panCoordinator;      //!< True, if sent by the PAN coordinator
+
+  /**
+   * The GTS descriptors.
+   */
+  std::vector<GtsDescriptor> m_gtsList;
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_BEACON_HEADER_H */
@@ -0,0 +1,92 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-block-ack-header.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LrWpanBlockAckHeader);
+
+TypeId
+LrWpanBlockAckHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanBlockAckHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<LrWpanBlockAckHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+LrWpanBlockAckHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+LrWpanBlockAckHeader::LrWpanBlockAckHeader (void)
+  : m_bitmap (0)
+{
+}
+
+uint32_t
+LrWpanBlockAckHeader::GetSerializedSize (void) const
+{
+  return sizeof (uint16_t);
+}
+
+void
+LrWpanBlockAckHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteHtolsbU16 (m_bitmap);
+}
+
+uint32_t
+LrWpanBlockAckHeader::Deserialize (Buffer::Iterator start)
+{
+  m_bitmap = start.ReadLsbtohU16 ();
+  return GetSerializedSize ();
+}
+
+void
+LrWpanBlockAckHeader::Print (std::ostream &os) const
+{
+  os << "Bitmap = 0x" << std::hex << m_bitmap << std::dec;
+}
+
+void
+LrWpanBlockAckHeader::SetReceived (uint8_t lastSeqNum, uint8_t seqNum)
+{
+  uint8_t offset = lastSeqNum - seqNum;
+  if (offset < BITMAP_SIZE)
+    {
+      m_bitmap |= (1 << offset);
+    }
+}
+
+bool
+LrWpanBlockAckHeader::IsReceived (uint8_t lastSeqNum, uint8_t seqNum) const
+{
+  uint8_t offset = lastSeqNum - seqNum;
+  return offset < BITMAP_SIZE && (m_bitmap & (1 << offset)) != 0;
+}
+
+uint16_t
+LrWpanBlockAckHeader::GetBitmap (void) const
+{
+  return m_bitmap;
+}
+
+} // namespace ns3
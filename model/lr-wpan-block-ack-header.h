@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_BLOCK_ACK_HEADER_H
+#define LR_WPAN_BLOCK_ACK_HEADER_H
+
+#include <ns3/header.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief The bitmap of a block ACK.
+ *
+ * A block ACK answers the last frame of a burst, and carries its sequence
+ * number in the MAC header. Bit i of the bitmap is set if the frame with the
+ * sequence number i before it has been received, bit 0 standing for the last
+ * frame itself.
+ */
+class LrWpanBlockAckHeader : public Header
+{
+public:
+  /**
+   * The number of sequence numbers covered by the bitmap.
+   */
+  static const uint32_t BITMAP_SIZE = 16;
+
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * Create a block ACK with an empty bitmap.
+   */
+  LrWpanBlockAckHeader (void);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * Mark a frame as received.
+   *
+   * \param lastSeqNum the sequence number of the last frame of the burst
+   * \param seqNum the sequence number of the received frame
+   */
+  void SetReceived (uint8_t lastSeqNum, uint8_t seqNum);
+
+  /**
+   * Check if a frame has been received.
+   *
+   * \param lastSeqNum the sequence number of the last frame of the burst
+   * \param seqNum the sequence number of the frame
+   * \return true, if the frame is covered by the bitmap and has been received
+   */
+  bool IsReceived (uint8_t lastSeqNum, uint8_t seqNum) const;
+
+  /**
+   * \return the bitmap
+   */
+  uint16_t GetBitmap (void) const;
+
+private:
+  /**
+   * The bitmap of the received frames.
+   */
+  uint16_t m_bitmap;
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_BLOCK_ACK_HEADER_H */
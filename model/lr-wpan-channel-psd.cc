@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-channel-psd.h"
+#include <ns3/spectrum-value.h>
+#include <ns3/spectrum-model.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LrWpanChannelPsd");
+
+extern Ptr<SpectrumModel> g_LrWpanSpectrumModel;
+
+LrWpanChannelPsd::LrWpanChannelPsd (void)
+  : m_channel (0)
+{
+  Clear ();
+}
+
+LrWpanChannelPsd::LrWpanChannelPsd (uint32_t channel)
+  : m_channel (channel)
+{
+  NS_ASSERT_MSG ((channel >= 11 && channel <= 26), "Invalid channel numbers");
+  Clear ();
+}
+
+uint32_t
+LrWpanChannelPsd::GetFirstBand (uint32_t channel)
+{
+  // Channel 11 centered at 2.405 GHz, 12 at 2.410 GHz, ... 26 at 2.480 GHz,
+  // see LrWpanSpectrumValueHelper::CreateTxPowerSpectralDensity.
+  return 2405 + 5 * (channel - 11) - 2400 - 2;
+}
+
+LrWpanChannelPsd
+LrWpanChannelPsd::FromSpectrumValue (Ptr<const SpectrumValue> psd, uint32_t channel)
+{
+  NS_ASSERT (psd->GetSpectrumModel () == g_LrWpanSpectrumModel);
+
+  LrWpanChannelPsd compact (channel);
+  uint32_t first = GetFirstBand (channel);
+  for (uint32_t i = 0; i < NUM_BANDS; i++)
+    {
+      compact.m_lanes[i] = (*psd)[first + i];
+    }
+  return compact;
+}
+
+LrWpanChannelPsd
+LrWpanChannelPsd::FromSpectrumValue (Ptr<const SpectrumValue> psd)
+{
+  NS_ASSERT (psd->GetSpectrumModel () == g_LrWpanSpectrumModel);
+
+  for (uint32_t channel = 11; channel <= 26; channel++)
+    {
+      if ((*psd)[GetFirstBand (channel) + NUM_BANDS / 2] != 0.0)
+        {
+          return FromSpectrumValue (psd, channel);
+        }
+    }
+  return LrWpanChannelPsd ();
+}
+
+uint32_t
+LrWpanChannelPsd::GetChannel (void) const
+{
+  return m_channel;
+}
+
+double &
+LrWpanChannelPsd::operator[] (uint32_t band)
+{
+  NS_ASSERT (band < NUM_BANDS);
+  return m_lanes[band];
+}
+
+double
+LrWpanChannelPsd::operator[] (uint32_t band) const
+{
+  NS_ASSERT (band < NUM_BANDS);
+  return m_lanes[band];
+}
+
+LrWpanChannelPsd &
+LrWpanChannelPsd::operator+= (const LrWpanChannelPsd &other)
+{
+  NS_ASSERT_MSG (m_channel == other.m_channel, "PSDs of different channels");
+  for (uint32_t i = 0; i < NUM_LANES; i++)
+    {
+      m_lanes[i] += other.m_lanes[i];
+    }
+  return *this;
+}
+
+LrWpanChannelPsd &
+LrWpanChannelPsd::operator-= (const LrWpanChannelPsd &other)
+{
+  NS_ASSERT_MSG (m_channel == other.m_channel, "PSDs of different channels");
+  for (uint32_t i = 0; i < NUM_LANES; i++)
+    {
+      m_lanes[i] -= other.m_lanes[i];
+    }
+  return *this;
+}
+
+void
+LrWpanChannelPsd::Clear (void)
+{
+  for (uint32_t i = 0; i < NUM_LANES; i++)
+    {
+      m_lanes[i] = 0.0;
+    }
+}
+
+double
+LrWpanChannelPsd::TotalAvgPower (void) const
+{
+  // Numerically integrate using 1 MHz resolution. The padding lanes are
+  // zero, summing all lanes keeps the loop length fixed.
+  double totalAvgPower = 0.0;
+  for (uint32_t i = 0; i < NUM_LANES; i++)
+    {
+      totalAvgPower += m_lanes[i];
+    }
+  return totalAvgPower * 1.0e6;
+}
+
+double
+LrWpanChannelPsd::TotalAvgPower (uint32_t channel) const
+{
+  if (channel != m_channel)
+    {
+      return 0.0;
+    }
+  return TotalAvgPower ();
+}
+
+} // namespace ns3
@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_CHANNEL_PSD_H
+#define LR_WPAN_CHANNEL_PSD_H
+
+#include <ns3/ptr.h>
+#include <stdint.h>
+
+namespace ns3 {
+
+class SpectrumValue;
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief A compact power spectral density, anchored to a single IEEE 802.15.4
+ * channel.
+ *
+ * The PSDs created by LrWpanSpectrumValueHelper only carry power in the five
+ * 1 MHz bands around the center frequency of a channel, out of the 84 bands of
+ * the LrWpan SpectrumModel. This class only stores these five bands, together
+ * with the channel they belong to. The bands are padded to a fixed number of
+ * lanes, so that the arithmetic is done in fixed length loops which can be
+ * vectorized by the compiler.
+ *
+ * PSDs are converted from and to SpectrumValue only when signals enter or
+ * leave the PHY through the SpectrumChannel.
+ */
+class LrWpanChannelPsd
+{
+public:
+  /**
+   * The number of 1 MHz bands of the LrWpan SpectrumModel belonging to a
+   * channel.
+   */
+  static const uint32_t NUM_BANDS = 5;
+
+  /**
+   * The number of stored lanes. Lanes beyond NUM_BANDS are always zero.
+   */
+  static const uint32_t NUM_LANES = 8;
+
+  /**
+   * Create an empty PSD, which is not anchored to any channel.
+   */
+  LrWpanChannelPsd (void);
+
+  /**
+   * Create an all-zero PSD, anchored to the given channel.
+   *
+   * \param channel the channel number per IEEE 802.15.4 (11-26)
+   */
+  LrWpanChannelPsd (uint32_t channel);
+
+  /**
+   * Extract the bands of the given channel from a SpectrumValue of the
+   * LrWpan SpectrumModel.
+   *
+   * \param psd the PSD to be converted
+   * \param channel the channel number per IEEE 802.15.4 (11-26)
+   * \return the compact PSD of the given channel
+   */
+  static LrWpanChannelPsd FromSpectrumValue (Ptr<const SpectrumValue> psd, uint32_t channel);
+
+  /**
+   * Convert a SpectrumValue of the LrWpan SpectrumModel, which carries power
+   * in the band of a single channel only, as created by
+   * LrWpanSpectrumValueHelper. The channel is the first one with power in its
+   * center band. If there is none, the returned PSD is not anchored.
+   *
+   * \param psd the PSD to be converted
+   * \return the compact PSD
+   */
+  static LrWpanChannelPsd FromSpectrumValue (Ptr<const SpectrumValue> psd);
+
+  /**
+   * Get the channel this PSD is anchored to.
+   *
+   * \return the channel number per IEEE 802.15.4, or 0 if not anchored
+   */
+  uint32_t GetChannel (void) const;
+
+  /**
+   * Access a band of this PSD.
+   *
+   * \param band the band index, 0 is the lowest band of the channel
+   * \return the power spectral density of the band in W/Hz
+   */
+  double &operator[] (uint32_t band);
+
+  /**
+   * Access a band of this PSD.
+   *
+   * \param band the band index, 0 is the lowest band of the channel
+   * \return the power spectral density of the band in W/Hz
+   */
+  double operator[] (uint32_t band) const;
+
+  /**
+   * Add the given PSD, which has to be anchored to the same channel.
+   *
+   * \param other the PSD to be added
+   * \return this PSD
+   */
+  LrWpanChannelPsd &operator+= (const LrWpanChannelPsd &other);
+
+  /**
+   * Subtract the given PSD, which has to be anchored to the same channel.
+   *
+   * \param other the PSD to be subtracted
+   * \return this PSD
+   */
+  LrWpanChannelPsd &operator-= (const LrWpanChannelPsd &other);
+
+  /**
+   * Set all bands to zero, keeping the channel.
+   */
+  void Clear (void);
+
+  /**
+   * Get the total power of this PSD, i.e. the integral over the bands of its
+   * channel. This matches LrWpanSpectrumValueHelper::TotalAvgPower.
+   *
+   * \return the total power in W
+   */
+  double TotalAvgPower (void) const;
+
+  /**
+   * Get the total power of this PSD within the given channel.
+   *
+   * \param channel the channel number per IEEE 802.15.4 (11-26)
+   * \return the total power in W, 0 if the PSD belongs to another channel
+   */
+  double TotalAvgPower (uint32_t channel) const;
+
+private:
+  /**
+   * Get the index of the lowest band of the given channel in the LrWpan
+   * SpectrumModel.
+   *
+   * \param channel the channel number per IEEE 802.15.4 (11-26)
+   * \return the band index
+   */
+  static uint32_t GetFirstBand (uint32_t channel);
+
+  /**
+   * The channel the PSD is anchored to, 0 if none.
+   */
+  uint32_t m_channel;
+
+  /**
+   * The power spectral density of the bands in W/Hz, padded to NUM_LANES.
+   */
+  double m_lanes[NUM_LANES];
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_CHANNEL_PSD_H */
@@ -173,15 +173,32 @@ LrWpanCsmaCa::GetUnitBackoffPeriod (void) const
   return m_aUnitBackoffPeriod;
 }
 
+Time
+LrWpanCsmaCa::GetUnitBackoffTime (void) const
+{
+  bool isData = false;
+  uint64_t symbolRate = (uint64_t) m_mac->GetPhy ()->GetDataOrSymbolRate (isData); //symbols per second
+  return MicroSeconds (GetUnitBackoffPeriod () * 1000 * 1000 / symbolRate);
+}
+
 Time
 LrWpanCsmaCa::GetTimeToNextSlot (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  // TODO: Calculate the offset to the next slot.
-
-  return Seconds (0);
+  if (!m_mac->IsBeaconEnabled ())
+    {
+      return Seconds (0);
+    }
 
+  // The backoff periods are counted from the start of the superframe.
+  int64_t period = GetUnitBackoffTime ().GetNanoSeconds ();
+  int64_t offset = (Simulator::Now () - m_mac->GetSuperframeStart ()).GetNanoSeconds () % period;
+  if (offset == 0)
+    {
+      return Seconds (0);
+    }
+  return NanoSeconds (period - offset);
 }
 void
 LrWpanCsmaCa::Start ()
@@ -200,7 +217,7 @@ LrWpanCsmaCa::Start ()
         {
           m_BE = m_macMinBE;
         }
-      //TODO: for slotted, locate backoff period boundary. i.e. delay to the next slot boundary
+      // The backoff starts on a backoff period boundary.
       Time backoffBoundary = GetTimeToNextSlot ();
       m_randomBackoffEvent = Simulator::Schedule (backoffBoundary, &LrWpanCsmaCa::RandomBackoffDelay, this);
     }
@@ -240,6 +257,8 @@ LrWpanCsmaCa::Cancel ()
   m_requestCcaEvent.Cancel ();
   m_canProceedEvent.Cancel ();
   m_rfMacBackOffEvent.Cancel ();
+  // The confirmation of a CCA in progress is ignored.
+  m_ccaRequestRunning = false;
 }
 
 /*
@@ -333,6 +352,12 @@ LrWpanCsmaCa::StopTimer (void)
 {
   NS_LOG_FUNCTION (this);
   m_requestCcaEvent.Cancel ();
+  if (IsSlottedCsmaCa ())
+    {
+      // The slotted channel access starts over.
+      m_randomBackoffEvent.Cancel ();
+      m_canProceedEvent.Cancel ();
+    }
 
   if (m_rfMacBackOffEvent.IsRunning ())
     {
@@ -346,31 +371,31 @@ LrWpanCsmaCa::StopTimer (void)
     }
 }
 
-// TODO : Determine if transmission can be completed before end of CAP for the slotted csmaca
-//        If not delay to the next CAP
+/*
+ * Determine if the CCAs and the transaction can be completed before the end of
+ * the CAP. If not, a new backoff is started in the CAP of the next superframe.
+ */
 void
 LrWpanCsmaCa::CanProceed ()
 {
   NS_LOG_FUNCTION (this);
 
-  bool canProceed = true;
-
-  if (m_BLE)
-    {
-    }
-  else
-    {
-    }
+  // The CCAs are performed on backoff period boundaries, one period each,
+  // followed by the turnaround to TX.
+  Time backoffBoundary = GetTimeToNextSlot ();
+  bool isData = false;
+  uint64_t symbolRate = (uint64_t) m_mac->GetPhy ()->GetDataOrSymbolRate (isData);
+  Time ccaTime = MicroSeconds ((m_CW * GetUnitBackoffPeriod () + m_mac->GetPhy ()->aTurnaroundTime) * 1000 * 1000 / symbolRate);
+  Time transactionEnd = Simulator::Now () + backoffBoundary + ccaTime + m_mac->GetTransactionDuration (m_mac->m_txPkt);
 
-  if (canProceed)
+  if (transactionEnd <= m_mac->GetCapEnd ())
     {
-      // TODO: For slotted, Perform CCA on backoff period boundary i.e. delay to next slot boundary
-      Time backoffBoundary = GetTimeToNextSlot ();
       m_requestCcaEvent = Simulator::Schedule (backoffBoundary, &LrWpanCsmaCa::RequestCCA, this);
     }
   else
     {
-      Time nextCap = Seconds (0);
+      Time nextCap = m_mac->GetNextCapStart () - Simulator::Now ();
+      NS_LOG_LOGIC ("Slotted: transaction does not fit in the CAP, backoff again in " << nextCap.GetMicroSeconds () << " us");
       m_randomBackoffEvent = Simulator::Schedule (nextCap, &LrWpanCsmaCa::RandomBackoffDelay, this);
     }
 }
@@ -414,7 +439,8 @@ LrWpanCsmaCa::PlmeCcaConfirm (LrWpanPhyEnumeration status)
               else
                 {
                   NS_LOG_LOGIC ("Perform CCA again, m_CW = " << m_CW);
-                  m_requestCcaEvent = Simulator::ScheduleNow (&LrWpanCsmaCa::RequestCCA, this); // Perform CCA again
+                  // Perform CCA again, on the next backoff period boundary
+                  m_requestCcaEvent = Simulator::Schedule (GetTimeToNextSlot (), &LrWpanCsmaCa::RequestCCA, this);
                 }
             }
           else //unslotted
@@ -450,6 +476,12 @@ LrWpanCsmaCa::PlmeCcaConfirm (LrWpanPhyEnumeration status)
             }
           else
             {
+              if (IsSlottedCsmaCa ())
+                {
+                  NS_LOG_DEBUG ("Perform another backoff; m_NB = " << static_cast<uint16_t> (m_NB));
+                  m_randomBackoffEvent = Simulator::ScheduleNow (&LrWpanCsmaCa::RandomBackoffDelay, this); //Perform another backoff (step 2)
+                  return;
+                }
               NS_LOG_LOGIC ("Notifying MAC of not idle channel");
               // NS_LOG_DEBUG ("Perform another backoff; m_NB = " << static_cast<uint16_t> (m_NB));
               // m_randomBackoffEvent = Simulator::ScheduleNow (&LrWpanCsmaCa::RandomBackoffDelay, this); //Perform another backoff (step 2)
@@ -177,7 +177,8 @@ public:
   void Start (void);
 
   /**
-   * Cancel CSMA-CA algorithm.
+   * Cancel CSMA-CA algorithm. The confirmation of a CCA requested before is
+   * ignored.
    */
   void Cancel (void);
 
@@ -257,6 +258,11 @@ private:
  
   virtual void DoDispose (void);
 
+  /**
+   * \return the duration of a backoff period
+   */
+  Time GetUnitBackoffTime (void) const;
+
   /**
    * The callback to inform the configured MAC of the CSMA/CA result.
    */
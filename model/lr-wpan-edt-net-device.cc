@@ -31,8 +31,8 @@ LrWpanEdtNetDevice::LrWpanEdtNetDevice (void)
   	GetPhy ()->m_phyPIBAttributes.phyTransmitPower = 30;
 
   	LrWpanSpectrumValueHelper psdHelper;
-  	GetPhy ()->m_txPsd = psdHelper.CreateTxPowerSpectralDensity (GetPhy ()->m_phyPIBAttributes.phyTransmitPower,
-                                                    GetPhy ()->m_phyPIBAttributes.phyCurrentChannel);
+  	GetPhy ()->m_txPsd = psdHelper.GetTxPowerSpectralDensity (GetPhy ()->m_phyPIBAttributes.phyTransmitPower,
+                                                 GetPhy ()->m_phyPIBAttributes.phyCurrentChannel);
 }
 
 LrWpanEdtNetDevice::~LrWpanEdtNetDevice (void)
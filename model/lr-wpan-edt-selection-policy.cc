@@ -0,0 +1,229 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-edt-selection-policy.h"
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/uinteger.h>
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LrWpanEdtSelectionPolicy");
+
+NS_OBJECT_ENSURE_REGISTERED (LrWpanEdtSelectionPolicy);
+NS_OBJECT_ENSURE_REGISTERED (LrWpanTopKEdtSelectionPolicy);
+NS_OBJECT_ENSURE_REGISTERED (LrWpanPhaseAlignedEdtSelectionPolicy);
+
+TypeId
+LrWpanEdtSelectionPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanEdtSelectionPolicy")
+    .SetParent<Object> ()
+    .SetGroupName ("LrWpan")
+    .AddAttribute ("CollectionWindow",
+                   "The time from the first report of an RFE to the "
+                   "selection of the answering EDTs",
+                   TimeValue (MicroSeconds (1)),
+                   MakeTimeAccessor (&LrWpanEdtSelectionPolicy::m_collectionWindow),
+                   MakeTimeChecker ())
+    .AddTraceSource ("Selection",
+                     "The EDTs answering an RFE have been selected",
+                     MakeTraceSourceAccessor (&LrWpanEdtSelectionPolicy::m_selectionTrace),
+                     "ns3::LrWpanEdtSelectionPolicy::SelectionTracedCallback")
+  ;
+  return tid;
+}
+
+LrWpanEdtSelectionPolicy::LrWpanEdtSelectionPolicy (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LrWpanEdtSelectionPolicy::~LrWpanEdtSelectionPolicy (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LrWpanEdtSelectionPolicy::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::map<Mac16Address, EventId>::iterator it = m_selectEvents.begin (); it != m_selectEvents.end (); it++)
+    {
+      it->second.Cancel ();
+    }
+  m_selectEvents.clear ();
+  m_candidates.clear ();
+  Object::DoDispose ();
+}
+
+void
+LrWpanEdtSelectionPolicy::AddCandidate (Mac16Address sensor, Mac16Address edtAddress, double rxPower,
+                                        uint8_t group, Time slotOffset, AnswerCallback answer)
+{
+  NS_LOG_FUNCTION (this << sensor << edtAddress << rxPower << static_cast<uint32_t> (group));
+
+  Candidate candidate;
+  candidate.m_edtAddress = edtAddress;
+  candidate.m_rxPower = rxPower;
+  candidate.m_group = group;
+  candidate.m_slotOffset = slotOffset;
+  candidate.m_answer = answer;
+  candidate.m_selected = false;
+  candidate.m_offset = Seconds (0);
+
+  std::vector<Candidate> &candidates = m_candidates[sensor];
+  for (std::vector<Candidate>::iterator it = candidates.begin (); it != candidates.end (); it++)
+    {
+      if (it->m_edtAddress == edtAddress)
+        {
+          *it = candidate;
+          return;
+        }
+    }
+  candidates.push_back (candidate);
+
+  if (!m_selectEvents[sensor].IsRunning ())
+    {
+      m_selectEvents[sensor] = Simulator::Schedule (m_collectionWindow, &LrWpanEdtSelectionPolicy::Select, this, sensor);
+    }
+}
+
+void
+LrWpanEdtSelectionPolicy::Select (Mac16Address sensor)
+{
+  NS_LOG_FUNCTION (this << sensor);
+
+  std::vector<Candidate> candidates;
+  candidates.swap (m_candidates[sensor]);
+  m_candidates.erase (sensor);
+  m_selectEvents.erase (sensor);
+
+  DoSelect (candidates);
+
+  uint32_t selected = 0;
+  for (std::vector<Candidate>::iterator it = candidates.begin (); it != candidates.end (); it++)
+    {
+      if (it->m_selected)
+        {
+          NS_LOG_DEBUG ("EDT " << it->m_edtAddress << " answers " << sensor << " after " << it->m_offset.GetMicroSeconds () << " us");
+          selected++;
+          it->m_answer (sensor, it->m_offset);
+        }
+    }
+  m_selectionTrace (sensor, candidates.size (), selected);
+}
+
+TypeId
+LrWpanTopKEdtSelectionPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanTopKEdtSelectionPolicy")
+    .SetParent<LrWpanEdtSelectionPolicy> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<LrWpanTopKEdtSelectionPolicy> ()
+    .AddAttribute ("K",
+                   "The maximum number of EDTs answering an RFE",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&LrWpanTopKEdtSelectionPolicy::m_k),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+LrWpanTopKEdtSelectionPolicy::LrWpanTopKEdtSelectionPolicy (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LrWpanTopKEdtSelectionPolicy::~LrWpanTopKEdtSelectionPolicy (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+/**
+ * Order the candidates by decreasing received power.
+ */
+static bool
+IsStronger (const LrWpanEdtSelectionPolicy::Candidate *a, const LrWpanEdtSelectionPolicy::Candidate *b)
+{
+  return a->m_rxPower > b->m_rxPower;
+}
+
+void
+LrWpanTopKEdtSelectionPolicy::DoSelect (std::vector<Candidate> &candidates)
+{
+  std::vector<Candidate *> ranking;
+  for (std::vector<Candidate>::iterator it = candidates.begin (); it != candidates.end (); it++)
+    {
+      ranking.push_back (&(*it));
+    }
+  std::stable_sort (ranking.begin (), ranking.end (), IsStronger);
+
+  for (uint32_t i = 0; i < ranking.size () && i < m_k; i++)
+    {
+      ranking[i]->m_selected = true;
+      ranking[i]->m_offset = ranking[i]->m_slotOffset;
+    }
+}
+
+TypeId
+LrWpanPhaseAlignedEdtSelectionPolicy::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanPhaseAlignedEdtSelectionPolicy")
+    .SetParent<LrWpanEdtSelectionPolicy> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<LrWpanPhaseAlignedEdtSelectionPolicy> ()
+  ;
+  return tid;
+}
+
+LrWpanPhaseAlignedEdtSelectionPolicy::LrWpanPhaseAlignedEdtSelectionPolicy (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LrWpanPhaseAlignedEdtSelectionPolicy::~LrWpanPhaseAlignedEdtSelectionPolicy (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LrWpanPhaseAlignedEdtSelectionPolicy::DoSelect (std::vector<Candidate> &candidates)
+{
+  Candidate *strongest = 0;
+  bool aligned = false;
+  for (std::vector<Candidate>::iterator it = candidates.begin (); it != candidates.end (); it++)
+    {
+      if (it->m_group == 1)
+        {
+          it->m_selected = true;
+          it->m_offset = MicroSeconds (0);
+          aligned = true;
+        }
+      if (strongest == 0 || it->m_rxPower > strongest->m_rxPower)
+        {
+          strongest = &(*it);
+        }
+    }
+
+  if (!aligned && strongest != 0)
+    {
+      strongest->m_selected = true;
+      strongest->m_offset = strongest->m_slotOffset;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_EDT_SELECTION_POLICY_H
+#define LR_WPAN_EDT_SELECTION_POLICY_H
+
+#include <ns3/object.h>
+#include <ns3/callback.h>
+#include <ns3/nstime.h>
+#include <ns3/event-id.h>
+#include <ns3/traced-callback.h>
+#include <ns3/mac16-address.h>
+#include <map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief Select the energy transmitters answering an RFE.
+ *
+ * All EDTs of a scenario share one policy object, which stands for the
+ * coordination of the EDTs over their backhaul. Each EDT receiving an RFE
+ * reports itself as a candidate, with the received power of the RFE and its
+ * probe slot. After the collection window the policy selects a subset of
+ * the candidates and their start offsets; only the selected EDTs answer with
+ * a CFE and later send the energy pulse, the others stay silent.
+ */
+class LrWpanEdtSelectionPolicy : public Object
+{
+public:
+  /**
+   * Called with the RFE source and the start offset of the CFE of a
+   * selected EDT.
+   */
+  typedef Callback<void, Mac16Address, Time> AnswerCallback;
+
+  /**
+   * An EDT which received an RFE.
+   */
+  struct Candidate
+  {
+    Mac16Address m_edtAddress; //!< The address of the EDT
+    double m_rxPower;          //!< The received power of the RFE, in dBm
+    uint8_t m_group;           //!< The probe slot of the EDT, 1 if in phase with the sensor
+    Time m_slotOffset;         //!< The start offset of the probe slot of the EDT
+    AnswerCallback m_answer;   //!< Called if the EDT is selected
+    bool m_selected;           //!< Set by the selection
+    Time m_offset;             //!< The start offset of the CFE, set by the selection
+  };
+
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  LrWpanEdtSelectionPolicy (void);
+  virtual ~LrWpanEdtSelectionPolicy (void);
+
+  /**
+   * Report an EDT which received an RFE. The first report for a sensor
+   * starts its collection window, a repeated report of an EDT replaces the
+   * previous one.
+   *
+   * \param sensor the source of the RFE
+   * \param edtAddress the address of the EDT
+   * \param rxPower the received power of the RFE, in dBm
+   * \param group the probe slot of the EDT, 1 if in phase with the sensor
+   * \param slotOffset the start offset of the probe slot of the EDT
+   * \param answer called with the start offset of the CFE, if selected
+   */
+  void AddCandidate (Mac16Address sensor, Mac16Address edtAddress, double rxPower,
+                     uint8_t group, Time slotOffset, AnswerCallback answer);
+
+  /**
+   * TracedCallback signature for the selections.
+   *
+   * \param [in] sensor the source of the RFE
+   * \param [in] candidates the number of EDTs which received the RFE
+   * \param [in] selected the number of selected EDTs
+   */
+  typedef void (* SelectionTracedCallback)(Mac16Address sensor, uint32_t candidates, uint32_t selected);
+
+protected:
+  virtual void DoDispose (void);
+
+  /**
+   * Select the EDTs answering the RFE of a sensor, by setting m_selected and
+   * m_offset of the candidates.
+   *
+   * \param candidates the EDTs which received the RFE, none selected
+   */
+  virtual void DoSelect (std::vector<Candidate> &candidates) = 0;
+
+private:
+  /**
+   * End of the collection window of a sensor, select and answer.
+   *
+   * \param sensor the source of the RFE
+   */
+  void Select (Mac16Address sensor);
+
+  /**
+   * The time from the first report of an RFE to the selection.
+   */
+  Time m_collectionWindow;
+
+  /**
+   * The candidates, per RFE source.
+   */
+  std::map<Mac16Address, std::vector<Candidate> > m_candidates;
+
+  /**
+   * The pending selections, per RFE source.
+   */
+  std::map<Mac16Address, EventId> m_selectEvents;
+
+  /**
+   * The trace source fired at each selection.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Mac16Address, uint32_t, uint32_t> m_selectionTrace;
+};
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief Select the K EDTs with the strongest link to the sensor.
+ *
+ * The links are symmetric, so the received power of the RFE ranks the
+ * power the sensor harvests from each EDT. The selected EDTs keep their probe
+ * slot.
+ */
+class LrWpanTopKEdtSelectionPolicy : public LrWpanEdtSelectionPolicy
+{
+public:
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  LrWpanTopKEdtSelectionPolicy (void);
+  virtual ~LrWpanTopKEdtSelectionPolicy (void);
+
+protected:
+  virtual void DoSelect (std::vector<Candidate> &candidates);
+
+private:
+  /**
+   * The maximum number of selected EDTs.
+   */
+  uint32_t m_k;
+};
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief Select the EDTs in phase with the sensor.
+ *
+ * The EDTs of the probe slot 1 add up constructively at the sensor, they
+ * all start at the same time. If no EDT is in phase, the strongest one is
+ * selected alone.
+ */
+class LrWpanPhaseAlignedEdtSelectionPolicy : public LrWpanEdtSelectionPolicy
+{
+public:
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  LrWpanPhaseAlignedEdtSelectionPolicy (void);
+  virtual ~LrWpanPhaseAlignedEdtSelectionPolicy (void);
+
+protected:
+  virtual void DoSelect (std::vector<Candidate> &candidates);
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_EDT_SELECTION_POLICY_H */
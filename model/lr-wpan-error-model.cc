@@ -19,6 +19,7 @@
  */
 #include "lr-wpan-error-model.h"
 #include <ns3/log.h>
+#include <ns3/boolean.h>
 
 #include <cmath>
 
@@ -28,6 +29,17 @@ NS_LOG_COMPONENT_DEFINE ("LrWpanErrorModel");
 
 NS_OBJECT_ENSURE_REGISTERED (LrWpanErrorModel);
 
+/**
+ * The number of steps of the BER table.
+ */
+static const uint32_t BER_TABLE_STEPS = 1000;
+
+/**
+ * The largest SNR (power ratio) of the BER table. The BER is below 1e-21
+ * at this SNR, and decays exponentially beyond.
+ */
+static const double BER_TABLE_MAX_SNR = 5.0;
+
 TypeId
 LrWpanErrorModel::GetTypeId (void)
 {
@@ -35,11 +47,18 @@ LrWpanErrorModel::GetTypeId (void)
     .SetParent<Object> ()
     .SetGroupName ("LrWpan")
     .AddConstructor<LrWpanErrorModel> ()
+    .AddAttribute ("Tabulated",
+                   "If true, interpolate the BER from a precomputed table "
+                   "instead of evaluating the exact model.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LrWpanErrorModel::m_tabulated),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
 
 LrWpanErrorModel::LrWpanErrorModel (void)
+  : m_tabulated (false)
 {
   m_binomialCoefficients[0]  = 1;
   m_binomialCoefficients[1]  = -16;
@@ -62,6 +81,20 @@ LrWpanErrorModel::LrWpanErrorModel (void)
 
 double
 LrWpanErrorModel::GetChunkSuccessRate (double snr, uint32_t nbits) const
+{
+  if (m_tabulated)
+    {
+      double ber = GetTabulatedBer (snr);
+      return exp (nbits * log1p (-ber));
+    }
+
+  double ber = GetExactBer (snr);
+  double retval = pow (1.0 - ber, nbits);
+  return retval;
+}
+
+double
+LrWpanErrorModel::GetExactBer (double snr) const
 {
   double ber = 0.0;
 
@@ -72,9 +105,38 @@ LrWpanErrorModel::GetChunkSuccessRate (double snr, uint32_t nbits) const
 
   ber = ber * 8.0 / 15.0 / 16.0;
 
-  ber = std::min (ber, 1.0);
-  double retval = pow (1.0 - ber, nbits);
-  return retval;
+  return std::min (ber, 1.0);
+}
+
+double
+LrWpanErrorModel::GetTabulatedBer (double snr) const
+{
+  const std::vector<double> &table = GetLogBerTable ();
+
+  // Find the table segment, the last one is used for extrapolation.
+  double x = std::max (snr, 0.0) * BER_TABLE_STEPS / BER_TABLE_MAX_SNR;
+  uint32_t i = std::min (static_cast<uint32_t> (std::min (x, static_cast<double> (BER_TABLE_STEPS))),
+                         BER_TABLE_STEPS - 1);
+  double logBer = table[i] + (table[i + 1] - table[i]) * (x - i);
+
+  // Never exceed the BER of the exact model at SNR 0.
+  return std::min (exp (logBer), 0.5);
+}
+
+const std::vector<double> &
+LrWpanErrorModel::GetLogBerTable (void) const
+{
+  static std::vector<double> table;
+
+  if (table.empty ())
+    {
+      table.resize (BER_TABLE_STEPS + 1);
+      for (uint32_t i = 0; i <= BER_TABLE_STEPS; i++)
+        {
+          table[i] = log (GetExactBer (i * BER_TABLE_MAX_SNR / BER_TABLE_STEPS));
+        }
+    }
+  return table;
 }
 
 } // namespace ns3
@@ -21,6 +21,7 @@
 #define LR_WPAN_ERROR_MODEL_H
 
 #include <ns3/object.h>
+#include <vector>
 
 namespace ns3 {
 
@@ -30,6 +31,15 @@ namespace ns3 {
  * Model the error rate for IEEE 802.15.4 2.4 GHz AWGN channel for OQPSK
  * the model description can be found in IEEE Std 802.15.4-2006, section
  * E.4.1.7
+ *
+ * If the Tabulated attribute is set, the BER is not evaluated exactly, but
+ * interpolated from a table which is computed once for all instances. The
+ * table covers SNRs (power ratio) from 0 to 5 in 1000 equally spaced steps,
+ * and the logarithm of the BER is linearly interpolated in between, or
+ * extrapolated beyond. Within this grid, the interpolated BER deviates from
+ * the exact BER by less than 0.01% (relative), and the returned chunk
+ * success rate deviates by less than 5e-5 (absolute), for chunks of up to
+ * 8192 bits.
  */
 class LrWpanErrorModel : public Object
 {
@@ -53,6 +63,35 @@ public:
   double GetChunkSuccessRate (double snr, uint32_t nbits) const;
 
 private:
+  /**
+   * Compute the exact BER for the given SNR.
+   *
+   * \param snr SNR expressed as a power ratio (i.e. not in dB)
+   * \return the BER
+   */
+  double GetExactBer (double snr) const;
+
+  /**
+   * Interpolate the BER for the given SNR from the BER table.
+   *
+   * \param snr SNR expressed as a power ratio (i.e. not in dB)
+   * \return the BER
+   */
+  double GetTabulatedBer (double snr) const;
+
+  /**
+   * Get the table of the natural logarithm of the BER, at equally spaced SNR
+   * values. The table is computed on first use and shared by all instances.
+   *
+   * \return the BER table
+   */
+  const std::vector<double> &GetLogBerTable (void) const;
+
+  /**
+   * Use the BER table instead of the exact BER computation.
+   */
+  bool m_tabulated;
+
   /**
    * Array of precalculated binomial coefficients.
    */
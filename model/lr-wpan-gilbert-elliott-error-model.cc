@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-gilbert-elliott-error-model.h"
+#include <ns3/log.h>
+#include <ns3/double.h>
+#include <ns3/packet.h>
+#include <ns3/random-variable-stream.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LrWpanGilbertElliottErrorModel");
+
+NS_OBJECT_ENSURE_REGISTERED (LrWpanGilbertElliottErrorModel);
+
+TypeId
+LrWpanGilbertElliottErrorModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanGilbertElliottErrorModel")
+    .SetParent<ErrorModel> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<LrWpanGilbertElliottErrorModel> ()
+    .AddAttribute ("GoodToBad",
+                   "The probability of a transition from the good to the bad "
+                   "state after a packet",
+                   DoubleValue (0.01),
+                   MakeDoubleAccessor (&LrWpanGilbertElliottErrorModel::m_goodToBad),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("BadToGood",
+                   "The probability of a transition from the bad to the good "
+                   "state after a packet",
+                   DoubleValue (0.1),
+                   MakeDoubleAccessor (&LrWpanGilbertElliottErrorModel::m_badToGood),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("GoodLossRate",
+                   "The packet loss rate in the good state",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&LrWpanGilbertElliottErrorModel::m_goodLossRate),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("BadLossRate",
+                   "The packet loss rate in the bad state",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&LrWpanGilbertElliottErrorModel::m_badLossRate),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+  ;
+  return tid;
+}
+
+LrWpanGilbertElliottErrorModel::LrWpanGilbertElliottErrorModel (void)
+  : m_bad (false)
+{
+  NS_LOG_FUNCTION (this);
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+LrWpanGilbertElliottErrorModel::~LrWpanGilbertElliottErrorModel (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+bool
+LrWpanGilbertElliottErrorModel::IsBad (void) const
+{
+  return m_bad;
+}
+
+int64_t
+LrWpanGilbertElliottErrorModel::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_random->SetStream (stream);
+  return 1;
+}
+
+bool
+LrWpanGilbertElliottErrorModel::DoCorrupt (Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (this << p);
+
+  bool corrupt = m_random->GetValue () < (m_bad ? m_badLossRate : m_goodLossRate);
+  if (m_random->GetValue () < (m_bad ? m_badToGood : m_goodToBad))
+    {
+      m_bad = !m_bad;
+      NS_LOG_DEBUG ("Channel now in the " << (m_bad ? "bad" : "good") << " state");
+    }
+  return corrupt;
+}
+
+void
+LrWpanGilbertElliottErrorModel::DoReset (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_bad = false;
+}
+
+} // namespace ns3
@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_GILBERT_ELLIOTT_ERROR_MODEL_H
+#define LR_WPAN_GILBERT_ELLIOTT_ERROR_MODEL_H
+
+#include <ns3/error-model.h>
+
+namespace ns3 {
+
+class UniformRandomVariable;
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief A two-state Gilbert-Elliott packet loss model.
+ *
+ * The channel is either in the good or in the bad state. Each packet is lost
+ * with the loss rate of the current state, then the channel changes state
+ * with the transition probability of the current state. With the default
+ * values the losses come in bursts, with a mean length of 1 / BadToGood
+ * packets.
+ */
+class LrWpanGilbertElliottErrorModel : public ErrorModel
+{
+public:
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  LrWpanGilbertElliottErrorModel (void);
+  virtual ~LrWpanGilbertElliottErrorModel (void);
+
+  /**
+   * \return true, if the channel is in the bad state
+   */
+  bool IsBad (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variable
+   * used by this model.  Return the number of streams (possibly zero) that
+   * have been assigned.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+private:
+  // Inherited from ErrorModel.
+  virtual bool DoCorrupt (Ptr<Packet> p);
+  virtual void DoReset (void);
+
+  /**
+   * The probability of a transition from the good to the bad state.
+   */
+  double m_goodToBad;
+
+  /**
+   * The probability of a transition from the bad to the good state.
+   */
+  double m_badToGood;
+
+  /**
+   * The packet loss rate in the good state.
+   */
+  double m_goodLossRate;
+
+  /**
+   * The packet loss rate in the bad state.
+   */
+  double m_badLossRate;
+
+  /**
+   * True, if the channel is in the bad state.
+   */
+  bool m_bad;
+
+  /**
+   * The random variable for the losses and the state transitions.
+   */
+  Ptr<UniformRandomVariable> m_random;
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_GILBERT_ELLIOTT_ERROR_MODEL_H */
@@ -21,23 +21,29 @@
 #include "lr-wpan-interference-helper.h"
 #include <ns3/spectrum-value.h>
 #include <ns3/spectrum-model.h>
+#include <ns3/simulator.h>
 #include <ns3/log.h>
 
+#include <algorithm>
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("LrWpanInterferenceHelper");
 
 LrWpanInterferenceHelper::LrWpanInterferenceHelper (Ptr<const SpectrumModel> spectrumModel)
-  : m_spectrumModel (spectrumModel),
-    m_dirty (false)
+  : m_spectrumModel (spectrumModel)
 {
-  m_signal = Create<SpectrumValue> (m_spectrumModel);
+  for (uint32_t i = 0; i < NUM_CHANNELS; i++)
+    {
+      m_channelPsd[i] = LrWpanChannelPsd (i + 11);
+      m_channelSignals[i] = 0;
+    }
+  ResetSignalEnergy ();
 }
 
 LrWpanInterferenceHelper::~LrWpanInterferenceHelper (void)
 {
   m_spectrumModel = 0;
-  m_signal = 0;
   m_signals.clear ();
 }
 
@@ -46,14 +52,22 @@ LrWpanInterferenceHelper::AddSignal (Ptr<const SpectrumValue> signal)
 {
   NS_LOG_FUNCTION (this << signal);
 
+  return AddSignal (signal, LrWpanChannelPsd ());
+}
+
+bool
+LrWpanInterferenceHelper::AddSignal (Ptr<const SpectrumValue> signal, const LrWpanChannelPsd &compact)
+{
+  NS_LOG_FUNCTION (this << signal << compact.GetChannel ());
+
   bool result = false;
 
   if (signal->GetSpectrumModel () == m_spectrumModel)
     {
-      result = m_signals.insert (signal).second;
-      if (result && !m_dirty)
+      result = m_signals.insert (std::make_pair (signal, compact)).second;
+      if (result)
         {
-          *m_signal += *signal;
+          UpdateChannelPsd (signal, compact, true);
         }
     }
   return result;
@@ -68,10 +82,12 @@ LrWpanInterferenceHelper::RemoveSignal (Ptr<const SpectrumValue> signal)
 
   if (signal->GetSpectrumModel () == m_spectrumModel)
     {
-      result = (m_signals.erase (signal) == 1);
-      if (result)
+      std::map<Ptr<const SpectrumValue>, LrWpanChannelPsd>::iterator it = m_signals.find (signal);
+      if (it != m_signals.end ())
         {
-          m_dirty = true;
+          result = true;
+          UpdateChannelPsd (signal, it->second, false);
+          m_signals.erase (it);
         }
     }
   return result;
@@ -83,7 +99,57 @@ LrWpanInterferenceHelper::ClearSignals (void)
   NS_LOG_FUNCTION (this);
 
   m_signals.clear ();
-  m_dirty = true;
+  for (uint32_t i = 0; i < NUM_CHANNELS; i++)
+    {
+      IntegrateChannelEnergy (i);
+      m_channelPsd[i].Clear ();
+      m_channelSignals[i] = 0;
+    }
+}
+
+void
+LrWpanInterferenceHelper::UpdateChannelPsd (Ptr<const SpectrumValue> signal, const LrWpanChannelPsd &compact, bool add)
+{
+  uint32_t first = 0;
+  uint32_t last = NUM_CHANNELS;
+  if (compact.GetChannel () != 0)
+    {
+      first = compact.GetChannel () - 11;
+      last = first + 1;
+    }
+
+  for (uint32_t i = first; i < last; i++)
+    {
+      IntegrateChannelEnergy (i);
+      if (add)
+        {
+          m_channelSignals[i]++;
+          if (compact.GetChannel () != 0)
+            {
+              m_channelPsd[i] += compact;
+            }
+          else
+            {
+              m_channelPsd[i] += LrWpanChannelPsd::FromSpectrumValue (signal, i + 11);
+            }
+        }
+      else
+        {
+          NS_ASSERT (m_channelSignals[i] > 0);
+          if (--m_channelSignals[i] == 0)
+            {
+              m_channelPsd[i].Clear ();
+            }
+          else if (compact.GetChannel () != 0)
+            {
+              m_channelPsd[i] -= compact;
+            }
+          else
+            {
+              m_channelPsd[i] -= LrWpanChannelPsd::FromSpectrumValue (signal, i + 11);
+            }
+        }
+    }
 }
 
 Ptr<SpectrumValue>
@@ -91,19 +157,55 @@ LrWpanInterferenceHelper::GetSignalPsd (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_dirty)
+  // The Phy only uses the per-channel sums, so the full sum is computed on
+  // demand instead of being kept up to date.
+  Ptr<SpectrumValue> signal = Create<SpectrumValue> (m_spectrumModel);
+  std::map<Ptr<const SpectrumValue>, LrWpanChannelPsd>::const_iterator it;
+  for (it = m_signals.begin (); it != m_signals.end (); ++it)
     {
-      // Sum up the current interference PSD.
-      std::set<Ptr<const SpectrumValue> >::const_iterator it;
-      m_signal = Create<SpectrumValue> (m_spectrumModel);
-      for (it = m_signals.begin (); it != m_signals.end (); ++it)
-        {
-          *m_signal += *(*it);
-        }
-      m_dirty = false;
+      *signal += *(it->first);
     }
+  return signal;
+}
+
+double
+LrWpanInterferenceHelper::GetSignalPower (uint32_t channel) const
+{
+  NS_LOG_FUNCTION (this << channel);
+  NS_ASSERT_MSG ((channel >= 11 && channel <= 26), "Invalid channel numbers");
+
+  return std::max (m_channelPsd[channel - 11].TotalAvgPower (), 0.0);
+}
+
+void
+LrWpanInterferenceHelper::IntegrateChannelEnergy (uint32_t index)
+{
+  Time now = Simulator::Now ();
+  m_channelEnergy[index] += std::max (m_channelPsd[index].TotalAvgPower (), 0.0) * (now - m_channelEnergyUpdate[index]).GetSeconds ();
+  m_channelEnergyUpdate[index] = now;
+}
+
+void
+LrWpanInterferenceHelper::ResetSignalEnergy (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time now = Simulator::Now ();
+  for (uint32_t i = 0; i < NUM_CHANNELS; i++)
+    {
+      m_channelEnergy[i] = 0.0;
+      m_channelEnergyUpdate[i] = now;
+    }
+}
+
+double
+LrWpanInterferenceHelper::GetSignalEnergy (uint32_t channel) const
+{
+  NS_LOG_FUNCTION (this << channel);
+  NS_ASSERT_MSG ((channel >= 11 && channel <= 26), "Invalid channel numbers");
 
-  return m_signal->Copy ();
+  uint32_t index = channel - 11;
+  return m_channelEnergy[index] + GetSignalPower (channel) * (Simulator::Now () - m_channelEnergyUpdate[index]).GetSeconds ();
 }
 
 }
@@ -21,9 +21,11 @@
 #ifndef LR_WPAN_INTERFERENCE_HELPER_H
 #define LR_WPAN_INTERFERENCE_HELPER_H
 
+#include "lr-wpan-channel-psd.h"
 #include <ns3/simple-ref-count.h>
 #include <ns3/ptr.h>
-#include <set>
+#include <ns3/nstime.h>
+#include <map>
 
 namespace ns3 {
 
@@ -58,6 +60,19 @@ public:
    */
   bool AddSignal (Ptr<const SpectrumValue> signal);
 
+  /**
+   * Add the given signal to the set of accumulated signals, using its compact
+   * representation for the per-channel sums. Only the band of the channel of
+   * the compact PSD is accounted for, so use this for signals created by
+   * LrWpanSpectrumValueHelper only.
+   *
+   * \param signal the signal to be added
+   * \param compact the compact PSD of the signal
+   * \return false, if the signal was not added because the SpectrumModel of the
+   * signal does not match the one of the helper, true otherwise.
+   */
+  bool AddSignal (Ptr<const SpectrumValue> signal, const LrWpanChannelPsd &compact);
+
   /**
    * Remove the given signal to the set of accumulated signals.
    *
@@ -73,12 +88,41 @@ public:
   void ClearSignals (void);
 
   /**
-   * Get the sum of all accumulated signals.
+   * Get the sum of all accumulated signals, computed at each call.
    *
    * \return the sum of the signals
    */
   Ptr<SpectrumValue> GetSignalPsd (void) const;
 
+  /**
+   * Get the total power of all accumulated signals within the band of the
+   * given IEEE 802.15.4 channel. The per-channel sums are updated
+   * incrementally whenever a signal is added or removed, so this is a
+   * constant time lookup which does not allocate a SpectrumValue.
+   *
+   * \param channel the channel number per IEEE 802.15.4 (11-26)
+   * \return the in-band power of the accumulated signals in W
+   */
+  double GetSignalPower (uint32_t channel) const;
+
+  /**
+   * Restart the energy integration of all channels at the current simulation
+   * time.
+   */
+  void ResetSignalEnergy (void);
+
+  /**
+   * Get the energy of all accumulated signals within the band of the given
+   * IEEE 802.15.4 channel, i.e. the in-band power integrated over time since
+   * the last call of ResetSignalEnergy, or since the creation of the helper.
+   * The integral is advanced piecewise whenever a signal is added or
+   * removed, so this is a constant time lookup.
+   *
+   * \param channel the channel number per IEEE 802.15.4 (11-26)
+   * \return the in-band energy of the accumulated signals in J
+   */
+  double GetSignalEnergy (uint32_t channel) const;
+
   /**
    * Get the SpectrumModel used by the helper.
    *
@@ -102,20 +146,57 @@ private:
   Ptr<const SpectrumModel> m_spectrumModel;
 
   /**
-   * The set of accumulated signals.
+   * Add or subtract a signal to or from the per-channel sums.
+   *
+   * \param signal the signal
+   * \param compact the compact PSD of the signal, or a PSD not anchored to any
+   * channel, if the signal has to be accounted for in all channels
+   * \param add true to add the signal, false to subtract it
+   */
+  void UpdateChannelPsd (Ptr<const SpectrumValue> signal, const LrWpanChannelPsd &compact, bool add);
+
+  /**
+   * Advance the energy integral of a channel to the current simulation time,
+   * using the current in-band power.
+   *
+   * \param index the index of the channel, 0 corresponding to channel 11
+   */
+  void IntegrateChannelEnergy (uint32_t index);
+
+  /**
+   * The accumulated signals, mapped to their compact PSD. Signals added
+   * without a compact PSD map to a PSD not anchored to any channel.
+   */
+  std::map<Ptr<const SpectrumValue>, LrWpanChannelPsd> m_signals;
+
+  /**
+   * The number of 2.4 GHz channels (11-26) tracked by the per-channel sums.
+   */
+  static const uint32_t NUM_CHANNELS = 16;
+
+  /**
+   * The running sum of all accumulated signals, per 2.4 GHz channel. Index 0
+   * corresponds to channel 11.
+   */
+  LrWpanChannelPsd m_channelPsd[NUM_CHANNELS];
+
+  /**
+   * The number of accumulated signals contributing to each of the per-channel
+   * sums. A sum is reset to exact zero once no signal contributes anymore, so
+   * rounding errors of the incremental updates do not accumulate over time.
    */
-  std::set<Ptr<const SpectrumValue> > m_signals;
+  uint32_t m_channelSignals[NUM_CHANNELS];
 
   /**
-   * The precomputed sum of all accumulated signals.
+   * The in-band energy of the accumulated signals per channel, integrated up
+   * to m_channelEnergyUpdate.
    */
-  mutable Ptr<SpectrumValue> m_signal;
+  double m_channelEnergy[NUM_CHANNELS];
 
   /**
-   * Mark m_signal as dirty, whenever a signal is added or removed. m_signal has
-   * to be recomputed before next use.
+   * The time up to which the energy of each channel is integrated.
    */
-  mutable bool m_dirty;
+  Time m_channelEnergyUpdate[NUM_CHANNELS];
 };
 
 }
@@ -157,6 +157,18 @@ LrWpanMacHeader::IsAckReq (void) const
   return (m_fctrlAckReq == 1);
 }
 
+bool
+LrWpanMacHeader::IsAggregate (void) const
+{
+  return ((m_fctrlReserved & 0x01) == 1);
+}
+
+bool
+LrWpanMacHeader::IsBlockAck (void) const
+{
+  return ((m_fctrlReserved & 0x02) == 0x02);
+}
+
 bool
 LrWpanMacHeader::IsPanIdComp (void) const
 {
@@ -416,6 +428,34 @@ LrWpanMacHeader::SetNoAckReq (void)
 }
 
 
+void
+LrWpanMacHeader::SetAggregate (void)
+{
+  m_fctrlReserved |= 0x01;
+}
+
+
+void
+LrWpanMacHeader::SetNoAggregate (void)
+{
+  m_fctrlReserved &= ~0x01;
+}
+
+
+void
+LrWpanMacHeader::SetBlockAck (void)
+{
+  m_fctrlReserved |= 0x02;
+}
+
+
+void
+LrWpanMacHeader::SetNoBlockAck (void)
+{
+  m_fctrlReserved &= ~0x02;
+}
+
+
 void
 LrWpanMacHeader::SetPanIdComp (void)
 {
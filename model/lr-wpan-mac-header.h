@@ -146,6 +146,21 @@ public:
    */
   bool IsAckReq (void) const;
 
+  /**
+   * Check if the frame carries several aggregated MSDUs, which is signaled by
+   * the first of the reserved bits of Frame Control (bit 7)
+   * \return true if the frame is an aggregate
+   */
+  bool IsAggregate (void) const;
+
+  /**
+   * Check if the frame belongs to a burst acknowledged by a block ACK, or is
+   * a block ACK, which is signaled by the second of the reserved bits of Frame
+   * Control (bit 8)
+   * \return true if the block ACK bit is enabled
+   */
+  bool IsBlockAck (void) const;
+
   /**
    * Check if PAN ID Compression bit of Frame Control is enabled
    * \return true if PAN ID Compression bit is enabled
@@ -327,6 +342,26 @@ public:
    */
   void SetNoAckReq (void);
 
+  /**
+   * Set the Frame Control field aggregate bit (bit 7) to true
+   */
+  void SetAggregate (void);
+
+  /**
+   * Set the Frame Control field aggregate bit (bit 7) to false
+   */
+  void SetNoAggregate (void);
+
+  /**
+   * Set the Frame Control field block ACK bit (bit 8) to true
+   */
+  void SetBlockAck (void);
+
+  /**
+   * Set the Frame Control field block ACK bit (bit 8) to false
+   */
+  void SetNoBlockAck (void);
+
   /**
    * Set the Frame Control field "PAN ID Compression" bit to true
    */
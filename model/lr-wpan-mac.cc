@@ -26,19 +26,35 @@
 #include "lr-wpan-csmaca.h"
 #include "lr-wpan-mac-header.h"
 #include "lr-wpan-mac-trailer.h"
+#include "lr-wpan-beacon-header.h"
+#include "lr-wpan-subframe-header.h"
+#include "lr-wpan-block-ack-header.h"
+#include "lr-wpan-gilbert-elliott-error-model.h"
+#include "lr-wpan-work-queue.h"
+#include "lr-wpan-edt-selection-policy.h"
 #include <ns3/simulator.h>
+#include <ns3/make-event.h>
 #include <ns3/log.h>
 #include <ns3/uinteger.h>
 #include <ns3/node.h>
 #include <ns3/packet.h>
 #include <ns3/random-variable-stream.h>
 #include <ns3/double.h>
+#include <ns3/enum.h>
+#include <ns3/pointer.h>
+#include <ns3/boolean.h>
+#include <ns3/error-model.h>
 
 #include <ns3/rng-seed-manager.h>
+#include <algorithm>
+#include <cmath>
 
 #include "rf-mac-type-tag.h"
 #include "rf-mac-duration-tag.h"
 #include "rf-mac-group-tag.h"
+#include "rf-mac-probe-tag.h"
+#include "rf-mac-requester-tag.h"
+#include "rf-mac-charge-request-tag.h"
 
 #undef NS_LOG_APPEND_CONTEXT
 #define NS_LOG_APPEND_CONTEXT                                   \
@@ -51,6 +67,7 @@ NS_LOG_COMPONENT_DEFINE ("LrWpanMac");
 NS_OBJECT_ENSURE_REGISTERED (LrWpanMac);
 
 const uint32_t LrWpanMac::aMinMPDUOverhead = 9; // Table 85
+const uint32_t LrWpanMac::aMinCAPLength = 440; // Table 85
 
 TypeId
 LrWpanMac::GetTypeId (void)
@@ -63,6 +80,181 @@ LrWpanMac::GetTypeId (void)
                    UintegerValue (),
                    MakeUintegerAccessor (&LrWpanMac::m_macPanId),
                    MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("MaxQueueSize",
+                   "The maximum number of packets in the transmission queue "
+                   "of each traffic class",
+                   UintegerValue (32),
+                   MakeUintegerAccessor (&LrWpanMac::SetMaxQueueSize,
+                                         &LrWpanMac::GetMaxQueueSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("QueueDropPolicy",
+                   "The packet dropped when a packet is enqueued in the full "
+                   "transmission queue of its traffic class: the new one, or "
+                   "the oldest waiting one of the class. The packet currently "
+                   "being sent is never dropped.",
+                   EnumValue (TX_QUEUE_TAIL_DROP),
+                   MakeEnumAccessor (&LrWpanMac::m_txQueueDropPolicy),
+                   MakeEnumChecker (TX_QUEUE_TAIL_DROP, "TailDrop",
+                                    TX_QUEUE_HEAD_DROP, "HeadDrop"))
+    .AddAttribute ("QueueScheduling",
+                   "The scheduling among the transmission queues of the "
+                   "traffic classes: strict priority of energy requests over "
+                   "acknowledged data over best-effort data, or weighted round "
+                   "robin.",
+                   EnumValue (TX_QUEUE_STRICT_PRIORITY),
+                   MakeEnumAccessor (&LrWpanMac::m_txQueueScheduling),
+                   MakeEnumChecker (TX_QUEUE_STRICT_PRIORITY, "StrictPriority",
+                                    TX_QUEUE_WEIGHTED_ROUND_ROBIN, "WeightedRoundRobin"))
+    .AddAttribute ("EnergyQueueWeight",
+                   "The number of packets sent in a round from the queue of "
+                   "the energy requests, with weighted round robin scheduling",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&LrWpanMac::m_energyQueueWeight),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("AckDataQueueWeight",
+                   "The number of packets sent in a round from the queue of "
+                   "the acknowledged data, with weighted round robin scheduling",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&LrWpanMac::m_ackDataQueueWeight),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("BestEffortQueueWeight",
+                   "The number of packets sent in a round from the queue of "
+                   "the best-effort data, with weighted round robin scheduling",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&LrWpanMac::m_bestEffortQueueWeight),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("Aggregation",
+                   "Aggregate the data packets queued for the same destination "
+                   "in one frame, as long as it fits in a PSDU",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LrWpanMac::m_aggregation),
+                   MakeBooleanChecker ())
+    .AddAttribute ("MaxBurstSize",
+                   "The maximum number of acknowledged data frames to the same "
+                   "destination sent back to back after a single channel "
+                   "access, and acknowledged by a single block ACK. 1 disables "
+                   "the bursts.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&LrWpanMac::m_maxBurstSize),
+                   MakeUintegerChecker<uint32_t> (1, LrWpanBlockAckHeader::BITMAP_SIZE))
+    .AddAttribute ("DirectDispatch",
+                   "Run the zero-delay MAC state changes issued from a PHY or "
+                   "MAC handler when the handler returns, instead of "
+                   "scheduling an event for each of them. The state changes "
+                   "then run before the other events scheduled for the same "
+                   "time, which may change the order of simultaneous events",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LrWpanMac::m_directDispatch),
+                   MakeBooleanChecker ())
+    .AddAttribute ("DutyCycle",
+                   "Only enable the receiver of the idle MAC during periodic "
+                   "listen windows, and strobe the data frames for a wakeup "
+                   "interval. Read when the MAC is initialized.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LrWpanMac::m_dutyCycle),
+                   MakeBooleanChecker ())
+    .AddAttribute ("WakeupInterval",
+                   "The interval between the starts of two listen windows, "
+                   "with duty cycling",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&LrWpanMac::m_wakeupInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("ListenWindow",
+                   "The duration of a listen window, with duty cycling. It "
+                   "has to be longer than a strobed frame and its ACK wait "
+                   "duration.",
+                   TimeValue (MilliSeconds (10)),
+                   MakeTimeAccessor (&LrWpanMac::m_listenWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("BeaconOrder",
+                   "The beacon order of the PAN coordinated by this MAC. "
+                   "Below 15, the MAC sends a beacon every "
+                   "aBaseSuperframeDuration * 2^BeaconOrder symbols. The "
+                   "other devices follow the beacons they receive. Read when "
+                   "the MAC is initialized.",
+                   UintegerValue (15),
+                   MakeUintegerAccessor (&LrWpanMac::m_macBeaconOrder),
+                   MakeUintegerChecker<uint64_t> (0, 15))
+    .AddAttribute ("SuperframeOrder",
+                   "The superframe order of the PAN coordinated by this MAC, "
+                   "at most the beacon order. The active portion of the "
+                   "superframe lasts aBaseSuperframeDuration * "
+                   "2^SuperframeOrder symbols.",
+                   UintegerValue (15),
+                   MakeUintegerAccessor (&LrWpanMac::m_macSuperframeOrder),
+                   MakeUintegerChecker<uint64_t> (0, 15))
+    .AddAttribute ("MaxPendingTransactions",
+                   "The maximum number of transactions pending for indirect "
+                   "transmission, for all destinations. A new transaction is "
+                   "dropped when the limit is reached.",
+                   UintegerValue (128),
+                   MakeUintegerAccessor (&LrWpanMac::m_maxIndTxQueueSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("TransactionPersistenceTime",
+                   "The time a transaction is kept for indirect transmission, "
+                   "in unit periods of aBaseSuperframeDuration * 2^BeaconOrder "
+                   "symbols (aBaseSuperframeDuration symbols without beacons).",
+                   UintegerValue (0x01f4),
+                   MakeUintegerAccessor (&LrWpanMac::m_macTransactionPersistenceTime),
+                   MakeUintegerChecker<uint64_t> (0, 0xffff))
+    .AddAttribute ("ProbeSlots",
+                   "The number of probe slots of the CFEs of an EDT. The "
+                   "EDTs probe in the slot of their phase to the sensor.",
+                   UintegerValue (2),
+                   MakeUintegerAccessor (&LrWpanMac::m_probeSlots),
+                   MakeUintegerChecker<uint8_t> (2, RfMacProbeTag::MAX_SLOTS))
+    .AddAttribute ("ProbeSlotDuration",
+                   "The duration of a probe slot, and of a CFE, of an EDT.",
+                   TimeValue (MicroSeconds (10)),
+                   MakeTimeAccessor (&LrWpanMac::m_probeSlotDuration),
+                   MakeTimeChecker ())
+    .AddAttribute ("ProbeSlotThreshold",
+                   "The fraction of the power of the strongest probe slot "
+                   "below which a sensor does not ask the EDTs of a slot for "
+                   "the energy pulse. All probed EDTs send the pulse with 0.",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&LrWpanMac::m_probeSlotThreshold),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("RfeAggregationWindow",
+                   "The time an EDT collects RFEs before answering them with "
+                   "one multicast CFE and one energy pulse. Each RFE is "
+                   "answered on its own with 0.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&LrWpanMac::m_rfeAggregationWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("ChargingTimePercentile",
+                   "The percentile of the charging times requested after a "
+                   "multicast CFE which sizes the energy pulse, 1 for the "
+                   "longest one.",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&LrWpanMac::m_chargingTimePercentile),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("ChargingCacheValidity",
+                   "The time a sensor asks an EDT it probed for the energy "
+                   "pulse right away, with the charging time predicted from "
+                   "the probed power. Every request is probed with 0.",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&LrWpanMac::m_chargingCacheValidity),
+                   MakeTimeChecker ())
+    .AddAttribute ("ChargingCacheDrift",
+                   "The relative deviation of the harvested power from the "
+                   "cached power of an EDT beyond which the EDT is probed "
+                   "again.",
+                   DoubleValue (0.2),
+                   MakeDoubleAccessor (&LrWpanMac::m_chargingCacheDrift),
+                   MakeDoubleChecker<double> (0.0))
+    .AddAttribute ("ReceiveErrorModel",
+                   "The error model deciding which received data frames are "
+                   "lost. No frame is lost without an error model.",
+                   PointerValue (),
+                   MakePointerAccessor (&LrWpanMac::m_receiveErrorModel),
+                   MakePointerChecker<ErrorModel> ())
+    .AddAttribute ("EdtSelectionPolicy",
+                   "The policy selecting the EDTs answering an RFE, shared "
+                   "by all EDTs. Every EDT answers without a policy.",
+                   PointerValue (),
+                   MakePointerAccessor (&LrWpanMac::m_edtSelectionPolicy),
+                   MakePointerChecker<LrWpanEdtSelectionPolicy> ())
     .AddTraceSource ("MacTxEnqueue",
                      "Trace source indicating a packet has been "
                      "enqueued in the transaction queue",
@@ -73,6 +265,38 @@ LrWpanMac::GetTypeId (void)
                      "dequeued from the transaction queue",
                      MakeTraceSourceAccessor (&LrWpanMac::m_macTxDequeueTrace),
                      "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacTxQueueOverflow",
+                     "Trace source indicating a packet has been "
+                     "dropped because the transaction queue was full",
+                     MakeTraceSourceAccessor (&LrWpanMac::m_macTxQueueOverflowTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("MacTxClassEnqueue",
+                     "Trace source indicating a packet has been "
+                     "enqueued in the transaction queue of a traffic class",
+                     MakeTraceSourceAccessor (&LrWpanMac::m_macTxClassEnqueueTrace),
+                     "ns3::LrWpanMac::TxClassTracedCallback")
+    .AddTraceSource ("MacTxClassDequeue",
+                     "Trace source indicating a packet has been "
+                     "dequeued from the transaction queue of a traffic class",
+                     MakeTraceSourceAccessor (&LrWpanMac::m_macTxClassDequeueTrace),
+                     "ns3::LrWpanMac::TxClassTracedCallback")
+    .AddTraceSource ("MacTxClassDrop",
+                     "Trace source indicating a packet of a traffic class "
+                     "has been dropped, because the transaction queue was "
+                     "full or its transmission failed",
+                     MakeTraceSourceAccessor (&LrWpanMac::m_macTxClassDropTrace),
+                     "ns3::LrWpanMac::TxClassTracedCallback")
+    .AddTraceSource ("RfMacChargeCycle",
+                     "Trace source indicating the end of an energy pulse "
+                     "requested by this sensor, with the harvested energy "
+                     "and the charging time",
+                     MakeTraceSourceAccessor (&LrWpanMac::m_rfMacChargeCycleTrace),
+                     "ns3::LrWpanMac::ChargeCycleTracedCallback")
+    .AddTraceSource ("RfMacEnergyTx",
+                     "Trace source indicating this EDT starts sending a CFE "
+                     "or an energy pulse, with its duration",
+                     MakeTraceSourceAccessor (&LrWpanMac::m_rfMacEnergyTxTrace),
+                     "ns3::LrWpanMac::EnergyTxTracedCallback")
     .AddTraceSource ("MacTx",
                      "Trace source indicating a packet has "
                      "arrived for transmission by this device",
@@ -150,6 +374,47 @@ LrWpanMac::LrWpanMac ()
   m_retransmission = 0;
   m_numCsmacaRetry = 0;
   m_txPkt = 0;
+  m_txMsdus = 1;
+  m_aggregation = false;
+  m_maxBurstSize = 1;
+  m_burst = false;
+  m_burstFrame = 0;
+  m_directDispatch = false;
+  m_dutyCycle = false;
+  m_wakeupInterval = MilliSeconds (100);
+  m_listenWindow = MilliSeconds (10);
+  m_awake = false;
+  m_wakeupRandom = CreateObject<UniformRandomVariable> ();
+  m_strobing = false;
+  m_lastRxSrcAddress = Mac16Address ("ff:ff");
+  m_lastRxSeqNum = 0;
+  m_aBaseSlotDuration = 60;
+  m_aNumSuperframeSlots = 16;
+  m_aBaseSuperframeDuration = m_aBaseSlotDuration * m_aNumSuperframeSlots;
+  m_macBeaconTxTime = 0;
+  m_macSyncSymbolOffset = 0;
+  m_macBeaconOrder = 15;
+  m_macSuperframeOrder = 15;
+  m_finalCapSlot = m_aNumSuperframeSlots - 1;
+  m_macBsn = 0;
+  m_coordinator = false;
+  m_gtsStartSlot = 0;
+  m_gtsLength = 0;
+  for (uint32_t i = 0; i < TX_QUEUE_CLASSES; i++)
+    {
+      m_txQueue[i].SetCapacity (32);
+      m_txQueueCredits[i] = 0;
+    }
+  m_maxQueueSize = 32;
+  m_energyQueueWeight = 4;
+  m_ackDataQueueWeight = 2;
+  m_bestEffortQueueWeight = 1;
+  m_txQueueDropPolicy = TX_QUEUE_TAIL_DROP;
+  m_indTxQueueSize = 0;
+  m_maxIndTxQueueSize = 128;
+  m_macTransactionPersistenceTime = 0x01f4;
+  m_txQueueScheduling = TX_QUEUE_STRICT_PRIORITY;
+  m_txClass = TX_CLASS_BEST_EFFORT;
 
   m_slotTimeOfData = MicroSeconds (20);
   m_slotTimeOfEnergy = MicroSeconds (10);
@@ -158,8 +423,10 @@ LrWpanMac::LrWpanMac ()
   m_difsOfData = MicroSeconds (50);
   m_difsOfEnergy = MicroSeconds (25);
 
-  m_receivedEnergyFromFirstSlot = 0.0;
-  m_receivedEnergyFromSecondSlot = 0.0;
+  m_probeSlot = 1;
+  m_chargingTime = Seconds (0);
+  m_cfeAckIndex = 0;
+  m_cachedEdt = Mac16Address ("ff:ff");
 
   Ptr<UniformRandomVariable> uniformVar = CreateObject<UniformRandomVariable> ();
   uniformVar->SetAttribute ("Min", DoubleValue (0.0));
@@ -176,13 +443,21 @@ LrWpanMac::~LrWpanMac ()
 void
 LrWpanMac::DoInitialize ()
 {
-  if (m_macRxOnWhenIdle)
+  if (m_dutyCycle)
     {
-      m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
+      // Spread the listen windows of the devices over the wakeup interval.
+      Time phase = Seconds (m_wakeupRandom->GetValue (0.0, m_wakeupInterval.GetSeconds ()));
+      m_wakeupEvent = Simulator::Schedule (phase, &LrWpanMac::Wakeup, this);
     }
-  else
+  m_phy->PlmeSetTRXStateRequest (GetIdleTrxState ());
+  if (m_macBeaconOrder < 15)
     {
-      m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TRX_OFF);
+      // This MAC coordinates a beacon-enabled PAN.
+      NS_ASSERT_MSG (m_macSuperframeOrder <= m_macBeaconOrder, "The superframe order exceeds the beacon order");
+      m_coordinator = true;
+      m_superframeStart = Simulator::Now ();
+      m_csmaCa->SetSlottedCsmaCa ();
+      m_beaconEvent = Simulator::ScheduleNow (&LrWpanMac::SendBeacon, this);
     }
 
   Object::DoInitialize ();
@@ -197,15 +472,35 @@ LrWpanMac::DoDispose ()
       m_csmaCa = 0;
     }
   m_txPkt = 0;
-  for (uint32_t i = 0; i < m_txQueue.size (); i++)
+  for (uint32_t i = 0; i < TX_QUEUE_CLASSES; i++)
     {
-      m_txQueue[i]->txQPkt = 0;
-      delete m_txQueue[i];
+      m_txQueue[i].Clear ();
     }
-  m_txQueue.clear ();
+  m_indTxQueue.clear ();
+  m_indTxQueueSize = 0;
   m_phy = 0;
+  m_receiveErrorModel = 0;
+  m_edtSelectionPolicy = 0;
+  CancelTransition ();
+  m_wakeupEvent.Cancel ();
+  m_sleepEvent.Cancel ();
+  m_cfeWaitTimeout.Cancel ();
+  m_rfeAggregationEvent.Cancel ();
+  m_cfeAckTimeout.Cancel ();
+  m_rfeRequesters.clear ();
+  m_rfeCandidates.clear ();
+  m_cfeRequesters.clear ();
+  m_energyWaitTimeout.Cancel ();
+  m_chargingCache.clear ();
+  m_probeEdts.clear ();
+  m_beaconEvent.Cancel ();
+  m_gtsEvent.Cancel ();
+  m_indTxExpiryEvent.Cancel ();
+  m_pollWaitTimeout.Cancel ();
+  m_wakeupRandom = 0;
   m_mcpsDataIndicationCallback = MakeNullCallback< void, McpsDataIndicationParams, Ptr<Packet> > ();
   m_mcpsDataConfirmCallback = MakeNullCallback< void, McpsDataConfirmParams > ();
+  m_mlmePollConfirmCallback = MakeNullCallback< void, MlmePollConfirmParams > ();
 
   Object::DoDispose ();
 }
@@ -224,14 +519,7 @@ LrWpanMac::SetRxOnWhenIdle (bool rxOnWhenIdle)
 
   if (m_lrWpanMacState == MAC_IDLE)
     {
-      if (m_macRxOnWhenIdle)
-        {
-          m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
-        }
-      else
-        {
-          m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TRX_OFF);
-        }
+      m_phy->PlmeSetTRXStateRequest (GetIdleTrxState ());
     }
 }
 
@@ -268,6 +556,7 @@ void
 LrWpanMac::McpsDataRequest (McpsDataRequestParams params, Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this << p);
+  LrWpanWorkQueue::Scope scope (m_workQueue);
 
   McpsDataConfirmParams confirmParams;
   confirmParams.m_msduHandle = params.m_msduHandle;
@@ -367,11 +656,21 @@ LrWpanMac::McpsDataRequest (McpsDataRequestParams params, Ptr<Packet> p)
     {
       if (b1 == TX_OPTION_GTS)
         {
-          //TODO:GTS Transmission
+          // The frame waits for the GTS of this device.
+          if (m_gtsLength == 0)
+            {
+              NS_LOG_ERROR (this << " no GTS allocated to this device");
+              confirmParams.m_status = IEEE_802_15_4_INVALID_GTS;
+              if (!m_mcpsDataConfirmCallback.IsNull ())
+                {
+                  m_mcpsDataConfirmCallback (confirmParams);
+                }
+              return;
+            }
         }
       else if (b1 == 0)
         {
-          //TODO:CAP Transmission
+          // The frame is sent in the CAP, after a slotted channel access.
         }
       else
         {
@@ -400,11 +699,11 @@ LrWpanMac::McpsDataRequest (McpsDataRequestParams params, Ptr<Packet> p)
 
   if (b2 == TX_OPTION_INDIRECT)
     {
-      //TODO :indirect tx
+      // The frame is kept until the destination polls for it.
     }
   else if (b2 == 0)
     {
-      //TODO :direct tx
+      // The frame is sent right away.
     }
   else
     {
@@ -432,189 +731,728 @@ LrWpanMac::McpsDataRequest (McpsDataRequestParams params, Ptr<Packet> p)
     }
   p->AddTrailer (macTrailer);
 
-  m_macTxEnqueueTrace (p);
+  if (b2 == TX_OPTION_INDIRECT)
+    {
+      EnqueueIndTxQElement (params.m_msduHandle, p);
+      return;
+    }
 
-  TxQueueElement *txQElement = new TxQueueElement;
-  txQElement->txQMsduHandle = params.m_msduHandle;
-  txQElement->txQPkt = p;
-  m_txQueue.push_back (txQElement);
+  LrWpanTxQueueClass txClass = macHdr.IsAckReq () ? TX_CLASS_ACK_DATA : TX_CLASS_BEST_EFFORT;
+  if (b1 == TX_OPTION_GTS)
+    {
+      txClass = TX_CLASS_GTS;
+    }
+  EnqueueTxQElement (txClass, params.m_msduHandle, p);
 
   CheckQueue ();
   // m_rfMacTimer = Simulator::Schedule (GetDifsOfData (), &LrWpanMac::CheckQueue, this);
 }
 
+void
+LrWpanMac::MlmePollRequest (MlmePollRequestParams params)
+{
+  NS_LOG_FUNCTION (this << params.m_coordShortAddr);
+  LrWpanWorkQueue::Scope scope (m_workQueue);
+
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_COMMAND, m_macDsn.GetValue ());
+  m_macDsn++;
+  macHdr.SetSrcAddrMode (SHORT_ADDR);
+  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
+  macHdr.SetDstAddrMode (SHORT_ADDR);
+  macHdr.SetDstAddrFields (params.m_coordPanId, params.m_coordShortAddr);
+  macHdr.SetSecDisable ();
+  macHdr.SetAckReq ();
+  m_pollCoordAddress = params.m_coordShortAddr;
+
+  uint8_t command = CMD_DATA_REQUEST;
+  Ptr<Packet> p = Create<Packet> (&command, 1);
+  // The data request goes through the same channel access as data.
+  RfMacTypeTag typeTag;
+  typeTag.Set (RfMacTypeTag::RF_MAC_DATA);
+  p->AddPacketTag (typeTag);
+  p->AddHeader (macHdr);
+
+  LrWpanMacTrailer macTrailer;
+  // Calculate FCS if the global attribute ChecksumEnable is set.
+  if (Node::ChecksumEnabled ())
+    {
+      macTrailer.EnableFcs (true);
+      macTrailer.SetFcs (p);
+    }
+  p->AddTrailer (macTrailer);
+
+  EnqueueTxQElement (TX_CLASS_ACK_DATA, 0, p);
+  CheckQueue ();
+}
+
 void
 LrWpanMac::CheckQueue ()
 {
-  NS_LOG_FUNCTION (this << !m_txQueue.empty () << " " << m_txPkt << " " <<!m_setMacState.IsRunning ());
+  NS_LOG_FUNCTION (this << m_txPkt << " " <<!IsTransitionPending ());
+  // During the GTS of this device, its frames are sent without a channel
+  // access. A GTS frame waiting for its retransmission is only sent there,
+  // and holds back the frames of the CAP until it is acknowledged or dropped.
+  if (m_lrWpanMacState == MAC_IDLE && !IsTransitionPending ()
+      && (m_txPkt == 0 || m_txClass == TX_CLASS_GTS) && SendGtsFrame ())
+    {
+      return;
+    }
   // Pull a packet from the queue and start sending, if we are not already sending.
-  if (m_lrWpanMacState == MAC_IDLE && !m_txQueue.empty () && m_txPkt == 0 && !m_setMacState.IsRunning ())
+  if (m_lrWpanMacState == MAC_IDLE && m_txPkt == 0 && !IsTransitionPending ()
+      && SelectTxClass ())
     {
-      TxQueueElement *txQElement = m_txQueue.front ();
-      m_txPkt = txQElement->txQPkt;
-      m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA);
+      if (!StartBurst ())
+        {
+          m_txPkt = AggregateTxQElements ();
+        }
+      DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA));
     }
 }
 
 void
-LrWpanMac::SetCsmaCa (Ptr<LrWpanCsmaCa> csmaCa)
+LrWpanMac::DeferTransition (EventImpl *transition)
 {
-  m_csmaCa = csmaCa;
+  Ptr<EventImpl> event = Ptr<EventImpl> (transition, false);
+  if (m_directDispatch && m_workQueue.IsActive ())
+    {
+      m_pendingTransition = event;
+      m_workQueue.Push (Ptr<EventImpl> (MakeEvent (&LrWpanMac::DispatchTransition, this, event), false));
+    }
+  else
+    {
+      m_setMacState = Simulator::ScheduleNow (event);
+    }
 }
 
 void
-LrWpanMac::SetPhy (Ptr<LrWpanPhy> phy)
+LrWpanMac::ScheduleTransition (Time delay, EventImpl *transition)
 {
-  m_phy = phy;
+  if (delay.IsZero ())
+    {
+      DeferTransition (transition);
+    }
+  else
+    {
+      m_setMacState = Simulator::Schedule (delay, Ptr<EventImpl> (transition, false));
+    }
 }
 
-Ptr<LrWpanPhy>
-LrWpanMac::GetPhy (void)
+void
+LrWpanMac::DispatchTransition (Ptr<EventImpl> transition)
 {
-  return m_phy;
+  NS_LOG_FUNCTION (this);
+  if (m_pendingTransition == transition)
+    {
+      m_pendingTransition = 0;
+    }
+  // A cancelled transition is not invoked.
+  transition->Invoke ();
 }
 
 void
-LrWpanMac::SetMcpsDataIndicationCallback (McpsDataIndicationCallback c)
+LrWpanMac::CancelTransition (void)
 {
-  m_mcpsDataIndicationCallback = c;
+  m_setMacState.Cancel ();
+  if (m_pendingTransition != 0)
+    {
+      m_pendingTransition->Cancel ();
+      m_pendingTransition = 0;
+    }
+}
+
+bool
+LrWpanMac::IsTransitionPending (void) const
+{
+  return m_setMacState.IsRunning () || m_pendingTransition != 0;
+}
+
+LrWpanPhyEnumeration
+LrWpanMac::GetIdleTrxState (void) const
+{
+  if (m_pollWaitTimeout.IsRunning ())
+    {
+      // The coordinator announced pending data.
+      return IEEE_802_15_4_PHY_RX_ON;
+    }
+  if (m_macRxOnWhenIdle && (!m_dutyCycle || m_awake))
+    {
+      return IEEE_802_15_4_PHY_RX_ON;
+    }
+  return IEEE_802_15_4_PHY_TRX_OFF;
 }
 
 void
-LrWpanMac::SetMcpsDataConfirmCallback (McpsDataConfirmCallback c)
+LrWpanMac::Wakeup (void)
 {
-  m_mcpsDataConfirmCallback = c;
+  NS_LOG_FUNCTION (this);
+
+  m_awake = true;
+  m_wakeupEvent = Simulator::Schedule (m_wakeupInterval, &LrWpanMac::Wakeup, this);
+  m_sleepEvent.Cancel ();
+  m_sleepEvent = Simulator::Schedule (m_listenWindow, &LrWpanMac::Sleep, this);
+  if (m_lrWpanMacState == MAC_IDLE && !IsTransitionPending ())
+    {
+      m_phy->PlmeSetTRXStateRequest (GetIdleTrxState ());
+    }
 }
 
 void
-LrWpanMac::SetRfMacEnergyIndicationCallback (RfMacEnergyIndicationCallback c)
+LrWpanMac::Sleep (void)
 {
-  m_rfMacEnergyIndicationCallback = c;
+  NS_LOG_FUNCTION (this);
+
+  // Otherwise, the receiver is switched off when the MAC becomes idle.
+  m_awake = false;
+  if (m_lrWpanMacState == MAC_IDLE && !IsTransitionPending ())
+    {
+      m_phy->PlmeSetTRXStateRequest (GetIdleTrxState ());
+    }
 }
 
 void
-LrWpanMac::PdDataIndication (uint32_t psduLength, Ptr<Packet> p, uint8_t lqi)
+LrWpanMac::CfeWaitTimeout (void)
 {
-  NS_LOG_DEBUG ("state: "<<m_lrWpanMacState);
-  NS_ASSERT (m_lrWpanMacState == MAC_IDLE
-              || m_lrWpanMacState == MAC_ACK_PENDING
-              || m_lrWpanMacState == MAC_CSMA
-              || m_lrWpanMacState == MAC_CFE_PENDING
-              || m_lrWpanMacState == MAC_CFE_ACK_PENDING
-              || m_lrWpanMacState == MAC_ENERGY_PENDING);
+  NS_LOG_FUNCTION (this);
 
-  NS_LOG_FUNCTION (this << psduLength << p << lqi);
+  if (m_lrWpanMacState == MAC_CFE_PENDING)
+    {
+      NS_LOG_DEBUG (this << " no CFE received after the RFE");
+      SetLrWpanMacState (MAC_IDLE);
+    }
+}
 
-  bool acceptFrame;
+void
+LrWpanMac::EnergyWaitTimeout (void)
+{
+  NS_LOG_FUNCTION (this);
 
-  // from sec 7.5.6.2 Reception and rejection, Std802.15.4-2006
-  // level 1 filtering, test FCS field and reject if frame fails
-  // level 2 filtering if promiscuous mode pass frame to higher layer otherwise perform level 3 filtering
-  // level 3 filtering accept frame
-  // if Frame type and version is not reserved, and
-  // if there is a dstPanId then dstPanId=m_macPanId or broadcastPanI, and
-  // if there is a shortDstAddr then shortDstAddr =shortMacAddr or broadcastAddr, and
-  // if beacon frame then srcPanId = m_macPanId
-  // if only srcAddr field in Data or Command frame,accept frame if srcPanId=m_macPanId
+  if (m_lrWpanMacState == MAC_ENERGY_PENDING)
+    {
+      NS_LOG_DEBUG (this << " no energy pulse from " << m_cachedEdt << ", probe it again");
+      m_chargingCache.erase (m_cachedEdt);
+      m_cachedEdt = Mac16Address ("ff:ff");
+      m_cfeDstAddress = Mac16Address ("ff:ff");
+      SetLrWpanMacState (MAC_IDLE);
+    }
+}
+
+bool
+LrWpanMac::IsStrobing (void) const
+{
+  return m_strobing && Simulator::Now () < m_strobeEnd;
+}
+
+Time
+LrWpanMac::GetSymbolsDuration (uint64_t symbols) const
+{
+  return MicroSeconds (symbols * 1000 * 1000 / m_phy->GetDataOrSymbolRate (false));
+}
 
-  Ptr<Packet> originalPkt = p->Copy (); // because we will strip headers
+Time
+LrWpanMac::GetSuperframeSlotDuration (void) const
+{
+  return GetSymbolsDuration (m_aBaseSlotDuration << m_macSuperframeOrder);
+}
 
-  m_promiscSnifferTrace (originalPkt);
+Time
+LrWpanMac::GetBeaconInterval (void) const
+{
+  return GetSymbolsDuration (m_aBaseSuperframeDuration << m_macBeaconOrder);
+}
 
-  m_macPromiscRxTrace (originalPkt);
-  // XXX no rejection tracing (to macRxDropTrace) being performed below
+bool
+LrWpanMac::IsBeaconEnabled (void) const
+{
+  return m_macBeaconOrder < 15;
+}
 
-  LrWpanMacTrailer receivedMacTrailer;
-  p->RemoveTrailer (receivedMacTrailer);
-  if (Node::ChecksumEnabled ())
+Time
+LrWpanMac::GetSuperframeStart (void) const
+{
+  NS_ASSERT (IsBeaconEnabled ());
+
+  int64_t interval = GetBeaconInterval ().GetNanoSeconds ();
+  int64_t superframes = (Simulator::Now () - m_superframeStart).GetNanoSeconds () / interval;
+  return m_superframeStart + NanoSeconds (superframes * interval);
+}
+
+Time
+LrWpanMac::GetCapEnd (void) const
+{
+  return GetSuperframeStart () + NanoSeconds ((m_finalCapSlot + 1) * GetSuperframeSlotDuration ().GetNanoSeconds ());
+}
+
+Time
+LrWpanMac::GetNextCapStart (void) const
+{
+  return GetSuperframeStart () + GetBeaconInterval () + m_beaconDuration;
+}
+
+Time
+LrWpanMac::GetTransactionDuration (Ptr<const Packet> p) const
+{
+  Time duration = m_phy->CalculateTxTime (p);
+  LrWpanMacHeader macHdr;
+  p->PeekHeader (macHdr);
+  if (macHdr.IsAckReq ())
     {
-      receivedMacTrailer.EnableFcs (true);
+      duration += GetSymbolsDuration (GetMacAckWaitDuration ());
     }
+  return duration;
+}
 
-  // level 1 filtering
-  if (!receivedMacTrailer.CheckFcs (p))
+bool
+LrWpanMac::AllocateGts (Mac16Address address, uint8_t length)
+{
+  NS_LOG_FUNCTION (this << address << static_cast<uint32_t> (length));
+  NS_ASSERT_MSG (IsBeaconEnabled (), "GTSs are only allocated in a beacon-enabled PAN");
+
+  if (length == 0 || m_gtsList.size () >= LrWpanBeaconHeader::MAX_GTS)
     {
-      m_macRxDropTrace (originalPkt);
+      return false;
     }
-  else
+  for (std::vector<LrWpanBeaconHeader::GtsDescriptor>::const_iterator it = m_gtsList.begin (); it != m_gtsList.end (); it++)
     {
-      LrWpanMacHeader receivedMacHdr;
-      p->RemoveHeader (receivedMacHdr);
-
-      McpsDataIndicationParams params;
-      params.m_dsn = receivedMacHdr.GetSeqNum ();
-      params.m_mpduLinkQuality = lqi;
-      params.m_srcPanId = receivedMacHdr.GetSrcPanId ();
-      params.m_srcAddrMode = receivedMacHdr.GetSrcAddrMode ();
-      // TODO: Add field for EXT_ADDR source address.
-      if (params.m_srcAddrMode == SHORT_ADDR)
-        {
-          params.m_srcAddr = receivedMacHdr.GetShortSrcAddr ();
-        }
-      params.m_dstPanId = receivedMacHdr.GetDstPanId ();
-      params.m_dstAddrMode = receivedMacHdr.GetDstAddrMode ();
-      // TODO: Add field for EXT_ADDR destination address.
-      if (params.m_dstAddrMode == SHORT_ADDR)
+      if (it->m_address == address)
         {
-          params.m_dstAddr = receivedMacHdr.GetShortDstAddr ();
+          NS_LOG_DEBUG (this << " " << address << " already has a GTS");
+          return false;
         }
+    }
 
-      NS_LOG_DEBUG ("Packet from " << params.m_srcAddr << " to " << params.m_dstAddr);
+  // The CAP keeps at least aMinCAPLength symbols.
+  uint64_t slotSymbols = m_aBaseSlotDuration << m_macSuperframeOrder;
+  if (length > m_finalCapSlot
+      || (m_finalCapSlot + 1 - length) * slotSymbols < aMinCAPLength)
+    {
+      NS_LOG_DEBUG (this << " no room for a GTS of " << static_cast<uint32_t> (length) << " slots");
+      return false;
+    }
 
-      if (receivedMacHdr.GetType () == LrWpanMacHeader::LRWPAN_MAC_DATA)
-        {
-          Ptr<UniformRandomVariable> perValue = CreateObject<UniformRandomVariable> ();
-          perValue->SetAttribute ("Min", DoubleValue (0.0));
-          perValue->SetAttribute ("Max", DoubleValue (1.0));
-          double per = perValue->GetValue ();
-          NS_LOG_DEBUG ("per value: "<<per);
-          if (per < 0.75)
-            {
-              m_macRxDropTrace (originalPkt);
-              NS_LOG_DEBUG ("drop the packet");
-              return;
-            }
-        }
+  LrWpanBeaconHeader::GtsDescriptor gts;
+  gts.m_address = address;
+  gts.m_startSlot = m_finalCapSlot + 1 - length;
+  gts.m_length = length;
+  m_gtsList.push_back (gts);
+  m_finalCapSlot -= length;
+  return true;
+}
 
-      if (m_macPromiscuousMode)
+void
+LrWpanMac::DeallocateGts (Mac16Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  // Pack the remaining GTSs at the end of the superframe, in their order.
+  uint8_t startSlot = m_aNumSuperframeSlots;
+  std::vector<LrWpanBeaconHeader::GtsDescriptor>::iterator it = m_gtsList.begin ();
+  while (it != m_gtsList.end ())
+    {
+      if (it->m_address == address)
         {
-          //level 2 filtering
-          if (!m_mcpsDataIndicationCallback.IsNull ())
-            {
-              NS_LOG_DEBUG ("promiscuous mode, forwarding up");
-              m_mcpsDataIndicationCallback (params, p);
-            }
-          else
-            {
-              NS_LOG_ERROR (this << " Data Indication Callback not initialised");
-            }
+          it = m_gtsList.erase (it);
+          continue;
         }
-      else
-        {
-          //level 3 frame filtering
-          acceptFrame = (receivedMacHdr.GetType () != LrWpanMacHeader::LRWPAN_MAC_RESERVED);
+      startSlot -= it->m_length;
+      it->m_startSlot = startSlot;
+      it++;
+    }
+  m_finalCapSlot = startSlot - 1;
+}
 
-          if (acceptFrame)
-            {
-              acceptFrame = (receivedMacHdr.GetFrameVer () <= 1);
-            }
+void
+LrWpanMac::SendBeacon (void)
+{
+  NS_LOG_FUNCTION (this);
 
-          if (acceptFrame
-              && (receivedMacHdr.GetDstAddrMode () > 1))
-            {
-              acceptFrame = receivedMacHdr.GetDstPanId () == m_macPanId
-                || receivedMacHdr.GetDstPanId () == 0xffff;
-            }
+  m_beaconEvent = Simulator::Schedule (GetBeaconInterval (), &LrWpanMac::SendBeacon, this);
+  if (m_lrWpanMacState != MAC_CSMA
+      && (m_lrWpanMacState != MAC_IDLE || IsTransitionPending ()))
+    {
+      // The superframe timing goes on without this beacon.
+      NS_LOG_DEBUG (this << " transaction in progress, no beacon sent");
+      return;
+    }
 
-          if (acceptFrame
-              && (receivedMacHdr.GetDstAddrMode () == 2))
-            {
-              acceptFrame = receivedMacHdr.GetShortDstAddr () == m_shortAddress
-                || receivedMacHdr.GetShortDstAddr () == Mac16Address ("ff:ff");        // check for broadcast addrs
-            }
+  LrWpanBeaconHeader beaconHdr;
+  beaconHdr.SetBeaconOrder (m_macBeaconOrder);
+  beaconHdr.SetSuperframeOrder (m_macSuperframeOrder);
+  beaconHdr.SetFinalCapSlot (m_finalCapSlot);
+  beaconHdr.SetPanCoordinator (true);
+  for (std::vector<LrWpanBeaconHeader::GtsDescriptor>::const_iterator it = m_gtsList.begin (); it != m_gtsList.end (); it++)
+    {
+      beaconHdr.AddGts (*it);
+    }
 
-          if (acceptFrame
-              && (receivedMacHdr.GetDstAddrMode () == 3))
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_BEACON, m_macBsn.GetValue ());
+  m_macBsn++;
+  macHdr.SetSrcAddrMode (SHORT_ADDR);
+  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
+
+  Ptr<Packet> beacon = Create<Packet> (0);
+  beacon->AddHeader (beaconHdr);
+  beacon->AddHeader (macHdr);
+  LrWpanMacTrailer macTrailer;
+  // Calculate FCS if the global attribute ChecksumEnable is set.
+  if (Node::ChecksumEnabled ())
+    {
+      macTrailer.EnableFcs (true);
+      macTrailer.SetFcs (beacon);
+    }
+  beacon->AddTrailer (macTrailer);
+
+  // As for an ACK, a running channel access is given up and started again
+  // for the head of the queue after the beacon.
+  if (m_lrWpanMacState == MAC_CSMA)
+    {
+      m_csmaCa->Cancel ();
+    }
+  m_beaconDuration = m_phy->CalculateTxTime (beacon);
+  m_txPkt = beacon;
+  ChangeMacState (MAC_SENDING);
+  m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+}
+
+void
+LrWpanMac::ReceiveBeacon (const LrWpanBeaconHeader &beaconHdr, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << p);
+
+  if (m_coordinator)
+    {
+      return;
+    }
+
+  // The beacon was received at its end.
+  m_beaconDuration = m_phy->CalculateTxTime (p);
+  m_superframeStart = Simulator::Now () - m_beaconDuration;
+  m_macBeaconOrder = beaconHdr.GetBeaconOrder ();
+  m_macSuperframeOrder = beaconHdr.GetSuperframeOrder ();
+  m_finalCapSlot = beaconHdr.GetFinalCapSlot ();
+  m_gtsLength = 0;
+  m_gtsEvent.Cancel ();
+  if (!IsBeaconEnabled ())
+    {
+      m_csmaCa->SetUnSlottedCsmaCa ();
+      return;
+    }
+  m_csmaCa->SetSlottedCsmaCa ();
+
+  const std::vector<LrWpanBeaconHeader::GtsDescriptor> &gtsList = beaconHdr.GetGtsList ();
+  for (std::vector<LrWpanBeaconHeader::GtsDescriptor>::const_iterator it = gtsList.begin (); it != gtsList.end (); it++)
+    {
+      if (it->m_address == GetShortAddress ())
+        {
+          m_gtsStartSlot = it->m_startSlot;
+          m_gtsLength = it->m_length;
+          Time gtsStart = m_superframeStart + NanoSeconds (m_gtsStartSlot * GetSuperframeSlotDuration ().GetNanoSeconds ());
+          NS_LOG_DEBUG (this << " GTS of " << static_cast<uint32_t> (m_gtsLength) << " slots at " << gtsStart);
+          m_gtsEvent = Simulator::Schedule (gtsStart - Simulator::Now (), &LrWpanMac::StartGts, this);
+          break;
+        }
+    }
+}
+
+void
+LrWpanMac::StartGts (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // A channel access deferred to the next CAP is given up, and started again
+  // after the frames of the GTS.
+  if (m_lrWpanMacState == MAC_CSMA
+      && (!m_txQueue[TX_CLASS_ENERGY].IsEmpty () || !m_txQueue[TX_CLASS_GTS].IsEmpty ()))
+    {
+      m_csmaCa->Cancel ();
+      CancelTransition ();
+      m_txPkt = 0;
+      ChangeMacState (MAC_IDLE);
+    }
+  CheckQueue ();
+}
+
+bool
+LrWpanMac::SendGtsFrame (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_gtsLength == 0 || !IsBeaconEnabled ())
+    {
+      return false;
+    }
+  int64_t slot = GetSuperframeSlotDuration ().GetNanoSeconds ();
+  Time gtsStart = GetSuperframeStart () + NanoSeconds (m_gtsStartSlot * slot);
+  Time gtsEnd = gtsStart + NanoSeconds (m_gtsLength * slot);
+  Time now = Simulator::Now ();
+  if (now < gtsStart || now >= gtsEnd)
+    {
+      return false;
+    }
+
+  Ptr<Packet> frame = m_txPkt;
+  if (frame == 0)
+    {
+      if (!m_txQueue[TX_CLASS_ENERGY].IsEmpty ())
+        {
+          m_txClass = TX_CLASS_ENERGY;
+        }
+      else if (!m_txQueue[TX_CLASS_GTS].IsEmpty ())
+        {
+          m_txClass = TX_CLASS_GTS;
+        }
+      else
+        {
+          return false;
+        }
+      frame = AggregateTxQElements ();
+    }
+
+  // The transceiver is switched to TX before the transaction.
+  if (now + GetSymbolsDuration (m_phy->aTurnaroundTime) + GetTransactionDuration (frame) > gtsEnd)
+    {
+      NS_LOG_DEBUG (this << " transaction does not fit in the GTS");
+      if (m_txPkt == 0)
+        {
+          m_txMsdus = 1;
+        }
+      return false;
+    }
+
+  m_txPkt = frame;
+  SendNow ();
+  return true;
+}
+
+void
+LrWpanMac::SetCsmaCa (Ptr<LrWpanCsmaCa> csmaCa)
+{
+  m_csmaCa = csmaCa;
+}
+
+void
+LrWpanMac::SetPhy (Ptr<LrWpanPhy> phy)
+{
+  m_phy = phy;
+}
+
+Ptr<LrWpanPhy>
+LrWpanMac::GetPhy (void)
+{
+  return m_phy;
+}
+
+void
+LrWpanMac::SetMcpsDataIndicationCallback (McpsDataIndicationCallback c)
+{
+  m_mcpsDataIndicationCallback = c;
+}
+
+void
+LrWpanMac::SetMcpsDataConfirmCallback (McpsDataConfirmCallback c)
+{
+  m_mcpsDataConfirmCallback = c;
+}
+
+void
+LrWpanMac::SetMlmePollConfirmCallback (MlmePollConfirmCallback c)
+{
+  m_mlmePollConfirmCallback = c;
+}
+
+void
+LrWpanMac::SetRfMacEnergyIndicationCallback (RfMacEnergyIndicationCallback c)
+{
+  m_rfMacEnergyIndicationCallback = c;
+}
+
+void
+LrWpanMac::SetReceiveErrorModel (Ptr<ErrorModel> em)
+{
+  NS_LOG_FUNCTION (this << em);
+  m_receiveErrorModel = em;
+}
+
+Ptr<ErrorModel>
+LrWpanMac::GetReceiveErrorModel (void) const
+{
+  return m_receiveErrorModel;
+}
+
+void
+LrWpanMac::SetEdtSelectionPolicy (Ptr<LrWpanEdtSelectionPolicy> policy)
+{
+  NS_LOG_FUNCTION (this << policy);
+  m_edtSelectionPolicy = policy;
+}
+
+Ptr<LrWpanEdtSelectionPolicy>
+LrWpanMac::GetEdtSelectionPolicy (void) const
+{
+  return m_edtSelectionPolicy;
+}
+
+int64_t
+LrWpanMac::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_wakeupRandom->SetStream (stream);
+  if (m_receiveErrorModel == 0)
+    {
+      return 1;
+    }
+  Ptr<RateErrorModel> rateErrorModel = DynamicCast<RateErrorModel> (m_receiveErrorModel);
+  if (rateErrorModel != 0)
+    {
+      return 1 + rateErrorModel->AssignStreams (stream + 1);
+    }
+  Ptr<BurstErrorModel> burstErrorModel = DynamicCast<BurstErrorModel> (m_receiveErrorModel);
+  if (burstErrorModel != 0)
+    {
+      return 1 + burstErrorModel->AssignStreams (stream + 1);
+    }
+  Ptr<LrWpanGilbertElliottErrorModel> gilbertElliottErrorModel = DynamicCast<LrWpanGilbertElliottErrorModel> (m_receiveErrorModel);
+  if (gilbertElliottErrorModel != 0)
+    {
+      return 1 + gilbertElliottErrorModel->AssignStreams (stream + 1);
+    }
+  // The list error models do not draw random numbers. The ErrorModel base
+  // class has no AssignStreams, so the streams of other models are left to
+  // their user.
+  if (DynamicCast<ListErrorModel> (m_receiveErrorModel) == 0
+      && DynamicCast<ReceiveListErrorModel> (m_receiveErrorModel) == 0)
+    {
+      NS_LOG_WARN ("No stream assigned to the receive error model " << m_receiveErrorModel->GetInstanceTypeId ().GetName ());
+    }
+  return 1;
+}
+
+uint64_t
+LrWpanMac::GetDispatchedTransitions (void) const
+{
+  return m_workQueue.GetDispatchedCount ();
+}
+
+void
+LrWpanMac::PdDataIndication (uint32_t psduLength, Ptr<Packet> p, uint8_t lqi)
+{
+  LrWpanWorkQueue::Scope scope (m_workQueue);
+  NS_LOG_DEBUG ("state: "<<m_lrWpanMacState);
+  NS_ASSERT (m_lrWpanMacState == MAC_IDLE
+              || m_lrWpanMacState == MAC_ACK_PENDING
+              || m_lrWpanMacState == MAC_CSMA
+              || m_lrWpanMacState == MAC_CFE_PENDING
+              || m_lrWpanMacState == MAC_CFE_ACK_PENDING
+              || m_lrWpanMacState == MAC_ENERGY_PENDING);
+
+  NS_LOG_FUNCTION (this << psduLength << p << lqi);
+
+  bool acceptFrame;
+
+  // from sec 7.5.6.2 Reception and rejection, Std802.15.4-2006
+  // level 1 filtering, test FCS field and reject if frame fails
+  // level 2 filtering if promiscuous mode pass frame to higher layer otherwise perform level 3 filtering
+  // level 3 filtering accept frame
+  // if Frame type and version is not reserved, and
+  // if there is a dstPanId then dstPanId=m_macPanId or broadcastPanI, and
+  // if there is a shortDstAddr then shortDstAddr =shortMacAddr or broadcastAddr, and
+  // if beacon frame then srcPanId = m_macPanId
+  // if only srcAddr field in Data or Command frame,accept frame if srcPanId=m_macPanId
+
+  // The header and the trailer are only peeked, the received packet is passed
+  // unmodified to the traces. Only the payload forwarded up the stack is
+  // stripped.
+  m_promiscSnifferTrace (p);
+
+  m_macPromiscRxTrace (p);
+  // XXX no rejection tracing (to macRxDropTrace) being performed below
+
+  LrWpanMacTrailer receivedMacTrailer;
+  p->PeekTrailer (receivedMacTrailer);
+  bool fcsOk = true;
+  if (Node::ChecksumEnabled ())
+    {
+      // The FCS covers the frame without the trailer.
+      receivedMacTrailer.EnableFcs (true);
+      fcsOk = receivedMacTrailer.CheckFcs (p->CreateFragment (0, p->GetSize () - receivedMacTrailer.GetSerializedSize ()));
+    }
+
+  // level 1 filtering
+  if (!fcsOk)
+    {
+      m_macRxDropTrace (p);
+    }
+  else
+    {
+      LrWpanMacHeader receivedMacHdr;
+      p->PeekHeader (receivedMacHdr);
+
+      McpsDataIndicationParams params;
+      params.m_dsn = receivedMacHdr.GetSeqNum ();
+      params.m_mpduLinkQuality = lqi;
+      params.m_srcPanId = receivedMacHdr.GetSrcPanId ();
+      params.m_srcAddrMode = receivedMacHdr.GetSrcAddrMode ();
+      // TODO: Add field for EXT_ADDR source address.
+      if (params.m_srcAddrMode == SHORT_ADDR)
+        {
+          params.m_srcAddr = receivedMacHdr.GetShortSrcAddr ();
+        }
+      params.m_dstPanId = receivedMacHdr.GetDstPanId ();
+      params.m_dstAddrMode = receivedMacHdr.GetDstAddrMode ();
+      // TODO: Add field for EXT_ADDR destination address.
+      if (params.m_dstAddrMode == SHORT_ADDR)
+        {
+          params.m_dstAddr = receivedMacHdr.GetShortDstAddr ();
+        }
+
+      NS_LOG_DEBUG ("Packet from " << params.m_srcAddr << " to " << params.m_dstAddr);
+
+      if (receivedMacHdr.GetType () == LrWpanMacHeader::LRWPAN_MAC_DATA
+          && m_receiveErrorModel != 0 && m_receiveErrorModel->IsCorrupt (p))
+        {
+          NS_LOG_DEBUG ("Data frame lost by the receive error model");
+          m_macRxDropTrace (p);
+          return;
+        }
+
+      if (m_macPromiscuousMode)
+        {
+          //level 2 filtering
+          if (!m_mcpsDataIndicationCallback.IsNull ())
+            {
+              NS_LOG_DEBUG ("promiscuous mode, forwarding up");
+              IndicateData (params, p, receivedMacHdr, receivedMacTrailer);
+            }
+          else
+            {
+              NS_LOG_ERROR (this << " Data Indication Callback not initialised");
+            }
+        }
+      else
+        {
+          //level 3 frame filtering
+          acceptFrame = (receivedMacHdr.GetType () != LrWpanMacHeader::LRWPAN_MAC_RESERVED);
+
+          if (acceptFrame)
+            {
+              acceptFrame = (receivedMacHdr.GetFrameVer () <= 1);
+            }
+
+          if (acceptFrame
+              && (receivedMacHdr.GetDstAddrMode () > 1))
+            {
+              acceptFrame = receivedMacHdr.GetDstPanId () == m_macPanId
+                || receivedMacHdr.GetDstPanId () == 0xffff;
+            }
+
+          if (acceptFrame
+              && (receivedMacHdr.GetDstAddrMode () == 2))
+            {
+              acceptFrame = receivedMacHdr.GetShortDstAddr () == m_shortAddress
+                || receivedMacHdr.GetShortDstAddr () == Mac16Address ("ff:ff");        // check for broadcast addrs
+            }
+
+          if (acceptFrame
+              && (receivedMacHdr.GetDstAddrMode () == 3))
             {
               acceptFrame = (receivedMacHdr.GetExtDstAddr () == m_selfExt);
             }
@@ -644,7 +1482,19 @@ LrWpanMac::PdDataIndication (uint32_t psduLength, Ptr<Packet> p, uint8_t lqi)
           if (acceptFrame)
             {
               // NS_LOG_DEBUG ("acceptFrame is true "<<m_lrWpanMacState << " hdr type "<< receivedMacHdr.GetType ());
-              m_macRxTrace (originalPkt);
+              m_macRxTrace (p);
+              if (receivedMacHdr.IsBeacon ())
+                {
+                  LrWpanBeaconHeader beaconHdr;
+                  GetPayload (p, receivedMacHdr, receivedMacTrailer)->PeekHeader (beaconHdr);
+                  ReceiveBeacon (beaconHdr, p);
+                }
+              if (m_awake)
+                {
+                  // More frames may follow, keep listening.
+                  m_sleepEvent.Cancel ();
+                  m_sleepEvent = Simulator::Schedule (m_listenWindow, &LrWpanMac::Sleep, this);
+                }
               if (receivedMacHdr.IsRfMac ())
                 {
                   NS_LOG_DEBUG ("This packet is rf-mac type");
@@ -654,47 +1504,117 @@ LrWpanMac::PdDataIndication (uint32_t psduLength, Ptr<Packet> p, uint8_t lqi)
                     }
 
                   RfMacTypeTag typeTag;
-                  originalPkt->PeekPacketTag (typeTag);
+                  p->PeekPacketTag (typeTag);
                   if (IsEdt ())
                     {
                       NS_LOG_DEBUG ("A edt node received. type : "<<typeTag.Get ());
-                      if (typeTag.IsRfe ())
+                      RfMacChargeRequestTag requestTag;
+                      if (typeTag.IsRfe () && p->PeekPacketTag (requestTag))
                         {
-                          m_setMacState.Cancel ();
-                          ChangeMacState (MAC_IDLE);
-                          Time delay;
-
-                          m_rfeSrcAddress = receivedMacHdr.GetShortSrcAddr ();
-                          m_rfeSrcPanId = receivedMacHdr.GetSrcPanId ();
-
-                          RfMacGroupTag groupTag;
-                          originalPkt->PeekPacketTag (groupTag);
+                          // The sensor predicted its charging time, skip the
+                          // probing. Only the EDT asked answers.
+                          if (requestTag.GetEdt () == GetShortAddress ()
+                              && m_lrWpanMacState == MAC_IDLE && !IsTransitionPending ())
+                            {
+                              m_rfeSrcAddress = receivedMacHdr.GetShortSrcAddr ();
+                              DeferTransition (MakeEvent (&LrWpanMac::SendEnergyPulse, this, requestTag.GetChargingTime ()));
+                            }
+                          else
+                            {
+                              NS_LOG_DEBUG ("Charge request for " << requestTag.GetEdt () << " not answered");
+                            }
+                        }
+                      else if (typeTag.IsRfe ())
+                        {
+                          Mac16Address sensor = receivedMacHdr.GetShortSrcAddr ();
 
-                          m_groupNumber = groupTag.Get ();
-                          if (m_groupNumber == 1)
+                          RfMacGroupTag groupTag;
+                          p->PeekPacketTag (groupTag);
+
+                          uint8_t probeSlot = GetProbeSlot (groupTag.GetPhase (), m_probeSlots);
+                          Time delay = (probeSlot - 1) * m_probeSlotDuration;
+                          if (m_rfeAggregationWindow.IsZero ())
+                            {
+                              CancelTransition ();
+                              ChangeMacState (MAC_IDLE);
+                              m_rfeSrcAddress = sensor;
+                              m_rfeSrcPanId = receivedMacHdr.GetSrcPanId ();
+                              m_groupNumber = groupTag.Get ();
+                              m_probeSlot = probeSlot;
+                            }
+                          if (m_edtSelectionPolicy != 0)
+                            {
+                              // Stay silent, unless the policy selects this EDT.
+                              // Later RFEs of other sensors overwrite the
+                              // fields above, so keep them for AnswerRfe.
+                              RfeCandidate candidate;
+                              candidate.m_panId = receivedMacHdr.GetSrcPanId ();
+                              candidate.m_groupNumber = groupTag.Get ();
+                              candidate.m_probeSlot = probeSlot;
+                              m_rfeCandidates[sensor] = candidate;
+                              m_edtSelectionPolicy->AddCandidate (sensor, GetShortAddress (),
+                                                                  groupTag.GetRxPower (), probeSlot, delay,
+                                                                  MakeCallback (&LrWpanMac::AnswerRfe, this));
+                            }
+                          else if (m_rfeAggregationWindow.IsZero ())
                             {
-                              delay = MicroSeconds (0.0);
+                              ScheduleTransition (delay, MakeEvent (&LrWpanMac::SendCfeAfterRfe, this));
                             }
-                          else if (m_groupNumber == 2)
+                          else
                             {
-                              delay = MicroSeconds (10.0);
+                              // Keep on with an ongoing handshake, the RFE is
+                              // answered at the end of the window.
+                              AggregateRfe (sensor, delay);
                             }
+                        }
+                      else if (typeTag.IsCfeAck () && m_lrWpanMacState == MAC_CFE_ACK_PENDING
+                               && m_cfeAckTimeout.IsRunning ())
+                        {
+                          RfMacDurationTag chargingTime;
+                          p->PeekPacketTag (chargingTime);
+
+                          RfMacProbeTag probeTag;
+                          p->PeekPacketTag (probeTag);
 
-                          m_setMacState = Simulator::Schedule (delay, &LrWpanMac::SendCfeAfterRfe, this);
+                          std::vector<Mac16Address>::iterator it = std::find (m_cfeRequesters.begin (), m_cfeRequesters.end (),
+                                                                              receivedMacHdr.GetShortSrcAddr ());
+                          if (it != m_cfeRequesters.end ())
+                            {
+                              m_cfeRequesters.erase (it);
+                              if (probeTag.IsSelected (m_probeSlot))
+                                {
+                                  m_cfeAckChargingTimes.push_back (chargingTime.Get ());
+                                }
+                            }
+                          if (m_cfeRequesters.empty ())
+                            {
+                              m_cfeAckTimeout.Cancel ();
+                              EndCfeAckCollection ();
+                            }
                         }
                       else if (typeTag.IsCfeAck () && m_lrWpanMacState == MAC_CFE_ACK_PENDING)
                         {
-                          m_setMacState.Cancel ();
+                          CancelTransition ();
                           ChangeMacState (MAC_IDLE);
 
                           RfMacDurationTag chargingTime;
-                          originalPkt->PeekPacketTag (chargingTime);
+                          p->PeekPacketTag (chargingTime);
 
-                          m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SendEnergyPulse, this, chargingTime.Get ());
+                          RfMacProbeTag probeTag;
+                          p->PeekPacketTag (probeTag);
+                          if (probeTag.IsSelected (m_probeSlot))
+                            {
+                              DeferTransition (MakeEvent (&LrWpanMac::SendEnergyPulse, this, chargingTime.Get ()));
+                            }
+                          else
+                            {
+                              NS_LOG_DEBUG ("Probe slot " << static_cast<uint32_t> (m_probeSlot) << " not selected");
+                              DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
+                            }
                         }
                       else // A edt doesn't need to receive except rfe, ack for cfe.
                         {
-                          m_macRxDropTrace (originalPkt);
+                          m_macRxDropTrace (p);
                         }
                     }
                   else if(IsSensor ())
@@ -703,23 +1623,87 @@ LrWpanMac::PdDataIndication (uint32_t psduLength, Ptr<Packet> p, uint8_t lqi)
                       //If a sensor node receive the rfe packet, the sensor are forced to freeze their backoff timers and get into charging mode.
                       if (typeTag.IsRfe ()) 
                         {
-                          m_setMacState.Cancel ();
+                          CancelTransition ();
                           ChangeMacState (MAC_ENERGY_PENDING);
                         }
                       if (typeTag.IsCfe ())
                         {
-                          m_cfeDstAddress = receivedMacHdr.GetShortDstAddr ();
+                          RfMacRequesterTag requesterTag;
+                          if (p->PeekPacketTag (requesterTag))
+                            {
+                              // A multicast CFE, the sensors listed answer one
+                              // after the other.
+                              if (requesterTag.GetIndex (GetShortAddress (), m_cfeAckIndex))
+                                {
+                                  m_cfeDstAddress = GetShortAddress ();
+                                }
+                              else if (m_cfeDstAddress != GetShortAddress ())
+                                {
+                                  m_cfeDstAddress = receivedMacHdr.GetShortDstAddr ();
+                                }
+                            }
+                          else
+                            {
+                              m_cfeAckIndex = 0;
+                              m_cfeDstAddress = receivedMacHdr.GetShortDstAddr ();
+                            }
                           m_cfeDstPanId = receivedMacHdr.GetDstPanId ();
+                          if (!m_chargingCacheValidity.IsZero ())
+                            {
+                              // The power of a slot is only the power of its
+                              // EDT, if no other EDT probes in it.
+                              RfMacProbeTag probeTag;
+                              p->PeekPacketTag (probeTag);
+                              Mac16Address edt = receivedMacHdr.GetShortSrcAddr ();
+                              std::map<uint8_t, Mac16Address>::iterator it = m_probeEdts.find (probeTag.GetSlot ());
+                              if (it == m_probeEdts.end ())
+                                {
+                                  m_probeEdts[probeTag.GetSlot ()] = edt;
+                                }
+                              else if (it->second != edt)
+                                {
+                                  it->second = Mac16Address ("ff:ff");
+                                }
+                            }
+                          if (m_cfeDstAddress == GetShortAddress ())
+                            {
+                              m_cfeWaitTimeout.Cancel ();
+                            }
                         }
                     }
                 }
               // \todo: What should we do if we receive a frame while waiting for an ACK?
               //        Especially if this frame has the ACK request bit set, should we reply with an ACK, possibly missing the pending ACK?
 
+              // The frames of a burst are recorded, until the last one asks for a block ACK.
+              bool blockAckReq = false;
+              if (receivedMacHdr.IsData () && receivedMacHdr.IsBlockAck ())
+                {
+                  if (receivedMacHdr.GetShortSrcAddr () != m_blockAckSrcAddress)
+                    {
+                      m_blockAckSrcAddress = receivedMacHdr.GetShortSrcAddr ();
+                      m_blockAckSeqNums.clear ();
+                    }
+                  m_blockAckSeqNums.push_back (receivedMacHdr.GetSeqNum ());
+                  blockAckReq = !receivedMacHdr.IsFrmPend ();
+                }
+
+              // A data request is acknowledged with the frame pending bit set,
+              // if a transaction is pending for the polling device.
+              bool framePending = false;
+              if (receivedMacHdr.IsCommand () && receivedMacHdr.GetSrcAddrMode () == SHORT_ADDR)
+                {
+                  uint8_t command = 0;
+                  GetPayload (p, receivedMacHdr, receivedMacTrailer)->CopyData (&command, 1);
+                  framePending = command == CMD_DATA_REQUEST
+                    && m_indTxQueue.find (receivedMacHdr.GetShortSrcAddr ()) != m_indTxQueue.end ();
+                }
+
               // If the received frame is a frame with the ACK request bit set, we immediately send back an ACK.
               // If we are currently waiting for a pending ACK, we assume the ACK was lost and trigger a retransmission after sending the ACK.
-              if ((receivedMacHdr.IsData () || receivedMacHdr.IsCommand ()) && receivedMacHdr.IsAckReq ()
-                  && !(receivedMacHdr.GetDstAddrMode () == SHORT_ADDR && receivedMacHdr.GetShortDstAddr () == "ff:ff"))
+              if (((receivedMacHdr.IsData () || receivedMacHdr.IsCommand ()) && receivedMacHdr.IsAckReq ()
+                   && !(receivedMacHdr.GetDstAddrMode () == SHORT_ADDR && receivedMacHdr.GetShortDstAddr () == "ff:ff"))
+                  || blockAckReq)
                 {
                   // If this is a data or mac command frame, which is not a broadcast,
                   // with ack req set, generate and send an ack frame.
@@ -740,39 +1724,104 @@ LrWpanMac::PdDataIndication (uint32_t psduLength, Ptr<Packet> p, uint8_t lqi)
                       m_csmaCa->StopTimer ();
                     }
                   // Cancel any pending MAC state change, ACKs have higher priority.
-                  m_setMacState.Cancel ();
+                  CancelTransition ();
                   ChangeMacState (MAC_IDLE);
-                  m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SendAck, this, receivedMacHdr.GetSeqNum ());
+                  if (blockAckReq)
+                    {
+                      DeferTransition (MakeEvent (&LrWpanMac::SendBlockAck, this, receivedMacHdr.GetSeqNum ()));
+                    }
+                  else
+                    {
+                      DeferTransition (MakeEvent (&LrWpanMac::SendAck, this, receivedMacHdr.GetSeqNum (), framePending));
+                    }
+                }
+
+              if (framePending)
+                {
+                  // The pending frame is sent after the ACK, with a channel
+                  // access.
+                  ExtractIndTxQElement (receivedMacHdr.GetShortSrcAddr ());
                 }
 
-              if (receivedMacHdr.IsData () && !m_mcpsDataIndicationCallback.IsNull ())
+              // With duty cycling, a strobed frame is acknowledged again but
+              // only indicated once.
+              bool duplicate = false;
+              if (m_dutyCycle && receivedMacHdr.IsData ())
                 {
-                  // If it is a data frame, push it up the stack.
-                  NS_LOG_DEBUG ("PdDataIndication():  Packet is for me; forwarding up");
-                  m_mcpsDataIndicationCallback (params, p);
+                  duplicate = receivedMacHdr.GetShortSrcAddr () == m_lastRxSrcAddress
+                    && receivedMacHdr.GetSeqNum () == m_lastRxSeqNum;
+                  m_lastRxSrcAddress = receivedMacHdr.GetShortSrcAddr ();
+                  m_lastRxSeqNum = receivedMacHdr.GetSeqNum ();
+                }
+
+              if (duplicate)
+                {
+                  NS_LOG_DEBUG ("PdDataIndication():  duplicate frame, not forwarded up");
+                }
+              else if (receivedMacHdr.IsData ())
+                {
+                  if (!m_mcpsDataIndicationCallback.IsNull ())
+                    {
+                      // If it is a data frame, push it up the stack.
+                      NS_LOG_DEBUG ("PdDataIndication():  Packet is for me; forwarding up");
+                      IndicateData (params, p, receivedMacHdr, receivedMacTrailer);
+                    }
+                  if (m_pollWaitTimeout.IsRunning () && receivedMacHdr.GetShortSrcAddr () == m_pollCoordAddress)
+                    {
+                      // The data announced by the coordinator was received.
+                      m_pollWaitTimeout.Cancel ();
+                      ConfirmPoll (MLMEPOLL_SUCCESS);
+                      if (m_lrWpanMacState == MAC_IDLE && !IsTransitionPending ())
+                        {
+                          m_phy->PlmeSetTRXStateRequest (GetIdleTrxState ());
+                        }
+                    }
                 }
               else if (receivedMacHdr.IsAcknowledgment () && m_txPkt && m_lrWpanMacState == MAC_ACK_PENDING)
                 {
                   NS_LOG_DEBUG ("PdDataIndication():  ACK");
                   LrWpanMacHeader macHdr;
                   m_txPkt->PeekHeader (macHdr);
-                  if (receivedMacHdr.GetSeqNum () == macHdr.GetSeqNum ())
+                  if (m_burst && receivedMacHdr.IsBlockAck () && receivedMacHdr.GetSeqNum () == macHdr.GetSeqNum ())
+                    {
+                      // A block ACK for the burst. Only the missing frames are retransmitted.
+                      m_ackWaitTimeout.Cancel ();
+                      LrWpanBlockAckHeader blockAckHdr;
+                      GetPayload (p, receivedMacHdr, receivedMacTrailer)->PeekHeader (blockAckHdr);
+                      CancelTransition ();
+                      if (ReceiveBlockAck (blockAckHdr, receivedMacHdr.GetSeqNum ()) || !PrepareRetransmission ())
+                        {
+                          DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
+                        }
+                      else
+                        {
+                          DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA));
+                        }
+                    }
+                  else if (receivedMacHdr.GetSeqNum () == macHdr.GetSeqNum ())
                     {
                       m_macTxOkTrace (m_txPkt);
                       // If it is an ACK with the expected sequence number, finish the transmission
                       // and notify the upper layer.
                       m_ackWaitTimeout.Cancel ();
-                      if (!m_mcpsDataConfirmCallback.IsNull ())
+                      if (macHdr.IsCommand ())
                         {
-                          TxQueueElement *txQElement = m_txQueue.front ();
-                          McpsDataConfirmParams confirmParams;
-                          confirmParams.m_msduHandle = txQElement->txQMsduHandle;
-                          confirmParams.m_status = IEEE_802_15_4_SUCCESS;
-                          m_mcpsDataConfirmCallback (confirmParams);
+                          // The ACK of a data request tells if data is pending at the coordinator.
+                          if (receivedMacHdr.IsFrmPend ())
+                            {
+                              m_pollWaitTimeout.Cancel ();
+                              m_pollWaitTimeout = Simulator::Schedule (GetSymbolsDuration (GetMacMaxFrameTotalWaitTime ()),
+                                                                       &LrWpanMac::PollWaitTimeout, this);
+                            }
+                          else
+                            {
+                              ConfirmPoll (MLMEPOLL_NO_DATA);
+                            }
                         }
+                      ConfirmTxQElements (IEEE_802_15_4_SUCCESS);
                       RemoveFirstTxQElement ();
-                      m_setMacState.Cancel ();
-                      m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE);
+                      CancelTransition ();
+                      DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
                     }
                   else
                     {
@@ -780,111 +1829,579 @@ LrWpanMac::PdDataIndication (uint32_t psduLength, Ptr<Packet> p, uint8_t lqi)
                       m_ackWaitTimeout.Cancel ();
                       if (!PrepareRetransmission ())
                         {
-                          m_setMacState.Cancel ();
-                          m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE);
+                          CancelTransition ();
+                          DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
                         }
                       else
                         {
-                          m_setMacState.Cancel ();
-                          m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA);
+                          CancelTransition ();
+                          DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA));
                         }
                     }
                 }
             }
           else
             {
-              m_macRxDropTrace (originalPkt);
+              m_macRxDropTrace (p);
             }
         }
     }
 }
 
+Ptr<Packet>
+LrWpanMac::GetPayload (Ptr<const Packet> p, const LrWpanMacHeader &hdr, const LrWpanMacTrailer &trailer) const
+{
+  uint32_t headerSize = hdr.GetSerializedSize ();
+  return p->CreateFragment (headerSize, p->GetSize () - headerSize - trailer.GetSerializedSize ());
+}
+
+void
+LrWpanMac::IndicateData (McpsDataIndicationParams params, Ptr<const Packet> p, const LrWpanMacHeader &hdr, const LrWpanMacTrailer &trailer)
+{
+  Ptr<Packet> payload = GetPayload (p, hdr, trailer);
+  if (!hdr.IsAggregate ())
+    {
+      m_mcpsDataIndicationCallback (params, payload);
+      return;
+    }
+
+  // Split the aggregate into its MSDUs, each one preceded by its length.
+  LrWpanSubframeHeader subframeHdr;
+  while (payload->GetSize () >= subframeHdr.GetSerializedSize ())
+    {
+      payload->RemoveHeader (subframeHdr);
+      if (subframeHdr.GetLength () > payload->GetSize ())
+        {
+          NS_LOG_ERROR (this << " malformed aggregate, dropping the remaining MSDUs");
+          m_macRxDropTrace (p);
+          return;
+        }
+      m_mcpsDataIndicationCallback (params, payload->CreateFragment (0, subframeHdr.GetLength ()));
+      payload->RemoveAtStart (subframeHdr.GetLength ());
+    }
+}
+
+void
+LrWpanMac::PdEnergyIndication (double energy, uint8_t slotNumber)
+{
+  LrWpanWorkQueue::Scope scope (m_workQueue);
+  if (IsSensor ())
+  {
+    NS_LOG_FUNCTION (this << energy << "slot " << static_cast<uint32_t> (slotNumber));
+    if (slotNumber != 0)
+      {
+        // The probing starts in the slot of the first CFE, the slots before
+        // it are empty.
+        if (slotNumber <= m_probePowers.size ())
+          {
+            m_probePowers.clear ();
+          }
+        m_probePowers.resize (slotNumber, 0.0);
+        m_probePowers[slotNumber - 1] = energy;
+        if (slotNumber == m_phy->GetProbeSlots ())
+          {
+            if (GetShortAddress () == m_cfeDstAddress)
+              {
+                for (std::map<uint8_t, Mac16Address>::iterator it = m_probeEdts.begin (); it != m_probeEdts.end (); it++)
+                  {
+                    if (it->second != Mac16Address ("ff:ff") && it->first >= 1 && it->first <= m_probePowers.size ()
+                        && m_probePowers[it->first - 1] > 0.0)
+                      {
+                        ChargingCacheEntry entry;
+                        entry.m_power = m_probePowers[it->first - 1];
+                        entry.m_measured = Simulator::Now ();
+                        m_chargingCache[it->second] = entry;
+                      }
+                  }
+              }
+            m_probeEdts.clear ();
+          }
+        if (slotNumber == m_phy->GetProbeSlots () && GetShortAddress () == m_cfeDstAddress)
+          {
+            CancelTransition ();
+            ChangeMacState (MAC_IDLE);
+            DeferTransition (MakeEvent (&LrWpanMac::SendAckAfterCfe, this));
+          }
+        return;
+      }
+  }
+
+  if (slotNumber == 0 && m_lrWpanMacState == MAC_ENERGY_PENDING)
+  {
+    // check whether this device send the rfe packet or not.
+    if (GetShortAddress () == m_cfeDstAddress)
+      {
+        m_rfMacChargeCycleTrace (energy, m_chargingTime);
+        m_cfeDstAddress = Mac16Address ("ff:ff");
+        m_energyWaitTimeout.Cancel ();
+
+        std::map<Mac16Address, ChargingCacheEntry>::iterator it = m_chargingCache.find (m_cachedEdt);
+        if (it != m_chargingCache.end () && m_chargingTime.IsStrictlyPositive ())
+          {
+            // Check the prediction against the harvested energy.
+            double power = energy / m_chargingTime.GetSeconds ();
+            if (std::fabs (power - it->second.m_power) > m_chargingCacheDrift * it->second.m_power)
+              {
+                NS_LOG_DEBUG ("Harvested " << power << " W from " << m_cachedEdt << " instead of " << it->second.m_power << " W, probe it again");
+                m_chargingCache.erase (it);
+              }
+            else
+              {
+                it->second.m_power = power;
+              }
+          }
+        m_cachedEdt = Mac16Address ("ff:ff");
+      }
+
+    if (!m_rfMacEnergyIndicationCallback.IsNull ())
+      {
+        m_rfMacEnergyIndicationCallback (energy);
+      }
+    m_txPkt = 0;
+    CancelTransition ();
+    DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
+  }
+}
+
+void
+LrWpanMac::SendAck (uint8_t seqno, bool framePending)
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (seqno) << framePending);
+
+  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
+
+  // Generate a corresponding ACK Frame.
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_ACKNOWLEDGMENT, seqno);
+  if (framePending)
+    {
+      macHdr.SetFrmPend ();
+    }
+  LrWpanMacTrailer macTrailer;
+  Ptr<Packet> ackPacket = Create<Packet> (0);
+  ackPacket->AddHeader (macHdr);
+  // Calculate FCS if the global attribute ChecksumEnable is set.
+  if (Node::ChecksumEnabled ())
+    {
+      macTrailer.EnableFcs (true);
+      macTrailer.SetFcs (ackPacket);
+    }
+  ackPacket->AddTrailer (macTrailer);
+
+  // Enqueue the ACK packet for further processing
+  // when the transmitter is activated.
+  m_txPkt = ackPacket;
+
+  // Switch transceiver to TX mode. Proceed sending the Ack on confirm.
+  ChangeMacState (MAC_SENDING);
+  m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+}
+
+void
+LrWpanMac::SendBlockAck (uint8_t seqno)
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (seqno));
+
+  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
+
+  // Generate a block ACK covering the frames of the burst received so far.
+  LrWpanBlockAckHeader blockAckHdr;
+  for (std::vector<uint8_t>::const_iterator it = m_blockAckSeqNums.begin (); it != m_blockAckSeqNums.end (); it++)
+    {
+      blockAckHdr.SetReceived (seqno, *it);
+    }
+  m_blockAckSeqNums.clear ();
+
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_ACKNOWLEDGMENT, seqno);
+  macHdr.SetBlockAck ();
+  LrWpanMacTrailer macTrailer;
+  Ptr<Packet> ackPacket = Create<Packet> (0);
+  ackPacket->AddHeader (blockAckHdr);
+  ackPacket->AddHeader (macHdr);
+  // Calculate FCS if the global attribute ChecksumEnable is set.
+  if (Node::ChecksumEnabled ())
+    {
+      macTrailer.EnableFcs (true);
+      macTrailer.SetFcs (ackPacket);
+    }
+  ackPacket->AddTrailer (macTrailer);
+
+  m_txPkt = ackPacket;
+
+  // Switch transceiver to TX mode. Proceed sending the block ACK on confirm.
+  ChangeMacState (MAC_SENDING);
+  m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+}
+
+void
+LrWpanMac::SendRfeForEnergy (void)
+{
+  NS_LOG_FUNCTION (this);
+  LrWpanWorkQueue::Scope scope (m_workQueue);
+	
+  Ptr<Packet> ackPacket = Create<Packet> (0);
+
+  RfMacTypeTag typeTag;
+  typeTag.Set (RfMacTypeTag::RF_MAC_RFE);
+
+  ackPacket->AddPacketTag (typeTag);
+
+  // Ask the strongest EDT probed recently for the energy pulse right away.
+  Mac16Address edt ("ff:ff");
+  double power = 0.0;
+  std::map<Mac16Address, ChargingCacheEntry>::iterator it = m_chargingCache.begin ();
+  while (it != m_chargingCache.end ())
+    {
+      if (Simulator::Now () - it->second.m_measured > m_chargingCacheValidity)
+        {
+          m_chargingCache.erase (it++);
+          continue;
+        }
+      if (it->second.m_power > power)
+        {
+          edt = it->first;
+          power = it->second.m_power;
+        }
+      it++;
+    }
+  if (power > 0.0)
+    {
+      RfMacChargeRequestTag requestTag;
+      requestTag.SetEdt (edt);
+      requestTag.SetChargingTime (Seconds (GetRequiredEnergy () / power));
+      NS_LOG_DEBUG ("Cached power of " << edt << ": " << power << " W, charging time: " << requestTag.GetChargingTime ().GetSeconds () << " s");
+      ackPacket->AddPacketTag (requestTag);
+    }
+
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
+  macHdr.SetSrcAddrMode (SHORT_ADDR);
+  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
+  macHdr.SetDstAddrMode (SHORT_ADDR);
+  macHdr.SetDstAddrFields (0, Mac16Address("ff:ff"));
+
+  ackPacket->AddHeader (macHdr);
+
+  LrWpanMacTrailer macTrailer;
+  
+  if (Node::ChecksumEnabled ())
+    {
+      macTrailer.EnableFcs (true);
+      macTrailer.SetFcs (ackPacket);
+    }
+  ackPacket->AddTrailer (macTrailer);
+
+  // Queue the request ahead of any backlogged data, instead of replacing the
+  // packet currently being sent.
+  EnqueueTxQElement (TX_CLASS_ENERGY, 0, ackPacket);
+  CheckQueue ();
+}
+
+
+void
+LrWpanMac::SendCfeAfterRfe (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
+
+  Ptr<Packet> ackPacket = Create<Packet> (0);
+
+  RfMacTypeTag typeTag;
+  typeTag.Set (RfMacTypeTag::RF_MAC_CFE);
+
+  RfMacDurationTag durationTag;
+  durationTag.Set (m_probeSlotDuration);
+
+  RfMacProbeTag probeTag;
+  probeTag.SetSlots (m_probeSlots);
+  probeTag.SetSlot (m_probeSlot);
+
+  ackPacket->AddPacketTag (typeTag);
+  ackPacket->AddPacketTag (durationTag);
+  ackPacket->AddPacketTag (probeTag);
+
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
+  macHdr.SetSrcAddrMode (SHORT_ADDR);
+  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
+  macHdr.SetDstAddrMode (SHORT_ADDR);
+  if (m_cfeRequesters.empty ())
+    {
+      macHdr.SetDstAddrFields (m_rfeSrcPanId, m_rfeSrcAddress);
+    }
+  else
+    {
+      RfMacRequesterTag requesterTag;
+      for (uint32_t i = 0; i < m_cfeRequesters.size (); i++)
+        {
+          requesterTag.AddRequester (m_cfeRequesters[i]);
+        }
+      ackPacket->AddPacketTag (requesterTag);
+      macHdr.SetDstAddrFields (0, Mac16Address ("ff:ff"));
+
+      // Wait for the probe slots and one CFE_ACK per requester.
+      m_cfeAckChargingTimes.clear ();
+      m_cfeAckTimeout.Cancel ();
+      m_cfeAckTimeout = Simulator::Schedule (m_probeSlots * m_probeSlotDuration
+                                             + static_cast<uint32_t> (m_cfeRequesters.size () + 1) * GetCfeAckSlot (),
+                                             &LrWpanMac::EndCfeAckCollection, this);
+    }
+
+  ackPacket->AddHeader (macHdr);
+
+  LrWpanMacTrailer macTrailer;
+  // Calculate FCS if the global attribute ChecksumEnable is set.
+  if (Node::ChecksumEnabled ())
+    {
+      macTrailer.EnableFcs (true);
+      macTrailer.SetFcs (ackPacket);
+    }
+  ackPacket->AddTrailer (macTrailer);
+
+  m_txPkt = ackPacket;
+  m_rfMacEnergyTxTrace (ackPacket, durationTag.Get ());
+
+  SendNow ();
+}
+
+void
+LrWpanMac::AnswerRfe (Mac16Address sensor, Time offset)
+{
+  NS_LOG_FUNCTION (this << sensor << offset);
+
+  std::map<Mac16Address, RfeCandidate>::const_iterator it = m_rfeCandidates.find (sensor);
+  NS_ASSERT (it != m_rfeCandidates.end ());
+  RfeCandidate candidate = it->second;
+
+  if (!m_rfeAggregationWindow.IsZero ())
+    {
+      AggregateRfe (sensor, offset);
+      return;
+    }
+  if (m_lrWpanMacState != MAC_IDLE || IsTransitionPending ())
+    {
+      NS_LOG_DEBUG ("Selected for " << sensor << ", but busy");
+      return;
+    }
+  m_rfeSrcAddress = sensor;
+  m_rfeSrcPanId = candidate.m_panId;
+  m_groupNumber = candidate.m_groupNumber;
+  m_probeSlot = candidate.m_probeSlot;
+  ScheduleTransition (offset, MakeEvent (&LrWpanMac::SendCfeAfterRfe, this));
+}
+
+void
+LrWpanMac::AggregateRfe (Mac16Address sensor, Time offset)
+{
+  NS_LOG_FUNCTION (this << sensor << offset);
+
+  // The phase, so the probe slot, is per link. Only the sensors of one
+  // probe slot share a CFE.
+  uint8_t slot = static_cast<uint8_t> (offset.GetInteger () / m_probeSlotDuration.GetInteger ()) + 1;
+  for (uint32_t i = 0; i < m_rfeRequesters.size (); i++)
+    {
+      if (m_rfeRequesters[i].first == sensor)
+        {
+          return;
+        }
+    }
+  m_rfeRequesters.push_back (std::make_pair (sensor, slot));
+  if (!m_rfeAggregationEvent.IsRunning ())
+    {
+      m_rfeAggregationEvent = Simulator::Schedule (m_rfeAggregationWindow + offset, &LrWpanMac::EndRfeAggregation, this);
+    }
+}
+
+void
+LrWpanMac::EndRfeAggregation (void)
+{
+  NS_LOG_FUNCTION (this << m_rfeRequesters.size ());
+
+  if (m_rfeRequesters.empty ())
+    {
+      return;
+    }
+  if (m_lrWpanMacState != MAC_IDLE || IsTransitionPending () || m_txPkt != 0)
+    {
+      NS_LOG_DEBUG ("Busy, answer " << m_rfeRequesters.size () << " RFEs later");
+      m_rfeAggregationEvent = Simulator::Schedule (m_rfeAggregationWindow, &LrWpanMac::EndRfeAggregation, this);
+      return;
+    }
+
+  m_probeSlot = m_rfeRequesters.front ().second;
+  m_cfeRequesters.clear ();
+  std::vector<std::pair<Mac16Address, uint8_t> >::iterator it = m_rfeRequesters.begin ();
+  while (it != m_rfeRequesters.end ())
+    {
+      if (it->second == m_probeSlot && m_cfeRequesters.size () < RfMacRequesterTag::MAX_REQUESTERS)
+        {
+          m_cfeRequesters.push_back (it->first);
+          it = m_rfeRequesters.erase (it);
+        }
+      else
+        {
+          it++;
+        }
+    }
+  if (!m_rfeRequesters.empty ())
+    {
+      m_rfeAggregationEvent = Simulator::Schedule (m_rfeAggregationWindow, &LrWpanMac::EndRfeAggregation, this);
+    }
+
+  SendCfeAfterRfe ();
+}
+
+void
+LrWpanMac::EndCfeAckCollection (void)
+{
+  NS_LOG_FUNCTION (this << m_cfeAckChargingTimes.size ());
+
+  m_cfeRequesters.clear ();
+  if (m_lrWpanMacState != MAC_CFE_ACK_PENDING)
+    {
+      return;
+    }
+
+  CancelTransition ();
+  ChangeMacState (MAC_IDLE);
+  if (m_cfeAckChargingTimes.empty ())
+    {
+      NS_LOG_DEBUG ("Probe slot " << static_cast<uint32_t> (m_probeSlot) << " not selected");
+      DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
+      return;
+    }
+
+  // Nearest rank of the percentile.
+  std::sort (m_cfeAckChargingTimes.begin (), m_cfeAckChargingTimes.end ());
+  uint32_t rank = static_cast<uint32_t> (std::ceil (m_chargingTimePercentile * m_cfeAckChargingTimes.size ()));
+  rank = std::max<uint32_t> (rank, 1);
+  Time chargingTime = m_cfeAckChargingTimes[rank - 1];
+  NS_LOG_DEBUG (m_cfeAckChargingTimes.size () << " charging times, pulse of " << chargingTime.GetSeconds () << " s");
+  m_cfeAckChargingTimes.clear ();
+  DeferTransition (MakeEvent (&LrWpanMac::SendEnergyPulse, this, chargingTime));
+}
+
+double
+LrWpanMac::GetRequiredEnergy (void) const
+{
+  return 0.5*36*(m_maxThresholdVoltage*m_maxThresholdVoltage - m_minThresholdVoltage*m_minThresholdVoltage);
+}
+
+Time
+LrWpanMac::GetCfeAckSlot (void) const
+{
+  Ptr<Packet> ackPacket = Create<Packet> (0);
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
+  macHdr.SetSrcAddrMode (SHORT_ADDR);
+  macHdr.SetDstAddrMode (SHORT_ADDR);
+  ackPacket->AddHeader (macHdr);
+  LrWpanMacTrailer macTrailer;
+  ackPacket->AddTrailer (macTrailer);
+
+  return m_phy->CalculateTxTime (ackPacket) + GetSymbolsDuration (m_phy->aTurnaroundTime);
+}
+
 void
-LrWpanMac::PdEnergyIndication (double energy, uint8_t slotNumber)
+LrWpanMac::SendAckAfterCfe (void)
 {
-  if (IsSensor ())
-  {
-    NS_LOG_FUNCTION (this << energy << "slot " << static_cast<uint32_t> (slotNumber));
-    if(slotNumber == 1)
-      {
-        m_receivedEnergyFromFirstSlot = energy; 
-        return;
-      }
-    else if(slotNumber == 2)
-      {
-        m_receivedEnergyFromSecondSlot = energy;
-        if (GetShortAddress () == m_cfeDstAddress)
-          {
-            m_setMacState.Cancel ();
-            ChangeMacState (MAC_IDLE);
-            m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SendAckAfterCfe, this);
-          }
-        return;
-      }
-  }
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
 
-  if (slotNumber == 0 && m_lrWpanMacState == MAC_ENERGY_PENDING)
-  {
-    // check whether this device send the rfe packet or not.
-    if (GetShortAddress () == m_cfeDstAddress)
-      {
+  Ptr<Packet> ackPacket = Create<Packet> (0);
 
-      }
-    else
-      {
+  RfMacTypeTag typeTag;
+  typeTag.Set (RfMacTypeTag::RF_MAC_CFE_ACK);
 
-      }
+  // Select the probe slots contributing enough power, their EDTs send the
+  // energy pulse.
+  double bestPower = 0.0;
+  for (uint32_t i = 0; i < m_probePowers.size (); i++)
+    {
+      bestPower = std::max (bestPower, m_probePowers[i]);
+    }
+  RfMacProbeTag probeTag;
+  uint16_t selected = 0;
+  double power = 0.0;
+  for (uint32_t i = 0; i < m_probePowers.size (); i++)
+    {
+      if (m_probePowers[i] > 0.0 && m_probePowers[i] >= m_probeSlotThreshold * bestPower)
+        {
+          selected |= (1 << i);
+          power += m_probePowers[i];
+        }
+    }
+  probeTag.SetSelected (selected);
 
-    if (!m_rfMacEnergyIndicationCallback.IsNull ())
-      {
-        m_rfMacEnergyIndicationCallback (energy);
-      }
-    m_txPkt = 0;
-    m_setMacState.Cancel ();
-    m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE);
-  }
-}
+  if (power <= 0.0)
+    {
+      // Nothing was harvested in the probe slots, no EDT can charge us.
+      NS_LOG_DEBUG ("No power in the " << m_probePowers.size () << " probe slots, no CFE_ACK");
+      m_cfeDstAddress = Mac16Address ("ff:ff");
+      SetLrWpanMacState (MAC_IDLE);
+      return;
+    }
 
-void
-LrWpanMac::SendAck (uint8_t seqno)
-{
-  NS_LOG_FUNCTION (this << static_cast<uint32_t> (seqno));
+  //need to calculate charging time T
+  double requiredEnergy = GetRequiredEnergy ();
+  double time = requiredEnergy / power;
+  NS_LOG_DEBUG ("probe slots: " << m_probePowers.size () << " selected: " << selected << " power: " << power);
+  NS_LOG_DEBUG ("max v: "<<m_maxThresholdVoltage<< " min v: "<<m_minThresholdVoltage<< " required energy: "<<requiredEnergy<<" charging time: "<<time);
+  Time chargingTime = Seconds (time);
+  m_chargingTime = chargingTime;
 
-  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
+  RfMacDurationTag durationTag;
+  durationTag.Set (chargingTime);
+
+  ackPacket->AddPacketTag (typeTag);
+  ackPacket->AddPacketTag (durationTag);
+  ackPacket->AddPacketTag (probeTag);
 
   // Generate a corresponding ACK Frame.
-  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_ACKNOWLEDGMENT, seqno);
-  LrWpanMacTrailer macTrailer;
-  Ptr<Packet> ackPacket = Create<Packet> (0);
+  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
+  macHdr.SetSrcAddrMode (SHORT_ADDR);
+  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
+  macHdr.SetDstAddrMode (SHORT_ADDR);
+  macHdr.SetDstAddrFields (0, Mac16Address("ff:ff"));
+
   ackPacket->AddHeader (macHdr);
+
+  LrWpanMacTrailer macTrailer;
   // Calculate FCS if the global attribute ChecksumEnable is set.
   if (Node::ChecksumEnabled ())
     {
       macTrailer.EnableFcs (true);
       macTrailer.SetFcs (ackPacket);
     }
+
   ackPacket->AddTrailer (macTrailer);
 
-  // Enqueue the ACK packet for further processing
-  // when the transmitter is activated.
   m_txPkt = ackPacket;
 
-  // Switch transceiver to TX mode. Proceed sending the Ack on confirm.
-  ChangeMacState (MAC_SENDING);
-  m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+  if (m_cfeAckIndex > 0)
+    {
+      // Follow the CFE_ACKs of the sensors listed before in the multicast CFE.
+      ScheduleTransition (m_cfeAckIndex * GetCfeAckSlot (), MakeEvent (&LrWpanMac::SendNow, this));
+    }
+  else
+    {
+      SendNow ();
+    }
 }
 
 void
-LrWpanMac::SendRfeForEnergy (void)
+LrWpanMac::SendEnergyPulse (Time chargingTime)
 {
   NS_LOG_FUNCTION (this);
-	
-  Ptr<Packet> ackPacket = Create<Packet> (0);
+  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
+
+  Ptr<Packet> energyPulse = Create<Packet> (0);
 
   RfMacTypeTag typeTag;
-  typeTag.Set (RfMacTypeTag::RF_MAC_RFE);
+  typeTag.Set (RfMacTypeTag::RF_MAC_ENERGY);
 
-  ackPacket->AddPacketTag (typeTag);
+  RfMacDurationTag durationTag;
+  durationTag.Set (chargingTime);
+
+  energyPulse->AddPacketTag (typeTag);
+  energyPulse->AddPacketTag (durationTag);
 
   LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
   macHdr.SetSrcAddrMode (SHORT_ADDR);
@@ -892,188 +2409,663 @@ LrWpanMac::SendRfeForEnergy (void)
   macHdr.SetDstAddrMode (SHORT_ADDR);
   macHdr.SetDstAddrFields (0, Mac16Address("ff:ff"));
 
-  ackPacket->AddHeader (macHdr);
+  energyPulse->AddHeader (macHdr);
 
   LrWpanMacTrailer macTrailer;
-  
+  // Calculate FCS if the global attribute ChecksumEnable is set.
   if (Node::ChecksumEnabled ())
     {
       macTrailer.EnableFcs (true);
-      macTrailer.SetFcs (ackPacket);
+      macTrailer.SetFcs (energyPulse);
     }
-  ackPacket->AddTrailer (macTrailer);
 
-  m_txPkt = ackPacket;
+  energyPulse->AddTrailer (macTrailer);
+
+  m_txPkt = energyPulse;
+  m_rfMacEnergyTxTrace (energyPulse, chargingTime);
 
-  Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA);
+  SendNow ();
 }
 
+void
+LrWpanMac::SendNow (void)
+{
+  NS_LOG_FUNCTION (this);
+  // m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA);
+  ChangeMacState (MAC_SENDING);
+  m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+}
 
 void
-LrWpanMac::SendCfeAfterRfe (void)
+LrWpanMac::RemoveFirstTxQElement ()
+{
+  m_numCsmacaRetry += m_csmaCa->GetNB () + 1;
+
+  // An aggregated frame carries the first m_txMsdus elements of the queue.
+  for (uint32_t i = 0; i < m_txMsdus; i++)
+    {
+      Ptr<const Packet> p = m_txQueue[m_txClass].Front ().txQPkt;
+
+      Ptr<Packet> pkt = p->Copy ();
+      LrWpanMacHeader hdr;
+      pkt->RemoveHeader (hdr);
+      if (hdr.GetShortDstAddr () != Mac16Address ("ff:ff"))
+        {
+          m_sentPktTrace (p, m_retransmission + 1, m_numCsmacaRetry);
+        }
+
+      m_txQueue[m_txClass].PopFront ();
+      m_macTxDequeueTrace (p);
+      m_macTxClassDequeueTrace (p, m_txClass);
+    }
+  m_txPkt = 0;
+  m_txMsdus = 1;
+  m_burst = false;
+  m_strobing = false;
+  m_retransmission = 0;
+  m_numCsmacaRetry = 0;
+}
+
+void
+LrWpanMac::ConfirmTxQElements (LrWpanMcpsDataConfirmStatus status)
+{
+  NS_LOG_FUNCTION (this << status);
+
+  // Energy requests are generated by the MAC itself, not requested by the
+  // upper layer.
+  if (m_txClass == TX_CLASS_ENERGY)
+    {
+      return;
+    }
+
+  NS_ASSERT_MSG (m_txQueue[m_txClass].GetSize () >= m_txMsdus, "TxQsize = " << m_txQueue[m_txClass].GetSize ());
+  LrWpanMacHeader macHdr;
+  m_txQueue[m_txClass].Front ().txQPkt->PeekHeader (macHdr);
+  if (macHdr.IsCommand ())
+    {
+      // A data request is confirmed as a poll request. Its success depends on
+      // the ACK, and is reported when the ACK is received.
+      if (status == IEEE_802_15_4_CHANNEL_ACCESS_FAILURE)
+        {
+          ConfirmPoll (MLMEPOLL_CHANNEL_ACCESS_FAILURE);
+        }
+      else if (status != IEEE_802_15_4_SUCCESS)
+        {
+          ConfirmPoll (MLMEPOLL_NO_ACK);
+        }
+      return;
+    }
+  McpsDataConfirmParams confirmParams;
+  confirmParams.m_status = status;
+  if (m_mcpsDataConfirmCallback.IsNull ())
+    {
+      return;
+    }
+  for (uint32_t i = 0; i < m_txMsdus; i++)
+    {
+      confirmParams.m_msduHandle = m_txQueue[m_txClass].Get (i).txQMsduHandle;
+      m_mcpsDataConfirmCallback (confirmParams);
+    }
+}
+
+void
+LrWpanMac::EnqueueIndTxQElement (uint8_t msduHandle, Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (msduHandle) << p);
+
+  if (m_indTxQueueSize >= m_maxIndTxQueueSize)
+    {
+      NS_LOG_DEBUG (this << " too many pending transactions, dropping the new packet");
+      m_macTxQueueOverflowTrace (p);
+      if (!m_mcpsDataConfirmCallback.IsNull ())
+        {
+          McpsDataConfirmParams confirmParams;
+          confirmParams.m_msduHandle = msduHandle;
+          confirmParams.m_status = IEEE_802_15_4_TRANSACTION_OVERFLOW;
+          m_mcpsDataConfirmCallback (confirmParams);
+        }
+      return;
+    }
+
+  LrWpanMacHeader macHdr;
+  p->PeekHeader (macHdr);
+  IndTxQueueElement element;
+  element.txQMsduHandle = msduHandle;
+  element.txQPkt = p;
+  element.expireTime = Simulator::Now () + GetTransactionPersistenceTime ();
+  m_indTxQueue[macHdr.GetShortDstAddr ()].push_back (element);
+  m_indTxQueueSize++;
+
+  // All transactions persist for the same time, the new one expires last.
+  if (!m_indTxExpiryEvent.IsRunning ())
+    {
+      m_indTxExpiryEvent = Simulator::Schedule (GetTransactionPersistenceTime (), &LrWpanMac::PurgeIndTxQueue, this);
+    }
+}
+
+bool
+LrWpanMac::ExtractIndTxQElement (Mac16Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  std::map<Mac16Address, std::list<IndTxQueueElement> >::iterator it = m_indTxQueue.find (address);
+  if (it == m_indTxQueue.end ())
+    {
+      return false;
+    }
+
+  IndTxQueueElement element = it->second.front ();
+  it->second.pop_front ();
+  m_indTxQueueSize--;
+  Ptr<Packet> p = element.txQPkt;
+  LrWpanMacHeader macHdr;
+  if (it->second.empty ())
+    {
+      m_indTxQueue.erase (it);
+      p->PeekHeader (macHdr);
+    }
+  else
+    {
+      // Tell the device to poll again.
+      LrWpanMacTrailer macTrailer;
+      p->RemoveHeader (macHdr);
+      p->RemoveTrailer (macTrailer);
+      macHdr.SetFrmPend ();
+      p->AddHeader (macHdr);
+      if (Node::ChecksumEnabled ())
+        {
+          macTrailer.EnableFcs (true);
+          macTrailer.SetFcs (p);
+        }
+      p->AddTrailer (macTrailer);
+    }
+
+  EnqueueTxQElement (macHdr.IsAckReq () ? TX_CLASS_ACK_DATA : TX_CLASS_BEST_EFFORT, element.txQMsduHandle, p);
+  return true;
+}
+
+void
+LrWpanMac::PurgeIndTxQueue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
+  // The transactions of each destination are in the order of their expiry.
+  bool pending = false;
+  Time nextExpiry;
+  std::map<Mac16Address, std::list<IndTxQueueElement> >::iterator it = m_indTxQueue.begin ();
+  while (it != m_indTxQueue.end ())
+    {
+      std::list<IndTxQueueElement> &transactions = it->second;
+      while (!transactions.empty () && transactions.front ().expireTime <= Simulator::Now ())
+        {
+          NS_LOG_DEBUG (this << " transaction for " << it->first << " expired");
+          m_macTxDropTrace (transactions.front ().txQPkt);
+          if (!m_mcpsDataConfirmCallback.IsNull ())
+            {
+              McpsDataConfirmParams confirmParams;
+              confirmParams.m_msduHandle = transactions.front ().txQMsduHandle;
+              confirmParams.m_status = IEEE_802_15_4_TRANSACTION_EXPIRED;
+              m_mcpsDataConfirmCallback (confirmParams);
+            }
+          transactions.pop_front ();
+          m_indTxQueueSize--;
+        }
+      if (transactions.empty ())
+        {
+          m_indTxQueue.erase (it++);
+        }
+      else
+        {
+          if (!pending || transactions.front ().expireTime < nextExpiry)
+            {
+              nextExpiry = transactions.front ().expireTime;
+              pending = true;
+            }
+          it++;
+        }
+    }
 
-  Ptr<Packet> ackPacket = Create<Packet> (0);
+  if (pending)
+    {
+      m_indTxExpiryEvent = Simulator::Schedule (nextExpiry - Simulator::Now (), &LrWpanMac::PurgeIndTxQueue, this);
+    }
+}
 
-  RfMacTypeTag typeTag;
-  typeTag.Set (RfMacTypeTag::RF_MAC_CFE);
+Time
+LrWpanMac::GetTransactionPersistenceTime (void) const
+{
+  uint64_t unitPeriod = m_aBaseSuperframeDuration;
+  if (IsBeaconEnabled ())
+    {
+      unitPeriod <<= m_macBeaconOrder;
+    }
+  return GetSymbolsDuration (m_macTransactionPersistenceTime * unitPeriod);
+}
 
-  RfMacDurationTag durationTag;
-  durationTag.Set (MicroSeconds (10.0));
+uint32_t
+LrWpanMac::GetPendingTransactions (void) const
+{
+  return m_indTxQueueSize;
+}
+
+void
+LrWpanMac::PollWaitTimeout (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_LOG_DEBUG (this << " no data received after the data request");
+  ConfirmPoll (MLMEPOLL_NO_DATA);
+  if (m_lrWpanMacState == MAC_IDLE && !IsTransitionPending ())
+    {
+      m_phy->PlmeSetTRXStateRequest (GetIdleTrxState ());
+    }
+}
+
+void
+LrWpanMac::ConfirmPoll (LrWpanMlmePollConfirmStatus status)
+{
+  NS_LOG_FUNCTION (this << status);
+
+  if (!m_mlmePollConfirmCallback.IsNull ())
+    {
+      MlmePollConfirmParams confirmParams;
+      confirmParams.m_status = status;
+      m_mlmePollConfirmCallback (confirmParams);
+    }
+}
+
+bool
+LrWpanMac::IsSameLink (const LrWpanMacHeader &hdr1, const LrWpanMacHeader &hdr2) const
+{
+  return hdr1.GetType () == hdr2.GetType ()
+         && hdr1.GetDstAddrMode () == hdr2.GetDstAddrMode ()
+         && hdr1.GetDstPanId () == hdr2.GetDstPanId ()
+         && hdr1.GetShortDstAddr () == hdr2.GetShortDstAddr ()
+         && hdr1.GetExtDstAddr () == hdr2.GetExtDstAddr ()
+         && hdr1.GetSrcAddrMode () == hdr2.GetSrcAddrMode ()
+         && hdr1.GetSerializedSize () == hdr2.GetSerializedSize ();
+}
+
+bool
+LrWpanMac::StartBurst (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_burst = false;
+  LrWpanTxQueue &queue = m_txQueue[m_txClass];
+  if (m_maxBurstSize < 2 || m_txClass != TX_CLASS_ACK_DATA || queue.GetSize () < 2)
+    {
+      return false;
+    }
+
+  // Take the following data packets for the same destination, as long as the
+  // block ACK bitmap covers their sequence numbers. MAC commands are never
+  // sent in a burst.
+  LrWpanMacHeader macHdr;
+  queue.Front ().txQPkt->PeekHeader (macHdr);
+  if (!macHdr.IsData ())
+    {
+      return false;
+    }
+  uint32_t count = 1;
+  while (count < queue.GetSize () && count < m_maxBurstSize)
+    {
+      LrWpanMacHeader nextHdr;
+      queue.Get (count).txQPkt->PeekHeader (nextHdr);
+      uint8_t span = nextHdr.GetSeqNum () - macHdr.GetSeqNum ();
+      if (!nextHdr.IsData () || !IsSameLink (macHdr, nextHdr)
+          || span >= LrWpanBlockAckHeader::BITMAP_SIZE)
+        {
+          break;
+        }
+      count++;
+    }
 
-  ackPacket->AddPacketTag (typeTag);
-  ackPacket->AddPacketTag (durationTag);
+  if (count == 1)
+    {
+      return false;
+    }
 
-  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
-  macHdr.SetSrcAddrMode (SHORT_ADDR);
-  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
-  macHdr.SetDstAddrMode (SHORT_ADDR);
-  macHdr.SetDstAddrFields (m_rfeSrcPanId, m_rfeSrcAddress);
+  NS_LOG_DEBUG (this << " starting a burst of " << count << " frames");
+  m_burst = true;
+  m_txMsdus = count;
+  m_burstFrame = 0;
+  m_txPkt = GetBurstFrame (m_burstFrame);
+  return true;
+}
 
-  ackPacket->AddHeader (macHdr);
+Ptr<Packet>
+LrWpanMac::GetBurstFrame (uint32_t index)
+{
+  NS_LOG_FUNCTION (this << index);
+  NS_ASSERT (index < m_txMsdus);
 
+  // The frames of a burst do not request an ACK on their own. All but the
+  // last one announce a following frame.
+  Ptr<Packet> frame = m_txQueue[m_txClass].Get (index).txQPkt->Copy ();
+  LrWpanMacHeader macHdr;
   LrWpanMacTrailer macTrailer;
-  // Calculate FCS if the global attribute ChecksumEnable is set.
+  frame->RemoveHeader (macHdr);
+  frame->RemoveTrailer (macTrailer);
+  macHdr.SetNoAckReq ();
+  macHdr.SetBlockAck ();
+  if (index + 1 < m_txMsdus)
+    {
+      macHdr.SetFrmPend ();
+    }
+  else
+    {
+      macHdr.SetNoFrmPend ();
+    }
+  frame->AddHeader (macHdr);
   if (Node::ChecksumEnabled ())
     {
       macTrailer.EnableFcs (true);
-      macTrailer.SetFcs (ackPacket);
+      macTrailer.SetFcs (frame);
     }
-  ackPacket->AddTrailer (macTrailer);
+  frame->AddTrailer (macTrailer);
+  return frame;
+}
 
-  m_txPkt = ackPacket;
+bool
+LrWpanMac::ReceiveBlockAck (const LrWpanBlockAckHeader &blockAckHdr, uint8_t lastSeqNum)
+{
+  NS_LOG_FUNCTION (this << blockAckHdr.GetBitmap () << static_cast<uint32_t> (lastSeqNum));
+
+  // Confirm and remove the acknowledged frames. The missing ones are kept in
+  // order at the head of the queue.
+  LrWpanTxQueue &queue = m_txQueue[m_txClass];
+  uint8_t numCsmacaRetry = m_numCsmacaRetry + m_csmaCa->GetNB () + 1;
+  uint32_t missing = 0;
+  for (uint32_t i = 0; i < m_txMsdus; i++)
+    {
+      LrWpanTxQueue::Element txQElement = queue.Get (missing);
+      LrWpanMacHeader hdr;
+      txQElement.txQPkt->PeekHeader (hdr);
+      if (!blockAckHdr.IsReceived (lastSeqNum, hdr.GetSeqNum ()))
+        {
+          missing++;
+          continue;
+        }
 
-  SendNow ();
+      m_macTxOkTrace (txQElement.txQPkt);
+      if (!m_mcpsDataConfirmCallback.IsNull ())
+        {
+          McpsDataConfirmParams confirmParams;
+          confirmParams.m_msduHandle = txQElement.txQMsduHandle;
+          confirmParams.m_status = IEEE_802_15_4_SUCCESS;
+          m_mcpsDataConfirmCallback (confirmParams);
+        }
+      m_sentPktTrace (txQElement.txQPkt, m_retransmission + 1, numCsmacaRetry);
+      queue.Remove (missing);
+      m_macTxDequeueTrace (txQElement.txQPkt);
+      m_macTxClassDequeueTrace (txQElement.txQPkt, m_txClass);
+    }
+
+  NS_LOG_DEBUG (this << " block ACK, " << missing << " of " << m_txMsdus << " frames missing");
+  if (missing == 0)
+    {
+      m_txPkt = 0;
+      m_txMsdus = 1;
+      m_burst = false;
+      m_retransmission = 0;
+      m_numCsmacaRetry = 0;
+      return true;
+    }
+  m_txMsdus = missing;
+  return false;
 }
 
-void
-LrWpanMac::SendAckAfterCfe (void)
+Ptr<Packet>
+LrWpanMac::AggregateTxQElements (void)
 {
   NS_LOG_FUNCTION (this);
-  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
 
-  Ptr<Packet> ackPacket = Create<Packet> (0);
-
-  //Frequency Optimization and Calculate the charging time.
-  RfMacTypeTag typeTag;
-  typeTag.Set (RfMacTypeTag::RF_MAC_CFE_ACK);
-
-  //need to calculate charging time T
-  double requiredEnergy = 0.5*36*(m_maxThresholdVoltage*m_maxThresholdVoltage - m_minThresholdVoltage*m_minThresholdVoltage);
-  double time = requiredEnergy / (m_receivedEnergyFromFirstSlot + m_receivedEnergyFromSecondSlot);
-  NS_LOG_DEBUG ("max v: "<<m_maxThresholdVoltage<< " min v: "<<m_minThresholdVoltage<< " required energy: "<<requiredEnergy<<" charging time: "<<time);
-  Time chargingTime = Seconds (time);
+  LrWpanTxQueue &queue = m_txQueue[m_txClass];
+  Ptr<Packet> head = queue.Front ().txQPkt;
+  m_txMsdus = 1;
+  if (!m_aggregation || m_txClass == TX_CLASS_ENERGY || queue.GetSize () < 2)
+    {
+      return head;
+    }
 
-  RfMacDurationTag durationTag;
-  durationTag.Set (chargingTime);
+  // Only data frames are aggregated, MAC commands such as the data requests
+  // of a poll are always sent on their own.
+  LrWpanMacHeader macHdr;
+  head->PeekHeader (macHdr);
+  if (!macHdr.IsData ())
+    {
+      return head;
+    }
+  LrWpanMacTrailer macTrailer;
+  LrWpanSubframeHeader subframeHdr;
+  uint32_t overhead = macHdr.GetSerializedSize () + macTrailer.GetSerializedSize ();
+  // The head gains a subframe header in the aggregate.
+  uint32_t frameSize = head->GetSize () + subframeHdr.GetSerializedSize ();
+
+  // Take the following packets for the same destination, as long as the
+  // aggregate fits in a PSDU. The queue order is kept.
+  uint32_t count = 1;
+  while (count < queue.GetSize ())
+    {
+      Ptr<Packet> next = queue.Get (count).txQPkt;
+      LrWpanMacHeader nextHdr;
+      next->PeekHeader (nextHdr);
+      if (!IsSameLink (macHdr, nextHdr))
+        {
+          break;
+        }
+      uint32_t subframeSize = subframeHdr.GetSerializedSize () + next->GetSize () - overhead;
+      if (frameSize + subframeSize > LrWpanPhy::aMaxPhyPacketSize)
+        {
+          break;
+        }
+      frameSize += subframeSize;
+      count++;
+    }
 
-  ackPacket->AddPacketTag (typeTag);
-  ackPacket->AddPacketTag (durationTag);
+  if (count == 1)
+    {
+      return head;
+    }
 
-  // Generate a corresponding ACK Frame.
-  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
-  macHdr.SetSrcAddrMode (SHORT_ADDR);
-  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
-  macHdr.SetDstAddrMode (SHORT_ADDR);
-  macHdr.SetDstAddrFields (0, Mac16Address("ff:ff"));
+  NS_LOG_DEBUG (this << " aggregating " << count << " packets in a frame of " << frameSize << " bytes");
 
-  ackPacket->AddHeader (macHdr);
+  // The aggregate keeps the MAC header, the sequence number and the tags of
+  // the head of the queue.
+  Ptr<Packet> frame;
+  for (uint32_t i = 0; i < count; i++)
+    {
+      Ptr<Packet> p = queue.Get (i).txQPkt;
+      Ptr<Packet> msdu = p->CreateFragment (macHdr.GetSerializedSize (), p->GetSize () - overhead);
+      msdu->AddHeader (LrWpanSubframeHeader (msdu->GetSize ()));
+      if (frame == 0)
+        {
+          frame = msdu;
+        }
+      else
+        {
+          frame->AddAtEnd (msdu);
+        }
+    }
 
-  LrWpanMacTrailer macTrailer;
-  // Calculate FCS if the global attribute ChecksumEnable is set.
+  macHdr.SetAggregate ();
+  frame->AddHeader (macHdr);
   if (Node::ChecksumEnabled ())
     {
       macTrailer.EnableFcs (true);
-      macTrailer.SetFcs (ackPacket);
+      macTrailer.SetFcs (frame);
     }
+  frame->AddTrailer (macTrailer);
 
-  ackPacket->AddTrailer (macTrailer);
-
-  m_txPkt = ackPacket;
-
-  SendNow ();
+  m_txMsdus = count;
+  return frame;
 }
 
 void
-LrWpanMac::SendEnergyPulse (Time chargingTime)
+LrWpanMac::EnqueueTxQElement (LrWpanTxQueueClass txClass, uint8_t msduHandle, Ptr<Packet> p)
 {
-  NS_LOG_FUNCTION (this);
-  NS_ASSERT (m_lrWpanMacState == MAC_IDLE);
-
-  Ptr<Packet> energyPulse = Create<Packet> (0);
+  NS_LOG_FUNCTION (this << txClass << static_cast<uint32_t> (msduHandle) << p);
 
-  RfMacTypeTag typeTag;
-  typeTag.Set (RfMacTypeTag::RF_MAC_ENERGY);
+  if (m_txQueue[txClass].GetSize () >= m_maxQueueSize && !DropWaitingTxQElement (txClass))
+    {
+      NS_LOG_DEBUG (this << " transmission queue full, dropping the new packet");
+      TxQueueOverflow (txClass, msduHandle, p);
+      return;
+    }
 
-  RfMacDurationTag durationTag;
-  durationTag.Set (chargingTime);
+  m_macTxEnqueueTrace (p);
+  m_macTxClassEnqueueTrace (p, txClass);
+  m_txQueue[txClass].PushBack (msduHandle, p);
+}
 
-  energyPulse->AddPacketTag (typeTag);
-  energyPulse->AddPacketTag (durationTag);
+bool
+LrWpanMac::DropWaitingTxQElement (LrWpanTxQueueClass txClass)
+{
+  NS_LOG_FUNCTION (this << txClass);
 
-  LrWpanMacHeader macHdr (LrWpanMacHeader::LRWPAN_MAC_RF_MAC, 0);
-  macHdr.SetSrcAddrMode (SHORT_ADDR);
-  macHdr.SetSrcAddrFields (GetPanId (), GetShortAddress ());
-  macHdr.SetDstAddrMode (SHORT_ADDR);
-  macHdr.SetDstAddrFields (0, Mac16Address("ff:ff"));
+  LrWpanTxQueue &queue = m_txQueue[txClass];
 
-  energyPulse->AddHeader (macHdr);
+  // The head of the queue is the packet currently being sent, or the next
+  // one to be sent as soon as the MAC becomes idle. It is never dropped, nor
+  // are the packets aggregated with it.
+  uint32_t first = (txClass == m_txClass) ? m_txMsdus : 1;
+  uint32_t victim = 0;
+  switch (m_txQueueDropPolicy)
+    {
+    case TX_QUEUE_TAIL_DROP:
+      break;
+    case TX_QUEUE_HEAD_DROP:
+      if (queue.GetSize () > first)
+        {
+          victim = first;
+        }
+      break;
+    default:
+      NS_FATAL_ERROR ("Unknown transmission queue drop policy " << m_txQueueDropPolicy);
+    }
 
-  LrWpanMacTrailer macTrailer;
-  // Calculate FCS if the global attribute ChecksumEnable is set.
-  if (Node::ChecksumEnabled ())
+  if (victim == 0)
     {
-      macTrailer.EnableFcs (true);
-      macTrailer.SetFcs (energyPulse);
+      return false;
     }
 
-  energyPulse->AddTrailer (macTrailer);
+  NS_LOG_DEBUG (this << " transmission queue full, dropping queued packet " << victim);
+  LrWpanTxQueue::Element txQElement = queue.Get (victim);
+  queue.Remove (victim);
+  TxQueueOverflow (txClass, txQElement.txQMsduHandle, txQElement.txQPkt);
+  return true;
+}
 
-  m_txPkt = energyPulse;
+void
+LrWpanMac::TxQueueOverflow (LrWpanTxQueueClass txClass, uint8_t msduHandle, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (this << txClass << static_cast<uint32_t> (msduHandle) << p);
 
-  SendNow ();
+  m_macTxQueueOverflowTrace (p);
+  m_macTxClassDropTrace (p, txClass);
+  // Energy requests are generated by the MAC itself, not requested by the
+  // upper layer.
+  if (txClass == TX_CLASS_ENERGY)
+    {
+      return;
+    }
+  // A data request is confirmed as a poll request.
+  LrWpanMacHeader macHdr;
+  p->PeekHeader (macHdr);
+  if (macHdr.IsCommand ())
+    {
+      ConfirmPoll (MLMEPOLL_TRANSACTION_OVERFLOW);
+    }
+  else if (!m_mcpsDataConfirmCallback.IsNull ())
+    {
+      McpsDataConfirmParams confirmParams;
+      confirmParams.m_msduHandle = msduHandle;
+      confirmParams.m_status = IEEE_802_15_4_TRANSACTION_OVERFLOW;
+      m_mcpsDataConfirmCallback (confirmParams);
+    }
 }
 
-void
-LrWpanMac::SendNow (void)
+bool
+LrWpanMac::SelectTxClass (void)
 {
   NS_LOG_FUNCTION (this);
-  // m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_CSMA);
-  ChangeMacState (MAC_SENDING);
-  m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+
+  if (m_txQueueScheduling == TX_QUEUE_WEIGHTED_ROUND_ROBIN)
+    {
+      // Serve the backlogged classes in priority order as long as they have
+      // credits left. When all of them used their credits, start a new round.
+      for (uint32_t round = 0; round < 2; round++)
+        {
+          for (uint32_t i = 0; i < TX_CLASS_GTS; i++)
+            {
+              if (!m_txQueue[i].IsEmpty () && m_txQueueCredits[i] > 0)
+                {
+                  m_txQueueCredits[i]--;
+                  m_txClass = static_cast<LrWpanTxQueueClass> (i);
+                  return true;
+                }
+            }
+          m_txQueueCredits[TX_CLASS_ENERGY] = m_energyQueueWeight;
+          m_txQueueCredits[TX_CLASS_ACK_DATA] = m_ackDataQueueWeight;
+          m_txQueueCredits[TX_CLASS_BEST_EFFORT] = m_bestEffortQueueWeight;
+        }
+    }
+
+  // The GTS class is served by SendGtsFrame only.
+  for (uint32_t i = 0; i < TX_CLASS_GTS; i++)
+    {
+      if (!m_txQueue[i].IsEmpty ())
+        {
+          m_txClass = static_cast<LrWpanTxQueueClass> (i);
+          return true;
+        }
+    }
+  return false;
 }
 
 void
-LrWpanMac::RemoveFirstTxQElement ()
+LrWpanMac::SetMaxQueueSize (uint32_t size)
 {
-  TxQueueElement *txQElement = m_txQueue.front ();
-  Ptr<const Packet> p = txQElement->txQPkt;
-  m_numCsmacaRetry += m_csmaCa->GetNB () + 1;
+  NS_LOG_FUNCTION (this << size);
 
-  Ptr<Packet> pkt = p->Copy ();
-  LrWpanMacHeader hdr;
-  pkt->RemoveHeader (hdr);
-  if (hdr.GetShortDstAddr () != Mac16Address ("ff:ff"))
+  m_maxQueueSize = size;
+  for (uint32_t i = 0; i < TX_QUEUE_CLASSES; i++)
     {
-      m_sentPktTrace (p, m_retransmission + 1, m_numCsmacaRetry);
+      // Drop the newest packets which do not fit anymore. Like in
+      // DropWaitingTxQElement, the head of the queue and the packets sent
+      // together with it are kept, so the capacity may stay above the size.
+      LrWpanTxQueueClass txClass = static_cast<LrWpanTxQueueClass> (i);
+      uint32_t first = (txClass == m_txClass) ? m_txMsdus : 1;
+      while (m_txQueue[i].GetSize () > std::max (size, first))
+        {
+          LrWpanTxQueue::Element txQElement = m_txQueue[i].Get (m_txQueue[i].GetSize () - 1);
+          m_txQueue[i].Remove (m_txQueue[i].GetSize () - 1);
+          TxQueueOverflow (txClass, txQElement.txQMsduHandle, txQElement.txQPkt);
+        }
+      m_txQueue[i].SetCapacity (std::max (size, m_txQueue[i].GetSize ()));
     }
+}
 
-  txQElement->txQPkt = 0;
-  delete txQElement;
-  m_txQueue.pop_front ();
-  m_txPkt = 0;
-  m_retransmission = 0;
-  m_numCsmacaRetry = 0;
-  m_macTxDequeueTrace (p);
+uint32_t
+LrWpanMac::GetMaxQueueSize (void) const
+{
+  return m_maxQueueSize;
 }
 
 void
 LrWpanMac::AckWaitTimeout (void)
 {
   NS_LOG_FUNCTION (this);
+  LrWpanWorkQueue::Scope scope (m_workQueue);
+
+  if (IsStrobing ())
+    {
+      // The destination may still be asleep. Repeat the frame right away,
+      // without a channel access or a retransmission.
+      SendNow ();
+      return;
+    }
 
   // TODO: If we are a PAN coordinator and this was an indirect transmission,
   //       we will not initiate a retransmission. Instead we wait for the data
@@ -1097,15 +3089,9 @@ LrWpanMac::PrepareRetransmission (void)
     {
       // Maximum number of retransmissions has been reached.
       // remove the copy of the packet that was just sent
-      TxQueueElement *txQElement = m_txQueue.front ();
-      m_macTxDropTrace (txQElement->txQPkt);
-      if (!m_mcpsDataConfirmCallback.IsNull ())
-        {
-          McpsDataConfirmParams confirmParams;
-          confirmParams.m_msduHandle = txQElement->txQMsduHandle;
-          confirmParams.m_status = IEEE_802_15_4_NO_ACK;
-          m_mcpsDataConfirmCallback (confirmParams);
-        }
+      m_macTxDropTrace (m_txPkt);
+      m_macTxClassDropTrace (m_txPkt, m_txClass);
+      ConfirmTxQElements (IEEE_802_15_4_NO_ACK);
       RemoveFirstTxQElement ();
       return false;
     }
@@ -1113,6 +3099,14 @@ LrWpanMac::PrepareRetransmission (void)
     {
       m_retransmission++;
       m_numCsmacaRetry += m_csmaCa->GetNB () + 1;
+      // A retransmission is strobed again.
+      m_strobing = false;
+      if (m_burst)
+        {
+          // Restart the burst with its first frame.
+          m_burstFrame = 0;
+          m_txPkt = GetBurstFrame (m_burstFrame);
+        }
       // Start next CCA process for this packet.
       return true;
     }
@@ -1121,9 +3115,10 @@ LrWpanMac::PrepareRetransmission (void)
 void
 LrWpanMac::PdDataConfirm (LrWpanPhyEnumeration status)
 {
+  LrWpanWorkQueue::Scope scope (m_workQueue);
   NS_ASSERT (m_lrWpanMacState == MAC_SENDING);
 
-  NS_LOG_FUNCTION (this << status << m_txQueue.size ());
+  NS_LOG_FUNCTION (this << status << m_txQueue[m_txClass].GetSize ());
 
   LrWpanMacHeader macHdr;
   m_txPkt->PeekHeader (macHdr);
@@ -1157,49 +3152,95 @@ LrWpanMac::PdDataConfirm (LrWpanPhyEnumeration status)
                   Time waitTime = MicroSeconds (GetMacAckWaitDuration () * 1000 * 1000 / m_phy->GetDataOrSymbolRate (false));
                   NS_ASSERT (m_ackWaitTimeout.IsExpired ());
                   m_ackWaitTimeout = Simulator::Schedule (waitTime, &LrWpanMac::AckWaitTimeout, this);
-                  m_setMacState.Cancel ();
-                  m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_ACK_PENDING);
+                  CancelTransition ();
+                  DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_ACK_PENDING));
                   return;
                 // }
             }
+          else if (macHdr.IsBlockAck ())
+            {
+              CancelTransition ();
+              if (macHdr.IsFrmPend ())
+                {
+                  // Send the next frame of the burst after a SIFS, without a
+                  // new channel access.
+                  m_burstFrame++;
+                  m_txPkt = GetBurstFrame (m_burstFrame);
+                  m_setMacState = Simulator::Schedule (GetSifsOfData (), &LrWpanMac::SendNow, this);
+                }
+              else
+                {
+                  // The block ACK carries a bitmap, after the ACK frame.
+                  LrWpanBlockAckHeader blockAckHdr;
+                  Time waitTime = MicroSeconds ((GetMacAckWaitDuration () + blockAckHdr.GetSerializedSize () * m_phy->GetPhySymbolsPerOctet ())
+                                                * 1000 * 1000 / m_phy->GetDataOrSymbolRate (false));
+                  NS_ASSERT (m_ackWaitTimeout.IsExpired ());
+                  m_ackWaitTimeout = Simulator::Schedule (waitTime, &LrWpanMac::AckWaitTimeout, this);
+                  DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_ACK_PENDING));
+                }
+              return;
+            }
           else if (macHdr.IsRfMac ())
             {
               RfMacTypeTag typeTag;
               m_txPkt->PeekPacketTag (typeTag);
 
-              m_setMacState.Cancel ();
+              CancelTransition ();
 
               if (typeTag.IsRfe ())
                 {
-                  m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_CFE_PENDING);
+                  NS_ASSERT (m_txClass == TX_CLASS_ENERGY);
+                  RfMacChargeRequestTag requestTag;
+                  bool cached = m_txPkt->PeekPacketTag (requestTag);
+                  RemoveFirstTxQElement ();
+                  if (cached)
+                    {
+                      // The EDT asked sends the energy pulse right away.
+                      m_cachedEdt = requestTag.GetEdt ();
+                      m_cfeDstAddress = GetShortAddress ();
+                      m_chargingTime = requestTag.GetChargingTime ();
+                      m_energyWaitTimeout.Cancel ();
+                      m_energyWaitTimeout = Simulator::Schedule (m_chargingTime + GetCfeAckSlot (), &LrWpanMac::EnergyWaitTimeout, this);
+                      DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_ENERGY_PENDING));
+                    }
+                  else
+                    {
+                      // The energy request is done, wait for the CFE.
+                      m_cachedEdt = Mac16Address ("ff:ff");
+                      DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_CFE_PENDING));
+                    }
                 }
               else if (typeTag.IsCfe ())
                 {
-                  m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_CFE_ACK_PENDING);
+                  DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_CFE_ACK_PENDING));
                 }
               else if (typeTag.IsCfeAck ())
                 {
-                  m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_ENERGY_PENDING);
+                  DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_ENERGY_PENDING));
                 }
               else if (typeTag.IsEnergy ())
                 {
-                  m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE);
+                  DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
                 }
                 return;
             }
+          else if (macHdr.IsBeacon ())
+            {
+              // The channel access of the head of the queue starts again.
+              m_txPkt = 0;
+            }
+          else if (IsStrobing ())
+            {
+              // Repeat the frame after a SIFS, until the end of the strobe.
+              CancelTransition ();
+              m_setMacState = Simulator::Schedule (GetSifsOfData (), &LrWpanMac::SendNow, this);
+              return;
+            }
           else
             {
               m_macTxOkTrace (m_txPkt);
               // remove the copy of the packet that was just sent
-              if (!m_mcpsDataConfirmCallback.IsNull ())
-                {
-                  McpsDataConfirmParams confirmParams;
-                  NS_ASSERT_MSG (m_txQueue.size () > 0, "TxQsize = 0");
-                  TxQueueElement *txQElement = m_txQueue.front ();
-                  confirmParams.m_msduHandle = txQElement->txQMsduHandle;
-                  confirmParams.m_status = IEEE_802_15_4_SUCCESS;
-                  m_mcpsDataConfirmCallback (confirmParams);
-                }
+              ConfirmTxQElements (IEEE_802_15_4_SUCCESS);
               RemoveFirstTxQElement ();
             }
         }
@@ -1214,16 +3255,10 @@ LrWpanMac::PdDataConfirm (LrWpanPhyEnumeration status)
 
       if (!macHdr.IsAcknowledgment ())
         {
-          NS_ASSERT_MSG (m_txQueue.size () > 0, "TxQsize = 0");
-          TxQueueElement *txQElement = m_txQueue.front ();
-          m_macTxDropTrace (txQElement->txQPkt);
-          if (!m_mcpsDataConfirmCallback.IsNull ())
-            {
-              McpsDataConfirmParams confirmParams;
-              confirmParams.m_msduHandle = txQElement->txQMsduHandle;
-              confirmParams.m_status = IEEE_802_15_4_FRAME_TOO_LONG;
-              m_mcpsDataConfirmCallback (confirmParams);
-            }
+          NS_ASSERT_MSG (m_txQueue[m_txClass].GetSize () > 0, "TxQsize = 0");
+          m_macTxDropTrace (m_txPkt);
+          m_macTxClassDropTrace (m_txPkt, m_txClass);
+          ConfirmTxQElements (IEEE_802_15_4_FRAME_TOO_LONG);
           RemoveFirstTxQElement ();
         }
       else
@@ -1238,8 +3273,8 @@ LrWpanMac::PdDataConfirm (LrWpanPhyEnumeration status)
       NS_FATAL_ERROR ("Transmission attempt failed with PHY status " << status);
     }
 
-  m_setMacState.Cancel ();
-  m_setMacState = Simulator::ScheduleNow (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE);
+  CancelTransition ();
+  DeferTransition (MakeEvent (&LrWpanMac::SetLrWpanMacState, this, MAC_IDLE));
 }
 
 void
@@ -1267,6 +3302,7 @@ LrWpanMac::PlmeGetAttributeConfirm (LrWpanPhyEnumeration status,
 void
 LrWpanMac::PlmeSetTRXStateConfirm (LrWpanPhyEnumeration status)
 {
+  LrWpanWorkQueue::Scope scope (m_workQueue);
   NS_LOG_FUNCTION (this << status);
 
   if (m_lrWpanMacState == MAC_SENDING && (status == IEEE_802_15_4_PHY_TX_ON || status == IEEE_802_15_4_PHY_SUCCESS))
@@ -1274,6 +3310,29 @@ LrWpanMac::PlmeSetTRXStateConfirm (LrWpanPhyEnumeration status)
       NS_ASSERT (m_txPkt);
 
       // Start sending if we are in state SENDING and the PHY transmitter was enabled.
+      if (m_coordinator)
+        {
+          LrWpanMacHeader macHdr;
+          m_txPkt->PeekHeader (macHdr);
+          if (macHdr.IsBeacon ())
+            {
+              // The superframe starts with the transmission of its beacon.
+              m_superframeStart = Simulator::Now ();
+              m_macBeaconTxTime = static_cast<uint64_t> (Simulator::Now ().GetSeconds () * m_phy->GetDataOrSymbolRate (false)) & 0xffffff;
+            }
+        }
+      if (m_dutyCycle && !m_strobing)
+        {
+          // The destination of a data frame may be asleep. The frame is
+          // repeated for a wakeup interval, covering one of its listen windows.
+          LrWpanMacHeader macHdr;
+          m_txPkt->PeekHeader (macHdr);
+          if (macHdr.IsData () && !macHdr.IsBlockAck ())
+            {
+              m_strobing = true;
+              m_strobeEnd = Simulator::Now () + m_wakeupInterval;
+            }
+        }
       m_promiscSnifferTrace (m_txPkt);
       m_snifferTrace (m_txPkt);
       m_macTxTrace (m_txPkt);
@@ -1313,22 +3372,12 @@ void
 LrWpanMac::SetLrWpanMacState (LrWpanMacState macState)
 {
   NS_LOG_FUNCTION (this << "mac state = " << macState);
-
-  McpsDataConfirmParams confirmParams;
+  LrWpanWorkQueue::Scope scope (m_workQueue);
 
   if (macState == MAC_IDLE)
     {
       ChangeMacState (MAC_IDLE);
-
-      if (m_macRxOnWhenIdle)
-        {
-          m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
-        }
-      else
-        {
-          m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TRX_OFF);
-        }
-
+      m_phy->PlmeSetTRXStateRequest (GetIdleTrxState ());
       CheckQueue ();
     }
   else if (macState == MAC_ACK_PENDING)
@@ -1340,6 +3389,13 @@ LrWpanMac::SetLrWpanMacState (LrWpanMacState macState)
     {
       ChangeMacState (MAC_CFE_PENDING);
       m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
+      if (m_dutyCycle)
+        {
+          // The energy transmitters answer an RFE right away, while the
+          // receiver is still on. Do not listen longer than a listen window.
+          m_cfeWaitTimeout.Cancel ();
+          m_cfeWaitTimeout = Simulator::Schedule (m_listenWindow, &LrWpanMac::CfeWaitTimeout, this);
+        }
     }
   else if (macState == MAC_CFE_ACK_PENDING)
     {
@@ -1351,6 +3407,11 @@ LrWpanMac::SetLrWpanMacState (LrWpanMacState macState)
       ChangeMacState (MAC_ENERGY_PENDING);
       m_phy->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON); 
     }
+  else if (macState == MAC_CSMA && m_txClass == TX_CLASS_GTS)
+    {
+      // A GTS frame is retransmitted in the GTS, without a channel access.
+      SetLrWpanMacState (MAC_IDLE);
+    }
   else if (macState == MAC_CSMA)
     {
       NS_ASSERT (m_lrWpanMacState == MAC_IDLE
@@ -1374,13 +3435,9 @@ LrWpanMac::SetLrWpanMacState (LrWpanMacState macState)
 
       // cannot find a clear channel, drop the current packet.
       NS_LOG_DEBUG ( this << " cannot find clear channel");
-      confirmParams.m_msduHandle = m_txQueue.front ()->txQMsduHandle;
-      confirmParams.m_status = IEEE_802_15_4_CHANNEL_ACCESS_FAILURE;
       m_macTxDropTrace (m_txPkt);
-      if (!m_mcpsDataConfirmCallback.IsNull ())
-        {
-          m_mcpsDataConfirmCallback (confirmParams);
-        }
+      m_macTxClassDropTrace (m_txPkt, m_txClass);
+      ConfirmTxQElements (IEEE_802_15_4_CHANNEL_ACCESS_FAILURE);
       // remove the copy of the packet that was just sent
       RemoveFirstTxQElement ();
 
@@ -1436,6 +3493,37 @@ LrWpanMac::GetMacCfeWaitDuration (void) const
          + ceil (6 * m_phy->GetPhySymbolsPerOctet ());  
 }
 
+uint64_t
+LrWpanMac::GetMacMaxFrameTotalWaitTime (void) const
+{
+  uint8_t minBE = m_csmaCa->GetMacMinBE ();
+  uint8_t maxBE = m_csmaCa->GetMacMaxBE ();
+  uint8_t maxBackoffs = m_csmaCa->GetMacMaxCSMABackoffs ();
+  uint8_t m = std::min (maxBE - minBE, static_cast<int> (maxBackoffs));
+
+  // The longest channel access of the coordinator, and the longest frame.
+  uint64_t backoffPeriods = ((1 << maxBE) - 1) * (maxBackoffs - m);
+  for (uint8_t k = 0; k < m; k++)
+    {
+      backoffPeriods += 1 << (minBE + k);
+    }
+  uint64_t maxFrameDuration = m_phy->GetPhySHRDuration ()
+    + ceil ((LrWpanPhy::aMaxPhyPacketSize + 1) * m_phy->GetPhySymbolsPerOctet ());
+  return backoffPeriods * m_csmaCa->GetUnitBackoffPeriod () + maxFrameDuration;
+}
+
+uint8_t
+LrWpanMac::GetProbeSlot (double phase, uint8_t slots)
+{
+  double inPhase = 1.0 / (2 * slots);
+  if (phase <= inPhase || slots < 2)
+    {
+      return 1;
+    }
+  uint32_t slot = 2 + static_cast<uint32_t> ((phase - inPhase) / ((1.0 - inPhase) / (slots - 1)));
+  return std::min<uint32_t> (slot, slots);
+}
+
 uint8_t
 LrWpanMac::GetMacMaxFrameRetries (void) const
 {
@@ -32,17 +32,30 @@
 #include <ns3/sequence-number.h>
 #include <ns3/lr-wpan-phy.h>
 #include <ns3/event-id.h>
-#include <deque>
+#include <ns3/event-impl.h>
+#include <ns3/nstime.h>
 
 #include <ns3/tag.h>
 
+#include <vector>
+#include <list>
+#include <map>
+
 #include "lr-wpan-mac-header.h"
+#include "lr-wpan-beacon-header.h"
+#include "lr-wpan-tx-queue.h"
+#include "lr-wpan-work-queue.h"
 
 
 namespace ns3 {
 
 class Packet;
 class LrWpanCsmaCa;
+class LrWpanMacTrailer;
+class LrWpanBlockAckHeader;
+class ErrorModel;
+class UniformRandomVariable;
+class LrWpanEdtSelectionPolicy;
 
 /**
  * \defgroup lr-wpan LR-WPAN models
@@ -144,6 +157,66 @@ typedef enum
   IEEE_802_15_4_INVALID_PARAMETER      = 11
 } LrWpanMcpsDataConfirmStatus;
 
+/**
+ * \ingroup lr-wpan
+ *
+ * MLME-POLL.confirm status, see IEEE 802.15.4-2006, section 7.1.16.2
+ */
+typedef enum
+{
+  MLMEPOLL_SUCCESS = 0,
+  MLMEPOLL_CHANNEL_ACCESS_FAILURE = 1,
+  MLMEPOLL_NO_ACK = 2,
+  MLMEPOLL_NO_DATA = 3,
+  MLMEPOLL_TRANSACTION_OVERFLOW = 4 //!< The data request was dropped by a full transmission queue
+} LrWpanMlmePollConfirmStatus;
+
+/**
+ * \ingroup lr-wpan
+ *
+ * MAC command frame identifiers, table 82 of 802.15.4-2006
+ */
+typedef enum
+{
+  CMD_DATA_REQUEST = 0x04
+} LrWpanMacCommand;
+
+
+/**
+ * \ingroup lr-wpan
+ *
+ * The packet dropped when a packet is enqueued in a full transmission queue
+ */
+typedef enum
+{
+  TX_QUEUE_TAIL_DROP = 0, //!< Drop the new packet
+  TX_QUEUE_HEAD_DROP = 1  //!< Drop the oldest waiting packet of the class
+} LrWpanTxQueueDropPolicy;
+
+/**
+ * \ingroup lr-wpan
+ *
+ * Traffic classes of the transmission queue, in decreasing priority. The GTS
+ * class is only served in the guaranteed time slot of the device.
+ */
+typedef enum
+{
+  TX_CLASS_ENERGY = 0,      //!< RF-MAC energy requests
+  TX_CLASS_ACK_DATA = 1,    //!< Data frames requesting an acknowledgment
+  TX_CLASS_BEST_EFFORT = 2, //!< Data frames without acknowledgment
+  TX_CLASS_GTS = 3          //!< Data frames sent in the GTS of the device
+} LrWpanTxQueueClass;
+
+/**
+ * \ingroup lr-wpan
+ *
+ * Scheduling among the transmission queues of the traffic classes
+ */
+typedef enum
+{
+  TX_QUEUE_STRICT_PRIORITY = 0,     //!< Always serve the highest backlogged class
+  TX_QUEUE_WEIGHTED_ROUND_ROBIN = 1 //!< Serve each class up to its weight per round
+} LrWpanTxQueueScheduling;
 
 typedef enum
 {
@@ -212,6 +285,40 @@ struct McpsDataIndicationParams
  */
 typedef Callback<void, McpsDataConfirmParams> McpsDataConfirmCallback;
 
+/**
+ * \ingroup lr-wpan
+ *
+ * MLME-POLL.request params. See 7.1.16.1
+ */
+struct MlmePollRequestParams
+{
+  MlmePollRequestParams ()
+    : m_coordPanId (0),
+      m_coordShortAddr ()
+  {
+  }
+  uint16_t m_coordPanId;         //!< The PAN identifier of the coordinator
+  Mac16Address m_coordShortAddr; //!< The short address of the coordinator
+};
+
+/**
+ * \ingroup lr-wpan
+ *
+ * MLME-POLL.confirm params. See 7.1.16.2
+ */
+struct MlmePollConfirmParams
+{
+  LrWpanMlmePollConfirmStatus m_status; //!< The status of the data request
+};
+
+/**
+ * \ingroup lr-wpan
+ *
+ * This callback is called after a MlmePollRequest, when the data pending at
+ * the coordinator was received, or none was pending.
+ */
+typedef Callback<void, MlmePollConfirmParams> MlmePollConfirmCallback;
+
 /**
  * \ingroup lr-wpan
  *
@@ -248,6 +355,13 @@ public:
    */
   static const uint32_t aMinMPDUOverhead;
 
+  /**
+   * The minimum number of symbols forming the CAP, which the GTSs leave to
+   * the contention-based access.
+   * See IEEE 802.15.4-2006, section 7.4.1, Table 85
+   */
+  static const uint32_t aMinCAPLength;
+
   /**
    * Default constructor.
    */
@@ -320,6 +434,17 @@ public:
    *  \param p the packet to be transmitted
    */
   void McpsDataRequest (McpsDataRequestParams params, Ptr<Packet> p);
+
+  /**
+   *  IEEE 802.15.4-2006, section 7.1.16.1
+   *  MLME-POLL.request
+   *  Request the data pending at a coordinator, with a data request command.
+   *  If the ACK announces pending data, the receiver is kept on for
+   *  macMaxFrameTotalWaitTime.
+   *
+   *  \param params the request parameters
+   */
+  void MlmePollRequest (MlmePollRequestParams params);
   
 	// void McpsRfeRequest (McpsDataRequestParams params);
 	// void McpsPacketRequest (LrWpanMacHeader::LrWpanMacType type, McpsDataRequestParams params, Ptr<Packet> p);
@@ -363,8 +488,128 @@ public:
    */
   void SetMcpsDataConfirmCallback (McpsDataConfirmCallback c);
 
+  /**
+   * Set the callback for the confirmation of a poll request.
+   * The callback implements MLME-POLL.confirm SAP of IEEE 802.15.4-2006,
+   * section 7.1.16.2.
+   *
+   * \param c the callback
+   */
+  void SetMlmePollConfirmCallback (MlmePollConfirmCallback c);
+
   void SetRfMacEnergyIndicationCallback (RfMacEnergyIndicationCallback c);
 
+  /**
+   * \return the number of transactions pending for indirect transmission
+   */
+  uint32_t GetPendingTransactions (void) const;
+
+  /**
+   * Set the error model deciding which received data frames are lost. Without
+   * an error model no frame is lost.
+   *
+   * \param em the error model, or 0 to disable the losses
+   */
+  void SetReceiveErrorModel (Ptr<ErrorModel> em);
+
+  /**
+   * \return the error model of the received data frames
+   */
+  Ptr<ErrorModel> GetReceiveErrorModel (void) const;
+
+  /**
+   * Set the policy selecting the EDTs answering an RFE. All EDTs of a
+   * scenario share the same policy. Without a policy every EDT answers.
+   *
+   * \param policy the selection policy, or 0 to disable the selection
+   */
+  void SetEdtSelectionPolicy (Ptr<LrWpanEdtSelectionPolicy> policy);
+
+  /**
+   * \return the policy selecting the EDTs answering an RFE
+   */
+  Ptr<LrWpanEdtSelectionPolicy> GetEdtSelectionPolicy (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model.  Return the number of streams (possibly zero) that
+   * have been assigned. The streams of the receive error model are assigned
+   * for a RateErrorModel, a BurstErrorModel and an
+   * LrWpanGilbertElliottErrorModel; a warning is logged for other random
+   * error models.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+  /**
+   * \return the number of MAC state changes run from the work queue of this
+   * MAC, with direct dispatch
+   */
+  uint64_t GetDispatchedTransitions (void) const;
+
+  /**
+   * Allocate a GTS to a device, at the end of the active portion of the
+   * superframe, before the previously allocated GTSs. Only the coordinator of
+   * a beacon-enabled PAN allocates GTSs, in the transmit direction, and the
+   * allocation is announced by the next beacon. The CAP is never shortened
+   * below aMinCAPLength.
+   *
+   * \param address the short address of the device
+   * \param length the number of superframe slots of the GTS
+   * \return false, if the GTS cannot be allocated
+   */
+  bool AllocateGts (Mac16Address address, uint8_t length);
+
+  /**
+   * Release the GTS of a device. The following GTSs are moved towards the
+   * end of the superframe, and the CAP is extended.
+   *
+   * \param address the short address of the device
+   */
+  void DeallocateGts (Mac16Address address);
+
+  /**
+   * Check if the MAC takes part in a beacon-enabled PAN, as its coordinator,
+   * or as a device which received a beacon.
+   *
+   * \return true, if the superframe structure is used
+   */
+  bool IsBeaconEnabled (void) const;
+
+  /**
+   * Get the start of the current superframe, i.e., of the last beacon sent or
+   * received. The superframes of missed beacons are extrapolated.
+   *
+   * \return the start of the current superframe
+   */
+  Time GetSuperframeStart (void) const;
+
+  /**
+   * \return the time between the starts of two beacons
+   */
+  Time GetBeaconInterval (void) const;
+
+  /**
+   * \return the end of the CAP of the current superframe
+   */
+  Time GetCapEnd (void) const;
+
+  /**
+   * \return the start of the CAP of the next superframe, after its beacon
+   */
+  Time GetNextCapStart (void) const;
+
+  /**
+   * Get the time needed to send a frame and, if the frame requests one, to
+   * wait for its ACK.
+   *
+   * \param p the frame
+   * \return the duration of the transaction
+   */
+  Time GetTransactionDuration (Ptr<const Packet> p) const;
+
   // interfaces between MAC and PHY
   /**
    *  IEEE 802.15.4-2006 section 6.2.1.3
@@ -544,6 +789,15 @@ public:
 
   uint64_t GetMacCfeWaitDuration (void) const;
 
+  /**
+   * Get the macMaxFrameTotalWaitTime attribute value, derived from the CSMA/CA
+   * parameters as in IEEE 802.15.4-2006, section 7.4.2, Table 86.
+   *
+   * \return the maximum number of symbols to wait for a pending frame after
+   * a data request
+   */
+  uint64_t GetMacMaxFrameTotalWaitTime (void) const;
+
   /**
    * Get the macMaxFrameRetries attribute value.
    *
@@ -551,6 +805,19 @@ public:
    */
   uint8_t GetMacMaxFrameRetries (void) const;
 
+  /**
+   * Get the probe slot of an EDT. The EDTs within 1 / (2 * slots) wavelengths
+   * beyond a multiple of the wavelength are in phase with the sensor and
+   * probe in slot 1, the others are spread over the remaining slots by their
+   * phase. With two slots, these are the two phase groups of the RF-MAC.
+   *
+   * \param phase the distance to the sensor modulo the wavelength, as a
+   * fraction of the wavelength
+   * \param slots the number of probe slots
+   * \return the probe slot, starting at 1
+   */
+  static uint8_t GetProbeSlot (double phase, uint8_t slots);
+
   /**
    * Set the macMaxFrameRetries attribute value.
    *
@@ -592,10 +859,76 @@ public:
   typedef void (* StateTracedCallback)
     (LrWpanMacState oldState, LrWpanMacState newState);
 
+  /**
+   * TracedCallback signature for packets of a traffic class.
+   *
+   * \param [in] packet The packet.
+   * \param [in] txClass The traffic class of the packet.
+   */
+  typedef void (* TxClassTracedCallback)
+    (Ptr<const Packet> packet, LrWpanTxQueueClass txClass);
+
+  /**
+   * TracedCallback signature for the charge cycles of a sensor.
+   *
+   * \param [in] energy The harvested energy, in J.
+   * \param [in] chargingTime The duration of the energy pulse.
+   */
+  typedef void (* ChargeCycleTracedCallback)
+    (double energy, Time chargingTime);
+
+  /**
+   * TracedCallback signature for the CFEs and energy pulses of an EDT.
+   *
+   * \param [in] packet The packet.
+   * \param [in] duration The time the signal occupies the channel.
+   */
+  typedef void (* EnergyTxTracedCallback)
+    (Ptr<const Packet> packet, Time duration);
+
 	void SendRfeForEnergy (void);
 
   void SendCfeAfterRfe (void);
 
+  /**
+   * Answer an RFE, after the EDT has been selected by the selection policy.
+   * The PAN ID, group and probe slot of the RFE of the sensor are restored
+   * from m_rfeCandidates.
+   *
+   * \param sensor the source of the RFE
+   * \param offset the start offset of the CFE
+   */
+  void AnswerRfe (Mac16Address sensor, Time offset);
+
+  /**
+   * Add a sensor to the requesters of the next multicast CFE, and start the
+   * aggregation window with the first one.
+   *
+   * \param sensor the source of the RFE
+   * \param offset the start offset of the CFE in its probe slot
+   */
+  void AggregateRfe (Mac16Address sensor, Time offset);
+
+  /**
+   * End of the aggregation window, answer the collected RFEs of the probe
+   * slot of the oldest one with one multicast CFE, or retry after the
+   * ongoing handshake. The RFEs of other probe slots are answered after
+   * another window.
+   */
+  void EndRfeAggregation (void);
+
+  /**
+   * End of the CFE_ACKs of a multicast CFE, after the last requester
+   * answered or on timeout. Send the energy pulse sized to the percentile
+   * of the requested charging times.
+   */
+  void EndCfeAckCollection (void);
+
+  /**
+   * \return the time reserved for each CFE_ACK answering a multicast CFE
+   */
+  Time GetCfeAckSlot (void) const;
+
   void SendAckAfterCfe (void);
 
   void SendEnergyPulse (Time chargingTime);
@@ -630,20 +963,31 @@ protected:
 
 private:
   /**
-   * Helper structure for managing transmission queue elements.
+   * Helper structure for managing the transactions pending for indirect
+   * transmission.
    */
-  struct TxQueueElement
+  struct IndTxQueueElement
   {
     uint8_t txQMsduHandle; //!< MSDU Handle
     Ptr<Packet> txQPkt;    //!< Queued packet
+    Time expireTime;       //!< The end of the transaction persistence time
   };
 
   /**
    * Send an acknowledgment packet for the given sequence number.
    *
    * \param seqno the sequence number for the ACK
+   * \param framePending true, if the frame pending bit is set
+   */
+  void SendAck (uint8_t seqno, bool framePending);
+
+  /**
+   * Send a block ACK for the burst ending with the given sequence number,
+   * covering the frames of the burst received so far.
+   *
+   * \param seqno the sequence number of the last frame of the burst
    */
-  void SendAck (uint8_t seqno);	
+  void SendBlockAck (uint8_t seqno);
 
   /**
    * Remove the tip of the transmission queue, including clean up related to the
@@ -652,131 +996,463 @@ private:
   void RemoveFirstTxQElement ();
 
   /**
-   * Change the current MAC state to the given new state.
+   * Confirm the MSDUs carried by the frame being sent to the upper layer.
    *
-   * \param newState the new state
+   * \param status the confirmed status
    */
-  void ChangeMacState (LrWpanMacState newState);
+  void ConfirmTxQElements (LrWpanMcpsDataConfirmStatus status);
 
   /**
-   * Handle an ACK timeout with a packet retransmission, if there are
-   * retransmission left, or a packet drop.
+   * Build the frame to be sent for the head of the transmission queue of the
+   * current traffic class. With aggregation enabled and a data frame at the
+   * head, the following packets to the same destination are aggregated with
+   * it, as long as the frame fits in a PSDU, and m_txMsdus is set to the
+   * number of aggregated packets. MAC commands are never aggregated.
+   *
+   * \return the frame to be sent
    */
-  void AckWaitTimeout (void);
+  Ptr<Packet> AggregateTxQElements (void);
 
   /**
-   * Check for remaining retransmissions for the packet currently being sent.
-   * Drop the packet, if there are no retransmissions left.
+   * Check if two frames are sent over the same link, with the same addressing
+   * fields.
    *
-   * \return true, if the packet should be retransmitted, false otherwise.
+   * \param hdr1 the MAC header of the first frame
+   * \param hdr2 the MAC header of the second frame
+   * \return true, if the addressing fields are the same
    */
-  bool PrepareRetransmission (void);
+  bool IsSameLink (const LrWpanMacHeader &hdr1, const LrWpanMacHeader &hdr2) const;
 
   /**
-   * Check the transmission queue. If there are packets in the transmission
-   * queue and the MAC is idle, pick the first one and initiate a packet
-   * transmission.
+   * Start a burst with the head of the transmission queue of the current
+   * traffic class and the following acknowledged data packets to the same
+   * destination, if bursts are enabled, the head is a data frame and there
+   * are such packets. MAC commands are never sent in a burst. m_txMsdus
+   * is set to the number of frames of the burst, and m_txPkt to its first
+   * frame.
+   *
+   * \return true, if a burst was started
    */
-  void CheckQueue (void);
+  bool StartBurst (void);
 
   /**
-   * The trace source fired when packets are considered as successfully sent
-   * or the transmission has been given up.
-   * Only non-broadcast packets are traced.
-   *
-   * The data should represent:
-   * packet, number of retries, total number of csma backoffs
+   * Build a frame of the current burst.
    *
-   * \see class CallBackTraceSource
+   * \param index the position of the frame in the burst
+   * \return the frame
    */
-  TracedCallback<Ptr<const Packet>, uint8_t, uint8_t > m_sentPktTrace;
+  Ptr<Packet> GetBurstFrame (uint32_t index);
 
   /**
-   * The trace source fired when packets come into the "top" of the device
-   * at the L3/L2 transition, when being queued for transmission.
+   * Confirm and remove the frames of the current burst acknowledged by a
+   * block ACK. The missing frames are kept as the new burst.
    *
-   * \see class CallBackTraceSource
+   * \param blockAckHdr the bitmap of the block ACK
+   * \param lastSeqNum the sequence number of the last frame of the burst
+   * \return true, if all frames were acknowledged
    */
-  TracedCallback<Ptr<const Packet> > m_macTxEnqueueTrace;
+  bool ReceiveBlockAck (const LrWpanBlockAckHeader &blockAckHdr, uint8_t lastSeqNum);
 
   /**
-   * The trace source fired when packets are dequeued from the
-   * L3/l2 transmission queue.
+   * Create the payload of a received frame, without its MAC header and
+   * trailer. The received frame is not modified.
    *
-   * \see class CallBackTraceSource
+   * \param p the received frame
+   * \param hdr the MAC header of the frame
+   * \param trailer the MAC trailer of the frame
+   * \return the payload
    */
-  TracedCallback<Ptr<const Packet> > m_macTxDequeueTrace;
+  Ptr<Packet> GetPayload (Ptr<const Packet> p, const LrWpanMacHeader &hdr, const LrWpanMacTrailer &trailer) const;
 
   /**
-   * The trace source fired when packets are being sent down to L1.
+   * Forward the payload of a received data frame to the upper layer. The MSDUs
+   * of an aggregated frame are indicated one by one.
    *
-   * \see class CallBackTraceSource
+   * \param params the indication parameters
+   * \param p the received frame
+   * \param hdr the MAC header of the frame
+   * \param trailer the MAC trailer of the frame
    */
-  TracedCallback<Ptr<const Packet> > m_macTxTrace;
+  void IndicateData (McpsDataIndicationParams params, Ptr<const Packet> p, const LrWpanMacHeader &hdr, const LrWpanMacTrailer &trailer);
 
   /**
-   * The trace source fired when packets where successfully transmitted, that is
-   * an acknowledgment was received, if requested, or the packet was
-   * successfully sent by L1, if no ACK was requested.
+   * Append a packet to the transmission queue of a traffic class, dropping a
+   * packet if the queue is full.
    *
-   * \see class CallBackTraceSource
+   * \param txClass the traffic class
+   * \param msduHandle the MSDU handle
+   * \param p the packet
    */
-  TracedCallback<Ptr<const Packet> > m_macTxOkTrace;
+  void EnqueueTxQElement (LrWpanTxQueueClass txClass, uint8_t msduHandle, Ptr<Packet> p);
 
   /**
-   * The trace source fired when packets are dropped due to missing ACKs or
-   * because of transmission failures in L1.
+   * Make room in the full transmission queue of a traffic class, by dropping
+   * a waiting packet according to the drop policy.
    *
-   * \see class CallBackTraceSource
+   * \param txClass the traffic class
+   * \return false, if the new packet has to be dropped instead
    */
-  TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+  bool DropWaitingTxQElement (LrWpanTxQueueClass txClass);
 
   /**
-   * The trace source fired for packets successfully received by the device
-   * immediately before being forwarded up to higher layers (at the L2/L3
-   * transition).  This is a promiscuous trace.
+   * Report a packet dropped because the transmission queue was full.
    *
-   * \see class CallBackTraceSource
+   * \param txClass the traffic class of the dropped packet
+   * \param msduHandle the MSDU handle of the dropped packet
+   * \param p the dropped packet
    */
-  TracedCallback<Ptr<const Packet> > m_macPromiscRxTrace;
+  void TxQueueOverflow (LrWpanTxQueueClass txClass, uint8_t msduHandle, Ptr<const Packet> p);
 
   /**
-   * The trace source fired for packets successfully received by the device
-   * immediately before being forwarded up to higher layers (at the L2/L3
-   * transition).  This is a non-promiscuous trace.
+   * Store a frame for indirect transmission, until its destination polls for
+   * it or the transaction persistence time expires. The frame is dropped, if
+   * MaxPendingTransactions are already pending.
    *
-   * \see class CallBackTraceSource
+   * \param msduHandle the MSDU handle
+   * \param p the frame
    */
-  TracedCallback<Ptr<const Packet> > m_macRxTrace;
+  void EnqueueIndTxQElement (uint8_t msduHandle, Ptr<Packet> p);
 
   /**
-   * The trace source fired for packets successfully received by the device
-   * but dropped before being forwarded up to higher layers (at the L2/L3
-   * transition).
+   * Move the oldest transaction pending for a device to the transmission
+   * queue, after a data request of the device. The frame pending bit of the
+   * frame is set, if more transactions are pending.
    *
-   * \see class CallBackTraceSource
+   * \param address the short address of the device
+   * \return false, if no transaction is pending for the device
    */
-  TracedCallback<Ptr<const Packet> > m_macRxDropTrace;
+  bool ExtractIndTxQElement (Mac16Address address);
 
   /**
-   * A trace source that emulates a non-promiscuous protocol sniffer connected
-   * to the device.  Unlike your average everyday sniffer, this trace source
-   * will not fire on PACKET_OTHERHOST events.
+   * Drop the pending transactions whose persistence time expired, and schedule
+   * the next expiry.
+   */
+  void PurgeIndTxQueue (void);
+
+  /**
+   * \return the macTransactionPersistenceTime, as a duration
+   */
+  Time GetTransactionPersistenceTime (void) const;
+
+  /**
+   * Stop waiting for the data announced by the coordinator after a data
+   * request.
+   */
+  void PollWaitTimeout (void);
+
+  /**
+   * Report the outcome of a poll request to the upper layer.
    *
-   * On the transmit size, this trace hook will fire after a packet is dequeued
-   * from the device queue for transmission.  In Linux, for example, this would
-   * correspond to the point just before a device hard_start_xmit where
-   * dev_queue_xmit_nit is called to dispatch the packet to the PF_PACKET
-   * ETH_P_ALL handlers.
+   * \param status the confirmed status
+   */
+  void ConfirmPoll (LrWpanMlmePollConfirmStatus status);
+
+  /**
+   * Select the traffic class of the next packet to be sent, according to the
+   * queue scheduling, and store it in m_txClass.
    *
-   * On the receive side, this trace hook will fire when a packet is received,
-   * just before the receive callback is executed.  In Linux, for example,
-   * this would correspond to the point at which the packet is dispatched to
-   * packet sniffers in netif_receive_skb.
+   * \return false, if all transmission queues are empty
+   */
+  bool SelectTxClass (void);
+
+  /**
+   * Set the capacity of the transmission queue of each traffic class, dropping
+   * the newest packets which do not fit anymore. The packets being sent are
+   * never dropped, they are kept until they are confirmed.
    *
-   * \see class CallBackTraceSource
+   * \param size the maximum number of packets
    */
-  TracedCallback<Ptr<const Packet> > m_snifferTrace;
+  void SetMaxQueueSize (uint32_t size);
+
+  /**
+   * \return the capacity of the transmission queue
+   */
+  uint32_t GetMaxQueueSize (void) const;
+
+  /**
+   * Change the current MAC state to the given new state.
+   *
+   * \param newState the new state
+   */
+  void ChangeMacState (LrWpanMacState newState);
+
+  /**
+   * Handle an ACK timeout with a packet retransmission, if there are
+   * retransmission left, or a packet drop.
+   */
+  void AckWaitTimeout (void);
+
+  /**
+   * Start a listen window of the duty cycle, and schedule the next one.
+   */
+  void Wakeup (void);
+
+  /**
+   * End the current listen window of the duty cycle. The receiver is switched
+   * off as soon as the MAC is idle.
+   */
+  void Sleep (void);
+
+  /**
+   * Give up waiting for a CFE after an energy request, with duty cycling.
+   */
+  void CfeWaitTimeout (void);
+
+  /**
+   * Give up waiting for the energy pulse requested from a cached EDT, and
+   * probe this EDT again with the next request.
+   */
+  void EnergyWaitTimeout (void);
+
+  /**
+   * \return the energy a sensor harvests in a charge cycle, from the minimum
+   * to the maximum threshold voltage
+   */
+  double GetRequiredEnergy (void) const;
+
+  /**
+   * Get the transceiver state of the idle MAC. With duty cycling, the
+   * receiver is only on during the listen windows.
+   *
+   * \return RX_ON or TRX_OFF
+   */
+  LrWpanPhyEnumeration GetIdleTrxState (void) const;
+
+  /**
+   * Send a beacon as the coordinator of a beacon-enabled PAN, and schedule the
+   * next one. The beacon preempts a running channel access, which is started
+   * again afterwards. No beacon is sent while a transaction is in progress.
+   */
+  void SendBeacon (void);
+
+  /**
+   * Synchronize with the superframe announced by a received beacon, and look
+   * up the GTS of this device.
+   *
+   * \param beaconHdr the payload of the beacon
+   * \param p the received beacon frame
+   */
+  void ReceiveBeacon (const LrWpanBeaconHeader &beaconHdr, Ptr<const Packet> p);
+
+  /**
+   * Start the GTS of this device. A channel access deferred to the next CAP is
+   * given up, if there are frames to be sent in the GTS.
+   */
+  void StartGts (void);
+
+  /**
+   * Send the next frame of the GTS of this device, without a channel access,
+   * if the GTS is running and the transaction fits in its remainder. Pending
+   * energy requests go first, then the frames of the GTS class.
+   *
+   * \return true, if a frame is sent
+   */
+  bool SendGtsFrame (void);
+
+  /**
+   * \return the duration of a superframe slot
+   */
+  Time GetSuperframeSlotDuration (void) const;
+
+  /**
+   * Convert a number of symbols into a duration, at the symbol rate of the
+   * PHY.
+   *
+   * \param symbols the number of symbols
+   * \return the duration
+   */
+  Time GetSymbolsDuration (uint64_t symbols) const;
+
+  /**
+   * Check if the frame currently being sent is repeated until the end of a
+   * strobe, because its destination may be asleep.
+   *
+   * \return true, if the strobe is running
+   */
+  bool IsStrobing (void) const;
+
+  /**
+   * Check for remaining retransmissions for the packet currently being sent.
+   * Drop the packet, if there are no retransmissions left.
+   *
+   * \return true, if the packet should be retransmitted, false otherwise.
+   */
+  bool PrepareRetransmission (void);
+
+  /**
+   * Check the transmission queue. If there are packets in the transmission
+   * queue and the MAC is idle, pick the first one and initiate a packet
+   * transmission.
+   */
+  void CheckQueue (void);
+
+  /**
+   * Run a MAC state change at the current time, after the running handler
+   * returns. With direct dispatch enabled and a scope of m_workQueue open,
+   * the change is run from the work queue, otherwise it is scheduled. As
+   * with m_setMacState, a previously pending change is not cancelled.
+   *
+   * \param transition the state change, as returned by MakeEvent
+   */
+  void DeferTransition (EventImpl *transition);
+
+  /**
+   * Run a MAC state change after the given delay. A zero delay is handled by
+   * DeferTransition, so that it is dispatched like the other zero-delay
+   * changes.
+   *
+   * \param delay the delay of the state change
+   * \param transition the state change, as returned by MakeEvent
+   */
+  void ScheduleTransition (Time delay, EventImpl *transition);
+
+  /**
+   * Run a state change from the work queue, unless it was cancelled.
+   *
+   * \param transition the state change
+   */
+  void DispatchTransition (Ptr<EventImpl> transition);
+
+  /**
+   * Cancel the pending MAC state change, scheduled or in the work queue.
+   */
+  void CancelTransition (void);
+
+  /**
+   * \return true, if a MAC state change is pending
+   */
+  bool IsTransitionPending (void) const;
+
+  /**
+   * The trace source fired when packets are considered as successfully sent
+   * or the transmission has been given up.
+   * Only non-broadcast packets are traced.
+   *
+   * The data should represent:
+   * packet, number of retries, total number of csma backoffs
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, uint8_t, uint8_t > m_sentPktTrace;
+
+  /**
+   * The trace source fired when packets come into the "top" of the device
+   * at the L3/L2 transition, when being queued for transmission.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macTxEnqueueTrace;
+
+  /**
+   * The trace source fired when packets are dequeued from the
+   * L3/l2 transmission queue.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macTxDequeueTrace;
+
+  /**
+   * The trace source fired when packets are dropped because the
+   * transmission queue is full.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macTxQueueOverflowTrace;
+
+  /**
+   * The trace sources fired when packets are enqueued in, dequeued from or
+   * dropped from the transmission queue of a traffic class.
+   */
+  TracedCallback<Ptr<const Packet>, LrWpanTxQueueClass> m_macTxClassEnqueueTrace;
+  TracedCallback<Ptr<const Packet>, LrWpanTxQueueClass> m_macTxClassDequeueTrace;
+  TracedCallback<Ptr<const Packet>, LrWpanTxQueueClass> m_macTxClassDropTrace;
+
+  /**
+   * The trace source fired when the energy pulse requested by this sensor
+   * ends, with the harvested energy and the charging time.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<double, Time> m_rfMacChargeCycleTrace;
+
+  /**
+   * The trace source fired when this EDT starts sending a CFE or an energy
+   * pulse, with the time the signal occupies the channel.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet>, Time> m_rfMacEnergyTxTrace;
+
+  /**
+   * The trace source fired when packets are being sent down to L1.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macTxTrace;
+
+  /**
+   * The trace source fired when packets where successfully transmitted, that is
+   * an acknowledgment was received, if requested, or the packet was
+   * successfully sent by L1, if no ACK was requested.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macTxOkTrace;
+
+  /**
+   * The trace source fired when packets are dropped due to missing ACKs or
+   * because of transmission failures in L1.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macTxDropTrace;
+
+  /**
+   * The trace source fired for packets successfully received by the device
+   * immediately before being forwarded up to higher layers (at the L2/L3
+   * transition).  This is a promiscuous trace.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macPromiscRxTrace;
+
+  /**
+   * The trace source fired for packets successfully received by the device
+   * immediately before being forwarded up to higher layers (at the L2/L3
+   * transition).  This is a non-promiscuous trace.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macRxTrace;
+
+  /**
+   * The trace source fired for packets successfully received by the device
+   * but dropped before being forwarded up to higher layers (at the L2/L3
+   * transition).
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_macRxDropTrace;
+
+  /**
+   * A trace source that emulates a non-promiscuous protocol sniffer connected
+   * to the device.  Unlike your average everyday sniffer, this trace source
+   * will not fire on PACKET_OTHERHOST events.
+   *
+   * On the transmit size, this trace hook will fire after a packet is dequeued
+   * from the device queue for transmission.  In Linux, for example, this would
+   * correspond to the point just before a device hard_start_xmit where
+   * dev_queue_xmit_nit is called to dispatch the packet to the PF_PACKET
+   * ETH_P_ALL handlers.
+   *
+   * On the receive side, this trace hook will fire when a packet is received,
+   * just before the receive callback is executed.  In Linux, for example,
+   * this would correspond to the point at which the packet is dispatched to
+   * packet sniffers in netif_receive_skb.
+   *
+   * \see class CallBackTraceSource
+   */
+  TracedCallback<Ptr<const Packet> > m_snifferTrace;
 
   /**
    * A trace source that emulates a promiscuous mode protocol sniffer connected
@@ -818,6 +1494,16 @@ private:
    */
   Ptr<LrWpanCsmaCa> m_csmaCa;
 
+  /**
+   * The error model deciding which received data frames are lost.
+   */
+  Ptr<ErrorModel> m_receiveErrorModel;
+
+  /**
+   * The policy selecting the EDTs answering an RFE.
+   */
+  Ptr<LrWpanEdtSelectionPolicy> m_edtSelectionPolicy;
+
   /**
    * This callback is used to notify incoming packets to the upper layers.
    * See IEEE 802.15.4-2006, section 7.1.1.3.
@@ -831,6 +1517,13 @@ private:
    */
   McpsDataConfirmCallback m_mcpsDataConfirmCallback;
 
+  /**
+   * This callback is used to report the outcome of a poll request to the
+   * upper layers.
+   * See IEEE 802.15.4-2006, section 7.1.16.2.
+   */
+  MlmePollConfirmCallback m_mlmePollConfirmCallback;
+
 
   RfMacEnergyIndicationCallback m_rfMacEnergyIndicationCallback;
 
@@ -858,9 +1551,89 @@ private:
   Mac64Address m_selfExt;
 
   /**
-   * The transmit queue used by the MAC.
+   * The number of traffic classes.
+   */
+  static const uint32_t TX_QUEUE_CLASSES = 4;
+
+  /**
+   * The transmit queues used by the MAC, one per traffic class.
+   */
+  LrWpanTxQueue m_txQueue[TX_QUEUE_CLASSES];
+
+  /**
+   * The traffic class of the packet currently being sent.
+   */
+  LrWpanTxQueueClass m_txClass;
+
+  /**
+   * The scheduling among the transmit queues.
+   */
+  LrWpanTxQueueScheduling m_txQueueScheduling;
+
+  /**
+   * The weights of the traffic classes for weighted round robin scheduling.
+   */
+  uint32_t m_energyQueueWeight;
+  uint32_t m_ackDataQueueWeight;
+  uint32_t m_bestEffortQueueWeight;
+
+  /**
+   * The packets each traffic class may still send in the current round of
+   * weighted round robin scheduling.
+   */
+  uint32_t m_txQueueCredits[TX_QUEUE_CLASSES];
+
+  /**
+   * The maximum number of packets in the transmission queue of each traffic
+   * class. A queue may hold more packets while they are being sent, after
+   * its size was reduced.
+   */
+  uint32_t m_maxQueueSize;
+
+  /**
+   * The packet dropped when the transmit queue is full.
+   */
+  LrWpanTxQueueDropPolicy m_txQueueDropPolicy;
+
+  /**
+   * The transactions pending for indirect transmission, per destination in
+   * the order of their requests. Destinations without pending transactions
+   * are removed.
+   */
+  std::map<Mac16Address, std::list<IndTxQueueElement> > m_indTxQueue;
+
+  /**
+   * The number of transactions pending for indirect transmission.
+   */
+  uint32_t m_indTxQueueSize;
+
+  /**
+   * The maximum number of transactions pending for indirect transmission.
+   */
+  uint32_t m_maxIndTxQueueSize;
+
+  /**
+   * The time a transaction is kept for indirect transmission, in unit
+   * periods of aBaseSuperframeDuration * 2^BO symbols.
+   * See IEEE 802.15.4-2006, section 7.4.2, Table 86.
+   */
+  uint64_t m_macTransactionPersistenceTime;
+
+  /**
+   * Scheduler event for the expiry of the oldest pending transaction.
    */
-  std::deque<TxQueueElement*> m_txQueue;
+  EventId m_indTxExpiryEvent;
+
+  /**
+   * The coordinator polled by the last poll request.
+   */
+  Mac16Address m_pollCoordAddress;
+
+  /**
+   * Scheduler event for the end of the wait for the data announced by the
+   * coordinator.
+   */
+  EventId m_pollWaitTimeout;
 
   /**
    * The number of already used retransmission for the currently transmitted
@@ -873,6 +1646,42 @@ private:
    */
   uint8_t m_numCsmacaRetry;
 
+  /**
+   * The number of packets from the head of the transmission queue carried by
+   * the frame currently being sent.
+   */
+  uint32_t m_txMsdus;
+
+  /**
+   * True, if the packets queued for the same destination are aggregated.
+   */
+  bool m_aggregation;
+
+  /**
+   * The maximum number of frames of a burst.
+   */
+  uint32_t m_maxBurstSize;
+
+  /**
+   * True, if the frame currently being sent belongs to a burst.
+   */
+  bool m_burst;
+
+  /**
+   * The position in the burst of the frame currently being sent.
+   */
+  uint32_t m_burstFrame;
+
+  /**
+   * The source of the burst currently being received.
+   */
+  Mac16Address m_blockAckSrcAddress;
+
+  /**
+   * The sequence numbers of the frames of the burst received so far.
+   */
+  std::vector<uint8_t> m_blockAckSeqNums;
+
   /**
    * Scheduler event for the ACK timeout of the currently transmitted data
    * packet.
@@ -883,8 +1692,86 @@ private:
    * Scheduler event for a deferred MAC state change.
    */
   EventId m_setMacState;
+
+  /**
+   * True, if zero-delay MAC state changes are run from the work queue
+   * instead of the scheduler.
+   */
+  bool m_directDispatch;
+
+  /**
+   * The zero-delay MAC state changes of this MAC, with direct dispatch.
+   */
+  LrWpanWorkQueue m_workQueue;
+
+  /**
+   * The zero-delay MAC state change waiting in the work queue, if any.
+   */
+  Ptr<EventImpl> m_pendingTransition;
   EventId m_rfMacTimer;
 
+  /**
+   * True, if the receiver is only enabled during periodic listen windows
+   * while the MAC is idle.
+   */
+  bool m_dutyCycle;
+
+  /**
+   * The interval between the starts of two listen windows.
+   */
+  Time m_wakeupInterval;
+
+  /**
+   * The duration of a listen window.
+   */
+  Time m_listenWindow;
+
+  /**
+   * True, during a listen window.
+   */
+  bool m_awake;
+
+  /**
+   * Scheduler event for the start of the next listen window.
+   */
+  EventId m_wakeupEvent;
+
+  /**
+   * Scheduler event for the end of the current listen window.
+   */
+  EventId m_sleepEvent;
+
+  /**
+   * Scheduler event for the end of the wait for a CFE, with duty cycling.
+   */
+  EventId m_cfeWaitTimeout;
+
+  /**
+   * The random variable for the phase of the listen windows.
+   */
+  Ptr<UniformRandomVariable> m_wakeupRandom;
+
+  /**
+   * True, if the frame currently being sent is strobed.
+   */
+  bool m_strobing;
+
+  /**
+   * The end of the strobe of the frame currently being sent.
+   */
+  Time m_strobeEnd;
+
+  /**
+   * The source of the last received data frame, for the detection of strobed
+   * duplicates.
+   */
+  Mac16Address m_lastRxSrcAddress;
+
+  /**
+   * The sequence number of the last received data frame.
+   */
+  uint8_t m_lastRxSeqNum;
+
   Time m_slotTimeOfData;
   Time m_slotTimeOfEnergy;
   Time m_sifsOfData;
@@ -894,8 +1781,140 @@ private:
 
   uint8_t m_deviceType;
 
-  double m_receivedEnergyFromFirstSlot;
-  double m_receivedEnergyFromSecondSlot;
+  /**
+   * The average harvested power of each probe slot of the last CFE probing,
+   * in W.
+   */
+  std::vector<double> m_probePowers;
+
+  /**
+   * The number of probe slots of the CFE probing of this EDT.
+   */
+  uint8_t m_probeSlots;
+
+  /**
+   * The duration of a probe slot, the duration of a CFE.
+   */
+  Time m_probeSlotDuration;
+
+  /**
+   * The probe slot of this EDT for the last RFE.
+   */
+  uint8_t m_probeSlot;
+
+  /**
+   * The fraction of the power of the strongest probe slot below which a
+   * sensor does not select a probe slot for the energy pulse.
+   */
+  double m_probeSlotThreshold;
+
+  /**
+   * The charging time requested by the last CFE_ACK of this sensor.
+   */
+  Time m_chargingTime;
+
+  /**
+   * The time an EDT collects RFEs before answering them with one multicast
+   * CFE, or zero to answer each RFE.
+   */
+  Time m_rfeAggregationWindow;
+
+  /**
+   * The percentile of the charging times requested after a multicast CFE,
+   * sizing the energy pulse.
+   */
+  double m_chargingTimePercentile;
+
+  /**
+   * Scheduler event for the end of the aggregation window.
+   */
+  EventId m_rfeAggregationEvent;
+
+  /**
+   * The sensors whose RFEs were collected in the aggregation window, with
+   * the probe slot of this EDT for each of them.
+   */
+  std::vector<std::pair<Mac16Address, uint8_t> > m_rfeRequesters;
+
+  /**
+   * The fields of an RFE needed to answer it with a CFE.
+   */
+  struct RfeCandidate
+  {
+    uint16_t m_panId;       //!< The PAN ID of the sensor
+    uint8_t m_groupNumber;  //!< The group of the link
+    uint8_t m_probeSlot;    //!< The probe slot of the link
+  };
+
+  /**
+   * The last RFE of each sensor offered to the EDT selection policy, restored
+   * when the policy selects this EDT for it.
+   */
+  std::map<Mac16Address, RfeCandidate> m_rfeCandidates;
+
+  /**
+   * The sensors listed in the last multicast CFE which did not answer yet.
+   */
+  std::vector<Mac16Address> m_cfeRequesters;
+
+  /**
+   * The charging times requested by the CFE_ACKs selecting this EDT.
+   */
+  std::vector<Time> m_cfeAckChargingTimes;
+
+  /**
+   * Scheduler event for the end of the CFE_ACKs of a multicast CFE.
+   */
+  EventId m_cfeAckTimeout;
+
+  /**
+   * The position of this sensor in the last multicast CFE, its CFE_ACK
+   * follows the ones of the sensors before it.
+   */
+  uint32_t m_cfeAckIndex;
+
+  /**
+   * The harvested power of one EDT, measured by a sensor in its probe slot.
+   */
+  struct ChargingCacheEntry
+  {
+    double m_power;   //!< The average harvested power, in W
+    Time m_measured;  //!< The time of the probing
+  };
+
+  /**
+   * The harvested power of the EDTs probed alone in their slot, per EDT.
+   */
+  std::map<Mac16Address, ChargingCacheEntry> m_chargingCache;
+
+  /**
+   * The time a cached harvested power is used without probing, or zero to
+   * probe at every request.
+   */
+  Time m_chargingCacheValidity;
+
+  /**
+   * The relative deviation of the power harvested from a cached EDT from its
+   * cached power, beyond which the entry is dropped.
+   */
+  double m_chargingCacheDrift;
+
+  /**
+   * The sources of the CFEs of the current probing, per probe slot. A slot
+   * with several EDTs is mapped to the broadcast address.
+   */
+  std::map<uint8_t, Mac16Address> m_probeEdts;
+
+  /**
+   * The EDT asked for the energy pulse without probing, the broadcast
+   * address after a full handshake.
+   */
+  Mac16Address m_cachedEdt;
+
+  /**
+   * Scheduler event for the energy pulse requested from a cached EDT.
+   */
+  EventId m_energyWaitTimeout;
 
   uint8_t m_groupNumber;
 
@@ -906,6 +1925,58 @@ private:
 
   Mac16Address m_rfeSrcAddress;
   uint16_t m_rfeSrcPanId;
+
+  /**
+   * The last superframe slot of the CAP, the following ones forming the CFP.
+   */
+  uint8_t m_finalCapSlot;
+
+  /**
+   * The sequence number added to the transmitted beacon frames.
+   * See IEEE 802.15.4-2006, section 7.4.2, Table 86.
+   */
+  SequenceNumber8 m_macBsn;
+
+  /**
+   * True, if this MAC sends the beacons of a beacon-enabled PAN.
+   */
+  bool m_coordinator;
+
+  /**
+   * The start of the last beacon sent or received, from which the superframe
+   * slots are counted.
+   */
+  Time m_superframeStart;
+
+  /**
+   * The duration of the last beacon sent or received.
+   */
+  Time m_beaconDuration;
+
+  /**
+   * The GTSs allocated by the coordinator, announced in its beacons.
+   */
+  std::vector<LrWpanBeaconHeader::GtsDescriptor> m_gtsList;
+
+  /**
+   * The first superframe slot of the GTS of this device.
+   */
+  uint8_t m_gtsStartSlot;
+
+  /**
+   * The number of superframe slots of the GTS of this device, 0 without GTS.
+   */
+  uint8_t m_gtsLength;
+
+  /**
+   * Scheduler event for the next beacon of the coordinator.
+   */
+  EventId m_beaconEvent;
+
+  /**
+   * Scheduler event for the start of the GTS of this device.
+   */
+  EventId m_gtsEvent;
 };
 
 } // namespace ns3
@@ -475,6 +475,7 @@ LrWpanNetDevice::AssignStreams (int64_t stream)
   int64_t streamIndex = stream;
   streamIndex += m_csmaca->AssignStreams (stream);
   streamIndex += m_phy->AssignStreams (stream);
+  streamIndex += m_mac->AssignStreams (streamIndex);
   NS_LOG_DEBUG ("Number of assigned RV streams:  " << (streamIndex - stream));
   return (streamIndex - stream);
 }
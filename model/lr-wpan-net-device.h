@@ -159,7 +159,7 @@ public:
    * \param stream first stream index to use
    * \return the number of stream indices assigned by this model
    */
-  int64_t AssignStreams (int64_t stream);
+  virtual int64_t AssignStreams (int64_t stream);
 
 protected:
   // Inherited from NetDevice/Object
@@ -25,6 +25,7 @@
 #include "lr-wpan-spectrum-value-helper.h"
 #include "lr-wpan-error-model.h"
 #include "lr-wpan-net-device.h"
+#include "lr-wpan-spectrum-channel.h"
 #include <ns3/log.h>
 #include <ns3/abort.h>
 #include <ns3/simulator.h>
@@ -33,14 +34,17 @@
 #include <ns3/mobility-model.h>
 #include <ns3/spectrum-channel.h>
 #include <ns3/packet.h>
-#include <ns3/packet-burst.h>
 #include <ns3/net-device.h>
 #include <ns3/random-variable-stream.h>
 #include <ns3/double.h>
+#include <ns3/boolean.h>
+
+#include <algorithm>
 
 #include "rf-mac-type-tag.h"
 #include "rf-mac-duration-tag.h"
 #include "rf-mac-group-tag.h"
+#include "rf-mac-probe-tag.h"
 
 namespace ns3 {
 
@@ -81,6 +85,29 @@ LrWpanPhy::GetTypeId (void)
     .SetParent<SpectrumPhy> ()
     .SetGroupName ("LrWpan")
     .AddConstructor<LrWpanPhy> ()
+    .AddAttribute ("DeferredPerEvaluation",
+                   "If true, the SINR of a packet currently received is only "
+                   "recorded per chunk whenever the interference changes, "
+                   "and the packet error rate and the LQI are evaluated "
+                   "once at the end of the reception.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LrWpanPhy::m_deferredPerEvaluation),
+                   MakeBooleanChecker ())
+    .AddAttribute ("EarlyRxRejection",
+                   "If true, signals received with a power below "
+                   "RxRejectionThreshold are only added to the interference, "
+                   "without any attempt to receive them. CFEs and energy "
+                   "pulses are always harvested.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LrWpanPhy::m_earlyRxRejection),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RxRejectionThreshold",
+                   "The received power (dBm) below which signals are "
+                   "rejected early. Should be some dB below the receiver "
+                   "sensitivity.",
+                   DoubleValue (-116.58),
+                   MakeDoubleAccessor (&LrWpanPhy::m_rxRejectionThreshold),
+                   MakeDoubleChecker<double> ())
     .AddTraceSource ("TrxStateValue",
                      "The state of the transceiver",
                      MakeTraceSourceAccessor (&LrWpanPhy::m_trxState),
@@ -144,16 +171,24 @@ LrWpanPhy::LrWpanPhy (void)
   SetMyPhyOption ();
 
   m_edPower.averagePower = 0.0;
-  m_edPower.lastUpdate = Seconds (0.0);
   m_edPower.measurementLength = Seconds (0.0);
 
   // default -110 dBm in W for 2.4 GHz
   m_rxSensitivity = pow (10.0, -106.58 / 10.0) / 1000.0;
   LrWpanSpectrumValueHelper psdHelper;
-  m_txPsd = psdHelper.CreateTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower,
-                                                    m_phyPIBAttributes.phyCurrentChannel);
-  m_noise = psdHelper.CreateNoisePowerSpectralDensity (m_phyPIBAttributes.phyCurrentChannel);
+  m_txPsd = psdHelper.GetTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower,
+                                                 m_phyPIBAttributes.phyCurrentChannel);
+  m_noise = psdHelper.GetNoisePowerSpectralDensity (m_phyPIBAttributes.phyCurrentChannel);
+  m_compactNoise = LrWpanChannelPsd::FromSpectrumValue (m_noise, m_phyPIBAttributes.phyCurrentChannel);
   m_signal = Create<LrWpanInterferenceHelper> (m_noise->GetSpectrumModel ());
+  m_harvest = Create<LrWpanInterferenceHelper> (m_noise->GetSpectrumModel ());
+  m_harvestStart = Seconds (0);
+  m_probeSlots = 0;
+  m_deferredPerEvaluation = false;
+  m_earlyRxRejection = false;
+  m_rxRejectionThreshold = -116.58;
+  m_rxRejectedCount = 0;
+  m_trxStateStart = Seconds (0);
   m_rxLastUpdate = Seconds (0);
   Ptr<Packet> none_packet = 0;
   Ptr<LrWpanSpectrumSignalParameters> none_params = 0;
@@ -162,7 +197,6 @@ LrWpanPhy::LrWpanPhy (void)
   m_errorModel = 0;
 
   m_receivedRxPackets.clear();
-  m_receivedEnergy = 0.0;
 
   m_random = CreateObject<UniformRandomVariable> ();
   m_random->SetAttribute ("Min", DoubleValue (0.0));
@@ -183,15 +217,20 @@ LrWpanPhy::DoDispose (void)
 
   // Cancel pending transceiver state change, if one is in progress.
   m_setTRXState.Cancel ();
+  m_probeSlotEvent.Cancel ();
   m_trxState = IEEE_802_15_4_PHY_TRX_OFF;
   m_trxStatePending = IEEE_802_15_4_PHY_IDLE;
 
   m_mobility = 0;
   m_device = 0;
   m_channel = 0;
+  m_lrWpanChannel = 0;
   m_txPsd = 0;
   m_noise = 0;
   m_signal = 0;
+  m_harvest = 0;
+  m_currentTxParams = 0;
+  m_txParamsPool.clear ();
   m_errorModel = 0;
   m_pdDataIndicationCallback = MakeNullCallback< void, uint32_t, Ptr<Packet>, uint8_t > ();
   m_pdDataConfirmCallback = MakeNullCallback< void, LrWpanPhyEnumeration > ();
@@ -241,6 +280,7 @@ LrWpanPhy::SetChannel (Ptr<SpectrumChannel> c)
 {
   NS_LOG_FUNCTION (this << c);
   m_channel = c;
+  m_lrWpanChannel = DynamicCast<LrWpanSpectrumChannel> (c);
 }
 
 
@@ -286,14 +326,6 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
   NS_LOG_FUNCTION (this << spectrumRxParams);
   LrWpanSpectrumValueHelper psdHelper;
 
-  if (!m_edRequest.IsExpired ())
-    {
-      // Update the average receive power during ED.
-      Time now = Simulator::Now ();
-      m_edPower.averagePower += LrWpanSpectrumValueHelper::TotalAvgPower (m_signal->GetSignalPsd (), m_phyPIBAttributes.phyCurrentChannel) * (now - m_edPower.lastUpdate).GetTimeStep () / m_edPower.measurementLength.GetTimeStep ();
-      m_edPower.lastUpdate = now;
-    }
-
   Ptr<LrWpanSpectrumSignalParameters> lrWpanRxParams = DynamicCast<LrWpanSpectrumSignalParameters> (spectrumRxParams);
 
   if (lrWpanRxParams == 0)
@@ -304,7 +336,7 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
       // Update peak power if CCA is in progress.
       if (!m_ccaRequest.IsExpired ())
         {
-          double power = LrWpanSpectrumValueHelper::TotalAvgPower (m_signal->GetSignalPsd (), m_phyPIBAttributes.phyCurrentChannel);
+          double power = GetAccumulatedSignalPower ();
           if (m_ccaPeakPower < power)
             {
               m_ccaPeakPower = power;
@@ -315,27 +347,66 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
       return;
     }
 
-  Ptr<Packet> p = (lrWpanRxParams->packetBurst->GetPackets ()).front ();
+  Ptr<Packet> p = lrWpanRxParams->GetPacket ();
   NS_ASSERT (p != 0);
 
+  // Signals of LrWpan devices only occupy the band of a single channel.
+  // Convert them once, all further PSD arithmetic is done on the compact form.
+  LrWpanChannelPsd rxPsd = LrWpanChannelPsd::FromSpectrumValue (lrWpanRxParams->psd);
+  double watt = rxPsd.TotalAvgPower (m_phyPIBAttributes.phyCurrentChannel);
+
   RfMacTypeTag typeTag;
   p->PeekPacketTag (typeTag);
 
+  // Signals far below the sensitivity can never be received. Account them as
+  // interference only, like signals of other technologies. CFEs and energy
+  // pulses are harvested rather than decoded, so they take the normal path.
+  if (m_earlyRxRejection && !typeTag.IsCfe () && !typeTag.IsEnergy ()
+      && 10 * log10 (watt) + 30 < m_rxRejectionThreshold)
+    {
+      m_rxRejectedCount++;
+      CheckInterference ();
+      m_signal->AddSignal (lrWpanRxParams->psd, rxPsd);
+
+      // Update peak power if CCA is in progress.
+      if (!m_ccaRequest.IsExpired ())
+        {
+          double power = GetAccumulatedSignalPower ();
+          if (m_ccaPeakPower < power)
+            {
+              m_ccaPeakPower = power;
+            }
+        }
+
+      Simulator::Schedule (spectrumRxParams->duration, &LrWpanPhy::EndRx, this, spectrumRxParams);
+      return;
+    }
+
   RfMacDurationTag durationTag;
   p->PeekPacketTag (durationTag);
 
   if (typeTag.IsCfe ())
     {
-      if (!m_firstEnergySlot.IsRunning () && !m_secondEnergySlot.IsRunning ())
+      // The first CFE starts the probing in its slot, the later ones fall in
+      // the following slots. The slots before the first CFE are empty.
+      if (!m_probeSlotEvent.IsRunning ())
         {
-          m_firstEnergySlot = Simulator::Schedule (durationTag.Get (), &LrWpanPhy::EndEnergyRx, this, 1);
-          m_secondEnergySlot = Simulator::Schedule (2 * durationTag.Get (), &LrWpanPhy::EndEnergyRx, this, 2);
+          RfMacProbeTag probeTag;
+          p->PeekPacketTag (probeTag);
+          m_probeSlots = probeTag.GetSlots ();
+          m_probeSlotDuration = durationTag.Get ();
+          m_harvest->ResetSignalEnergy ();
+          m_harvestStart = Simulator::Now ();
+          uint8_t slot = std::min (std::max (probeTag.GetSlot (), static_cast<uint8_t> (1)), m_probeSlots);
+          m_probeSlotEvent = Simulator::Schedule (m_probeSlotDuration, &LrWpanPhy::EndEnergyRx, this, slot);
         }
     }
   else if (typeTag.IsEnergy ())
     {
       if (!m_energyRx.IsRunning ())
         {
+          m_harvest->ResetSignalEnergy ();
+          m_harvestStart = Simulator::Now ();
           m_energyRx = Simulator::Schedule (durationTag.Get (), &LrWpanPhy::EndEnergyRx, this, 0); 
         }
     }
@@ -353,6 +424,8 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
         {
           groupTag.Set (2);
         }
+      groupTag.SetRxPower (10 * log10 (watt) + 30);
+      groupTag.SetPhase ((distance - quotient * lamda) / lamda);
       NS_LOG_DEBUG ("distance: "<<distance <<" group: "<<static_cast<uint32_t>(groupTag.Get ()));
       p->AddPacketTag (groupTag);
     }
@@ -376,28 +449,21 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
 
       // Add any incoming packet to the current interference before checking the
       // SINR.
-      double watt = LrWpanSpectrumValueHelper::TotalAvgPower (lrWpanRxParams->psd, m_phyPIBAttributes.phyCurrentChannel);
       double receivedPower = 10 * log10(watt) + 30;
       
-      m_signal->AddSignal (lrWpanRxParams->psd);
-      Ptr<SpectrumValue> interferenceAndNoise = m_signal->GetSignalPsd ();
-      *interferenceAndNoise -= *lrWpanRxParams->psd;
-      *interferenceAndNoise += *m_noise;
-      double sinr = LrWpanSpectrumValueHelper::TotalAvgPower (lrWpanRxParams->psd, m_phyPIBAttributes.phyCurrentChannel) / LrWpanSpectrumValueHelper::TotalAvgPower (interferenceAndNoise, m_phyPIBAttributes.phyCurrentChannel);
+      m_signal->AddSignal (lrWpanRxParams->psd, rxPsd);
+      double sinr = watt / GetInterferenceAndNoisePower (rxPsd);
       // double energy = LrWpanSpectrumValueHelper::TotalEnergy (lrWpanRxParams->psd, m_phyPIBAttributes.phyCurrentChannel);
       NS_LOG_DEBUG (this << " receiving packet with power: " << receivedPower << "dBm");
       // NS_LOG_DEBUG (this << " energy: "<< energy);
       // NS_LOG_DEBUG (this << " sinr: " << sinr << "dB");
 
-      if(m_energyRx.IsRunning ())
-        {
-          NS_LOG_DEBUG (this << " watt: "<< watt << " duration: "<<durationTag.Get ().ToDouble (Time::S));
-          m_receivedEnergy += watt * durationTag.Get ().ToDouble (Time::S);
-        }
-      else if(m_firstEnergySlot.IsRunning () || m_secondEnergySlot.IsRunning ())
+      if (typeTag.IsCfe () || typeTag.IsEnergy ())
         {
-          NS_LOG_DEBUG (this << " watt: "<< watt);
-          m_receivedEnergy += watt;  
+          // Harvest the signal over its whole duration.
+          NS_LOG_DEBUG (this << " watt: "<< watt << " duration: "<<spectrumRxParams->duration.ToDouble (Time::S));
+          m_harvest->AddSignal (lrWpanRxParams->psd, rxPsd);
+          Simulator::Schedule (spectrumRxParams->duration, &LrWpanPhy::EndHarvest, this, spectrumRxParams);
         }
       // Std. 802.15.4-2006, appendix E, Figure E.2
       // At SNR < -5 the BER is less than 10e-1.
@@ -409,6 +475,8 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
               ChangeTrxState (IEEE_802_15_4_PHY_BUSY_RX);
             }
           m_currentRxPacket = std::make_pair (lrWpanRxParams, false);
+          m_currentRxPsd = rxPsd;
+          m_rxSegments.clear ();
           m_phyRxBeginTrace (p);
           m_rxLastUpdate = Simulator::Now ();
         }
@@ -429,7 +497,7 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
       // Add the incoming packet to the current interference after we have
       // checked for successfull reception of the current packet for the time
       // before the additional interference.
-      m_signal->AddSignal (lrWpanRxParams->psd);
+      m_signal->AddSignal (lrWpanRxParams->psd, rxPsd);
     }
   else
     {
@@ -438,13 +506,13 @@ LrWpanPhy::StartRx (Ptr<SpectrumSignalParameters> spectrumRxParams)
       m_phyRxDropTrace (p);
 
       // Add the signal power to the interference, anyway.
-      m_signal->AddSignal (lrWpanRxParams->psd);
+      m_signal->AddSignal (lrWpanRxParams->psd, rxPsd);
     }
 
   // Update peak power if CCA is in progress.
   if (!m_ccaRequest.IsExpired ())
     {
-      double power = LrWpanSpectrumValueHelper::TotalAvgPower (m_signal->GetSignalPsd (), m_phyPIBAttributes.phyCurrentChannel);
+      double power = GetAccumulatedSignalPower ();
       if (m_ccaPeakPower < power)
         {
           m_ccaPeakPower = power;
@@ -469,38 +537,23 @@ LrWpanPhy::CheckInterference (void)
 {
   NS_LOG_DEBUG (this);
   // Calculate whether packet was lost.
-  LrWpanSpectrumValueHelper psdHelper;
-  Ptr<LrWpanSpectrumSignalParameters> currentRxParams = m_currentRxPacket.first;
 
   // We are currently receiving a packet.
   if (m_trxState == IEEE_802_15_4_PHY_BUSY_RX)
     {
-      // NS_ASSERT (currentRxParams && !m_currentRxPacket.second);
+      // NS_ASSERT (m_currentRxPacket.first && !m_currentRxPacket.second);
 
-      Ptr<Packet> currentPacket = currentRxParams->packetBurst->GetPackets ().front ();
       if (m_errorModel != 0)
         {
           // How many bits did we receive since the last calculation?
           double t = (Simulator::Now () - m_rxLastUpdate).ToDouble (Time::MS);
           uint32_t chunkSize = ceil (t * (GetDataOrSymbolRate (true) / 1000));
-          Ptr<SpectrumValue> interferenceAndNoise = m_signal->GetSignalPsd ();
-          *interferenceAndNoise -= *currentRxParams->psd;
-          *interferenceAndNoise += *m_noise;
-          double sinr = LrWpanSpectrumValueHelper::TotalAvgPower (currentRxParams->psd, m_phyPIBAttributes.phyCurrentChannel) / LrWpanSpectrumValueHelper::TotalAvgPower (interferenceAndNoise, m_phyPIBAttributes.phyCurrentChannel);
-          double per = 1.0 - m_errorModel->GetChunkSuccessRate (sinr, chunkSize);
-
-          // The LQI is the total packet success rate scaled to 0-255.
-          // If not already set, initialize to 255.
-          LrWpanLqiTag tag (std::numeric_limits<uint8_t>::max ());
-          currentPacket->PeekPacketTag (tag);
-          uint8_t lqi = tag.Get ();
-          tag.Set (lqi - (per * lqi));
-          currentPacket->ReplacePacketTag (tag);
-
-          if (m_random->GetValue () < per)
+          double sinr = m_currentRxPsd.TotalAvgPower (m_phyPIBAttributes.phyCurrentChannel) / GetInterferenceAndNoisePower (m_currentRxPsd);
+          m_rxSegments.push_back (std::make_pair (chunkSize, sinr));
+
+          if (!m_deferredPerEvaluation)
             {
-              // The packet was destroyed, drop the packet after reception.
-              m_currentRxPacket.second = true;
+              EvaluateRxSegments ();
             }
         }
       else
@@ -512,24 +565,59 @@ LrWpanPhy::CheckInterference (void)
 }
 
 void
-LrWpanPhy::EndRx (Ptr<SpectrumSignalParameters> par)
+LrWpanPhy::EvaluateRxSegments (void)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << m_rxSegments.size ());
 
-  Ptr<LrWpanSpectrumSignalParameters> params = DynamicCast<LrWpanSpectrumSignalParameters> (par);
+  if (m_rxSegments.empty ())
+    {
+      return;
+    }
 
-  if (!m_edRequest.IsExpired ())
+  Ptr<Packet> currentPacket = m_currentRxPacket.first->GetPacket ();
+
+  // The LQI is the total packet success rate scaled to 0-255.
+  // If not already set, initialize to 255.
+  LrWpanLqiTag tag (std::numeric_limits<uint8_t>::max ());
+  currentPacket->PeekPacketTag (tag);
+  uint8_t lqi = tag.Get ();
+
+  // The chunks are independent, so the packet survives all of them with the
+  // product of their success rates. The LQI is degraded chunk by chunk, as
+  // if every chunk was evaluated on its own.
+  double successRate = 1.0;
+  for (std::vector<std::pair<uint32_t, double> >::const_iterator it = m_rxSegments.begin ();
+       it != m_rxSegments.end ();
+       ++it)
     {
-      // Update the average receive power during ED.
-      Time now = Simulator::Now ();
-      m_edPower.averagePower += LrWpanSpectrumValueHelper::TotalAvgPower (m_signal->GetSignalPsd (), m_phyPIBAttributes.phyCurrentChannel) * (now - m_edPower.lastUpdate).GetTimeStep () / m_edPower.measurementLength.GetTimeStep ();
-      m_edPower.lastUpdate = now;
+      double chunkSuccessRate = m_errorModel->GetChunkSuccessRate (it->second, it->first);
+      lqi = lqi - ((1.0 - chunkSuccessRate) * lqi);
+      successRate *= chunkSuccessRate;
     }
+  m_rxSegments.clear ();
+
+  tag.Set (lqi);
+  currentPacket->ReplacePacketTag (tag);
+
+  if (m_random->GetValue () < 1.0 - successRate)
+    {
+      // The packet was destroyed, drop the packet after reception.
+      m_currentRxPacket.second = true;
+    }
+}
+
+void
+LrWpanPhy::EndRx (Ptr<SpectrumSignalParameters> par)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<LrWpanSpectrumSignalParameters> params = DynamicCast<LrWpanSpectrumSignalParameters> (par);
 
   Ptr<LrWpanSpectrumSignalParameters> currentRxParams = m_currentRxPacket.first;
   if (currentRxParams == params)
     {
       CheckInterference ();
+      EvaluateRxSegments ();
     }
 
   // Update the interference.
@@ -544,12 +632,9 @@ LrWpanPhy::EndRx (Ptr<SpectrumSignalParameters> par)
   // If this is the end of the currently received packet, check if reception was successful.
   if (currentRxParams == params)
     {
-      Ptr<Packet> currentPacket = currentRxParams->packetBurst->GetPackets ().front ();
+      Ptr<Packet> currentPacket = currentRxParams->GetPacket ();
       NS_ASSERT (currentPacket != 0);
 
-      // double watt = LrWpanSpectrumValueHelper::TotalAvgPower (params->psd, m_phyPIBAttributes.phyCurrentChannel);
-      // m_receivedEnergy += watt;
-
       // If there is no error model attached to the PHY, we always report the maximum LQI value.
       LrWpanLqiTag tag (std::numeric_limits<uint8_t>::max ());
       currentPacket->PeekPacketTag (tag);
@@ -598,15 +683,36 @@ LrWpanPhy::EndRx (Ptr<SpectrumSignalParameters> par)
 void
 LrWpanPhy::EndEnergyRx (uint8_t slotNumber)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << static_cast<uint32_t> (slotNumber));
+
+  Time now = Simulator::Now ();
+  double energy = m_harvest->GetSignalEnergy (m_phyPIBAttributes.phyCurrentChannel);
+  if (slotNumber != 0 && now > m_harvestStart)
+    {
+      // The probe slots report the average power.
+      energy /= (now - m_harvestStart).GetSeconds ();
+    }
+  m_harvest->ResetSignalEnergy ();
+  m_harvestStart = now;
+
+  if (slotNumber != 0 && slotNumber < m_probeSlots)
+    {
+      m_probeSlotEvent = Simulator::Schedule (m_probeSlotDuration, &LrWpanPhy::EndEnergyRx, this, slotNumber + 1);
+    }
+
   if (!m_pdEnergyIndicationCallback.IsNull ())
     {
-      m_pdEnergyIndicationCallback (m_receivedEnergy, slotNumber);
-      NS_LOG_DEBUG ("initiate receivedEnergy");
-      m_receivedEnergy = 0.0; 
+      m_pdEnergyIndicationCallback (energy, slotNumber);
     }
 }
 
+void
+LrWpanPhy::EndHarvest (Ptr<SpectrumSignalParameters> params)
+{
+  NS_LOG_FUNCTION (this << params);
+  m_harvest->RemoveSignal (params->psd);
+}
+
 void
 LrWpanPhy::PdDataRequest (const uint32_t psduLength, Ptr<Packet> p)
 {
@@ -642,7 +748,7 @@ LrWpanPhy::PdDataRequest (const uint32_t psduLength, Ptr<Packet> p)
           p->PeekPacketTag (durationTag);
           Time duration = durationTag.Get ();
 
-          Ptr<LrWpanSpectrumSignalParameters> txParams = Create<LrWpanSpectrumSignalParameters> ();
+          Ptr<LrWpanSpectrumSignalParameters> txParams = AllocateTxParams ();
           txParams->duration = CalculateTxTime (p);
           // NS_LOG_DEBUG ("calculate tx time p: "<<txParams->duration);
           if (!typeTag.IsCfeAck () && duration.IsStrictlyPositive ())
@@ -651,15 +757,15 @@ LrWpanPhy::PdDataRequest (const uint32_t psduLength, Ptr<Packet> p)
           }
 
           txParams->txPhy = GetObject<SpectrumPhy> ();
-          txParams->psd = m_txPsd;
+          // The PSD may be shared, but the channel copies it before applying
+          // the path loss.
+          txParams->psd = ConstCast<SpectrumValue> (m_txPsd);
           txParams->txAntenna = m_antenna;
-          Ptr<PacketBurst> pb = CreateObject<PacketBurst> ();
-          pb->AddPacket (p);
-          txParams->packetBurst = pb;
+          txParams->packet = p;
           m_channel->StartTx (txParams);
 
+          m_currentTxParams = txParams;
           m_pdDataRequest = Simulator::Schedule (txParams->duration, &LrWpanPhy::EndTx, this);
-          Simulator::Schedule (txParams->duration, &LrWpanPhy::CalculateEnergyConsumtion, this, txParams);
 
           ChangeTrxState (IEEE_802_15_4_PHY_BUSY_TX);
 
@@ -699,11 +805,36 @@ LrWpanPhy::PdDataRequest (const uint32_t psduLength, Ptr<Packet> p)
     }
 }
 
+Ptr<LrWpanSpectrumSignalParameters>
+LrWpanPhy::AllocateTxParams (void)
+{
+  // Reuse parameters which are not referenced by anyone else anymore, i.e.
+  // neither by a channel nor by a pending event.
+  for (std::vector<Ptr<LrWpanSpectrumSignalParameters> >::const_iterator it = m_txParamsPool.begin ();
+       it != m_txParamsPool.end ();
+       ++it)
+    {
+      if ((*it)->GetReferenceCount () == 1)
+        {
+          (*it)->packetBurst = 0;
+          (*it)->packet = 0;
+          return *it;
+        }
+    }
+
+  Ptr<LrWpanSpectrumSignalParameters> txParams = Create<LrWpanSpectrumSignalParameters> ();
+  if (m_txParamsPool.size () < TX_PARAMS_POOL_SIZE)
+    {
+      m_txParamsPool.push_back (txParams);
+    }
+  return txParams;
+}
+
 void
 LrWpanPhy::CalculateEnergyConsumtion (Ptr<SpectrumSignalParameters> spectrumRxParams)
 {
   Ptr<LrWpanSpectrumSignalParameters> lrWpanRxParams = DynamicCast<LrWpanSpectrumSignalParameters> (spectrumRxParams);
-  Ptr<Packet> p = (lrWpanRxParams->packetBurst->GetPackets ()).front ();
+  Ptr<Packet> p = lrWpanRxParams->GetPacket ();
   double watt = LrWpanSpectrumValueHelper::TotalAvgPower (lrWpanRxParams->psd, m_phyPIBAttributes.phyCurrentChannel);
   RfMacDurationTag durationTag;
   p->PeekPacketTag (durationTag);
@@ -761,8 +892,7 @@ LrWpanPhy::PlmeEdRequest (void)
   if (m_trxState == IEEE_802_15_4_PHY_RX_ON || m_trxState == IEEE_802_15_4_PHY_BUSY_RX)
     {
       // Average over the powers of all signals received until EndEd()
-      m_edPower.averagePower = 0;
-      m_edPower.lastUpdate = Simulator::Now ();
+      m_signal->ResetSignalEnergy ();
       m_edPower.measurementLength = Seconds (8.0 / GetDataOrSymbolRate (false));
       m_edRequest = Simulator::Schedule (m_edPower.measurementLength, &LrWpanPhy::EndEd, this);
     }
@@ -874,10 +1004,12 @@ LrWpanPhy::PlmeSetTRXStateRequest (LrWpanPhyEnumeration state)
     {
       CancelEd (state);
 
+      // A packet already destroyed is still received until its end, which
+      // then applies the pending state.
       if ((m_trxState == IEEE_802_15_4_PHY_BUSY_RX)
-          && (m_currentRxPacket.first) && (!m_currentRxPacket.second))
+          && (m_currentRxPacket.first))
         {
-          NS_LOG_DEBUG ("Receiver has valid SFD; defer state change");
+          NS_LOG_DEBUG ("Receiver is busy; defer state change");
           m_trxStatePending = state;
           return;  // Send PlmeSetTRXStateConfirm later
         }
@@ -1044,7 +1176,7 @@ LrWpanPhy::PlmeSetAttributeRequest (LrWpanPibAttributeIdentifier id,
             // Cancel a pending transceiver state change.
             // Switch off the transceiver.
             // TODO: Is switching off the transceiver the right choice?
-            m_trxState = IEEE_802_15_4_PHY_TRX_OFF;
+            ChangeTrxState (IEEE_802_15_4_PHY_TRX_OFF);
             if (m_trxStatePending != IEEE_802_15_4_PHY_IDLE)
               {
                 m_trxStatePending = IEEE_802_15_4_PHY_IDLE;
@@ -1063,6 +1195,14 @@ LrWpanPhy::PlmeSetAttributeRequest (LrWpanPibAttributeIdentifier id,
             if (PhyIsBusy ())
               {
                 m_currentTxPacket.second = true;
+                if (m_pdDataRequest.IsRunning ())
+                  {
+                    // The energy of the aborted transmission is still accounted
+                    // at its scheduled end.
+                    Simulator::Schedule (Simulator::GetDelayLeft (m_pdDataRequest), &LrWpanPhy::CalculateEnergyConsumtion, this,
+                                         m_currentTxParams);
+                    m_currentTxParams = 0;
+                  }
                 m_pdDataRequest.Cancel ();
                 m_currentTxPacket.first = 0;
                 if (!m_pdDataConfirmCallback.IsNull ())
@@ -1071,9 +1211,10 @@ LrWpanPhy::PlmeSetAttributeRequest (LrWpanPibAttributeIdentifier id,
                   }
               }
             m_phyPIBAttributes.phyCurrentChannel = attribute->phyCurrentChannel;
+            m_compactNoise = LrWpanChannelPsd::FromSpectrumValue (m_noise, m_phyPIBAttributes.phyCurrentChannel);
             LrWpanSpectrumValueHelper psdHelper;
             // SetTxPowerSpectralDensity (psdHelper.CreateTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower, m_phyPIBAttributes.phyCurrentChannel));
-            m_txPsd = psdHelper.CreateTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower, m_phyPIBAttributes.phyCurrentChannel);
+            m_txPsd = psdHelper.GetTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower, m_phyPIBAttributes.phyCurrentChannel);
           }
         break;
       }
@@ -1100,7 +1241,7 @@ LrWpanPhy::PlmeSetAttributeRequest (LrWpanPibAttributeIdentifier id,
             m_phyPIBAttributes.phyTransmitPower = attribute->phyTransmitPower;
             LrWpanSpectrumValueHelper psdHelper;
             // SetTxPowerSpectralDensity (psdHelper.CreateTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower, m_phyPIBAttributes.phyCurrentChannel));
-            m_txPsd = psdHelper.CreateTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower, m_phyPIBAttributes.phyCurrentChannel);
+            m_txPsd = psdHelper.GetTxPowerSpectralDensity (m_phyPIBAttributes.phyTransmitPower, m_phyPIBAttributes.phyCurrentChannel);
           }
         break;
       }
@@ -1197,6 +1338,8 @@ LrWpanPhy::ChangeTrxState (LrWpanPhyEnumeration newState)
 {
   NS_LOG_LOGIC (this << " state: " << m_trxState << " -> " << newState);
   m_trxStateLogger (Simulator::Now (), m_trxState, newState);
+  m_trxStateTime[m_trxState] += Simulator::Now () - m_trxStateStart;
+  m_trxStateStart = Simulator::Now ();
   m_trxState = newState;
 }
 
@@ -1209,6 +1352,36 @@ LrWpanPhy::PhyIsBusy (void) const
           || (m_trxState == IEEE_802_15_4_PHY_BUSY));
 }
 
+double
+LrWpanPhy::GetAccumulatedSignalPower (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  return m_signal->GetSignalPower (m_phyPIBAttributes.phyCurrentChannel) + GetFarFieldPower ();
+}
+
+double
+LrWpanPhy::GetInterferenceAndNoisePower (const LrWpanChannelPsd &signal) const
+{
+  NS_LOG_FUNCTION (this << signal.GetChannel ());
+
+  // The in-band power of the received signal is subtracted from the running
+  // per-channel sum of the interference helper.
+  uint32_t channel = m_phyPIBAttributes.phyCurrentChannel;
+  double interference = m_signal->GetSignalPower (channel) - signal.TotalAvgPower (channel);
+  return std::max (interference, 0.0) + m_compactNoise.TotalAvgPower (channel) + GetFarFieldPower ();
+}
+
+double
+LrWpanPhy::GetFarFieldPower (void) const
+{
+  if (m_lrWpanChannel == 0)
+    {
+      return 0.0;
+    }
+  return m_lrWpanChannel->GetFarFieldPower (this, m_phyPIBAttributes.phyCurrentChannel);
+}
+
 void
 LrWpanPhy::CancelEd (LrWpanPhyEnumeration state)
 {
@@ -1231,7 +1404,9 @@ LrWpanPhy::EndEd (void)
 {
   NS_LOG_FUNCTION (this);
 
-  m_edPower.averagePower += LrWpanSpectrumValueHelper::TotalAvgPower (m_signal->GetSignalPsd (), m_phyPIBAttributes.phyCurrentChannel) * (Simulator::Now () - m_edPower.lastUpdate).GetTimeStep () / m_edPower.measurementLength.GetTimeStep ();
+  // The far-field power is taken as constant during the measurement.
+  m_edPower.averagePower = m_signal->GetSignalEnergy (m_phyPIBAttributes.phyCurrentChannel) / m_edPower.measurementLength.GetSeconds ()
+    + GetFarFieldPower ();
 
   uint8_t energyLevel;
 
@@ -1265,7 +1440,7 @@ LrWpanPhy::EndCca (void)
   LrWpanPhyEnumeration sensedChannelState = IEEE_802_15_4_PHY_UNSPECIFIED;
 
   // Update peak power.
-  double power = LrWpanSpectrumValueHelper::TotalAvgPower (m_signal->GetSignalPsd (), m_phyPIBAttributes.phyCurrentChannel);
+  double power = GetAccumulatedSignalPower ();
   if (m_ccaPeakPower < power)
     {
       m_ccaPeakPower = power;
@@ -1354,6 +1529,11 @@ LrWpanPhy::EndTx (void)
 
   NS_ABORT_IF ( (m_trxState != IEEE_802_15_4_PHY_BUSY_TX) && (m_trxState != IEEE_802_15_4_PHY_TRX_OFF));
 
+  // Calculate the energy consumption after the transmission was confirmed,
+  // even if the MAC already starts the next one from the confirm callback.
+  Ptr<LrWpanSpectrumSignalParameters> txParams = m_currentTxParams;
+  m_currentTxParams = 0;
+
   if (m_currentTxPacket.second == false)
     {
       NS_LOG_DEBUG ("Packet successfully transmitted");
@@ -1401,6 +1581,13 @@ LrWpanPhy::EndTx (void)
           ChangeTrxState (IEEE_802_15_4_PHY_TX_ON);
         }
     }
+
+  if (txParams)
+    {
+      CalculateEnergyConsumtion (txParams);
+      // Release the packet, the parameters may be reused by the pool.
+      txParams->packet = 0;
+    }
 }
 
 Time
@@ -1524,6 +1711,7 @@ LrWpanPhy::SetNoisePowerSpectralDensity (Ptr<const SpectrumValue> noisePsd)
   NS_LOG_INFO ("\t computed noise_psd: " << *noisePsd );
   NS_ASSERT (noisePsd);
   m_noise = noisePsd;
+  m_compactNoise = LrWpanChannelPsd::FromSpectrumValue (m_noise, m_phyPIBAttributes.phyCurrentChannel);
 }
 
 Ptr<const SpectrumValue>
@@ -1558,6 +1746,30 @@ LrWpanPhy::GetPhySHRDuration (void) const
          + ppduHeaderSymbolNumbers[m_phyOption].shrSfd;
 }
 
+uint64_t
+LrWpanPhy::GetRxRejectedCount (void) const
+{
+  return m_rxRejectedCount;
+}
+
+uint8_t
+LrWpanPhy::GetProbeSlots (void) const
+{
+  return m_probeSlots;
+}
+
+Time
+LrWpanPhy::GetTrxStateTime (LrWpanPhyEnumeration state) const
+{
+  NS_ASSERT (state <= IEEE_802_15_4_PHY_UNSPECIFIED);
+  Time time = m_trxStateTime[state];
+  if (state == m_trxState)
+    {
+      time += Simulator::Now () - m_trxStateStart;
+    }
+  return time;
+}
+
 double
 LrWpanPhy::GetPhySymbolsPerOctet (void) const
 {
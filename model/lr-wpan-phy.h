@@ -23,6 +23,7 @@
 #define LR_WPAN_PHY_H
 
 #include "lr-wpan-interference-helper.h"
+#include "lr-wpan-channel-psd.h"
 
 #include <ns3/spectrum-phy.h>
 #include <ns3/traced-callback.h>
@@ -37,6 +38,7 @@ class LrWpanErrorModel;
 struct LrWpanSpectrumSignalParameters;
 class MobilityModel;
 class SpectrumChannel;
+class LrWpanSpectrumChannel;
 class SpectrumModel;
 class AntennaModel;
 class NetDevice;
@@ -50,7 +52,6 @@ class UniformRandomVariable;
 typedef struct
 {
   double averagePower;    //!< Average measured power
-  Time lastUpdate;        //!< Last update time
   Time measurementLength; //!< Total measuremement period
 } LrWpanEdPower;
 
@@ -480,6 +481,40 @@ public:
    */
   double GetPhySymbolsPerOctet (void) const;
 
+  /**
+   * Get the number of signals rejected early, because their received power
+   * was below the RxRejectionThreshold.
+   *
+   * \return the number of rejected signals
+   */
+  uint64_t GetRxRejectedCount (void) const;
+
+  /**
+   * Get the number of probe slots of the last CFE probing, announced by its
+   * first CFE.
+   *
+   * \return the number of probe slots
+   */
+  uint8_t GetProbeSlots (void) const;
+
+  /**
+   * Get the time the transceiver spent in a state so far. The listening time
+   * is the time in RX_ON and BUSY_RX, the sleeping time the time in TRX_OFF.
+   *
+   * \param state the transceiver state
+   * \return the total time spent in the state, including the current period
+   */
+  Time GetTrxStateTime (LrWpanPhyEnumeration state) const;
+
+  /**
+   * Calculate the time required for sending the given packet, including
+   * preamble, SFD and PHR.
+   *
+   * \param packet the packet for which the transmission time should be calculated
+   * \return the time required for transmitting the packet
+   */
+  Time CalculateTxTime (Ptr<const Packet> packet);
+
   /**
    * Assign a fixed random variable stream number to the random variables
    * used by this model.  Return the number of streams that have been assigned.
@@ -508,9 +543,10 @@ public:
   LrWpanPhyPibAttributes m_phyPIBAttributes;
 
   /**
-   * The transmit power spectral density.
+   * The transmit power spectral density. Usually shared with other PHYs, see
+   * LrWpanSpectrumValueHelper::GetTxPowerSpectralDensity.
    */
-  Ptr<SpectrumValue> m_txPsd;
+  Ptr<const SpectrumValue> m_txPsd;
 
 protected:
   /**
@@ -561,12 +597,27 @@ private:
    */
   void EndTx (void);
 
+  /**
+   * Get signal parameters for a new transmission, reusing parameters of a
+   * previous transmission if they are not referenced anymore.
+   *
+   * \return the signal parameters
+   */
+  Ptr<LrWpanSpectrumSignalParameters> AllocateTxParams (void);
+
   /**
    * Check if the interference destroys a frame currently received. Called
    * whenever a change in interference is detected.
    */
   void CheckInterference (void);
 
+  /**
+   * Evaluate the recorded SINR segments of the packet currently received:
+   * degrade its LQI, and decide by a single random draw on the combined
+   * success rate of the segments whether it is destroyed.
+   */
+  void EvaluateRxSegments (void);
+
   /**
    * Finish the reception of a frame. This is called at the end of a frame
    * reception, applying possibly pending PHY state changes and fireing the
@@ -579,8 +630,24 @@ private:
    */
   void EndRx (Ptr<SpectrumSignalParameters> params);
 
+  /**
+   * Report the harvested energy at the end of a CFE probe slot, or of an
+   * energy pulse, and restart the measurement. For the probe slots, from
+   * the slot of the first CFE to m_probeSlots, the average harvested power
+   * in W during the slot is reported, for slot 0 (energy pulse) the
+   * harvested energy in J. The end of the next probe slot follows, if any.
+   *
+   * \param slotNumber the probe slot, or 0 for an energy pulse
+   */
   void EndEnergyRx (uint8_t slotNumber);
 
+  /**
+   * Stop harvesting the energy of a CFE or energy pulse signal at its end.
+   *
+   * \param params the parameters of the harvested signal
+   */
+  void EndHarvest (Ptr<SpectrumSignalParameters> params);
+
   /**
    * Cancel an ongoing ED procedure. This is called when the transceiver is
    * switched off or set to TX mode. This calls the appropiate confirm callback
@@ -608,15 +675,6 @@ private:
    */
   void EndSetTRXState (void);
 
-  /**
-   * Calculate the time required for sending the given packet, including
-   * preamble, SFD and PHR.
-   *
-   * \param packet the packet for which the transmission time should be calculated
-   * \return the time required for transmitting the packet
-   */
-  Time CalculateTxTime (Ptr<const Packet> packet);
-
   /**
    * Calculate the time required for sending the PPDU header, that is the
    * preamble, SFD and PHR.
@@ -639,6 +697,33 @@ private:
    */
   bool PhyIsBusy (void) const;
 
+  /**
+   * Get the in-band power of all signals currently accumulated by the
+   * interference helper, on the current channel, plus the far-field power.
+   *
+   * \return the accumulated signal power in W
+   */
+  double GetAccumulatedSignalPower (void) const;
+
+  /**
+   * Get the in-band power of the interference and noise seen by the given
+   * signal, i.e. all accumulated signals except the given one, plus noise
+   * and the far-field power, on the current channel.
+   *
+   * \param signal the compact PSD of the signal of interest, which has to be
+   * part of the accumulated signals
+   * \return the interference and noise power in W
+   */
+  double GetInterferenceAndNoisePower (const LrWpanChannelPsd &signal) const;
+
+  /**
+   * Get the power of the signals culled by an LrWpanSpectrumChannel for this
+   * PHY, on the current channel.
+   *
+   * \return the far-field power in W, 0 for other channels
+   */
+  double GetFarFieldPower (void) const;
+
   // Trace sources
   /**
    * The trace source fired when a packet begins the transmission process on
@@ -815,11 +900,66 @@ private:
    */
   Ptr<LrWpanInterferenceHelper> m_signal;
 
+  /**
+   * The channel, if it is an LrWpanSpectrumChannel, queried for the far-field
+   * power.
+   */
+  Ptr<LrWpanSpectrumChannel> m_lrWpanChannel;
+
+  /**
+   * The noise PSD within the band of the current channel.
+   */
+  LrWpanChannelPsd m_compactNoise;
+
+  /**
+   * The compact PSD of the packet currently being received.
+   */
+  LrWpanChannelPsd m_currentRxPsd;
+
   /**
    * Timestamp of the last calculation of the PER of a packet currently received.
    */
   Time m_rxLastUpdate;
 
+  /**
+   * Evaluate the PER of a packet currently received once at the end of the
+   * reception, instead of whenever the interference changes.
+   */
+  bool m_deferredPerEvaluation;
+
+  /**
+   * The SINR timeline of the packet currently received, not yet evaluated,
+   * as pairs of the chunk size in bits and the SINR.
+   */
+  std::vector<std::pair<uint32_t, double> > m_rxSegments;
+
+  /**
+   * Reject signals received below m_rxRejectionThreshold before any further
+   * processing. CFEs and energy pulses are never rejected.
+   */
+  bool m_earlyRxRejection;
+
+  /**
+   * The received power (dBm) below which signals only contribute to the
+   * interference.
+   */
+  double m_rxRejectionThreshold;
+
+  /**
+   * The number of signals rejected early.
+   */
+  uint64_t m_rxRejectedCount;
+
+  /**
+   * The total time spent in each transceiver state, up to m_trxStateStart.
+   */
+  Time m_trxStateTime[IEEE_802_15_4_PHY_UNSPECIFIED + 1];
+
+  /**
+   * The time of the last transceiver state change.
+   */
+  Time m_trxStateStart;
+
   /**
    * Statusinformation of the currently received packet. The first parameter
    * contains the frame, as well the signal power of the frame. The second
@@ -830,7 +970,17 @@ private:
 
   std::vector<std::pair<Ptr<LrWpanSpectrumSignalParameters>, bool> > m_receivedRxPackets;
 
-  double m_receivedEnergy;
+  /**
+   * The CFE and energy pulse signals currently harvested. Their in-band energy
+   * integrated since m_harvestStart is reported per probe slot and per
+   * energy pulse.
+   */
+  Ptr<LrWpanInterferenceHelper> m_harvest;
+
+  /**
+   * The start of the current harvesting measurement.
+   */
+  Time m_harvestStart;
 
   /**
    * Statusinformation of the currently transmitted packet. The first parameter
@@ -860,10 +1010,38 @@ private:
    */
   EventId m_pdDataRequest;
 
+  /**
+   * The signal parameters of the current transmission.
+   */
+  Ptr<LrWpanSpectrumSignalParameters> m_currentTxParams;
+
+  /**
+   * The maximum number of signal parameters kept for reuse.
+   */
+  static const uint32_t TX_PARAMS_POOL_SIZE = 4;
+
+  /**
+   * The signal parameters kept for reuse by later transmissions.
+   */
+  std::vector<Ptr<LrWpanSpectrumSignalParameters> > m_txParamsPool;
+
   EventId m_energyRx;
   EventId m_cfeRx;
-  EventId m_firstEnergySlot;
-  EventId m_secondEnergySlot;
+
+  /**
+   * The end of the current CFE probe slot.
+   */
+  EventId m_probeSlotEvent;
+
+  /**
+   * The number of probe slots of the current CFE probing.
+   */
+  uint8_t m_probeSlots;
+
+  /**
+   * The duration of a probe slot of the current CFE probing.
+   */
+  Time m_probeSlotDuration;
 
   /**
    * Uniform random variable stream.
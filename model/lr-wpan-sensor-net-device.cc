@@ -3,7 +3,12 @@
 #include <ns3/simulator.h>
 #include <ns3/log.h>
 #include <ns3/uinteger.h>
+#include <ns3/double.h>
+#include <ns3/boolean.h>
+#include <ns3/nstime.h>
 #include <ns3/node.h>
+#include <algorithm>
+#include <cmath>
 
 namespace ns3{
 
@@ -26,6 +31,46 @@ LrWpanSensorNetDevice::GetTypeId(void)
 		.SetParent<LrWpanNetDevice> ()
 		.SetGroupName ("LrWpan")
 		.AddConstructor<LrWpanSensorNetDevice> ()
+		.AddAttribute ("ProactiveRequests",
+		               "Request energy ahead of the projected crossing of the "
+		               "minimum threshold voltage, instead of waiting for "
+		               "external requests.",
+		               BooleanValue (false),
+		               MakeBooleanAccessor (&LrWpanSensorNetDevice::m_proactiveRequests),
+		               MakeBooleanChecker ())
+		.AddAttribute ("UpdateInterval",
+		               "The interval of the updates of the consumption rate "
+		               "and of the projection of the next request.",
+		               TimeValue (Seconds (1)),
+		               MakeTimeAccessor (&LrWpanSensorNetDevice::m_updateInterval),
+		               MakeTimeChecker (MicroSeconds (1)))
+		.AddAttribute ("RequestGuard",
+		               "The margin of a request beyond the observed delay from "
+		               "a request to the end of its charge cycle.",
+		               TimeValue (MilliSeconds (500)),
+		               MakeTimeAccessor (&LrWpanSensorNetDevice::m_requestGuard),
+		               MakeTimeChecker ())
+		.AddAttribute ("RequestJitter",
+		               "The maximum random advance of a request, so the "
+		               "neighbouring sensors do not request at the same time.",
+		               TimeValue (MilliSeconds (100)),
+		               MakeTimeAccessor (&LrWpanSensorNetDevice::m_requestJitter),
+		               MakeTimeChecker ())
+		.AddAttribute ("ConsumptionSmoothing",
+		               "The weight of the last update interval in the "
+		               "smoothed consumption rate.",
+		               DoubleValue (0.5),
+		               MakeDoubleAccessor (&LrWpanSensorNetDevice::m_consumptionSmoothing),
+		               MakeDoubleChecker<double> (0.0, 1.0))
+		.AddTraceSource ("HarvestedPower",
+		                 "The average harvested power over the last update "
+		                 "interval, in W",
+		                 MakeTraceSourceAccessor (&LrWpanSensorNetDevice::m_harvestedPower),
+		                 "ns3::TracedValueCallback::Double")
+		.AddTraceSource ("TotalEnergyHarvested",
+		                 "The total harvested energy, in J",
+		                 MakeTraceSourceAccessor (&LrWpanSensorNetDevice::m_totalEnergyHarvestedJ),
+		                 "ns3::TracedValueCallback::Double")
 	;
 
 	return tid;
@@ -45,6 +90,16 @@ LrWpanSensorNetDevice::LrWpanSensorNetDevice (void)
 	m_q = m_amh * 3600;
 	m_c = m_q / m_maxVoltage;
 
+	m_harvestedPower = 0.0;
+	m_totalEnergyHarvestedJ = 0.0;
+	m_consumptionRate = 0.0;
+	m_consumedEnergy = 0.0;
+	m_harvestedEnergy = 0.0;
+	m_chargeDelay = Seconds (0);
+	m_lastRfe = Seconds (0);
+	m_requestPending = false;
+	m_requestJitterRandom = CreateObject<UniformRandomVariable> ();
+
 	GetMac ()->m_minThresholdVoltage = m_minThresholdVoltage;
 	GetMac ()->m_maxThresholdVoltage = m_maxVoltage;
 	GetMac ()->m_minVoltage = m_minVoltage;
@@ -66,36 +121,131 @@ LrWpanSensorNetDevice::DoDispose (void)
 {
 	NS_LOG_FUNCTION (this);
 	m_energyUpdateEvent.Cancel ();
+	m_rfeEvent.Cancel ();
+	m_requestJitterRandom = 0;
 	LrWpanNetDevice::DoDispose ();
 }
 
+int64_t
+LrWpanSensorNetDevice::AssignStreams (int64_t stream)
+{
+	NS_LOG_FUNCTION (this << stream);
+	int64_t streamIndex = stream + LrWpanNetDevice::AssignStreams (stream);
+	m_requestJitterRandom->SetStream (streamIndex);
+	return (streamIndex + 1 - stream);
+}
+
 void
 LrWpanSensorNetDevice::DoInitialize (void)
 {
 	NS_LOG_FUNCTION (this);
 	LrWpanNetDevice::DoInitialize ();
+	if (m_proactiveRequests)
+	{
+		m_energyUpdateEvent = Simulator::Schedule (m_updateInterval, &LrWpanSensorNetDevice::UpdatePower, this);
+	}
 }
 
 void
 LrWpanSensorNetDevice::SendRfe (void)
 {
+	NS_LOG_FUNCTION (this << m_currentVoltage);
+	m_requestPending = true;
+	m_lastRfe = Simulator::Now ();
 	GetMac()->SendRfeForEnergy ();
 }
 
+void
+LrWpanSensorNetDevice::UpdatePower (void)
+{
+	NS_LOG_FUNCTION (this);
+	double interval = m_updateInterval.GetSeconds ();
+	m_consumptionRate = m_consumptionSmoothing * m_consumedEnergy / interval
+	                    + (1 - m_consumptionSmoothing) * m_consumptionRate;
+	m_harvestedPower = m_harvestedEnergy / interval;
+	m_consumedEnergy = 0.0;
+	m_harvestedEnergy = 0.0;
+	NS_LOG_DEBUG ("Voltage: " << m_currentVoltage << " consumption: " << m_consumptionRate << " W");
+
+	ScheduleRfe ();
+	m_energyUpdateEvent = Simulator::Schedule (m_updateInterval, &LrWpanSensorNetDevice::UpdatePower, this);
+}
+
+void
+LrWpanSensorNetDevice::ScheduleRfe (void)
+{
+	if (m_requestPending && Simulator::Now () < m_lastRfe + m_chargeDelay + m_updateInterval)
+	{
+		// Wait for the charge cycle of the last request.
+		return;
+	}
+	m_requestPending = false;
+	m_rfeEvent.Cancel ();
+	if (m_consumptionRate <= 0.0)
+	{
+		return;
+	}
+
+	// E = C * V^2 / 2
+	double margin = GetStoredEnergy () - 0.5 * m_c * m_minThresholdVoltage * m_minThresholdVoltage;
+	Time brownOut = Seconds (std::max (margin, 0.0) / m_consumptionRate);
+	Time lead = m_chargeDelay + m_requestGuard + Seconds (m_requestJitterRandom->GetValue (0.0, m_requestJitter.GetSeconds ()));
+	Time delay = brownOut > lead ? brownOut - lead : Seconds (0);
+	NS_LOG_DEBUG ("Brown-out in " << brownOut.GetSeconds () << " s, request in " << delay.GetSeconds () << " s");
+
+	// A later request is projected again with the next consumption rate.
+	if (delay < m_updateInterval)
+	{
+		m_rfeEvent = Simulator::Schedule (delay, &LrWpanSensorNetDevice::SendRfe, this);
+	}
+}
+
+double
+LrWpanSensorNetDevice::GetStoredEnergy (void) const
+{
+	return 0.5 * m_c * m_currentVoltage * m_currentVoltage;
+}
+
+void
+LrWpanSensorNetDevice::SetStoredEnergy (double energy)
+{
+	double volt = std::sqrt (2 * std::max (energy, 0.0) / m_c);
+	m_currentVoltage = std::min (std::max (volt, m_minVoltage), m_maxVoltage);
+	GetMac ()->m_currentVoltage = m_currentVoltage;
+}
+
 void
 LrWpanSensorNetDevice::RfMacEnergyIndication (double energy)
 {
 	NS_LOG_DEBUG ("Received Power: "<<energy);
-
+	m_totalEnergyHarvestedJ += energy;
+	if (!m_proactiveRequests)
+	{
+		return;
+	}
+
+	m_harvestedEnergy += energy;
+	SetStoredEnergy (GetStoredEnergy () + energy);
+	if (m_requestPending)
+	{
+		m_chargeDelay = Simulator::Now () - m_lastRfe;
+		m_requestPending = false;
+	}
+	ScheduleRfe ();
 }
 
 void
 LrWpanSensorNetDevice::RfMacEnergyConsumtion (double energy)
 {
 	NS_LOG_DEBUG ("Consumed Power: "<<energy);
-	//V = E / Q
-	double volt = energy / m_q;
-	NS_LOG_DEBUG ("Voltage: "<<volt);
+	if (!m_proactiveRequests)
+	{
+		return;
+	}
+
+	m_consumedEnergy += energy;
+	SetStoredEnergy (GetStoredEnergy () - energy);
+	NS_LOG_DEBUG ("Voltage: "<<m_currentVoltage);
 }
 
 }//namespace ns3
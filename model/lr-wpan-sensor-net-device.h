@@ -2,6 +2,7 @@
 #define LR_WPAN_SENSOR_NET_DEVICE_H
 
 #include "lr-wpan-net-device.h"
+#include <ns3/random-variable-stream.h>
 
 namespace ns3 {
 
@@ -16,6 +17,15 @@ public:
 	void RfMacEnergyIndication (double energy);
 	void RfMacEnergyConsumtion (double energy);
 
+	/**
+	 * Assign a fixed random variable stream number to the random variables
+	 * of the device and to the jitter of the energy requests.
+	 *
+	 * \param stream first stream index to use
+	 * \return the number of stream indices assigned by this model
+	 */
+	virtual int64_t AssignStreams (int64_t stream);
+
 	double m_currentVoltage;
 	double m_minThresholdVoltage;
 
@@ -28,14 +38,102 @@ protected:
 private:
 
 	void SendRfe (void);
+
+	/**
+	 * Update the consumption rate and the harvested power over the last
+	 * update interval, and schedule the next energy request.
+	 */
 	void UpdatePower (void);
 
+	/**
+	 * Project the time the voltage crosses the minimum threshold voltage at
+	 * the current consumption rate, and schedule an energy request ahead of
+	 * it, if it falls before the next update.
+	 */
+	void ScheduleRfe (void);
+
+	/**
+	 * \return the energy stored at the current voltage, in J
+	 */
+	double GetStoredEnergy (void) const;
+
+	/**
+	 * Set the current voltage from the stored energy, within the minimum and
+	 * the maximum voltage.
+	 *
+	 * \param energy the stored energy, in J
+	 */
+	void SetStoredEnergy (double energy);
+
 	TracedValue<double> m_harvestedPower;
 	TracedValue<double> m_totalEnergyHarvestedJ;
 
 	Time m_updateInterval;
 	EventId m_energyUpdateEvent;
 
+	/**
+	 * Request energy ahead of the projected brown-out, instead of waiting
+	 * for external requests.
+	 */
+	bool m_proactiveRequests;
+
+	/**
+	 * The margin of the requests beyond the observed delay from a request to
+	 * the end of its charge cycle.
+	 */
+	Time m_requestGuard;
+
+	/**
+	 * The maximum random advance of a request.
+	 */
+	Time m_requestJitter;
+
+	/**
+	 * The weight of the last update interval in the consumption rate.
+	 */
+	double m_consumptionSmoothing;
+
+	/**
+	 * The smoothed consumption rate, in W.
+	 */
+	double m_consumptionRate;
+
+	/**
+	 * The energy consumed since the last update, in J.
+	 */
+	double m_consumedEnergy;
+
+	/**
+	 * The energy harvested since the last update, in J.
+	 */
+	double m_harvestedEnergy;
+
+	/**
+	 * The delay from the last request to the end of its charge cycle.
+	 */
+	Time m_chargeDelay;
+
+	/**
+	 * The time of the last request.
+	 */
+	Time m_lastRfe;
+
+	/**
+	 * A request was sent and its charge cycle did not end yet.
+	 */
+	bool m_requestPending;
+
+	/**
+	 * Scheduler event for the next request.
+	 */
+	EventId m_rfeEvent;
+
+	/**
+	 * The random advance of the requests, so neighbouring sensors do not
+	 * request at the same time.
+	 */
+	Ptr<UniformRandomVariable> m_requestJitterRandom;
+
 	double m_q;
 	double m_c;
 	double m_amh;
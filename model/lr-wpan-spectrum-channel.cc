@@ -0,0 +1,869 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-spectrum-channel.h"
+#include "lr-wpan-spectrum-signal-parameters.h"
+#include "lr-wpan-channel-psd.h"
+#include <ns3/log.h>
+#include <ns3/simulator.h>
+#include <ns3/double.h>
+#include <ns3/boolean.h>
+#include <ns3/uinteger.h>
+#include <ns3/node.h>
+#include <ns3/net-device.h>
+#include <ns3/mobility-model.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/antenna-model.h>
+#include <ns3/angles.h>
+#include <ns3/spectrum-phy.h>
+#include <ns3/spectrum-value.h>
+#include <ns3/spectrum-model.h>
+#include <ns3/spectrum-signal-parameters.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/propagation-delay-model.h>
+#include <ns3/spectrum-propagation-loss-model.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LrWpanSpectrumChannel");
+
+NS_OBJECT_ENSURE_REGISTERED (LrWpanSpectrumChannel);
+
+/**
+ * The largest cutoff radius searched for, in m.
+ */
+static const double MAX_CUTOFF_RADIUS = 1.0e7;
+
+TypeId
+LrWpanSpectrumChannel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanSpectrumChannel")
+    .SetParent<SpectrumChannel> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<LrWpanSpectrumChannel> ()
+    .AddAttribute ("MaxLossDb",
+                   "If a single-frequency PropagationLossModel is used, "
+                   "this value represents the maximum loss in dB for which "
+                   "transmissions will be passed to the receiving PHY.",
+                   DoubleValue (1.0e9),
+                   MakeDoubleAccessor (&LrWpanSpectrumChannel::m_maxLossDb),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("LinkBudgetCache",
+                   "If true, the path gain and the propagation delay are "
+                   "computed once per pair of transmitting and receiving PHY, "
+                   "and reused until one of them moves. Only use this with "
+                   "deterministic propagation loss models.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&LrWpanSpectrumChannel::m_linkBudgetCache),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ReceiverCulling",
+                   "If true, LR-WPAN signals are only delivered to receivers "
+                   "within the cutoff radius, at which the received power "
+                   "drops below RxPowerFloor.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LrWpanSpectrumChannel::m_receiverCulling),
+                   MakeBooleanChecker ())
+    .AddAttribute ("RxPowerFloor",
+                   "The received power (dBm) below which signals are culled. "
+                   "Should be some dB below the receiver sensitivity.",
+                   DoubleValue (-116.58),
+                   MakeDoubleAccessor (&LrWpanSpectrumChannel::SetRxPowerFloor,
+                                       &LrWpanSpectrumChannel::GetRxPowerFloor),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("MaxTxPower",
+                   "The maximum transmit power (dBm) of all transmitters, "
+                   "used to compute the cutoff radius. A signal sent with a "
+                   "higher power is an error.",
+                   DoubleValue (30.0),
+                   MakeDoubleAccessor (&LrWpanSpectrumChannel::SetMaxTxPower,
+                                       &LrWpanSpectrumChannel::GetMaxTxPower),
+                   MakeDoubleChecker<double> ())
+    .AddAttribute ("FarFieldNoise",
+                   "If true, the power of culled signals is accounted as "
+                   "far-field noise at the receivers.",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&LrWpanSpectrumChannel::m_farFieldNoise),
+                   MakeBooleanChecker ())
+    .AddAttribute ("FarFieldBlockSize",
+                   "The number of cells per side of the square blocks in which "
+                   "the far-field noise of distant cells is aggregated. With "
+                   "1, the far field is evaluated per cell.",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&LrWpanSpectrumChannel::SetFarFieldBlockSize,
+                                         &LrWpanSpectrumChannel::GetFarFieldBlockSize),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("PathLoss",
+                     "This trace is fired whenever a new path loss value "
+                     "is calculated.",
+                     MakeTraceSourceAccessor (&LrWpanSpectrumChannel::m_pathLossTrace),
+                     "ns3::SpectrumChannel::LossTracedCallback")
+  ;
+  return tid;
+}
+
+LrWpanSpectrumChannel::LrWpanSpectrumChannel (void)
+  : m_maxLossDb (1.0e9),
+    m_linkBudgetCache (true),
+    m_receiverCulling (false),
+    m_rxPowerFloor (-116.58),
+    m_maxTxPower (30.0),
+    m_farFieldNoise (true),
+    m_farFieldBlockSize (4),
+    m_cutoffRadius (-1.0),
+    m_indexDirty (true)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+LrWpanSpectrumChannel::FarField::FarField ()
+  : signals (0)
+{
+  std::fill (power, power + 16, 0.0);
+}
+
+LrWpanSpectrumChannel::~LrWpanSpectrumChannel (void)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LrWpanSpectrumChannel::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_phyList.clear ();
+  m_linkBudgets.clear ();
+  m_rxPsds.clear ();
+  m_trackedMobility.clear ();
+  m_cells.clear ();
+  m_blocks.clear ();
+  m_phyCells.clear ();
+  m_mobilityPhys.clear ();
+  m_unindexed.clear ();
+  m_farFieldGains.clear ();
+  m_blockFarFieldGains.clear ();
+  m_cellFarField.clear ();
+  m_blockFarField.clear ();
+  m_phyFarField.clear ();
+  m_cellProbe = 0;
+  m_spectrumModel = 0;
+  m_propagationDelay = 0;
+  m_propagationLoss = 0;
+  m_spectrumPropagationLoss = 0;
+  SpectrumChannel::DoDispose ();
+}
+
+void
+LrWpanSpectrumChannel::AddPropagationLossModel (Ptr<PropagationLossModel> loss)
+{
+  NS_LOG_FUNCTION (this << loss);
+  NS_ASSERT (m_propagationLoss == 0);
+  m_propagationLoss = loss;
+  m_cutoffRadius = -1.0;
+  m_indexDirty = true;
+  ClearLinkBudgetCache ();
+}
+
+void
+LrWpanSpectrumChannel::AddSpectrumPropagationLossModel (Ptr<SpectrumPropagationLossModel> loss)
+{
+  NS_LOG_FUNCTION (this << loss);
+  NS_ASSERT (m_spectrumPropagationLoss == 0);
+  m_spectrumPropagationLoss = loss;
+}
+
+void
+LrWpanSpectrumChannel::SetPropagationDelayModel (Ptr<PropagationDelayModel> delay)
+{
+  NS_LOG_FUNCTION (this << delay);
+  NS_ASSERT (m_propagationDelay == 0);
+  m_propagationDelay = delay;
+  ClearLinkBudgetCache ();
+}
+
+Ptr<SpectrumPropagationLossModel>
+LrWpanSpectrumChannel::GetSpectrumPropagationLossModel (void)
+{
+  NS_LOG_FUNCTION (this);
+  return m_spectrumPropagationLoss;
+}
+
+void
+LrWpanSpectrumChannel::AddRx (Ptr<SpectrumPhy> phy)
+{
+  NS_LOG_FUNCTION (this << phy);
+  m_phyList.push_back (phy);
+  m_indexDirty = true;
+}
+
+uint32_t
+LrWpanSpectrumChannel::GetNDevices (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_phyList.size ();
+}
+
+Ptr<NetDevice>
+LrWpanSpectrumChannel::GetDevice (uint32_t i) const
+{
+  NS_LOG_FUNCTION (this << i);
+  return m_phyList.at (i)->GetDevice ()->GetObject<NetDevice> ();
+}
+
+void
+LrWpanSpectrumChannel::ClearLinkBudgetCache (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_linkBudgets.clear ();
+  m_rxPsds.clear ();
+}
+
+void
+LrWpanSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
+{
+  NS_LOG_FUNCTION (this << txParams->psd << txParams->duration << txParams->txPhy);
+  NS_ASSERT_MSG (txParams->psd, "NULL txPsd");
+  NS_ASSERT_MSG (txParams->txPhy, "NULL txPhy");
+
+  // Just a sanity check routine. We might want to remove it to save some
+  // computational load -- one "if" statement  ;-)
+  if (m_spectrumModel == 0)
+    {
+      // First pak, record SpectrumModel
+      m_spectrumModel = txParams->psd->GetSpectrumModel ();
+    }
+  else
+    {
+      // All attached SpectrumPhy instances must use the same SpectrumModel
+      NS_ASSERT (m_spectrumModel->GetUid () == txParams->psd->GetSpectrumModelUid ());
+    }
+
+  Ptr<MobilityModel> txMobility = txParams->txPhy->GetMobility ();
+
+  if (m_receiverCulling && txMobility && GetCutoffRadius () < std::numeric_limits<double>::infinity ())
+    {
+      Ptr<LrWpanSpectrumSignalParameters> lrWpanTxParams = DynamicCast<LrWpanSpectrumSignalParameters> (txParams);
+      if (lrWpanTxParams != 0)
+        {
+          LrWpanChannelPsd txPsd = LrWpanChannelPsd::FromSpectrumValue (txParams->psd);
+          if (txPsd.GetChannel () != 0)
+            {
+              StartTxCulled (txParams, txMobility, txPsd.GetChannel (), txPsd.TotalAvgPower ());
+              return;
+            }
+        }
+    }
+
+  for (std::vector<Ptr<SpectrumPhy> >::const_iterator rxPhyIterator = m_phyList.begin ();
+       rxPhyIterator != m_phyList.end ();
+       ++rxPhyIterator)
+    {
+      TransmitTo (txParams, txMobility, *rxPhyIterator, 0.0, 0);
+    }
+}
+
+void
+LrWpanSpectrumChannel::StartTxCulled (Ptr<SpectrumSignalParameters> txParams, Ptr<MobilityModel> txMobility,
+                                      uint32_t channel, double txPower)
+{
+  NS_LOG_FUNCTION (this << txParams << txMobility << channel << txPower);
+  NS_ASSERT_MSG (10.0 * std::log10 (txPower * 1000.0) <= m_maxTxPower + 1.0e-6,
+                 "Transmit power above MaxTxPower, the cutoff radius is too small");
+
+  UpdateSpatialIndex ();
+
+  PhyContributions culledPhys;
+  Cell txCell = GetCell (txMobility->GetPosition ());
+  for (int64_t dx = -1; dx <= 1; dx++)
+    {
+      for (int64_t dy = -1; dy <= 1; dy++)
+        {
+          std::map<Cell, std::vector<Ptr<SpectrumPhy> > >::const_iterator cellIt;
+          cellIt = m_cells.find (Cell (txCell.first + dx, txCell.second + dy));
+          if (cellIt == m_cells.end ())
+            {
+              continue;
+            }
+          for (std::vector<Ptr<SpectrumPhy> >::const_iterator rxPhyIterator = cellIt->second.begin ();
+               rxPhyIterator != cellIt->second.end ();
+               ++rxPhyIterator)
+            {
+              TransmitTo (txParams, txMobility, *rxPhyIterator, txPower, &culledPhys);
+            }
+        }
+    }
+
+  for (std::vector<Ptr<SpectrumPhy> >::const_iterator rxPhyIterator = m_unindexed.begin ();
+       rxPhyIterator != m_unindexed.end ();
+       ++rxPhyIterator)
+    {
+      TransmitTo (txParams, txMobility, *rxPhyIterator, txPower, 0);
+    }
+
+  if (!m_farFieldNoise)
+    {
+      return;
+    }
+
+  // All cells beyond the neighbor cells are at least one cutoff radius away,
+  // their receivers only see the far field. It is evaluated per cell within
+  // the neighbor blocks of the transmitter, and per block beyond.
+  int64_t blockSize = m_farFieldBlockSize;
+  Cell txBlock = GetBlock (txCell);
+  CellContributions culledCells;
+  for (int64_t x = (txBlock.first - 1) * blockSize; x < (txBlock.first + 2) * blockSize; x++)
+    {
+      std::map<Cell, std::vector<Ptr<SpectrumPhy> > >::const_iterator cellIt;
+      cellIt = m_cells.lower_bound (Cell (x, (txBlock.second - 1) * blockSize));
+      for (; cellIt != m_cells.end () && cellIt->first.first == x
+           && cellIt->first.second < (txBlock.second + 2) * blockSize; ++cellIt)
+        {
+          if (x >= txCell.first - 1 && x <= txCell.first + 1
+              && cellIt->first.second >= txCell.second - 1 && cellIt->first.second <= txCell.second + 1)
+            {
+              continue;
+            }
+          double power = txPower * GetFarFieldGain (txParams->txPhy, txMobility, cellIt->first, false);
+          AddFarField (m_cellFarField[cellIt->first], channel, power);
+          culledCells.push_back (std::make_pair (cellIt->first, power));
+        }
+    }
+  CellContributions culledBlocks;
+  for (std::map<Cell, uint32_t>::const_iterator blockIt = m_blocks.begin (); blockIt != m_blocks.end (); ++blockIt)
+    {
+      if (blockIt->first.first >= txBlock.first - 1 && blockIt->first.first <= txBlock.first + 1
+          && blockIt->first.second >= txBlock.second - 1 && blockIt->first.second <= txBlock.second + 1)
+        {
+          continue;
+        }
+      double power = txPower * GetFarFieldGain (txParams->txPhy, txMobility, blockIt->first, true);
+      AddFarField (m_blockFarField[blockIt->first], channel, power);
+      culledBlocks.push_back (std::make_pair (blockIt->first, power));
+    }
+  for (PhyContributions::const_iterator it = culledPhys.begin (); it != culledPhys.end (); ++it)
+    {
+      AddFarField (m_phyFarField[it->first], channel, it->second);
+    }
+
+  if (!culledCells.empty () || !culledBlocks.empty () || !culledPhys.empty ())
+    {
+      Simulator::Schedule (txParams->duration, &LrWpanSpectrumChannel::EndFarField, this,
+                           culledCells, culledBlocks, culledPhys, channel);
+    }
+}
+
+void
+LrWpanSpectrumChannel::TransmitTo (Ptr<SpectrumSignalParameters> txParams, Ptr<MobilityModel> txMobility,
+                                   Ptr<SpectrumPhy> receiver, double txPower, PhyContributions *culled)
+{
+  if (receiver == txParams->txPhy)
+    {
+      return;
+    }
+
+  Time delay = MicroSeconds (0);
+  Ptr<SpectrumSignalParameters> rxParams;
+  Ptr<MobilityModel> rxMobility = receiver->GetMobility ();
+
+  if (txMobility && rxMobility)
+    {
+      LinkBudget link = GetLinkBudget (txParams, txMobility, receiver, rxMobility);
+      m_pathLossTrace (txParams->txPhy, receiver, link.pathLossDb);
+      if (link.pathLossDb > m_maxLossDb)
+        {
+          // Beyond range.
+          return;
+        }
+      if (culled != 0 && 10.0 * std::log10 (txPower * 1000.0) - link.pathLossDb < m_rxPowerFloor)
+        {
+          NS_LOG_LOGIC ("culled signal to " << receiver);
+          culled->push_back (std::make_pair (receiver, txPower * link.pathGain));
+          return;
+        }
+
+      Ptr<LrWpanSpectrumSignalParameters> lrWpanTxParams = DynamicCast<LrWpanSpectrumSignalParameters> (txParams);
+      if (lrWpanTxParams != 0 && !m_spectrumPropagationLoss)
+        {
+          rxParams = lrWpanTxParams->CopyWithPsd (GetRxPsd (txParams, receiver, link.pathGain));
+        }
+      else
+        {
+          rxParams = txParams->Copy ();
+          *(rxParams->psd) *= link.pathGain;
+
+          if (m_spectrumPropagationLoss)
+            {
+              rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity (rxParams->psd, txMobility, rxMobility);
+            }
+        }
+      delay = link.delay;
+    }
+  else
+    {
+      rxParams = txParams->Copy ();
+    }
+
+  Ptr<NetDevice> netDev = receiver->GetDevice ();
+  if (netDev)
+    {
+      // the receiver has a NetDevice, so we expect that it is attached to a Node
+      uint32_t dstNode = netDev->GetNode ()->GetId ();
+      Simulator::ScheduleWithContext (dstNode, delay, &LrWpanSpectrumChannel::StartRx, this,
+                                      rxParams, receiver);
+    }
+  else
+    {
+      // the receiver is not attached to a NetDevice, so we cannot assume that it is attached to a node
+      Simulator::Schedule (delay, &LrWpanSpectrumChannel::StartRx, this,
+                           rxParams, receiver);
+    }
+}
+
+void
+LrWpanSpectrumChannel::StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver)
+{
+  NS_LOG_FUNCTION (this << params << receiver);
+  receiver->StartRx (params);
+}
+
+LrWpanSpectrumChannel::LinkBudget
+LrWpanSpectrumChannel::CalcLinkBudget (Ptr<const SpectrumSignalParameters> params, Ptr<MobilityModel> txMobility,
+                                       Ptr<SpectrumPhy> receiver, Ptr<MobilityModel> rxMobility) const
+{
+  NS_LOG_FUNCTION (this << params << txMobility << receiver << rxMobility);
+
+  LinkBudget link;
+  link.txMobility = txMobility;
+  link.rxMobility = rxMobility;
+  link.pathLossDb = 0;
+  link.delay = MicroSeconds (0);
+
+  if (params->txAntenna != 0)
+    {
+      Angles txAngles (rxMobility->GetPosition (), txMobility->GetPosition ());
+      link.pathLossDb -= params->txAntenna->GetGainDb (txAngles);
+    }
+
+  Ptr<AntennaModel> rxAntenna = receiver->GetRxAntenna ();
+  if (rxAntenna != 0)
+    {
+      Angles rxAngles (txMobility->GetPosition (), rxMobility->GetPosition ());
+      link.pathLossDb -= rxAntenna->GetGainDb (rxAngles);
+    }
+
+  if (m_propagationLoss)
+    {
+      link.pathLossDb -= m_propagationLoss->CalcRxPower (0, txMobility, rxMobility);
+    }
+  NS_LOG_LOGIC ("total pathLoss = " << link.pathLossDb << " dB");
+
+  link.pathGain = std::pow (10.0, (-link.pathLossDb) / 10.0);
+
+  if (m_propagationDelay)
+    {
+      link.delay = m_propagationDelay->GetDelay (txMobility, rxMobility);
+    }
+
+  return link;
+}
+
+LrWpanSpectrumChannel::LinkBudget
+LrWpanSpectrumChannel::GetLinkBudget (Ptr<const SpectrumSignalParameters> params, Ptr<MobilityModel> txMobility,
+                                      Ptr<SpectrumPhy> receiver, Ptr<MobilityModel> rxMobility)
+{
+  if (!m_linkBudgetCache)
+    {
+      return CalcLinkBudget (params, txMobility, receiver, rxMobility);
+    }
+
+  std::pair<Ptr<SpectrumPhy>, Ptr<SpectrumPhy> > key (params->txPhy, receiver);
+  std::map<std::pair<Ptr<SpectrumPhy>, Ptr<SpectrumPhy> >, LinkBudget>::const_iterator it = m_linkBudgets.find (key);
+  if (it != m_linkBudgets.end ()
+      && it->second.txMobility == txMobility
+      && it->second.rxMobility == rxMobility)
+    {
+      return it->second;
+    }
+
+  TrackMobility (txMobility);
+  TrackMobility (rxMobility);
+  LinkBudget link = CalcLinkBudget (params, txMobility, receiver, rxMobility);
+  m_linkBudgets[key] = link;
+  return link;
+}
+
+Ptr<SpectrumValue>
+LrWpanSpectrumChannel::GetRxPsd (Ptr<const SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver,
+                                 double pathGain)
+{
+  if (!m_linkBudgetCache)
+    {
+      Ptr<SpectrumValue> rxPsd = params->psd->Copy ();
+      *rxPsd *= pathGain;
+      return rxPsd;
+    }
+
+  // The interference helpers of the Phy key the signals by their PSD, so a
+  // PSD still held by a reception is not shared with an overlapping one.
+  RxPsd &cached = m_rxPsds[std::make_pair (params->txPhy, receiver)];
+  if (cached.rxPsd == 0 || cached.rxPsd->GetReferenceCount () > 1
+      || cached.txPsd != params->psd || cached.pathGain != pathGain)
+    {
+      cached.txPsd = params->psd;
+      cached.pathGain = pathGain;
+      cached.rxPsd = params->psd->Copy ();
+      *cached.rxPsd *= pathGain;
+    }
+  return cached.rxPsd;
+}
+
+void
+LrWpanSpectrumChannel::TrackMobility (Ptr<MobilityModel> mobility)
+{
+  if (m_trackedMobility.insert (mobility).second)
+    {
+      mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&LrWpanSpectrumChannel::CourseChanged, this));
+    }
+}
+
+void
+LrWpanSpectrumChannel::CourseChanged (Ptr<const MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << mobility);
+
+  UpdateSpatialIndex (mobility);
+
+  std::map<std::pair<Ptr<SpectrumPhy>, Ptr<SpectrumPhy> >, LinkBudget>::iterator it = m_linkBudgets.begin ();
+  while (it != m_linkBudgets.end ())
+    {
+      if (it->second.txMobility == mobility || it->second.rxMobility == mobility)
+        {
+          m_linkBudgets.erase (it++);
+        }
+      else
+        {
+          ++it;
+        }
+    }
+}
+
+double
+LrWpanSpectrumChannel::GetCutoffRadius (void)
+{
+  if (m_cutoffRadius < 0)
+    {
+      m_cutoffRadius = CalcCutoffRadius ();
+      NS_LOG_LOGIC ("cutoff radius = " << m_cutoffRadius << " m");
+    }
+  return m_cutoffRadius;
+}
+
+double
+LrWpanSpectrumChannel::CalcCutoffRadius (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_propagationLoss == 0)
+    {
+      return std::numeric_limits<double>::infinity ();
+    }
+
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  a->SetPosition (Vector (0, 0, 0));
+  b->SetPosition (Vector (MAX_CUTOFF_RADIUS, 0, 0));
+  if (m_propagationLoss->CalcRxPower (m_maxTxPower, a, b) >= m_rxPowerFloor)
+    {
+      return std::numeric_limits<double>::infinity ();
+    }
+
+  // Bisection to a resolution of 1 mm, keeping the upper bound, so that the
+  // received power at the cutoff radius is below the floor.
+  double low = 0.0;
+  double high = MAX_CUTOFF_RADIUS;
+  while (high - low > 1.0e-3)
+    {
+      double mid = (low + high) / 2.0;
+      b->SetPosition (Vector (mid, 0, 0));
+      if (m_propagationLoss->CalcRxPower (m_maxTxPower, a, b) >= m_rxPowerFloor)
+        {
+          low = mid;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+  return high;
+}
+
+LrWpanSpectrumChannel::Cell
+LrWpanSpectrumChannel::GetCell (const Vector &position) const
+{
+  NS_ASSERT (m_cutoffRadius > 0);
+  return Cell (static_cast<int64_t> (std::floor (position.x / m_cutoffRadius)),
+               static_cast<int64_t> (std::floor (position.y / m_cutoffRadius)));
+}
+
+LrWpanSpectrumChannel::Cell
+LrWpanSpectrumChannel::GetBlock (const Cell &cell) const
+{
+  double blockSize = m_farFieldBlockSize;
+  return Cell (static_cast<int64_t> (std::floor (cell.first / blockSize)),
+               static_cast<int64_t> (std::floor (cell.second / blockSize)));
+}
+
+void
+LrWpanSpectrumChannel::UpdateSpatialIndex (void)
+{
+  if (!m_indexDirty)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this);
+
+  m_cells.clear ();
+  m_blocks.clear ();
+  m_phyCells.clear ();
+  m_mobilityPhys.clear ();
+  m_unindexed.clear ();
+  m_farFieldGains.clear ();
+  m_blockFarFieldGains.clear ();
+  for (std::vector<Ptr<SpectrumPhy> >::const_iterator it = m_phyList.begin (); it != m_phyList.end (); ++it)
+    {
+      Ptr<MobilityModel> mobility = (*it)->GetMobility ();
+      if (mobility == 0)
+        {
+          m_unindexed.push_back (*it);
+          continue;
+        }
+      TrackMobility (mobility);
+      Cell cell = GetCell (mobility->GetPosition ());
+      m_cells[cell].push_back (*it);
+      m_blocks[GetBlock (cell)]++;
+      m_phyCells[*it] = cell;
+      m_mobilityPhys.insert (std::make_pair (mobility, *it));
+    }
+  m_indexDirty = false;
+}
+
+void
+LrWpanSpectrumChannel::UpdateSpatialIndex (Ptr<const MobilityModel> mobility)
+{
+  // The transmitters using this MobilityModel need new far-field gains.
+  std::map<std::pair<Ptr<SpectrumPhy>, Cell>, double> *gains[] = { &m_farFieldGains, &m_blockFarFieldGains };
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      std::map<std::pair<Ptr<SpectrumPhy>, Cell>, double>::iterator gainIt = gains[i]->begin ();
+      while (gainIt != gains[i]->end ())
+        {
+          if (gainIt->first.first->GetMobility () == mobility)
+            {
+              gains[i]->erase (gainIt++);
+            }
+          else
+            {
+              ++gainIt;
+            }
+        }
+    }
+
+  if (m_indexDirty)
+    {
+      return;
+    }
+
+  Cell newCell = GetCell (mobility->GetPosition ());
+  typedef std::multimap<Ptr<const MobilityModel>, Ptr<SpectrumPhy> >::const_iterator PhyIterator;
+  std::pair<PhyIterator, PhyIterator> range = m_mobilityPhys.equal_range (mobility);
+  for (PhyIterator it = range.first; it != range.second; ++it)
+    {
+      Cell &cell = m_phyCells[it->second];
+      if (cell == newCell)
+        {
+          continue;
+        }
+      std::vector<Ptr<SpectrumPhy> > &oldPhys = m_cells[cell];
+      oldPhys.erase (std::find (oldPhys.begin (), oldPhys.end (), it->second));
+      if (oldPhys.empty ())
+        {
+          m_cells.erase (cell);
+        }
+      m_cells[newCell].push_back (it->second);
+      Cell oldBlock = GetBlock (cell);
+      if (--m_blocks[oldBlock] == 0)
+        {
+          m_blocks.erase (oldBlock);
+        }
+      m_blocks[GetBlock (newCell)]++;
+      cell = newCell;
+    }
+}
+
+double
+LrWpanSpectrumChannel::GetFarFieldGain (Ptr<SpectrumPhy> txPhy, Ptr<MobilityModel> txMobility, const Cell &cell, bool block)
+{
+  std::map<std::pair<Ptr<SpectrumPhy>, Cell>, double> &gains = block ? m_blockFarFieldGains : m_farFieldGains;
+  std::pair<Ptr<SpectrumPhy>, Cell> key (txPhy, cell);
+  std::map<std::pair<Ptr<SpectrumPhy>, Cell>, double>::const_iterator it = gains.find (key);
+  if (it != gains.end ())
+    {
+      return it->second;
+    }
+
+  if (m_cellProbe == 0)
+    {
+      m_cellProbe = CreateObject<ConstantPositionMobilityModel> ();
+    }
+  double size = block ? m_farFieldBlockSize * m_cutoffRadius : m_cutoffRadius;
+  m_cellProbe->SetPosition (Vector ((cell.first + 0.5) * size,
+                                    (cell.second + 0.5) * size,
+                                    txMobility->GetPosition ().z));
+  TrackMobility (txMobility);
+  double gain = std::pow (10.0, m_propagationLoss->CalcRxPower (0, txMobility, m_cellProbe) / 10.0);
+  gains[key] = gain;
+  return gain;
+}
+
+void
+LrWpanSpectrumChannel::AddFarField (FarField &field, uint32_t channel, double power)
+{
+  field.power[channel - 11] += power;
+  field.signals++;
+}
+
+bool
+LrWpanSpectrumChannel::RemoveFarField (FarField &field, uint32_t channel, double power)
+{
+  NS_ASSERT (field.signals > 0);
+  field.signals--;
+  if (field.signals == 0)
+    {
+      // Reset to exact zero, avoiding accumulated rounding errors.
+      std::fill (field.power, field.power + 16, 0.0);
+      return true;
+    }
+  field.power[channel - 11] = std::max (field.power[channel - 11] - power, 0.0);
+  return false;
+}
+
+void
+LrWpanSpectrumChannel::EndFarField (CellContributions cells, CellContributions blocks, PhyContributions phys, uint32_t channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  for (CellContributions::const_iterator it = cells.begin (); it != cells.end (); ++it)
+    {
+      if (RemoveFarField (m_cellFarField[it->first], channel, it->second))
+        {
+          m_cellFarField.erase (it->first);
+        }
+    }
+  for (CellContributions::const_iterator it = blocks.begin (); it != blocks.end (); ++it)
+    {
+      if (RemoveFarField (m_blockFarField[it->first], channel, it->second))
+        {
+          m_blockFarField.erase (it->first);
+        }
+    }
+  for (PhyContributions::const_iterator it = phys.begin (); it != phys.end (); ++it)
+    {
+      if (RemoveFarField (m_phyFarField[it->first], channel, it->second))
+        {
+          m_phyFarField.erase (it->first);
+        }
+    }
+}
+
+double
+LrWpanSpectrumChannel::GetFarFieldPower (Ptr<const SpectrumPhy> phy, uint32_t channel) const
+{
+  if (channel < 11 || channel > 26)
+    {
+      return 0.0;
+    }
+
+  double power = 0.0;
+  std::map<Ptr<const SpectrumPhy>, FarField>::const_iterator phyIt = m_phyFarField.find (phy);
+  if (phyIt != m_phyFarField.end ())
+    {
+      power += phyIt->second.power[channel - 11];
+    }
+  std::map<Ptr<const SpectrumPhy>, Cell>::const_iterator cellIt = m_phyCells.find (phy);
+  if (cellIt != m_phyCells.end ())
+    {
+      std::map<Cell, FarField>::const_iterator fieldIt = m_cellFarField.find (cellIt->second);
+      if (fieldIt != m_cellFarField.end ())
+        {
+          power += fieldIt->second.power[channel - 11];
+        }
+      fieldIt = m_blockFarField.find (GetBlock (cellIt->second));
+      if (fieldIt != m_blockFarField.end ())
+        {
+          power += fieldIt->second.power[channel - 11];
+        }
+    }
+  return power;
+}
+
+void
+LrWpanSpectrumChannel::SetRxPowerFloor (double floor)
+{
+  NS_LOG_FUNCTION (this << floor);
+  m_rxPowerFloor = floor;
+  m_cutoffRadius = -1.0;
+  m_indexDirty = true;
+}
+
+double
+LrWpanSpectrumChannel::GetRxPowerFloor (void) const
+{
+  return m_rxPowerFloor;
+}
+
+void
+LrWpanSpectrumChannel::SetMaxTxPower (double power)
+{
+  NS_LOG_FUNCTION (this << power);
+  m_maxTxPower = power;
+  m_cutoffRadius = -1.0;
+  m_indexDirty = true;
+}
+
+double
+LrWpanSpectrumChannel::GetMaxTxPower (void) const
+{
+  return m_maxTxPower;
+}
+
+void
+LrWpanSpectrumChannel::SetFarFieldBlockSize (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  NS_ASSERT (size > 0);
+  m_farFieldBlockSize = size;
+  m_indexDirty = true;
+}
+
+uint32_t
+LrWpanSpectrumChannel::GetFarFieldBlockSize (void) const
+{
+  return m_farFieldBlockSize;
+}
+
+} // namespace ns3
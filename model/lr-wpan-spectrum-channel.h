@@ -0,0 +1,537 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_SPECTRUM_CHANNEL_H
+#define LR_WPAN_SPECTRUM_CHANNEL_H
+
+#include <ns3/spectrum-channel.h>
+#include <ns3/traced-callback.h>
+#include <ns3/nstime.h>
+#include <ns3/vector.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace ns3 {
+
+class MobilityModel;
+class PropagationLossModel;
+class PropagationDelayModel;
+class SpectrumPropagationLossModel;
+class SpectrumModel;
+class ConstantPositionMobilityModel;
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief A SpectrumChannel for LrWpan devices, all using the same
+ * SpectrumModel.
+ *
+ * Signals are delivered like by the SingleModelSpectrumChannel. In addition,
+ * the channel can cache the link budget, i.e. the path gain including the
+ * antenna gains, and the propagation delay, per pair of transmitting and
+ * receiving SpectrumPhy. The cached values are reused for all following
+ * transmissions between the same pair, until the position of one of them
+ * changes, as signalled by the CourseChange trace of its MobilityModel.
+ *
+ * The cached path gain does not depend on the transmit power, so changing it
+ * does not invalidate the cache. The received PSD of an LR-WPAN signal is
+ * cached per link as well, so a repeated signal with the same transmitted PSD
+ * skips the copy and scaling of the PSD. Caching is only valid for deterministic
+ * propagation loss models. Disable it by the LinkBudgetCache attribute when
+ * using a random (e.g. fading) propagation loss model.
+ *
+ * With receiver culling enabled, the receivers are kept in a uniform grid,
+ * indexed by their position. From the maximum transmit power and the
+ * propagation loss model, the channel computes a cutoff radius, beyond which
+ * the received power is below a floor, which should be chosen some dB below
+ * the receiver sensitivity. The cell size of the grid equals this radius. An
+ * LR-WPAN signal is then only delivered to the receivers in the cell of the
+ * transmitter and its eight neighbor cells, and only if the received power
+ * exceeds the floor. The power of the culled signals is not lost, but
+ * accounted as far-field noise: per receiver for the culled receivers of the
+ * neighbor cells, and per cell, evaluated at the cell center, for all other
+ * cells. LrWpanPhy adds this power to the interference and to the energy
+ * detection, see GetFarFieldPower. To keep this cost independent of the
+ * number of cells, the cells are grouped in square blocks of
+ * FarFieldBlockSize cells. The cells of the block of the transmitter and its
+ * eight neighbor blocks are evaluated one by one, all farther receivers share
+ * the power evaluated at the center of their block. The cutoff radius
+ * assumes a propagation loss monotonically increasing with the distance. It
+ * is computed when the first signal is sent, and again after a change of
+ * RxPowerFloor or MaxTxPower.
+ */
+class LrWpanSpectrumChannel : public SpectrumChannel
+{
+public:
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  LrWpanSpectrumChannel (void);
+  virtual ~LrWpanSpectrumChannel (void);
+
+  // inherited from SpectrumChannel
+  virtual void AddPropagationLossModel (Ptr<PropagationLossModel> loss);
+  virtual void AddSpectrumPropagationLossModel (Ptr<SpectrumPropagationLossModel> loss);
+  virtual void SetPropagationDelayModel (Ptr<PropagationDelayModel> delay);
+  virtual void AddRx (Ptr<SpectrumPhy> phy);
+  virtual void StartTx (Ptr<SpectrumSignalParameters> params);
+
+  /**
+   * Get the frequency-dependent propagation loss model.
+   *
+   * \return the SpectrumPropagationLossModel, if any
+   */
+  virtual Ptr<SpectrumPropagationLossModel> GetSpectrumPropagationLossModel (void);
+
+  // inherited from Channel
+  virtual uint32_t GetNDevices (void) const;
+  virtual Ptr<NetDevice> GetDevice (uint32_t i) const;
+
+  /**
+   * Remove all cached link budgets.
+   */
+  void ClearLinkBudgetCache (void);
+
+  /**
+   * Get the cutoff radius of the receiver culling, i.e. the distance at which
+   * a signal sent with the maximum transmit power is received with the power
+   * floor.
+   *
+   * \return the cutoff radius in m, infinite if there is no such distance
+   */
+  double GetCutoffRadius (void);
+
+  /**
+   * Get the power of the currently culled signals at a receiver, within the
+   * band of the given channel.
+   *
+   * \param phy the receiving SpectrumPhy
+   * \param channel the channel number (11-26)
+   * \return the far-field power in W
+   */
+  double GetFarFieldPower (Ptr<const SpectrumPhy> phy, uint32_t channel) const;
+
+  /**
+   * Set the received power below which signals are culled.
+   *
+   * \param floor the power floor in dBm
+   */
+  void SetRxPowerFloor (double floor);
+
+  /**
+   * Get the received power below which signals are culled.
+   *
+   * \return the power floor in dBm
+   */
+  double GetRxPowerFloor (void) const;
+
+  /**
+   * Set the maximum transmit power of all transmitters.
+   *
+   * \param power the maximum transmit power in dBm
+   */
+  void SetMaxTxPower (double power);
+
+  /**
+   * Get the maximum transmit power of all transmitters.
+   *
+   * \return the maximum transmit power in dBm
+   */
+  double GetMaxTxPower (void) const;
+
+  /**
+   * Set the number of cells per side of the blocks aggregating the far field.
+   *
+   * \param size the block size, at least 1
+   */
+  void SetFarFieldBlockSize (uint32_t size);
+
+  /**
+   * Get the number of cells per side of the blocks aggregating the far field.
+   *
+   * \return the block size
+   */
+  uint32_t GetFarFieldBlockSize (void) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /**
+   * The link budget between a transmitting and a receiving SpectrumPhy.
+   */
+  struct LinkBudget
+  {
+    Ptr<MobilityModel> txMobility; //!< the mobility of the transmitter
+    Ptr<MobilityModel> rxMobility; //!< the mobility of the receiver
+    double pathLossDb;             //!< the total path loss, including antenna gains
+    double pathGain;               //!< the linear path gain
+    Time delay;                    //!< the propagation delay
+  };
+
+  /**
+   * The received PSD of the last LR-WPAN signal over a link.
+   */
+  struct RxPsd
+  {
+    Ptr<const SpectrumValue> txPsd; //!< the transmitted PSD it was scaled from
+    double pathGain;                //!< the linear path gain it was scaled by
+    Ptr<SpectrumValue> rxPsd;       //!< the received PSD
+  };
+
+  /**
+   * A cell of the spatial index, given by its x and y index.
+   */
+  typedef std::pair<int64_t, int64_t> Cell;
+
+  /**
+   * The power of the culled signals accumulated at a cell or a receiver.
+   */
+  struct FarField
+  {
+    FarField ();
+    double power[16];  //!< the power in W, per channel 11-26
+    uint32_t signals;  //!< the number of accumulated signals
+  };
+
+  /**
+   * A list of far-field contributions of a signal to cells or blocks.
+   */
+  typedef std::vector<std::pair<Cell, double> > CellContributions;
+
+  /**
+   * A list of far-field contributions of a signal to receivers.
+   */
+  typedef std::vector<std::pair<Ptr<SpectrumPhy>, double> > PhyContributions;
+
+  /**
+   * Compute the link budget between two SpectrumPhys.
+   *
+   * \param params the parameters of the transmitted signal
+   * \param txMobility the mobility of the transmitter
+   * \param receiver the receiving SpectrumPhy
+   * \param rxMobility the mobility of the receiver
+   * \return the link budget
+   */
+  LinkBudget CalcLinkBudget (Ptr<const SpectrumSignalParameters> params, Ptr<MobilityModel> txMobility,
+                             Ptr<SpectrumPhy> receiver, Ptr<MobilityModel> rxMobility) const;
+
+  /**
+   * Get the link budget between two SpectrumPhys, from the cache if possible.
+   *
+   * \param params the parameters of the transmitted signal
+   * \param txMobility the mobility of the transmitter
+   * \param receiver the receiving SpectrumPhy
+   * \param rxMobility the mobility of the receiver
+   * \return the link budget
+   */
+  LinkBudget GetLinkBudget (Ptr<const SpectrumSignalParameters> params, Ptr<MobilityModel> txMobility,
+                            Ptr<SpectrumPhy> receiver, Ptr<MobilityModel> rxMobility);
+
+  /**
+   * Get the PSD of a signal at a receiver. With the link budget cache, the
+   * received PSD is kept per link and shared by the following signals with
+   * the same transmitted PSD and path gain, once no reception holds it any
+   * more.
+   *
+   * \param params the parameters of the transmitted signal
+   * \param receiver the receiving SpectrumPhy
+   * \param pathGain the linear path gain of the link
+   * \return the received PSD
+   */
+  Ptr<SpectrumValue> GetRxPsd (Ptr<const SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver,
+                               double pathGain);
+
+  /**
+   * Connect to the CourseChange trace of a MobilityModel, if not done before.
+   *
+   * \param mobility the MobilityModel
+   */
+  void TrackMobility (Ptr<MobilityModel> mobility);
+
+  /**
+   * Remove all cached link budgets of a moved node.
+   *
+   * \param mobility the MobilityModel whose position changed
+   */
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+
+  /**
+   * Deliver a signal to a receiver.
+   *
+   * \param params the parameters of the received signal
+   * \param receiver the receiving SpectrumPhy
+   */
+  void StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver);
+
+  /**
+   * Send a signal to a receiver, applying the link budget.
+   *
+   * \param txParams the parameters of the transmitted signal
+   * \param txMobility the mobility of the transmitter, if any
+   * \param receiver the receiving SpectrumPhy
+   * \param txPower the transmit power in W, used for culling
+   * \param culled the list receiving the far-field contribution, if the
+   * received power is below the floor, or 0 to disable culling
+   */
+  void TransmitTo (Ptr<SpectrumSignalParameters> txParams, Ptr<MobilityModel> txMobility,
+                   Ptr<SpectrumPhy> receiver, double txPower, PhyContributions *culled);
+
+  /**
+   * Send an LR-WPAN signal to the receivers near the transmitter, and account
+   * it as far-field noise for all other receivers.
+   *
+   * \param txParams the parameters of the transmitted signal
+   * \param txMobility the mobility of the transmitter
+   * \param channel the channel of the signal
+   * \param txPower the transmit power in W
+   */
+  void StartTxCulled (Ptr<SpectrumSignalParameters> txParams, Ptr<MobilityModel> txMobility,
+                      uint32_t channel, double txPower);
+
+  /**
+   * Compute the cutoff radius by bisection of the propagation loss.
+   *
+   * \return the cutoff radius in m, infinite if there is no such distance
+   */
+  double CalcCutoffRadius (void) const;
+
+  /**
+   * Get the cell of the spatial index containing a position.
+   *
+   * \param position the position
+   * \return the cell
+   */
+  Cell GetCell (const Vector &position) const;
+
+  /**
+   * Get the block of cells containing a cell.
+   *
+   * \param cell the cell
+   * \return the block, given by its x and y index
+   */
+  Cell GetBlock (const Cell &cell) const;
+
+  /**
+   * Rebuild the spatial index, if receivers were added since the last build.
+   */
+  void UpdateSpatialIndex (void);
+
+  /**
+   * Move the receivers using a moved MobilityModel to their new cells.
+   *
+   * \param mobility the MobilityModel whose position changed
+   */
+  void UpdateSpatialIndex (Ptr<const MobilityModel> mobility);
+
+  /**
+   * Get the path gain between a transmitter and the center of a cell or a
+   * block, from the cache if possible.
+   *
+   * \param txPhy the transmitting SpectrumPhy
+   * \param txMobility the mobility of the transmitter
+   * \param cell the cell or the block
+   * \param block true, if cell is a block
+   * \return the linear path gain
+   */
+  double GetFarFieldGain (Ptr<SpectrumPhy> txPhy, Ptr<MobilityModel> txMobility, const Cell &cell, bool block);
+
+  /**
+   * Add the power of a culled signal to a far-field accumulator.
+   *
+   * \param field the accumulator
+   * \param channel the channel of the signal
+   * \param power the power in W
+   */
+  static void AddFarField (FarField &field, uint32_t channel, double power);
+
+  /**
+   * Remove the power of a culled signal from a far-field accumulator.
+   *
+   * \param field the accumulator
+   * \param channel the channel of the signal
+   * \param power the power in W
+   * \return true, if no more signals are accumulated
+   */
+  static bool RemoveFarField (FarField &field, uint32_t channel, double power);
+
+  /**
+   * Remove the far-field contributions of a signal, when it ends.
+   *
+   * \param cells the contributions to cells
+   * \param blocks the contributions to blocks
+   * \param phys the contributions to receivers
+   * \param channel the channel of the signal
+   */
+  void EndFarField (CellContributions cells, CellContributions blocks, PhyContributions phys, uint32_t channel);
+
+  /**
+   * The list of attached receivers.
+   */
+  std::vector<Ptr<SpectrumPhy> > m_phyList;
+
+  /**
+   * The SpectrumModel of all signals.
+   */
+  Ptr<const SpectrumModel> m_spectrumModel;
+
+  /**
+   * The propagation delay model.
+   */
+  Ptr<PropagationDelayModel> m_propagationDelay;
+
+  /**
+   * The single-frequency propagation loss model.
+   */
+  Ptr<PropagationLossModel> m_propagationLoss;
+
+  /**
+   * The frequency-dependent propagation loss model.
+   */
+  Ptr<SpectrumPropagationLossModel> m_spectrumPropagationLoss;
+
+  /**
+   * Signals are not delivered if the path loss exceeds this value (dB).
+   */
+  double m_maxLossDb;
+
+  /**
+   * Cache the link budgets between pairs of SpectrumPhys.
+   */
+  bool m_linkBudgetCache;
+
+  /**
+   * The cached link budgets, indexed by transmitter and receiver.
+   */
+  std::map<std::pair<Ptr<SpectrumPhy>, Ptr<SpectrumPhy> >, LinkBudget> m_linkBudgets;
+
+  /**
+   * The cached received PSDs, indexed by transmitter and receiver.
+   */
+  std::map<std::pair<Ptr<SpectrumPhy>, Ptr<SpectrumPhy> >, RxPsd> m_rxPsds;
+
+  /**
+   * The MobilityModels whose CourseChange trace is connected.
+   */
+  std::set<Ptr<MobilityModel> > m_trackedMobility;
+
+  /**
+   * Deliver LR-WPAN signals only to receivers near the transmitter.
+   */
+  bool m_receiverCulling;
+
+  /**
+   * Signals below this received power (dBm) are culled.
+   */
+  double m_rxPowerFloor;
+
+  /**
+   * The maximum transmit power of all transmitters (dBm).
+   */
+  double m_maxTxPower;
+
+  /**
+   * Account culled signals as far-field noise.
+   */
+  bool m_farFieldNoise;
+
+  /**
+   * The number of cells per side of the blocks aggregating the far field.
+   */
+  uint32_t m_farFieldBlockSize;
+
+  /**
+   * The cutoff radius in m, negative if not yet computed.
+   */
+  double m_cutoffRadius;
+
+  /**
+   * The spatial index needs to be rebuilt.
+   */
+  bool m_indexDirty;
+
+  /**
+   * The receivers with a MobilityModel, per cell.
+   */
+  std::map<Cell, std::vector<Ptr<SpectrumPhy> > > m_cells;
+
+  /**
+   * The number of receivers with a MobilityModel, per block.
+   */
+  std::map<Cell, uint32_t> m_blocks;
+
+  /**
+   * The cell of each receiver with a MobilityModel.
+   */
+  std::map<Ptr<const SpectrumPhy>, Cell> m_phyCells;
+
+  /**
+   * The receivers indexed, per MobilityModel.
+   */
+  std::multimap<Ptr<const MobilityModel>, Ptr<SpectrumPhy> > m_mobilityPhys;
+
+  /**
+   * The receivers without a MobilityModel, which receive all signals.
+   */
+  std::vector<Ptr<SpectrumPhy> > m_unindexed;
+
+  /**
+   * The cached path gains from transmitters to the centers of the cells of
+   * their neighbor blocks.
+   */
+  std::map<std::pair<Ptr<SpectrumPhy>, Cell>, double> m_farFieldGains;
+
+  /**
+   * The cached path gains from transmitters to block centers.
+   */
+  std::map<std::pair<Ptr<SpectrumPhy>, Cell>, double> m_blockFarFieldGains;
+
+  /**
+   * The MobilityModel placed at cell and block centers to evaluate the
+   * far-field path gain.
+   */
+  Ptr<ConstantPositionMobilityModel> m_cellProbe;
+
+  /**
+   * The far-field power per cell.
+   */
+  std::map<Cell, FarField> m_cellFarField;
+
+  /**
+   * The far-field power per block.
+   */
+  std::map<Cell, FarField> m_blockFarField;
+
+  /**
+   * The far-field power of the culled receivers near a transmitter.
+   */
+  std::map<Ptr<const SpectrumPhy>, FarField> m_phyFarField;
+
+  /**
+   * The trace source fired whenever a signal is delivered, reporting the path
+   * loss in dB.
+   */
+  TracedCallback<Ptr<const SpectrumPhy>, Ptr<const SpectrumPhy>, double> m_pathLossTrace;
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_SPECTRUM_CHANNEL_H */
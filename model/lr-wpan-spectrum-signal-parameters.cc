@@ -20,6 +20,7 @@
 #include "lr-wpan-spectrum-signal-parameters.h"
 #include <ns3/log.h>
 #include <ns3/packet-burst.h>
+#include <ns3/packet.h>
 
 
 namespace ns3 {
@@ -35,7 +36,14 @@ LrWpanSpectrumSignalParameters::LrWpanSpectrumSignalParameters (const LrWpanSpec
   : SpectrumSignalParameters (p)
 {
   NS_LOG_FUNCTION (this << &p);
-  packetBurst = p.packetBurst->Copy ();
+  if (p.packetBurst)
+    {
+      packetBurst = p.packetBurst->Copy ();
+    }
+  if (p.packet)
+    {
+      packet = p.packet->Copy ();
+    }
 }
 
 Ptr<SpectrumSignalParameters>
@@ -45,4 +53,35 @@ LrWpanSpectrumSignalParameters::Copy (void)
   return Create<LrWpanSpectrumSignalParameters> (*this);
 }
 
+Ptr<LrWpanSpectrumSignalParameters>
+LrWpanSpectrumSignalParameters::CopyWithPsd (Ptr<SpectrumValue> rxPsd) const
+{
+  NS_LOG_FUNCTION (this << rxPsd);
+  Ptr<LrWpanSpectrumSignalParameters> params = Create<LrWpanSpectrumSignalParameters> ();
+  params->psd = rxPsd;
+  params->duration = duration;
+  params->txPhy = txPhy;
+  params->txAntenna = txAntenna;
+  if (packetBurst)
+    {
+      params->packetBurst = packetBurst->Copy ();
+    }
+  if (packet)
+    {
+      params->packet = packet->Copy ();
+    }
+  return params;
+}
+
+Ptr<Packet>
+LrWpanSpectrumSignalParameters::GetPacket (void) const
+{
+  if (packet)
+    {
+      return packet;
+    }
+  NS_ASSERT (packetBurst);
+  return packetBurst->GetPackets ().front ();
+}
+
 } // namespace ns3
@@ -27,6 +27,7 @@
 namespace ns3 {
 
 class PacketBurst;
+class Packet;
 
 /**
  * \ingroup lr-wpan
@@ -49,10 +50,33 @@ struct LrWpanSpectrumSignalParameters : public SpectrumSignalParameters
    */
   LrWpanSpectrumSignalParameters (const LrWpanSpectrumSignalParameters& p);
 
+  /**
+   * Copy the parameters for a receiver, with the given PSD instead of a copy
+   * of the transmitted one.
+   *
+   * \param rxPsd the PSD of the signal at the receiver
+   * \return the copied parameters
+   */
+  Ptr<LrWpanSpectrumSignalParameters> CopyWithPsd (Ptr<SpectrumValue> rxPsd) const;
+
+  /**
+   * Get the packet transmitted with this signal, i.e. the packet, if set, or
+   * the first packet of the packet burst.
+   *
+   * \return the packet
+   */
+  Ptr<Packet> GetPacket (void) const;
+
   /**
    * The packet burst being transmitted with this signal
    */
   Ptr<PacketBurst> packetBurst;
+
+  /**
+   * The single packet being transmitted with this signal, used instead of a
+   * packet burst.
+   */
+  Ptr<Packet> packet;
 };
 
 }  // namespace ns3
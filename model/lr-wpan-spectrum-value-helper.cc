@@ -22,6 +22,7 @@
 #include <ns3/spectrum-value.h>
 
 #include <cmath>
+#include <map>
 
 namespace ns3 {
 
@@ -123,6 +124,44 @@ LrWpanSpectrumValueHelper::CreateNoisePowerSpectralDensity (uint32_t channel)
   return noisePsd;
 }
 
+Ptr<const SpectrumValue>
+LrWpanSpectrumValueHelper::GetTxPowerSpectralDensity (double txPower, uint32_t channel)
+{
+  NS_LOG_FUNCTION (this << txPower << channel);
+
+  // Shared by all PHYs, indexed by the transmit power and the channel.
+  static std::map<std::pair<double, uint32_t>, Ptr<const SpectrumValue> > txPsds;
+
+  std::pair<double, uint32_t> key (txPower, channel);
+  std::map<std::pair<double, uint32_t>, Ptr<const SpectrumValue> >::const_iterator it = txPsds.find (key);
+  if (it != txPsds.end ())
+    {
+      return it->second;
+    }
+  Ptr<const SpectrumValue> txPsd = CreateTxPowerSpectralDensity (txPower, channel);
+  txPsds[key] = txPsd;
+  return txPsd;
+}
+
+Ptr<const SpectrumValue>
+LrWpanSpectrumValueHelper::GetNoisePowerSpectralDensity (uint32_t channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  // Shared by all PHYs, indexed by the noise factor and the channel.
+  static std::map<std::pair<double, uint32_t>, Ptr<const SpectrumValue> > noisePsds;
+
+  std::pair<double, uint32_t> key (m_noiseFactor, channel);
+  std::map<std::pair<double, uint32_t>, Ptr<const SpectrumValue> >::const_iterator it = noisePsds.find (key);
+  if (it != noisePsds.end ())
+    {
+      return it->second;
+    }
+  Ptr<const SpectrumValue> noisePsd = CreateNoisePowerSpectralDensity (channel);
+  noisePsds[key] = noisePsd;
+  return noisePsd;
+}
+
 double
 LrWpanSpectrumValueHelper::TotalAvgPower (Ptr<const SpectrumValue> psd, uint32_t channel)
 {
@@ -52,6 +52,31 @@ public:
    */
   Ptr<SpectrumValue> CreateNoisePowerSpectralDensity (uint32_t channel);
 
+  /**
+   * \brief get a shared, immutable spectrum value
+   *
+   * The spectrum value is created on the first request for the given
+   * transmit power and channel, and the same instance is returned for all
+   * further requests. It must not be modified.
+   *
+   * \param txPower the power transmission in dBm
+   * \param channel the channel number per IEEE802.15.4
+   * \return a Ptr to the shared SpectrumValue instance
+   */
+  Ptr<const SpectrumValue> GetTxPowerSpectralDensity (double txPower, uint32_t channel);
+
+  /**
+   * \brief get a shared, immutable spectrum value for noise
+   *
+   * The spectrum value is created on the first request for the given noise
+   * factor and channel, and the same instance is returned for all further
+   * requests. It must not be modified.
+   *
+   * \param channel the channel number per IEEE802.15.4
+   * \return a Ptr to the shared SpectrumValue instance
+   */
+  Ptr<const SpectrumValue> GetNoisePowerSpectralDensity (uint32_t channel);
+
   /**
    * \brief total average power of the signal is the integral of the PSD using
    * the limits of the given channel
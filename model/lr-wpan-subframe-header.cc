@@ -0,0 +1,86 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-subframe-header.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (LrWpanSubframeHeader);
+
+TypeId
+LrWpanSubframeHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LrWpanSubframeHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<LrWpanSubframeHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+LrWpanSubframeHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+LrWpanSubframeHeader::LrWpanSubframeHeader (void)
+  : m_length (0)
+{
+}
+
+LrWpanSubframeHeader::LrWpanSubframeHeader (uint8_t length)
+  : m_length (length)
+{
+}
+
+uint32_t
+LrWpanSubframeHeader::GetSerializedSize (void) const
+{
+  return sizeof (uint8_t);
+}
+
+void
+LrWpanSubframeHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_length);
+}
+
+uint32_t
+LrWpanSubframeHeader::Deserialize (Buffer::Iterator start)
+{
+  m_length = start.ReadU8 ();
+  return GetSerializedSize ();
+}
+
+void
+LrWpanSubframeHeader::Print (std::ostream &os) const
+{
+  os << "Length = " << static_cast<uint32_t> (m_length);
+}
+
+void
+LrWpanSubframeHeader::SetLength (uint8_t length)
+{
+  m_length = length;
+}
+
+uint8_t
+LrWpanSubframeHeader::GetLength (void) const
+{
+  return m_length;
+}
+
+} // namespace ns3
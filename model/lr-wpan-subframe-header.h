@@ -0,0 +1,84 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_SUBFRAME_HEADER_H
+#define LR_WPAN_SUBFRAME_HEADER_H
+
+#include <ns3/header.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief The header of an MSDU in an aggregated data frame.
+ *
+ * An aggregated frame carries, after its MAC header, a sequence of MSDUs,
+ * each preceded by this header. The header only holds the length of the MSDU
+ * in one octet, which is enough for any MSDU fitting in a PSDU.
+ */
+class LrWpanSubframeHeader : public Header
+{
+public:
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * Create a subframe header for an empty MSDU.
+   */
+  LrWpanSubframeHeader (void);
+
+  /**
+   * Create a subframe header for an MSDU of the given length.
+   *
+   * \param length the MSDU length in octets
+   */
+  LrWpanSubframeHeader (uint8_t length);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * Set the MSDU length.
+   *
+   * \param length the MSDU length in octets
+   */
+  void SetLength (uint8_t length);
+
+  /**
+   * Get the MSDU length.
+   *
+   * \return the MSDU length in octets
+   */
+  uint8_t GetLength (void) const;
+
+private:
+  /**
+   * The MSDU length in octets.
+   */
+  uint8_t m_length;
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_SUBFRAME_HEADER_H */
@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-tx-queue.h"
+#include <ns3/packet.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LrWpanTxQueue");
+
+LrWpanTxQueue::LrWpanTxQueue (void)
+  : m_elements (1),
+    m_head (0),
+    m_size (0)
+{
+}
+
+void
+LrWpanTxQueue::SetCapacity (uint32_t capacity)
+{
+  NS_LOG_FUNCTION (this << capacity);
+  NS_ASSERT_MSG (capacity > 0, "The capacity must be at least one element");
+  NS_ASSERT_MSG (m_size <= capacity, "Too many queued elements for the new capacity");
+
+  if (capacity == m_elements.size ())
+    {
+      return;
+    }
+
+  // Move the queued elements to the start of the new buffer.
+  std::vector<Element> elements (capacity);
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      elements[i] = Get (i);
+    }
+  m_elements.swap (elements);
+  m_head = 0;
+}
+
+uint32_t
+LrWpanTxQueue::GetCapacity (void) const
+{
+  return m_elements.size ();
+}
+
+uint32_t
+LrWpanTxQueue::GetSize (void) const
+{
+  return m_size;
+}
+
+bool
+LrWpanTxQueue::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+bool
+LrWpanTxQueue::IsFull (void) const
+{
+  return m_size == m_elements.size ();
+}
+
+LrWpanTxQueue::Element &
+LrWpanTxQueue::Get (uint32_t index)
+{
+  NS_ASSERT (index < m_size);
+  return m_elements[(m_head + index) % m_elements.size ()];
+}
+
+LrWpanTxQueue::Element &
+LrWpanTxQueue::Front (void)
+{
+  return Get (0);
+}
+
+void
+LrWpanTxQueue::PushBack (uint8_t msduHandle, Ptr<Packet> p)
+{
+  NS_ASSERT_MSG (!IsFull (), "Transmission queue overflow");
+
+  Element &element = m_elements[(m_head + m_size) % m_elements.size ()];
+  element.txQMsduHandle = msduHandle;
+  element.txQPkt = p;
+  m_size++;
+}
+
+void
+LrWpanTxQueue::PopFront (void)
+{
+  NS_ASSERT (m_size > 0);
+
+  m_elements[m_head].txQPkt = 0;
+  m_head = (m_head + 1) % m_elements.size ();
+  m_size--;
+}
+
+void
+LrWpanTxQueue::Remove (uint32_t index)
+{
+  NS_ASSERT (index < m_size);
+
+  // Close the gap by moving the following elements one position forward.
+  for (uint32_t i = index; i + 1 < m_size; i++)
+    {
+      Get (i) = Get (i + 1);
+    }
+  Get (m_size - 1).txQPkt = 0;
+  m_size--;
+}
+
+void
+LrWpanTxQueue::Clear (void)
+{
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      Get (i).txQPkt = 0;
+    }
+  m_head = 0;
+  m_size = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_TX_QUEUE_H
+#define LR_WPAN_TX_QUEUE_H
+
+#include <ns3/ptr.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+class Packet;
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief A bounded FIFO of MAC transmission queue elements.
+ *
+ * The elements are held by value in a ring buffer, which is allocated once
+ * when the capacity is set. Enqueueing and dequeueing never allocate.
+ */
+class LrWpanTxQueue
+{
+public:
+  /**
+   * Helper structure for managing transmission queue elements.
+   */
+  struct Element
+  {
+    uint8_t txQMsduHandle; //!< MSDU Handle
+    Ptr<Packet> txQPkt;    //!< Queued packet
+  };
+
+  /**
+   * Create an empty queue with a capacity of one element.
+   */
+  LrWpanTxQueue (void);
+
+  /**
+   * Set the maximum number of elements. The queue must not hold more elements
+   * than the new capacity.
+   *
+   * \param capacity the new capacity, at least one
+   */
+  void SetCapacity (uint32_t capacity);
+
+  /**
+   * \return the maximum number of elements
+   */
+  uint32_t GetCapacity (void) const;
+
+  /**
+   * \return the number of queued elements
+   */
+  uint32_t GetSize (void) const;
+
+  /**
+   * \return true, if the queue holds no elements
+   */
+  bool IsEmpty (void) const;
+
+  /**
+   * \return true, if the queue holds as many elements as its capacity
+   */
+  bool IsFull (void) const;
+
+  /**
+   * Get a queued element.
+   *
+   * \param index the position in the queue, 0 being the head
+   * \return the element
+   */
+  Element &Get (uint32_t index);
+
+  /**
+   * \return the head of the queue
+   */
+  Element &Front (void);
+
+  /**
+   * Append an element at the tail. The queue must not be full.
+   *
+   * \param msduHandle the MSDU handle
+   * \param p the packet
+   */
+  void PushBack (uint8_t msduHandle, Ptr<Packet> p);
+
+  /**
+   * Remove the head of the queue.
+   */
+  void PopFront (void);
+
+  /**
+   * Remove an element, preserving the order of the remaining ones.
+   *
+   * \param index the position in the queue, 0 being the head
+   */
+  void Remove (uint32_t index);
+
+  /**
+   * Remove all elements.
+   */
+  void Clear (void);
+
+private:
+  /**
+   * The ring buffer.
+   */
+  std::vector<Element> m_elements;
+
+  /**
+   * The index of the head in the ring buffer.
+   */
+  uint32_t m_head;
+
+  /**
+   * The number of queued elements.
+   */
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_TX_QUEUE_H */
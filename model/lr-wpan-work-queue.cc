@@ -0,0 +1,79 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include "lr-wpan-work-queue.h"
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LrWpanWorkQueue");
+
+LrWpanWorkQueue::LrWpanWorkQueue (void)
+  : m_depth (0),
+    m_dispatched (0)
+{
+}
+
+LrWpanWorkQueue::Scope::Scope (LrWpanWorkQueue &queue)
+  : m_queue (queue)
+{
+  m_queue.m_depth++;
+}
+
+LrWpanWorkQueue::Scope::~Scope ()
+{
+  NS_ASSERT (m_queue.m_depth > 0);
+  if (m_queue.m_depth == 1)
+    {
+      // Keep the scope open while draining, so that the handlers invoked by
+      // the work push to the queue instead of draining it recursively.
+      m_queue.Drain ();
+    }
+  m_queue.m_depth--;
+}
+
+bool
+LrWpanWorkQueue::IsActive (void) const
+{
+  return m_depth > 0;
+}
+
+void
+LrWpanWorkQueue::Push (Ptr<EventImpl> work)
+{
+  NS_LOG_FUNCTION (this << work);
+  NS_ASSERT_MSG (m_depth > 0, "No open scope");
+  m_work.push_back (work);
+}
+
+uint64_t
+LrWpanWorkQueue::GetDispatchedCount (void) const
+{
+  return m_dispatched;
+}
+
+void
+LrWpanWorkQueue::Drain (void)
+{
+  while (!m_work.empty ())
+    {
+      Ptr<EventImpl> work = m_work.front ();
+      m_work.pop_front ();
+      m_dispatched++;
+      work->Invoke ();
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,96 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef LR_WPAN_WORK_QUEUE_H
+#define LR_WPAN_WORK_QUEUE_H
+
+#include <ns3/ptr.h>
+#include <ns3/event-impl.h>
+#include <stdint.h>
+#include <deque>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief A FIFO of zero-delay work of one MAC, run when the current handler
+ * of this MAC returns.
+ *
+ * The MAC handlers invoked by the simulator, and the MAC entry points of the
+ * PHY SAP, open a Scope on the queue of their MAC. Work pushed while a scope
+ * is open is run in FIFO order when the outermost scope is closed, at the
+ * same simulation time and without going through the scheduler. Work pushed
+ * by running work is appended to the same queue. Each MAC owns its queue, so
+ * the work of one MAC never waits for the handler of another one.
+ */
+class LrWpanWorkQueue
+{
+public:
+  LrWpanWorkQueue (void);
+
+  /**
+   * Marks a handler of the owner of a queue. The queued work is run when the
+   * outermost scope is destroyed.
+   */
+  class Scope
+  {
+  public:
+    /**
+     * \param queue the work queue of the handler
+     */
+    Scope (LrWpanWorkQueue &queue);
+    ~Scope ();
+  private:
+    Scope (const Scope &);
+    Scope &operator= (const Scope &);
+
+    LrWpanWorkQueue &m_queue; //!< The work queue of the handler.
+  };
+
+  /**
+   * \return true, if a scope is open and work can be pushed
+   */
+  bool IsActive (void) const;
+
+  /**
+   * Append work to the queue. A scope must be open.
+   *
+   * \param work the work to be invoked
+   */
+  void Push (Ptr<EventImpl> work);
+
+  /**
+   * \return the number of work items run by this queue
+   */
+  uint64_t GetDispatchedCount (void) const;
+
+private:
+  LrWpanWorkQueue (const LrWpanWorkQueue &);
+  LrWpanWorkQueue &operator= (const LrWpanWorkQueue &);
+
+  /**
+   * Run the queued work, including the work it pushes.
+   */
+  void Drain (void);
+
+  uint32_t m_depth;                   //!< The number of open scopes.
+  std::deque<Ptr<EventImpl> > m_work; //!< The queued work.
+  uint64_t m_dispatched;              //!< The number of run work items.
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_WORK_QUEUE_H */
@@ -0,0 +1,84 @@
+#include "rf-mac-charge-request-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (RfMacChargeRequestTag);
+
+TypeId
+RfMacChargeRequestTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RfMacChargeRequestTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<RfMacChargeRequestTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+RfMacChargeRequestTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+RfMacChargeRequestTag::RfMacChargeRequestTag (void)
+  : m_edt ("ff:ff"),
+    m_chargingTime (0)
+{
+}
+
+uint32_t
+RfMacChargeRequestTag::GetSerializedSize (void) const
+{
+  return 2 + sizeof (double);
+}
+
+void
+RfMacChargeRequestTag::Serialize (TagBuffer i) const
+{
+  uint8_t buffer[2];
+  m_edt.CopyTo (buffer);
+  i.Write (buffer, 2);
+  i.WriteDouble (m_chargingTime);
+}
+
+void
+RfMacChargeRequestTag::Deserialize (TagBuffer i)
+{
+  uint8_t buffer[2];
+  i.Read (buffer, 2);
+  m_edt.CopyFrom (buffer);
+  m_chargingTime = i.ReadDouble ();
+}
+
+void
+RfMacChargeRequestTag::Print (std::ostream &os) const
+{
+  os << "Edt = " << m_edt << ", ChargingTime = " << m_chargingTime << " us";
+}
+
+void
+RfMacChargeRequestTag::SetEdt (Mac16Address address)
+{
+  m_edt = address;
+}
+
+Mac16Address
+RfMacChargeRequestTag::GetEdt (void) const
+{
+  return m_edt;
+}
+
+void
+RfMacChargeRequestTag::SetChargingTime (Time time)
+{
+  m_chargingTime = time.ToDouble (Time::US);
+}
+
+Time
+RfMacChargeRequestTag::GetChargingTime (void) const
+{
+  return MicroSeconds (m_chargingTime);
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef RF_MAC_CHARGE_REQUEST_TAG_H
+#define RF_MAC_CHARGE_REQUEST_TAG_H
+
+#include <ns3/tag.h>
+#include <ns3/nstime.h>
+#include <ns3/mac16-address.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief The energy pulse requested from one EDT, without probing.
+ *
+ * A sensor which recently measured the harvested power of an EDT predicts
+ * its charging time, and asks this EDT for the energy pulse right away. The
+ * RFE stays a broadcast, so the neighbouring sensors freeze as usual; only
+ * the named EDT answers, with the energy pulse.
+ */
+class RfMacChargeRequestTag : public Tag
+{
+public:
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * Create a RfMacChargeRequestTag for the broadcast address, without
+   * charging time.
+   */
+  RfMacChargeRequestTag (void);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \param address the address of the EDT asked for the energy pulse
+   */
+  void SetEdt (Mac16Address address);
+
+  /**
+   * \return the address of the EDT asked for the energy pulse
+   */
+  Mac16Address GetEdt (void) const;
+
+  /**
+   * \param time the requested duration of the energy pulse
+   */
+  void SetChargingTime (Time time);
+
+  /**
+   * \return the requested duration of the energy pulse
+   */
+  Time GetChargingTime (void) const;
+
+private:
+  /**
+   * The EDT asked for the energy pulse.
+   */
+  Mac16Address m_edt;
+
+  /**
+   * The requested duration of the energy pulse, in microseconds.
+   */
+  double m_chargingTime;
+};
+
+
+}
+#endif /* RF_MAC_CHARGE_REQUEST_TAG_H */
@@ -23,32 +23,38 @@ RfMacGroupTag::GetInstanceTypeId (void) const
 }
 
 RfMacGroupTag::RfMacGroupTag (void)
-  : m_group (0)
+  : m_group (0),
+    m_rxPower (0.0),
+    m_phase (0.0)
 {
 }
 
 uint32_t
 RfMacGroupTag::GetSerializedSize (void) const
 {
-  return sizeof (uint8_t);
+  return sizeof (uint8_t) + 2 * sizeof (double);
 }
 
 void
 RfMacGroupTag::Serialize (TagBuffer i) const
 {
   i.WriteU8 (m_group);
+  i.WriteDouble (m_rxPower);
+  i.WriteDouble (m_phase);
 }
 
 void
 RfMacGroupTag::Deserialize (TagBuffer i)
 {
   m_group = i.ReadU8 ();
+  m_rxPower = i.ReadDouble ();
+  m_phase = i.ReadDouble ();
 }
 
 void
 RfMacGroupTag::Print (std::ostream &os) const
 {
-  os << "Lqi = " << m_group;
+  os << "Group = " << static_cast<uint32_t> (m_group) << ", RxPower = " << m_rxPower << ", Phase = " << m_phase;
 }
 
 void
@@ -63,4 +69,28 @@ RfMacGroupTag::Get (void) const
   return m_group;
 }
 
+void
+RfMacGroupTag::SetRxPower (double rxPower)
+{
+  m_rxPower = rxPower;
+}
+
+double
+RfMacGroupTag::GetRxPower (void) const
+{
+  return m_rxPower;
+}
+
+void
+RfMacGroupTag::SetPhase (double phase)
+{
+  m_phase = phase;
+}
+
+double
+RfMacGroupTag::GetPhase (void) const
+{
+  return m_phase;
+}
+
 }
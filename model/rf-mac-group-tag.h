@@ -44,11 +44,50 @@ public:
    * \return the LQI value
    */
   uint8_t Get (void) const;
+
+  /**
+   * Set the received power of the RFE.
+   *
+   * \param rxPower the received power, in dBm
+   */
+  void SetRxPower (double rxPower);
+
+  /**
+   * Get the received power of the RFE.
+   *
+   * \return the received power, in dBm
+   */
+  double GetRxPower (void) const;
+
+  /**
+   * Set the phase of the RFE source at the receiver.
+   *
+   * \param phase the distance modulo the wavelength, as a fraction of the
+   * wavelength, 0 - 1
+   */
+  void SetPhase (double phase);
+
+  /**
+   * Get the phase of the RFE source at the receiver.
+   *
+   * \return the distance modulo the wavelength, as a fraction of the wavelength
+   */
+  double GetPhase (void) const;
 private:
   /**
    * The current LQI value of the tag.
    */
   uint8_t m_group;
+
+  /**
+   * The received power of the RFE, in dBm.
+   */
+  double m_rxPower;
+
+  /**
+   * The distance modulo the wavelength, as a fraction of the wavelength.
+   */
+  double m_phase;
 };
 
 
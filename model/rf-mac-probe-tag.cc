@@ -0,0 +1,105 @@
+#include "rf-mac-probe-tag.h"
+#include <ns3/assert.h>
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (RfMacProbeTag);
+
+TypeId
+RfMacProbeTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RfMacProbeTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<RfMacProbeTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+RfMacProbeTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+RfMacProbeTag::RfMacProbeTag (void)
+  : m_slots (2),
+    m_slot (0),
+    m_selected (0xffff)
+{
+}
+
+uint32_t
+RfMacProbeTag::GetSerializedSize (void) const
+{
+  return 2 * sizeof (uint8_t) + sizeof (uint16_t);
+}
+
+void
+RfMacProbeTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_slots);
+  i.WriteU8 (m_slot);
+  i.WriteU16 (m_selected);
+}
+
+void
+RfMacProbeTag::Deserialize (TagBuffer i)
+{
+  m_slots = i.ReadU8 ();
+  m_slot = i.ReadU8 ();
+  m_selected = i.ReadU16 ();
+}
+
+void
+RfMacProbeTag::Print (std::ostream &os) const
+{
+  os << "Slots = " << static_cast<uint32_t> (m_slots)
+     << ", Slot = " << static_cast<uint32_t> (m_slot)
+     << ", Selected = " << m_selected;
+}
+
+void
+RfMacProbeTag::SetSlots (uint8_t slots)
+{
+  NS_ASSERT (slots >= 1 && slots <= MAX_SLOTS);
+  m_slots = slots;
+}
+
+uint8_t
+RfMacProbeTag::GetSlots (void) const
+{
+  return m_slots;
+}
+
+void
+RfMacProbeTag::SetSlot (uint8_t slot)
+{
+  m_slot = slot;
+}
+
+uint8_t
+RfMacProbeTag::GetSlot (void) const
+{
+  return m_slot;
+}
+
+void
+RfMacProbeTag::SetSelected (uint16_t selected)
+{
+  m_selected = selected;
+}
+
+uint16_t
+RfMacProbeTag::GetSelected (void) const
+{
+  return m_selected;
+}
+
+bool
+RfMacProbeTag::IsSelected (uint8_t slot) const
+{
+  return slot >= 1 && slot <= MAX_SLOTS && (m_selected & (1 << (slot - 1)));
+}
+
+}
@@ -0,0 +1,87 @@
+#ifndef RF_MAC_PROBE_TAG_H
+#define RF_MAC_PROBE_TAG_H
+
+#include <ns3/tag.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief The probe slots of the RF-MAC.
+ *
+ * A CFE carries the number of probe slots of the probing and the slot of the
+ * sending EDT. A CFE_ACK carries the slots selected by the sensor, only the
+ * EDTs of these slots send the energy pulse.
+ */
+class RfMacProbeTag : public Tag
+{
+public:
+  /**
+   * The maximum number of probe slots.
+   */
+  static const uint8_t MAX_SLOTS = 16;
+
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * Create a RfMacProbeTag with two probe slots, all selected.
+   */
+  RfMacProbeTag (void);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * \param slots the number of probe slots, 1 - MAX_SLOTS
+   */
+  void SetSlots (uint8_t slots);
+
+  /**
+   * \return the number of probe slots
+   */
+  uint8_t GetSlots (void) const;
+
+  /**
+   * \param slot the probe slot of the EDT sending the CFE, starting at 1
+   */
+  void SetSlot (uint8_t slot);
+
+  /**
+   * \return the probe slot of the EDT sending the CFE
+   */
+  uint8_t GetSlot (void) const;
+
+  /**
+   * \param selected the selected probe slots, bit n - 1 for slot n
+   */
+  void SetSelected (uint16_t selected);
+
+  /**
+   * \return the selected probe slots, bit n - 1 for slot n
+   */
+  uint16_t GetSelected (void) const;
+
+  /**
+   * \param slot the probe slot, starting at 1
+   * \return true, if the probe slot is selected
+   */
+  bool IsSelected (uint8_t slot) const;
+private:
+  uint8_t m_slots;     //!< The number of probe slots
+  uint8_t m_slot;      //!< The probe slot of the EDT sending the CFE
+  uint16_t m_selected; //!< The selected probe slots
+};
+
+
+}
+#endif /* RF_MAC_PROBE_TAG_H */
@@ -0,0 +1,99 @@
+#include "rf-mac-requester-tag.h"
+#include <ns3/assert.h>
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (RfMacRequesterTag);
+
+TypeId
+RfMacRequesterTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RfMacRequesterTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("LrWpan")
+    .AddConstructor<RfMacRequesterTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+RfMacRequesterTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+RfMacRequesterTag::RfMacRequesterTag (void)
+{
+}
+
+uint32_t
+RfMacRequesterTag::GetSerializedSize (void) const
+{
+  return sizeof (uint8_t) + 2 * m_requesters.size ();
+}
+
+void
+RfMacRequesterTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_requesters.size ());
+  for (std::vector<Mac16Address>::const_iterator it = m_requesters.begin (); it != m_requesters.end (); it++)
+    {
+      uint8_t buffer[2];
+      it->CopyTo (buffer);
+      i.Write (buffer, 2);
+    }
+}
+
+void
+RfMacRequesterTag::Deserialize (TagBuffer i)
+{
+  m_requesters.clear ();
+  uint8_t count = i.ReadU8 ();
+  for (uint8_t n = 0; n < count; n++)
+    {
+      uint8_t buffer[2];
+      i.Read (buffer, 2);
+      Mac16Address address;
+      address.CopyFrom (buffer);
+      m_requesters.push_back (address);
+    }
+}
+
+void
+RfMacRequesterTag::Print (std::ostream &os) const
+{
+  os << "Requesters =";
+  for (std::vector<Mac16Address>::const_iterator it = m_requesters.begin (); it != m_requesters.end (); it++)
+    {
+      os << " " << *it;
+    }
+}
+
+void
+RfMacRequesterTag::AddRequester (Mac16Address address)
+{
+  NS_ASSERT_MSG (m_requesters.size () < MAX_REQUESTERS, "Too many requesters");
+  m_requesters.push_back (address);
+}
+
+const std::vector<Mac16Address> &
+RfMacRequesterTag::GetRequesters (void) const
+{
+  return m_requesters;
+}
+
+bool
+RfMacRequesterTag::GetIndex (Mac16Address address, uint32_t &index) const
+{
+  for (uint32_t n = 0; n < m_requesters.size (); n++)
+    {
+      if (m_requesters[n] == address)
+        {
+          index = n;
+          return true;
+        }
+    }
+  return false;
+}
+
+}
@@ -0,0 +1,76 @@
+#ifndef RF_MAC_REQUESTER_TAG_H
+#define RF_MAC_REQUESTER_TAG_H
+
+#include <ns3/tag.h>
+#include <ns3/mac16-address.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup lr-wpan
+ *
+ * \brief The sensors answered by a multicast CFE.
+ *
+ * An EDT aggregating the RFEs of several sensors answers them with one CFE
+ * to the broadcast address, listing the requesting sensors. The sensors send
+ * their CFE_ACKs one after the other, in the order of the list.
+ */
+class RfMacRequesterTag : public Tag
+{
+public:
+  /**
+   * The maximum number of sensors listed in a CFE.
+   */
+  static const uint32_t MAX_REQUESTERS = 16;
+
+  /**
+   * Get the type ID.
+   *
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  /**
+   * Create a RfMacRequesterTag without requesters.
+   */
+  RfMacRequesterTag (void);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * Add a requesting sensor to the end of the list.
+   *
+   * \param address the address of the sensor
+   */
+  void AddRequester (Mac16Address address);
+
+  /**
+   * \return the requesting sensors
+   */
+  const std::vector<Mac16Address> &GetRequesters (void) const;
+
+  /**
+   * Get the position of a sensor in the list.
+   *
+   * \param address the address of the sensor
+   * \param index set to the position of the sensor, starting at 0
+   * \return true, if the sensor is listed
+   */
+  bool GetIndex (Mac16Address address, uint32_t &index) const;
+
+private:
+  /**
+   * The requesting sensors.
+   */
+  std::vector<Mac16Address> m_requesters;
+};
+
+
+}
+#endif /* RF_MAC_REQUESTER_TAG_H */
@@ -0,0 +1,192 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/boolean.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include "lr-wpan-test-pair.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-aggregation-test");
+
+class LrWpanAggregationTestCase : public TestCase
+{
+public:
+  LrWpanAggregationTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void DataIndication (McpsDataIndicationParams params, Ptr<Packet> p);
+  void DataConfirm (McpsDataConfirmParams params);
+  void MacTx (Ptr<const Packet> p);
+  void MacTxQueueOverflow (Ptr<const Packet> p);
+  void RunScenario (bool aggregation, uint32_t packetSize, bool shrinkQueue = false);
+
+  std::vector<uint32_t> m_rxSizes;
+  std::vector<uint32_t> m_confirmedHandles;
+  uint32_t m_txFrames;
+  uint32_t m_overflows;
+  Ptr<LrWpanMac> m_shrinkMac;
+};
+
+LrWpanAggregationTestCase::LrWpanAggregationTestCase ()
+  : TestCase ("Test the aggregation of MSDUs in the 802.15.4 MAC")
+{
+}
+
+void
+LrWpanAggregationTestCase::DataIndication (McpsDataIndicationParams params, Ptr<Packet> p)
+{
+  m_rxSizes.push_back (p->GetSize ());
+}
+
+void
+LrWpanAggregationTestCase::DataConfirm (McpsDataConfirmParams params)
+{
+  if (params.m_status == IEEE_802_15_4_SUCCESS)
+    {
+      m_confirmedHandles.push_back (params.m_msduHandle);
+    }
+}
+
+void
+LrWpanAggregationTestCase::MacTx (Ptr<const Packet> p)
+{
+  m_txFrames++;
+  // Shrink the queue while the aggregated frame is sent.
+  if (m_shrinkMac != 0 && m_txFrames == 2)
+    {
+      m_shrinkMac->SetAttribute ("MaxQueueSize", UintegerValue (1));
+    }
+}
+
+void
+LrWpanAggregationTestCase::MacTxQueueOverflow (Ptr<const Packet> p)
+{
+  m_overflows++;
+}
+
+void
+LrWpanAggregationTestCase::RunScenario (bool aggregation, uint32_t packetSize, bool shrinkQueue)
+{
+  m_rxSizes.clear ();
+  m_confirmedHandles.clear ();
+  m_txFrames = 0;
+  m_overflows = 0;
+
+  LrWpanTestPair pair;
+  Ptr<LrWpanNetDevice> dev0 = pair.dev0;
+  Ptr<LrWpanNetDevice> dev1 = pair.dev1;
+
+  dev0->GetMac ()->SetAttribute ("Aggregation", BooleanValue (aggregation));
+  dev0->GetMac ()->SetMcpsDataConfirmCallback (MakeCallback (&LrWpanAggregationTestCase::DataConfirm, this));
+  dev0->GetMac ()->TraceConnectWithoutContext ("MacTx", MakeCallback (&LrWpanAggregationTestCase::MacTx, this));
+  dev0->GetMac ()->TraceConnectWithoutContext ("MacTxQueueOverflow", MakeCallback (&LrWpanAggregationTestCase::MacTxQueueOverflow, this));
+  dev1->GetMac ()->SetMcpsDataIndicationCallback (MakeCallback (&LrWpanAggregationTestCase::DataIndication, this));
+  if (shrinkQueue)
+    {
+      m_shrinkMac = dev0->GetMac ();
+    }
+
+  // Four acknowledged packets are requested at once. The first one is sent
+  // right away, the others are backlogged behind it.
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstAddr = Mac16Address ("00:02");
+  params.m_txOptions = TX_OPTION_ACK;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      params.m_msduHandle = i;
+      Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (packetSize + i));
+    }
+
+  // Two more packets requested at once, after the queue was shrunk.
+  if (shrinkQueue)
+    {
+      for (uint32_t i = 4; i < 6; i++)
+        {
+          params.m_msduHandle = i;
+          Simulator::Schedule (Seconds (2.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (packetSize + i));
+        }
+    }
+
+  Simulator::Run ();
+  m_shrinkMac = 0;
+  Simulator::Destroy ();
+}
+
+void
+LrWpanAggregationTestCase::DoRun (void)
+{
+  // Without aggregation, every packet is sent in its own frame.
+  RunScenario (false, 20);
+  NS_TEST_ASSERT_MSG_EQ (m_txFrames, 4, "Wrong number of frames without aggregation");
+  NS_TEST_ASSERT_MSG_EQ (m_rxSizes.size (), 4, "Wrong number of received packets");
+
+  // The three backlogged packets go in one frame, and are split again at the
+  // receiver. Each packet is confirmed on its own.
+  RunScenario (true, 20);
+  NS_TEST_ASSERT_MSG_EQ (m_txFrames, 2, "Wrong number of frames with aggregation");
+  NS_TEST_ASSERT_MSG_EQ (m_rxSizes.size (), 4, "Wrong number of received packets");
+  for (uint32_t i = 0; i < m_rxSizes.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_rxSizes[i], 20 + i, "Wrong size of received packet " << i);
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles.size (), 4, "Wrong number of confirmed packets");
+  for (uint32_t i = 0; i < m_confirmedHandles.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles[i], i, "Wrong order of confirmed packets");
+    }
+
+  // Only two of the backlogged packets fit in a PSDU.
+  RunScenario (true, 50);
+  NS_TEST_ASSERT_MSG_EQ (m_txFrames, 3, "Wrong number of frames with aggregation of large packets");
+  NS_TEST_ASSERT_MSG_EQ (m_rxSizes.size (), 4, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles.size (), 4, "Wrong number of confirmed packets");
+
+  // Shrinking the queue to one packet while the three backlogged packets are
+  // sent together keeps them until they are confirmed. Of the two packets
+  // requested later, the second one no longer fits.
+  RunScenario (true, 20, true);
+  NS_TEST_ASSERT_MSG_EQ (m_txFrames, 3, "Wrong number of frames after shrinking the queue");
+  NS_TEST_ASSERT_MSG_EQ (m_rxSizes.size (), 5, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles.size (), 5, "Wrong number of confirmed packets");
+  for (uint32_t i = 0; i < m_confirmedHandles.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles[i], i, "Wrong order of confirmed packets");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_overflows, 1, "Wrong number of packets dropped by the shrunk queue");
+}
+
+class LrWpanAggregationTestSuite : public TestSuite
+{
+public:
+  LrWpanAggregationTestSuite ();
+};
+
+LrWpanAggregationTestSuite::LrWpanAggregationTestSuite ()
+  : TestSuite ("lr-wpan-aggregation", UNIT)
+{
+  AddTestCase (new LrWpanAggregationTestCase, TestCase::QUICK);
+}
+
+static LrWpanAggregationTestSuite g_lrWpanAggregationTestSuite;
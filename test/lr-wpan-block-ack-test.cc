@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/uinteger.h>
+#include <ns3/pointer.h>
+#include <ns3/simulator.h>
+#include <ns3/error-model.h>
+#include <ns3/lr-wpan-module.h>
+
+#include <list>
+#include "lr-wpan-test-pair.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-block-ack-test");
+
+class LrWpanBlockAckTestCase : public TestCase
+{
+public:
+  LrWpanBlockAckTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void DataIndication (McpsDataIndicationParams params, Ptr<Packet> p);
+  void DataConfirm (McpsDataConfirmParams params);
+  void SenderTx (Ptr<const Packet> p);
+  void ReceiverTx (Ptr<const Packet> p);
+  void RunScenario (Ptr<ErrorModel> em);
+
+  uint32_t m_rxPackets;
+  std::vector<uint32_t> m_confirmedHandles;
+  uint32_t m_senderFrames;
+  uint32_t m_receiverFrames;
+};
+
+LrWpanBlockAckTestCase::LrWpanBlockAckTestCase ()
+  : TestCase ("Test the bursts acknowledged by a block ACK in the 802.15.4 MAC")
+{
+}
+
+void
+LrWpanBlockAckTestCase::DataIndication (McpsDataIndicationParams params, Ptr<Packet> p)
+{
+  m_rxPackets++;
+}
+
+void
+LrWpanBlockAckTestCase::DataConfirm (McpsDataConfirmParams params)
+{
+  if (params.m_status == IEEE_802_15_4_SUCCESS)
+    {
+      m_confirmedHandles.push_back (params.m_msduHandle);
+    }
+}
+
+void
+LrWpanBlockAckTestCase::SenderTx (Ptr<const Packet> p)
+{
+  m_senderFrames++;
+}
+
+void
+LrWpanBlockAckTestCase::ReceiverTx (Ptr<const Packet> p)
+{
+  m_receiverFrames++;
+}
+
+void
+LrWpanBlockAckTestCase::RunScenario (Ptr<ErrorModel> em)
+{
+  m_rxPackets = 0;
+  m_confirmedHandles.clear ();
+  m_senderFrames = 0;
+  m_receiverFrames = 0;
+
+  LrWpanTestPair pair;
+  Ptr<LrWpanNetDevice> dev0 = pair.dev0;
+  Ptr<LrWpanNetDevice> dev1 = pair.dev1;
+
+  dev0->GetMac ()->SetAttribute ("MaxBurstSize", UintegerValue (4));
+  dev0->GetMac ()->SetMcpsDataConfirmCallback (MakeCallback (&LrWpanBlockAckTestCase::DataConfirm, this));
+  dev0->GetMac ()->TraceConnectWithoutContext ("MacTx", MakeCallback (&LrWpanBlockAckTestCase::SenderTx, this));
+  dev1->GetMac ()->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+  dev1->GetMac ()->SetMcpsDataIndicationCallback (MakeCallback (&LrWpanBlockAckTestCase::DataIndication, this));
+  dev1->GetMac ()->TraceConnectWithoutContext ("MacTx", MakeCallback (&LrWpanBlockAckTestCase::ReceiverTx, this));
+
+  // Five acknowledged packets are requested at once. The first one is sent
+  // right away with its own ACK, the four others are backlogged behind it.
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstAddr = Mac16Address ("00:02");
+  params.m_txOptions = TX_OPTION_ACK;
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      params.m_msduHandle = i;
+      Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (20));
+    }
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+LrWpanBlockAckTestCase::DoRun (void)
+{
+  // The backlog is sent in one burst, answered by one block ACK.
+  RunScenario (0);
+  NS_TEST_ASSERT_MSG_EQ (m_senderFrames, 5, "Wrong number of sent frames");
+  NS_TEST_ASSERT_MSG_EQ (m_receiverFrames, 2, "Wrong number of ACKs");
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 5, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles.size (), 5, "Wrong number of confirmed packets");
+
+  // The second frame of the burst is lost. Only this one is retransmitted,
+  // after the others have been confirmed.
+  Ptr<ReceiveListErrorModel> em = CreateObject<ReceiveListErrorModel> ();
+  std::list<uint32_t> lost;
+  lost.push_back (2);
+  em->SetList (lost);
+  RunScenario (em);
+  NS_TEST_ASSERT_MSG_EQ (m_senderFrames, 6, "Wrong number of sent frames");
+  NS_TEST_ASSERT_MSG_EQ (m_receiverFrames, 3, "Wrong number of ACKs");
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 5, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles.size (), 5, "Wrong number of confirmed packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles[3], 4, "Wrong confirmation order");
+  NS_TEST_ASSERT_MSG_EQ (m_confirmedHandles[4], 2, "The lost packet was not retransmitted last");
+}
+
+class LrWpanBlockAckTestSuite : public TestSuite
+{
+public:
+  LrWpanBlockAckTestSuite ();
+};
+
+LrWpanBlockAckTestSuite::LrWpanBlockAckTestSuite ()
+  : TestSuite ("lr-wpan-block-ack", UNIT)
+{
+  AddTestCase (new LrWpanBlockAckTestCase, TestCase::QUICK);
+}
+
+static LrWpanBlockAckTestSuite g_lrWpanBlockAckTestSuite;
@@ -0,0 +1,141 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/node.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <string>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-charging-cache-test");
+
+class LrWpanChargingCacheTestCase : public TestCase
+{
+public:
+  /**
+   * \param name the description of the test case
+   * \param validity the ChargingCacheValidity of the sensor
+   * \param distance the distance of the EDT, in m
+   * \param move move the EDT away after the first charge cycle
+   * \param cfes the expected number of CFEs
+   */
+  LrWpanChargingCacheTestCase (std::string name, Time validity, double distance, bool move, uint32_t cfes);
+
+private:
+  virtual void DoRun (void);
+  void EnergyTx (Ptr<const Packet> p, Time duration);
+  void ChargeCycle (double energy, Time chargingTime);
+
+  Time m_validity;
+  double m_distance;
+  bool m_move;
+  uint32_t m_expectedCfes;
+  uint32_t m_energyTx;
+  uint32_t m_chargeCycles;
+};
+
+LrWpanChargingCacheTestCase::LrWpanChargingCacheTestCase (std::string name, Time validity, double distance, bool move, uint32_t cfes)
+  : TestCase (name),
+    m_validity (validity),
+    m_distance (distance),
+    m_move (move),
+    m_expectedCfes (cfes),
+    m_energyTx (0),
+    m_chargeCycles (0)
+{
+}
+
+void
+LrWpanChargingCacheTestCase::EnergyTx (Ptr<const Packet> p, Time duration)
+{
+  m_energyTx++;
+}
+
+void
+LrWpanChargingCacheTestCase::ChargeCycle (double energy, Time chargingTime)
+{
+  m_chargeCycles++;
+}
+
+void
+LrWpanChargingCacheTestCase::DoRun (void)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  Ptr<Node> sensorNode = CreateObject<Node> ();
+  Ptr<LrWpanSensorNetDevice> sensor = CreateObject<LrWpanSensorNetDevice> ();
+  sensor->SetAddress (Mac16Address ("00:01"));
+  sensor->SetChannel (channel);
+  sensorNode->AddDevice (sensor);
+  sensor->GetPhy ()->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+  sensor->GetMac ()->SetAttribute ("ChargingCacheValidity", TimeValue (m_validity));
+  sensor->GetMac ()->TraceConnectWithoutContext ("RfMacChargeCycle", MakeCallback (&LrWpanChargingCacheTestCase::ChargeCycle, this));
+
+  Ptr<Node> edtNode = CreateObject<Node> ();
+  Ptr<LrWpanEdtNetDevice> edt = CreateObject<LrWpanEdtNetDevice> ();
+  edt->SetAddress (Mac16Address ("00:11"));
+  edt->SetChannel (channel);
+  edtNode->AddDevice (edt);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (Vector (m_distance, 0, 0));
+  edt->GetPhy ()->SetMobility (mobility);
+  edt->GetMac ()->TraceConnectWithoutContext ("RfMacEnergyTx", MakeCallback (&LrWpanChargingCacheTestCase::EnergyTx, this));
+
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::SendRfeForEnergy, sensor->GetMac ());
+  Simulator::Schedule (Seconds (3.0), &LrWpanMac::SendRfeForEnergy, sensor->GetMac ());
+  Simulator::Schedule (Seconds (5.0), &LrWpanMac::SendRfeForEnergy, sensor->GetMac ());
+  if (m_move)
+    {
+      // The harvested power drops to a third, beyond the drift of 0.2.
+      Simulator::Schedule (Seconds (2.0), &ConstantPositionMobilityModel::SetPosition, mobility, Vector (1.5 * m_distance, 0, 0));
+    }
+
+  Simulator::Stop (Seconds (7.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_chargeCycles, 3, "Not every request charged the sensor");
+  NS_TEST_ASSERT_MSG_EQ (m_energyTx, 3 + m_expectedCfes, "Wrong number of CFEs");
+}
+
+class LrWpanChargingCacheTestSuite : public TestSuite
+{
+public:
+  LrWpanChargingCacheTestSuite ();
+};
+
+LrWpanChargingCacheTestSuite::LrWpanChargingCacheTestSuite ()
+  : TestSuite ("lr-wpan-charging-cache", UNIT)
+{
+  AddTestCase (new LrWpanChargingCacheTestCase ("Test that every request is probed without cache", Seconds (0), 1.0, false, 3), TestCase::QUICK);
+  AddTestCase (new LrWpanChargingCacheTestCase ("Test that the repeated requests skip the probing", Seconds (10), 1.0, false, 1), TestCase::QUICK);
+  AddTestCase (new LrWpanChargingCacheTestCase ("Test that a stale cache entry is probed again", MilliSeconds (2500), 1.0, false, 2), TestCase::QUICK);
+  AddTestCase (new LrWpanChargingCacheTestCase ("Test that a drifting link is probed again", Seconds (10), 1.0, true, 2), TestCase::QUICK);
+  // At 7.5 wavelengths the EDT probes in slot 2, a wrong slot would be
+  // dropped as drifting.
+  AddTestCase (new LrWpanChargingCacheTestCase ("Test that the power of an EDT out of phase is cached", Seconds (10), 7.5 * 0.145, false, 1), TestCase::QUICK);
+}
+
+static LrWpanChargingCacheTestSuite g_lrWpanChargingCacheTestSuite;
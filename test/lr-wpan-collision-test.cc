@@ -27,6 +27,7 @@
 #include <ns3/mac16-address.h>
 #include <ns3/mac64-address.h>
 #include <ns3/log.h>
+#include <ns3/boolean.h>
 
 
 using namespace ns3;
@@ -215,6 +216,339 @@ LrWpanCollisionTestCase::DoRun (void)
 }
 
 // ==============================================================================
+class LrWpanInterferenceEnergyTestCase : public TestCase
+{
+public:
+  LrWpanInterferenceEnergyTestCase ();
+  virtual ~LrWpanInterferenceEnergyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void AddSignal (Ptr<const SpectrumValue> signal, LrWpanChannelPsd compact);
+  void ReadEnergy (void);
+
+  Ptr<LrWpanInterferenceHelper> m_helper;
+  double m_energy;
+  double m_otherChannelEnergy;
+};
+
+LrWpanInterferenceEnergyTestCase::LrWpanInterferenceEnergyTestCase ()
+  : TestCase ("Test the energy integration of the 802.15.4 interference helper"),
+    m_energy (0.0),
+    m_otherChannelEnergy (0.0)
+{
+}
+
+LrWpanInterferenceEnergyTestCase::~LrWpanInterferenceEnergyTestCase ()
+{
+}
+
+void
+LrWpanInterferenceEnergyTestCase::AddSignal (Ptr<const SpectrumValue> signal, LrWpanChannelPsd compact)
+{
+  m_helper->AddSignal (signal, compact);
+}
+
+void
+LrWpanInterferenceEnergyTestCase::ReadEnergy (void)
+{
+  m_energy = m_helper->GetSignalEnergy (11);
+  m_otherChannelEnergy = m_helper->GetSignalEnergy (12);
+}
+
+void
+LrWpanInterferenceEnergyTestCase::DoRun (void)
+{
+  LrWpanSpectrumValueHelper psdHelper;
+  Ptr<SpectrumValue> signal1 = psdHelper.CreateTxPowerSpectralDensity (0, 11);
+  Ptr<SpectrumValue> signal2 = psdHelper.CreateTxPowerSpectralDensity (-3, 11);
+  LrWpanChannelPsd compact1 = LrWpanChannelPsd::FromSpectrumValue (signal1);
+  LrWpanChannelPsd compact2 = LrWpanChannelPsd::FromSpectrumValue (signal2);
+  m_helper = Create<LrWpanInterferenceHelper> (signal1->GetSpectrumModel ());
+
+  // Two partially overlapping signals, the measurement starts while the
+  // first one is already active.
+  Simulator::Schedule (Seconds (1.0), &LrWpanInterferenceEnergyTestCase::AddSignal, this, signal1, compact1);
+  Simulator::Schedule (Seconds (1.2), &LrWpanInterferenceHelper::ResetSignalEnergy, m_helper);
+  Simulator::Schedule (Seconds (1.5), &LrWpanInterferenceEnergyTestCase::AddSignal, this, signal2, compact2);
+  Simulator::Schedule (Seconds (2.0), &LrWpanInterferenceHelper::RemoveSignal, m_helper, signal1);
+  Simulator::Schedule (Seconds (2.5), &LrWpanInterferenceEnergyTestCase::ReadEnergy, this);
+  Simulator::Schedule (Seconds (3.0), &LrWpanInterferenceHelper::RemoveSignal, m_helper, signal2);
+  Simulator::Run ();
+
+  double expected = compact1.TotalAvgPower () * 0.8 + compact2.TotalAvgPower () * 1.0;
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_energy, expected, expected * 1e-9, "Wrong integrated energy");
+  NS_TEST_ASSERT_MSG_EQ (m_otherChannelEnergy, 0.0, "Energy leaking into another channel");
+  double total = m_helper->GetSignalEnergy (11);
+  expected = compact1.TotalAvgPower () * 0.8 + compact2.TotalAvgPower () * 1.5;
+  NS_TEST_ASSERT_MSG_EQ_TOL (total, expected, expected * 1e-9, "Energy integrated without signals");
+
+  m_helper = 0;
+  Simulator::Destroy ();
+}
+
+class LrWpanDeferredPerTestCase : public TestCase
+{
+public:
+  LrWpanDeferredPerTestCase ();
+  virtual ~LrWpanDeferredPerTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void PhyRxEnd (Ptr<const Packet> p, double lqi);
+  void PhyRxDrop (Ptr<const Packet> p);
+  void RunScenario (bool deferred, double interfererDistance);
+
+  std::vector<double> m_lqi;
+  uint32_t m_drops;
+};
+
+LrWpanDeferredPerTestCase::LrWpanDeferredPerTestCase ()
+  : TestCase ("Test the deferred PER evaluation of the 802.15.4 PHY"),
+    m_drops (0)
+{
+}
+
+LrWpanDeferredPerTestCase::~LrWpanDeferredPerTestCase ()
+{
+}
+
+void
+LrWpanDeferredPerTestCase::PhyRxEnd (Ptr<const Packet> p, double lqi)
+{
+  m_lqi.push_back (lqi);
+}
+
+void
+LrWpanDeferredPerTestCase::PhyRxDrop (Ptr<const Packet> p)
+{
+  m_drops++;
+}
+
+void
+LrWpanDeferredPerTestCase::RunScenario (bool deferred, double interfererDistance)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  // A sender, a receiver at 60 m and an interferer behind the receiver.
+  double positions[3] = { 0.0, 60.0, 60.0 + interfererDistance };
+  std::vector<Ptr<LrWpanPhy> > phys;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<LrWpanPhy> phy = CreateObject<LrWpanPhy> ();
+      phy->SetAttribute ("DeferredPerEvaluation", BooleanValue (deferred));
+      phy->SetErrorModel (CreateObject<LrWpanErrorModel> ());
+      phy->SetChannel (channel);
+      channel->AddRx (phy);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (positions[i], 0, 0));
+      phy->SetMobility (mobility);
+      phys.push_back (phy);
+    }
+  phys[0]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+  phys[1]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
+  phys[2]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+  phys[1]->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback (&LrWpanDeferredPerTestCase::PhyRxEnd, this));
+  phys[1]->TraceConnectWithoutContext ("PhyRxDrop", MakeCallback (&LrWpanDeferredPerTestCase::PhyRxDrop, this));
+
+  // The interferer starts and ends during the reception, splitting it into
+  // three chunks of different SINR.
+  Ptr<Packet> p0 = Create<Packet> (100);
+  Ptr<Packet> p2 = Create<Packet> (10);
+  Simulator::Schedule (Seconds (1.0), &LrWpanPhy::PdDataRequest, phys[0], p0->GetSize (), p0);
+  Simulator::Schedule (Seconds (1.001), &LrWpanPhy::PdDataRequest, phys[2], p2->GetSize (), p2);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+LrWpanDeferredPerTestCase::DoRun (void)
+{
+  // The LQI does not depend on the random decision about the packet loss, so
+  // both modes have to yield the same LQI. An interferer at 150 m leaves the
+  // packet intact in both modes.
+  RunScenario (false, 150.0);
+  RunScenario (true, 150.0);
+
+  NS_TEST_ASSERT_MSG_EQ (m_lqi.size (), 2, "Packet not received in both modes");
+  NS_TEST_ASSERT_MSG_EQ (m_lqi[0], m_lqi[1], "The deferred PER evaluation yields a different LQI");
+  NS_TEST_ASSERT_MSG_EQ (m_drops, 0, "Packet dropped despite a weak interferer");
+
+  // An interferer at 1 m destroys the packet in both modes.
+  RunScenario (false, 1.0);
+  RunScenario (true, 1.0);
+
+  NS_TEST_ASSERT_MSG_EQ (m_lqi.size (), 4, "Packet end not traced in both modes");
+  NS_TEST_ASSERT_MSG_EQ (m_lqi[2], m_lqi[3], "The deferred PER evaluation yields a different LQI");
+  NS_TEST_ASSERT_MSG_EQ (m_drops, 2, "The deferred PER evaluation yields a different loss decision");
+}
+
+class LrWpanEarlyRxRejectionTestCase : public TestCase
+{
+public:
+  LrWpanEarlyRxRejectionTestCase ();
+  virtual ~LrWpanEarlyRxRejectionTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void NearRxBegin (Ptr<const Packet> p);
+  void FarRx (Ptr<const Packet> p);
+
+  uint32_t m_nearRxBegin;
+  uint32_t m_farRx;
+};
+
+LrWpanEarlyRxRejectionTestCase::LrWpanEarlyRxRejectionTestCase ()
+  : TestCase ("Test the early rejection of weak signals by the 802.15.4 PHY")
+{
+}
+
+LrWpanEarlyRxRejectionTestCase::~LrWpanEarlyRxRejectionTestCase ()
+{
+}
+
+void
+LrWpanEarlyRxRejectionTestCase::NearRxBegin (Ptr<const Packet> p)
+{
+  m_nearRxBegin++;
+}
+
+void
+LrWpanEarlyRxRejectionTestCase::FarRx (Ptr<const Packet> p)
+{
+  m_farRx++;
+}
+
+void
+LrWpanEarlyRxRejectionTestCase::DoRun (void)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  // A sender, a receiver at 60 m (about -100 dBm) and a receiver at 5 km
+  // (about -158 dBm).
+  double positions[3] = { 0.0, 60.0, 5000.0 };
+  std::vector<Ptr<LrWpanPhy> > phys;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<LrWpanPhy> phy = CreateObject<LrWpanPhy> ();
+      phy->SetAttribute ("EarlyRxRejection", BooleanValue (true));
+      phy->SetChannel (channel);
+      channel->AddRx (phy);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (positions[i], 0, 0));
+      phy->SetMobility (mobility);
+      phys.push_back (phy);
+    }
+  phys[0]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+  phys[1]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
+  phys[2]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
+  m_nearRxBegin = 0;
+  m_farRx = 0;
+  phys[1]->TraceConnectWithoutContext ("PhyRxBegin", MakeCallback (&LrWpanEarlyRxRejectionTestCase::NearRxBegin, this));
+  phys[2]->TraceConnectWithoutContext ("PhyRxBegin", MakeCallback (&LrWpanEarlyRxRejectionTestCase::FarRx, this));
+  phys[2]->TraceConnectWithoutContext ("PhyRxDrop", MakeCallback (&LrWpanEarlyRxRejectionTestCase::FarRx, this));
+
+  Ptr<Packet> p = Create<Packet> (20);
+  Simulator::Schedule (Seconds (1.0), &LrWpanPhy::PdDataRequest, phys[0], p->GetSize (), p);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (phys[1]->GetRxRejectedCount (), 0, "Signal above the threshold rejected");
+  NS_TEST_ASSERT_MSG_EQ (m_nearRxBegin, 1, "Signal above the threshold not received");
+  NS_TEST_ASSERT_MSG_EQ (phys[2]->GetRxRejectedCount (), 1, "Signal below the threshold not rejected");
+  NS_TEST_ASSERT_MSG_EQ (m_farRx, 0, "Rejected signal reached the receive path");
+
+  Simulator::Destroy ();
+}
+
+class LrWpanEarlyRxRejectionEnergyTestCase : public TestCase
+{
+public:
+  LrWpanEarlyRxRejectionEnergyTestCase ();
+  virtual ~LrWpanEarlyRxRejectionEnergyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void PhyRxEnd (Ptr<const Packet> p, double lqi);
+  void EnergyIndication (double energy, uint8_t slot);
+
+  uint32_t m_rxEnd;
+  std::vector<double> m_energy;
+};
+
+LrWpanEarlyRxRejectionEnergyTestCase::LrWpanEarlyRxRejectionEnergyTestCase ()
+  : TestCase ("Test that the early rejection of the 802.15.4 PHY leaves weak energy pulses to the harvesting")
+{
+}
+
+LrWpanEarlyRxRejectionEnergyTestCase::~LrWpanEarlyRxRejectionEnergyTestCase ()
+{
+}
+
+void
+LrWpanEarlyRxRejectionEnergyTestCase::PhyRxEnd (Ptr<const Packet> p, double lqi)
+{
+  m_rxEnd++;
+}
+
+void
+LrWpanEarlyRxRejectionEnergyTestCase::EnergyIndication (double energy, uint8_t slot)
+{
+  m_energy.push_back (energy);
+}
+
+void
+LrWpanEarlyRxRejectionEnergyTestCase::DoRun (void)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  // A sender, a receiver at 60 m and an energy source 5 km behind the
+  // receiver, well below the rejection threshold.
+  double positions[3] = { 0.0, 60.0, 5060.0 };
+  std::vector<Ptr<LrWpanPhy> > phys;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<LrWpanPhy> phy = CreateObject<LrWpanPhy> ();
+      phy->SetAttribute ("EarlyRxRejection", BooleanValue (true));
+      phy->SetChannel (channel);
+      channel->AddRx (phy);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (positions[i], 0, 0));
+      phy->SetMobility (mobility);
+      phys.push_back (phy);
+    }
+  phys[0]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+  phys[1]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_RX_ON);
+  phys[2]->PlmeSetTRXStateRequest (IEEE_802_15_4_PHY_TX_ON);
+  m_rxEnd = 0;
+  m_energy.clear ();
+  phys[1]->TraceConnectWithoutContext ("PhyRxEnd", MakeCallback (&LrWpanEarlyRxRejectionEnergyTestCase::PhyRxEnd, this));
+  phys[1]->SetPdEnergyIndicationCallback (MakeCallback (&LrWpanEarlyRxRejectionEnergyTestCase::EnergyIndication, this));
+
+  // The energy pulse lasts one second and overlaps the data packet.
+  Ptr<Packet> pulse = Create<Packet> (10);
+  RfMacTypeTag typeTag;
+  typeTag.Set (RfMacTypeTag::RF_MAC_ENERGY);
+  pulse->AddPacketTag (typeTag);
+  RfMacDurationTag durationTag;
+  durationTag.Set (Seconds (1.0));
+  pulse->AddPacketTag (durationTag);
+  Ptr<Packet> p = Create<Packet> (20);
+  Simulator::Schedule (Seconds (0.9), &LrWpanPhy::PdDataRequest, phys[2], pulse->GetSize (), pulse);
+  Simulator::Schedule (Seconds (1.0), &LrWpanPhy::PdDataRequest, phys[0], p->GetSize (), p);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (phys[1]->GetRxRejectedCount (), 0, "Energy pulse rejected");
+  NS_TEST_ASSERT_MSG_EQ (m_rxEnd, 1, "Data packet not received next to the energy pulse");
+  NS_TEST_ASSERT_MSG_EQ (m_energy.size (), 1, "Energy pulse not harvested");
+  NS_TEST_ASSERT_MSG_GT (m_energy[0], 0.0, "No energy harvested from the pulse");
+
+  Simulator::Destroy ();
+}
+
 class LrWpanCollisionTestSuite : public TestSuite
 {
 public:
@@ -225,6 +559,10 @@ LrWpanCollisionTestSuite::LrWpanCollisionTestSuite ()
   : TestSuite ("lr-wpan-collision", UNIT)
 {
   AddTestCase (new LrWpanCollisionTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanInterferenceEnergyTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanDeferredPerTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanEarlyRxRejectionTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanEarlyRxRejectionEnergyTestCase, TestCase::QUICK);
 }
 
 static LrWpanCollisionTestSuite g_lrWpanCollisionTestSuite;
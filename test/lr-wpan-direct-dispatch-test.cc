@@ -0,0 +1,217 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/boolean.h>
+#include <ns3/simulator.h>
+#include <ns3/make-event.h>
+#include <ns3/lr-wpan-module.h>
+#include "lr-wpan-test-pair.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-direct-dispatch-test");
+
+class LrWpanWorkQueueTestCase : public TestCase
+{
+public:
+  LrWpanWorkQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Work (uint32_t id);
+  void Handler (void);
+
+  LrWpanWorkQueue m_queue;
+  LrWpanWorkQueue m_otherQueue;
+  std::vector<uint32_t> m_run;
+};
+
+LrWpanWorkQueueTestCase::LrWpanWorkQueueTestCase ()
+  : TestCase ("Test the order of the 802.15.4 work queue")
+{
+}
+
+void
+LrWpanWorkQueueTestCase::Work (uint32_t id)
+{
+  m_run.push_back (id);
+  if (id == 0)
+    {
+      // Work pushed by running work goes after the work already queued.
+      m_queue.Push (Ptr<EventImpl> (MakeEvent (&LrWpanWorkQueueTestCase::Work, this, 2), false));
+    }
+}
+
+void
+LrWpanWorkQueueTestCase::Handler (void)
+{
+  LrWpanWorkQueue::Scope scope (m_queue);
+  // An event scheduled for now runs after the work of this handler, and
+  // the queue of another owner is not entered by this handler.
+  Simulator::ScheduleNow (&LrWpanWorkQueueTestCase::Work, this, 5);
+  m_queue.Push (Ptr<EventImpl> (MakeEvent (&LrWpanWorkQueueTestCase::Work, this, 3), false));
+  NS_TEST_EXPECT_MSG_EQ (m_otherQueue.IsActive (), false, "Scope open on the queue of another owner");
+  m_queue.Push (Ptr<EventImpl> (MakeEvent (&LrWpanWorkQueueTestCase::Work, this, 4), false));
+}
+
+void
+LrWpanWorkQueueTestCase::DoRun (void)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_queue.IsActive (), false, "Scope open without a handler");
+  {
+    LrWpanWorkQueue::Scope outer (m_queue);
+    m_queue.Push (Ptr<EventImpl> (MakeEvent (&LrWpanWorkQueueTestCase::Work, this, 0), false));
+    {
+      LrWpanWorkQueue::Scope inner (m_queue);
+      m_queue.Push (Ptr<EventImpl> (MakeEvent (&LrWpanWorkQueueTestCase::Work, this, 1), false));
+    }
+    NS_TEST_ASSERT_MSG_EQ (m_run.size (), 0, "Work run before the outermost scope was closed");
+
+    Ptr<EventImpl> cancelled = Ptr<EventImpl> (MakeEvent (&LrWpanWorkQueueTestCase::Work, this, 99), false);
+    m_queue.Push (cancelled);
+    cancelled->Cancel ();
+  }
+  NS_TEST_ASSERT_MSG_EQ (m_queue.IsActive (), false, "Scope still open");
+  NS_TEST_ASSERT_MSG_EQ (m_run.size (), 3, "Wrong number of run work items");
+
+  Simulator::Schedule (Seconds (1.0), &LrWpanWorkQueueTestCase::Handler, this);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_run.size (), 6, "Wrong number of run work items");
+  for (uint32_t i = 0; i < m_run.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_run[i], i, "Wrong order of the work items");
+    }
+  // The cancelled work item is dispatched, but not run.
+  NS_TEST_ASSERT_MSG_EQ (m_queue.GetDispatchedCount (), 6, "Wrong number of dispatched work items");
+  NS_TEST_ASSERT_MSG_EQ (m_otherQueue.GetDispatchedCount (), 0, "Work dispatched by another queue");
+}
+
+class LrWpanDirectDispatchTestCase : public TestCase
+{
+public:
+  LrWpanDirectDispatchTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void DataIndication (McpsDataIndicationParams params, Ptr<Packet> p);
+  void DataConfirm (McpsDataConfirmParams params);
+  void RunScenario (bool directDispatch);
+
+  std::vector<Time> m_rxTimes;
+  std::vector<Time> m_confirmTimes;
+  uint64_t m_dispatched;
+};
+
+LrWpanDirectDispatchTestCase::LrWpanDirectDispatchTestCase ()
+  : TestCase ("Test the direct dispatch of the 802.15.4 MAC state changes"),
+    m_dispatched (0)
+{
+}
+
+void
+LrWpanDirectDispatchTestCase::DataIndication (McpsDataIndicationParams params, Ptr<Packet> p)
+{
+  m_rxTimes.push_back (Simulator::Now ());
+}
+
+void
+LrWpanDirectDispatchTestCase::DataConfirm (McpsDataConfirmParams params)
+{
+  if (params.m_status == IEEE_802_15_4_SUCCESS)
+    {
+      m_confirmTimes.push_back (Simulator::Now ());
+    }
+}
+
+void
+LrWpanDirectDispatchTestCase::RunScenario (bool directDispatch)
+{
+  m_rxTimes.clear ();
+  m_confirmTimes.clear ();
+
+  LrWpanTestPair pair;
+  Ptr<LrWpanNetDevice> dev0 = pair.dev0;
+  Ptr<LrWpanNetDevice> dev1 = pair.dev1;
+
+  // Both runs draw the same backoffs.
+  dev0->AssignStreams (0);
+  dev1->AssignStreams (10);
+
+  dev0->GetMac ()->SetAttribute ("DirectDispatch", BooleanValue (directDispatch));
+  dev1->GetMac ()->SetAttribute ("DirectDispatch", BooleanValue (directDispatch));
+  dev0->GetMac ()->SetMcpsDataConfirmCallback (MakeCallback (&LrWpanDirectDispatchTestCase::DataConfirm, this));
+  dev1->GetMac ()->SetMcpsDataIndicationCallback (MakeCallback (&LrWpanDirectDispatchTestCase::DataIndication, this));
+
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstAddr = Mac16Address ("00:02");
+  params.m_txOptions = TX_OPTION_ACK;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      params.m_msduHandle = i;
+      Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (20));
+    }
+
+  Simulator::Run ();
+  m_dispatched = dev0->GetMac ()->GetDispatchedTransitions () + dev1->GetMac ()->GetDispatchedTransitions ();
+  Simulator::Destroy ();
+}
+
+void
+LrWpanDirectDispatchTestCase::DoRun (void)
+{
+  RunScenario (false);
+  NS_TEST_ASSERT_MSG_EQ (m_dispatched, 0, "Work dispatched without direct dispatch");
+  std::vector<Time> rxTimes = m_rxTimes;
+  std::vector<Time> confirmTimes = m_confirmTimes;
+  NS_TEST_ASSERT_MSG_EQ (rxTimes.size (), 4, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (confirmTimes.size (), 4, "Wrong number of confirmed packets");
+
+  // The state changes happen at the same times, only without scheduling them.
+  RunScenario (true);
+  NS_TEST_ASSERT_MSG_GT (m_dispatched, 0, "No work dispatched with direct dispatch");
+  NS_TEST_ASSERT_MSG_EQ (m_rxTimes.size (), rxTimes.size (), "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirmTimes.size (), confirmTimes.size (), "Wrong number of confirmed packets");
+  for (uint32_t i = 0; i < m_rxTimes.size () && i < rxTimes.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_rxTimes[i], rxTimes[i], "Wrong reception time of packet " << i);
+    }
+  for (uint32_t i = 0; i < m_confirmTimes.size () && i < confirmTimes.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_confirmTimes[i], confirmTimes[i], "Wrong confirmation time of packet " << i);
+    }
+}
+
+class LrWpanDirectDispatchTestSuite : public TestSuite
+{
+public:
+  LrWpanDirectDispatchTestSuite ();
+};
+
+LrWpanDirectDispatchTestSuite::LrWpanDirectDispatchTestSuite ()
+  : TestSuite ("lr-wpan-direct-dispatch", UNIT)
+{
+  AddTestCase (new LrWpanWorkQueueTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanDirectDispatchTestCase, TestCase::QUICK);
+}
+
+static LrWpanDirectDispatchTestSuite g_lrWpanDirectDispatchTestSuite;
@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/boolean.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include "lr-wpan-test-pair.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-duty-cycle-test");
+
+class LrWpanDutyCycleTestCase : public TestCase
+{
+public:
+  LrWpanDutyCycleTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void DataIndication (McpsDataIndicationParams params, Ptr<Packet> p);
+  void DataConfirm (McpsDataConfirmParams params);
+  void MacTx (Ptr<const Packet> p);
+  void RunScenario (bool dutyCycle, bool ack);
+
+  uint32_t m_rxPackets;
+  uint32_t m_txFrames;
+  std::vector<LrWpanMcpsDataConfirmStatus> m_confirms;
+  Time m_listenTime;
+  Time m_sleepTime;
+};
+
+LrWpanDutyCycleTestCase::LrWpanDutyCycleTestCase ()
+  : TestCase ("Test the duty cycling of the 802.15.4 MAC")
+{
+}
+
+void
+LrWpanDutyCycleTestCase::DataIndication (McpsDataIndicationParams params, Ptr<Packet> p)
+{
+  m_rxPackets++;
+}
+
+void
+LrWpanDutyCycleTestCase::DataConfirm (McpsDataConfirmParams params)
+{
+  m_confirms.push_back (params.m_status);
+}
+
+void
+LrWpanDutyCycleTestCase::MacTx (Ptr<const Packet> p)
+{
+  m_txFrames++;
+}
+
+void
+LrWpanDutyCycleTestCase::RunScenario (bool dutyCycle, bool ack)
+{
+  m_rxPackets = 0;
+  m_txFrames = 0;
+  m_confirms.clear ();
+
+  LrWpanTestPair pair;
+  Ptr<LrWpanNetDevice> dev0 = pair.dev0;
+  Ptr<LrWpanNetDevice> dev1 = pair.dev1;
+  dev0->AssignStreams (0);
+  dev1->AssignStreams (10);
+
+  dev0->GetMac ()->SetAttribute ("DutyCycle", BooleanValue (dutyCycle));
+  dev1->GetMac ()->SetAttribute ("DutyCycle", BooleanValue (dutyCycle));
+  dev0->GetMac ()->SetAttribute ("WakeupInterval", TimeValue (MilliSeconds (100)));
+  dev1->GetMac ()->SetAttribute ("WakeupInterval", TimeValue (MilliSeconds (100)));
+  dev0->GetMac ()->SetAttribute ("ListenWindow", TimeValue (MilliSeconds (5)));
+  dev1->GetMac ()->SetAttribute ("ListenWindow", TimeValue (MilliSeconds (5)));
+  dev0->GetMac ()->SetMcpsDataConfirmCallback (MakeCallback (&LrWpanDutyCycleTestCase::DataConfirm, this));
+  dev0->GetMac ()->TraceConnectWithoutContext ("MacTx", MakeCallback (&LrWpanDutyCycleTestCase::MacTx, this));
+  dev1->GetMac ()->SetMcpsDataIndicationCallback (MakeCallback (&LrWpanDutyCycleTestCase::DataIndication, this));
+
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstAddr = Mac16Address ("00:02");
+  params.m_msduHandle = 0;
+  params.m_txOptions = ack ? TX_OPTION_ACK : TX_OPTION_NONE;
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (20));
+
+  // The listen windows never stop.
+  Simulator::Stop (Seconds (2.0));
+  Simulator::Run ();
+
+  Ptr<LrWpanPhy> phy1 = dev1->GetPhy ();
+  m_listenTime = phy1->GetTrxStateTime (IEEE_802_15_4_PHY_RX_ON) + phy1->GetTrxStateTime (IEEE_802_15_4_PHY_BUSY_RX);
+  m_sleepTime = phy1->GetTrxStateTime (IEEE_802_15_4_PHY_TRX_OFF);
+
+  Simulator::Destroy ();
+}
+
+void
+LrWpanDutyCycleTestCase::DoRun (void)
+{
+  // Without duty cycling, the receiver is always on.
+  RunScenario (false, true);
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 1, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_txFrames, 1, "Wrong number of sent frames");
+  NS_TEST_ASSERT_MSG_EQ (m_sleepTime, Seconds (0), "The receiver was switched off");
+
+  // The acknowledged frame is strobed until the receiver wakes up, and the
+  // strobe ends with the ACK. The receiver listens about 5 ms every 100 ms.
+  RunScenario (true, true);
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 1, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms.size (), 1, "Wrong number of confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms[0], IEEE_802_15_4_SUCCESS, "The strobed frame was not acknowledged");
+  NS_TEST_ASSERT_MSG_GT (m_sleepTime, 10 * m_listenTime, "The receiver listened too long");
+  NS_TEST_ASSERT_MSG_LT (m_listenTime, MilliSeconds (200), "The receiver listened too long");
+
+  // An unacknowledged frame is strobed for a whole wakeup interval, and only
+  // indicated once.
+  RunScenario (true, false);
+  NS_TEST_ASSERT_MSG_GT (m_txFrames, 1, "The frame was not strobed");
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 1, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms.size (), 1, "Wrong number of confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms[0], IEEE_802_15_4_SUCCESS, "The strobed frame was not confirmed");
+}
+
+class LrWpanDutyCycleTestSuite : public TestSuite
+{
+public:
+  LrWpanDutyCycleTestSuite ();
+};
+
+LrWpanDutyCycleTestSuite::LrWpanDutyCycleTestSuite ()
+  : TestSuite ("lr-wpan-duty-cycle", UNIT)
+{
+  AddTestCase (new LrWpanDutyCycleTestCase, TestCase::QUICK);
+}
+
+static LrWpanDutyCycleTestSuite g_lrWpanDutyCycleTestSuite;
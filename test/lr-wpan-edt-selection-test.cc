@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/node.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <map>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-edt-selection-test");
+
+class LrWpanEdtSelectionPolicyTestCase : public TestCase
+{
+public:
+  LrWpanEdtSelectionPolicyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  static void Answer (LrWpanEdtSelectionPolicyTestCase *test, Mac16Address edt, Mac16Address sensor, Time offset);
+
+  std::map<Mac16Address, Time> m_offsets;
+  Time m_answerTime;
+};
+
+LrWpanEdtSelectionPolicyTestCase::LrWpanEdtSelectionPolicyTestCase ()
+  : TestCase ("Test the top-K and phase-aligned EDT selection policies")
+{
+}
+
+void
+LrWpanEdtSelectionPolicyTestCase::Answer (LrWpanEdtSelectionPolicyTestCase *test, Mac16Address edt, Mac16Address sensor, Time offset)
+{
+  test->m_offsets[edt] = offset;
+  test->m_answerTime = Simulator::Now ();
+}
+
+void
+LrWpanEdtSelectionPolicyTestCase::DoRun (void)
+{
+  Mac16Address sensor ("00:01");
+  Mac16Address edt1 ("00:11");
+  Mac16Address edt2 ("00:12");
+  Mac16Address edt3 ("00:13");
+
+  // The two strongest EDTs answer after the collection window, in the probe
+  // slot. The repeated report of edt1 replaces the first one.
+  Ptr<LrWpanTopKEdtSelectionPolicy> topK = CreateObject<LrWpanTopKEdtSelectionPolicy> ();
+  topK->SetAttribute ("K", UintegerValue (2));
+  topK->AddCandidate (sensor, edt1, -60.0, 1, MicroSeconds (0), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt1));
+  topK->AddCandidate (sensor, edt2, -40.0, 2, MicroSeconds (10), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt2));
+  topK->AddCandidate (sensor, edt3, -50.0, 1, MicroSeconds (0), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt3));
+  topK->AddCandidate (sensor, edt1, -70.0, 1, MicroSeconds (0), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt1));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_answerTime, MicroSeconds (1), "Not selected after the collection window");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets.size (), 2, "Wrong number of selected EDTs");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets.count (edt1), 0, "The weakest EDT was selected");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets[edt2], MicroSeconds (10), "Wrong offset of the second group");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets[edt3], MicroSeconds (0), "Wrong offset of the first group");
+
+  // All EDTs in phase answer together.
+  m_offsets.clear ();
+  Ptr<LrWpanPhaseAlignedEdtSelectionPolicy> aligned = CreateObject<LrWpanPhaseAlignedEdtSelectionPolicy> ();
+  aligned->AddCandidate (sensor, edt1, -60.0, 1, MicroSeconds (0), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt1));
+  aligned->AddCandidate (sensor, edt2, -40.0, 2, MicroSeconds (10), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt2));
+  aligned->AddCandidate (sensor, edt3, -50.0, 1, MicroSeconds (0), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt3));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_offsets.size (), 2, "Wrong number of EDTs in phase");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets.count (edt2), 0, "An EDT out of phase was selected");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets[edt1], MicroSeconds (0), "EDTs in phase do not start together");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets[edt3], MicroSeconds (0), "EDTs in phase do not start together");
+
+  // Without an EDT in phase, the strongest one answers alone.
+  m_offsets.clear ();
+  aligned->AddCandidate (sensor, edt1, -60.0, 2, MicroSeconds (10), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt1));
+  aligned->AddCandidate (sensor, edt2, -40.0, 2, MicroSeconds (10), MakeBoundCallback (&LrWpanEdtSelectionPolicyTestCase::Answer, this, edt2));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_offsets.size (), 1, "Wrong number of EDTs without phase alignment");
+  NS_TEST_ASSERT_MSG_EQ (m_offsets.count (edt2), 1, "The strongest EDT was not selected");
+
+  Simulator::Destroy ();
+}
+
+class LrWpanEdtSelectionTestCase : public TestCase
+{
+public:
+  LrWpanEdtSelectionTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Selection (Mac16Address sensor, uint32_t candidates, uint32_t selected);
+  static void EnergyTx (LrWpanEdtSelectionTestCase *test, uint32_t edt, Ptr<const Packet> p, Time duration);
+
+  uint32_t m_candidates;
+  uint32_t m_selected;
+  std::vector<uint32_t> m_energyTx;
+};
+
+LrWpanEdtSelectionTestCase::LrWpanEdtSelectionTestCase ()
+  : TestCase ("Test that only the selected EDTs answer an RFE"),
+    m_candidates (0),
+    m_selected (0),
+    m_energyTx (3, 0)
+{
+}
+
+void
+LrWpanEdtSelectionTestCase::Selection (Mac16Address sensor, uint32_t candidates, uint32_t selected)
+{
+  m_candidates = candidates;
+  m_selected = selected;
+}
+
+void
+LrWpanEdtSelectionTestCase::EnergyTx (LrWpanEdtSelectionTestCase *test, uint32_t edt, Ptr<const Packet> p, Time duration)
+{
+  test->m_energyTx[edt]++;
+}
+
+void
+LrWpanEdtSelectionTestCase::DoRun (void)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  Ptr<Node> sensorNode = CreateObject<Node> ();
+  Ptr<LrWpanSensorNetDevice> sensor = CreateObject<LrWpanSensorNetDevice> ();
+  sensor->SetAddress (Mac16Address ("00:01"));
+  sensor->SetChannel (channel);
+  sensorNode->AddDevice (sensor);
+  sensor->GetPhy ()->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+
+  // The EDTs are 1, 2 and 3 m away, only the nearest one is selected.
+  Ptr<LrWpanTopKEdtSelectionPolicy> policy = CreateObject<LrWpanTopKEdtSelectionPolicy> ();
+  policy->SetAttribute ("K", UintegerValue (1));
+  policy->TraceConnectWithoutContext ("Selection", MakeCallback (&LrWpanEdtSelectionTestCase::Selection, this));
+  const char *addresses[] = { "00:11", "00:12", "00:13" };
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<LrWpanEdtNetDevice> edt = CreateObject<LrWpanEdtNetDevice> ();
+      edt->SetAddress (Mac16Address (addresses[i]));
+      edt->SetChannel (channel);
+      node->AddDevice (edt);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (1.0 + i, 0, 0));
+      edt->GetPhy ()->SetMobility (mobility);
+      edt->GetMac ()->SetEdtSelectionPolicy (policy);
+      edt->GetMac ()->TraceConnectWithoutContext ("RfMacEnergyTx", MakeBoundCallback (&LrWpanEdtSelectionTestCase::EnergyTx, this, i));
+    }
+
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::SendRfeForEnergy, sensor->GetMac ());
+
+  Simulator::Stop (Seconds (2.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_candidates, 3, "Not all EDTs received the RFE");
+  NS_TEST_ASSERT_MSG_EQ (m_selected, 1, "Wrong number of selected EDTs");
+  NS_TEST_ASSERT_MSG_GT (m_energyTx[0], 0, "The nearest EDT did not answer");
+  NS_TEST_ASSERT_MSG_EQ (m_energyTx[1], 0, "An EDT which was not selected answered");
+  NS_TEST_ASSERT_MSG_EQ (m_energyTx[2], 0, "An EDT which was not selected answered");
+}
+
+class LrWpanEdtSelectionTestSuite : public TestSuite
+{
+public:
+  LrWpanEdtSelectionTestSuite ();
+};
+
+LrWpanEdtSelectionTestSuite::LrWpanEdtSelectionTestSuite ()
+  : TestSuite ("lr-wpan-edt-selection", UNIT)
+{
+  AddTestCase (new LrWpanEdtSelectionPolicyTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanEdtSelectionTestCase, TestCase::QUICK);
+}
+
+static LrWpanEdtSelectionTestSuite g_lrWpanEdtSelectionTestSuite;
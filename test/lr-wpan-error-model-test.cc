@@ -31,6 +31,7 @@
 #include <ns3/single-model-spectrum-channel.h>
 #include <ns3/mac16-address.h>
 #include <ns3/constant-position-mobility-model.h>
+#include <ns3/boolean.h>
 #include "ns3/rng-seed-manager.h"
 
 using namespace ns3;
@@ -63,6 +64,16 @@ private:
   virtual void DoRun (void);
 };
 
+class LrWpanErrorModelTabulatedTestCase : public TestCase
+{
+public:
+  LrWpanErrorModelTabulatedTestCase ();
+  virtual ~LrWpanErrorModelTabulatedTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
 LrWpanErrorDistanceTestCase::LrWpanErrorDistanceTestCase ()
   : TestCase ("Test the 802.15.4 error model vs distance"),
     m_received (0)
@@ -175,6 +186,47 @@ LrWpanErrorModelTestCase::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (ber, 0.175, 0.001, "Model fails for SNR = " << snr);
 }
 
+// ==============================================================================
+LrWpanErrorModelTabulatedTestCase::LrWpanErrorModelTabulatedTestCase ()
+  : TestCase ("Test the tabulated 802.15.4 error model against the exact model")
+{
+}
+
+LrWpanErrorModelTabulatedTestCase::~LrWpanErrorModelTabulatedTestCase ()
+{
+}
+
+void
+LrWpanErrorModelTabulatedTestCase::DoRun (void)
+{
+  Ptr<LrWpanErrorModel> exact = CreateObject<LrWpanErrorModel> ();
+  Ptr<LrWpanErrorModel> tabulated = CreateObject<LrWpanErrorModel> ();
+  tabulated->SetAttribute ("Tabulated", BooleanValue (true));
+
+  uint32_t chunkSizes[] = { 1, 8, 160, 1064, 8192 };
+
+  // Check the documented error bounds, also beyond the end of the table.
+  for (double snrDb = -20; snrDb <= 15; snrDb += 0.01)
+    {
+      double snr = pow (10.0, snrDb / 10.0);
+
+      double ber = 1.0 - exact->GetChunkSuccessRate (snr, 1);
+      if (ber > 1e-9)
+        {
+          double tabulatedBer = 1.0 - tabulated->GetChunkSuccessRate (snr, 1);
+          NS_TEST_ASSERT_MSG_EQ_TOL (tabulatedBer, ber, ber * 1e-4, "BER out of bounds for SNR = " << snrDb);
+        }
+
+      for (uint32_t i = 0; i < sizeof (chunkSizes) / sizeof (chunkSizes[0]); i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ_TOL (tabulated->GetChunkSuccessRate (snr, chunkSizes[i]),
+                                     exact->GetChunkSuccessRate (snr, chunkSizes[i]),
+                                     5e-5,
+                                     "Chunk success rate out of bounds for SNR = " << snrDb << " and " << chunkSizes[i] << " bits");
+        }
+    }
+}
+
 // ==============================================================================
 class LrWpanErrorModelTestSuite : public TestSuite
 {
@@ -186,6 +238,7 @@ LrWpanErrorModelTestSuite::LrWpanErrorModelTestSuite ()
   : TestSuite ("lr-wpan-error-model", UNIT)
 {
   AddTestCase (new LrWpanErrorModelTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanErrorModelTabulatedTestCase, TestCase::QUICK);
   AddTestCase (new LrWpanErrorDistanceTestCase, TestCase::QUICK);
 }
 
@@ -0,0 +1,207 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/uinteger.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include "lr-wpan-test-pair.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-indirect-test");
+
+class LrWpanIndirectTestCase : public TestCase
+{
+public:
+  LrWpanIndirectTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void DataIndication (McpsDataIndicationParams params, Ptr<Packet> p);
+  void DataConfirm (McpsDataConfirmParams params);
+  void PollConfirm (MlmePollConfirmParams params);
+  void DeviceRx (Ptr<const Packet> p);
+  void CoordinatorTx (Ptr<const Packet> p);
+  void RunScenario (uint64_t persistenceTime, bool overflow);
+
+  uint32_t m_rxPackets;
+  uint32_t m_coordinatorTxFrames;
+  std::vector<bool> m_framePending;
+  std::vector<std::pair<uint8_t, LrWpanMcpsDataConfirmStatus> > m_dataConfirms;
+  std::vector<LrWpanMlmePollConfirmStatus> m_pollConfirms;
+  Time m_listenTime;
+};
+
+LrWpanIndirectTestCase::LrWpanIndirectTestCase ()
+  : TestCase ("Test the indirect transmission of the 802.15.4 MAC")
+{
+}
+
+void
+LrWpanIndirectTestCase::DataIndication (McpsDataIndicationParams params, Ptr<Packet> p)
+{
+  m_rxPackets++;
+}
+
+void
+LrWpanIndirectTestCase::DataConfirm (McpsDataConfirmParams params)
+{
+  m_dataConfirms.push_back (std::make_pair (params.m_msduHandle, params.m_status));
+}
+
+void
+LrWpanIndirectTestCase::PollConfirm (MlmePollConfirmParams params)
+{
+  m_pollConfirms.push_back (params.m_status);
+}
+
+void
+LrWpanIndirectTestCase::DeviceRx (Ptr<const Packet> p)
+{
+  LrWpanMacHeader macHdr;
+  p->PeekHeader (macHdr);
+  if (macHdr.IsData ())
+    {
+      m_framePending.push_back (macHdr.IsFrmPend ());
+    }
+}
+
+void
+LrWpanIndirectTestCase::CoordinatorTx (Ptr<const Packet> p)
+{
+  m_coordinatorTxFrames++;
+}
+
+void
+LrWpanIndirectTestCase::RunScenario (uint64_t persistenceTime, bool overflow)
+{
+  m_rxPackets = 0;
+  m_coordinatorTxFrames = 0;
+  m_framePending.clear ();
+  m_dataConfirms.clear ();
+  m_pollConfirms.clear ();
+
+  LrWpanTestPair pair;
+  Ptr<LrWpanNetDevice> coordinator = pair.dev0;
+  Ptr<LrWpanNetDevice> device = pair.dev1;
+  coordinator->AssignStreams (0);
+  device->AssignStreams (10);
+
+  coordinator->GetMac ()->SetAttribute ("MaxPendingTransactions", UintegerValue (2));
+  coordinator->GetMac ()->SetAttribute ("TransactionPersistenceTime", UintegerValue (persistenceTime));
+  coordinator->GetMac ()->SetMcpsDataConfirmCallback (MakeCallback (&LrWpanIndirectTestCase::DataConfirm, this));
+  coordinator->GetMac ()->TraceConnectWithoutContext ("MacTx", MakeCallback (&LrWpanIndirectTestCase::CoordinatorTx, this));
+  device->GetMac ()->SetRxOnWhenIdle (false);
+  device->GetMac ()->SetMcpsDataIndicationCallback (MakeCallback (&LrWpanIndirectTestCase::DataIndication, this));
+  device->GetMac ()->SetMlmePollConfirmCallback (MakeCallback (&LrWpanIndirectTestCase::PollConfirm, this));
+  device->GetMac ()->TraceConnectWithoutContext ("MacRx", MakeCallback (&LrWpanIndirectTestCase::DeviceRx, this));
+
+  // Three frames for the sleeping device, one more than can be pending.
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstAddr = Mac16Address ("00:02");
+  params.m_txOptions = TX_OPTION_INDIRECT | TX_OPTION_ACK;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      params.m_msduHandle = i;
+      Simulator::Schedule (Seconds (0.1), &LrWpanMac::McpsDataRequest, coordinator->GetMac (), params, Create<Packet> (20));
+    }
+
+  MlmePollRequestParams pollParams;
+  pollParams.m_coordShortAddr = Mac16Address ("00:01");
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Simulator::Schedule (Seconds (1.0 + 0.5 * i), &LrWpanMac::MlmePollRequest, device->GetMac (), pollParams);
+    }
+  if (overflow)
+    {
+      // A second data request does not fit in the queue of the device.
+      device->GetMac ()->SetAttribute ("MaxQueueSize", UintegerValue (1));
+      Simulator::Schedule (Seconds (1.0), &LrWpanMac::MlmePollRequest, device->GetMac (), pollParams);
+    }
+
+  Simulator::Stop (Seconds (3.0));
+  Simulator::Run ();
+
+  Ptr<LrWpanPhy> phy1 = device->GetPhy ();
+  m_listenTime = phy1->GetTrxStateTime (IEEE_802_15_4_PHY_RX_ON) + phy1->GetTrxStateTime (IEEE_802_15_4_PHY_BUSY_RX);
+  NS_TEST_ASSERT_MSG_EQ (coordinator->GetMac ()->GetPendingTransactions (), 0, "Transactions left pending");
+
+  Simulator::Destroy ();
+}
+
+void
+LrWpanIndirectTestCase::DoRun (void)
+{
+  // The two pending frames are sent one per poll, the first one announcing
+  // the second. The third poll finds no data. Nothing is sent before the
+  // polls but the ACKs.
+  RunScenario (0x01f4, false);
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms.size (), 3, "Wrong number of data confirms");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (m_dataConfirms[0].first), 2, "Wrong transaction dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms[0].second, IEEE_802_15_4_TRANSACTION_OVERFLOW, "The third transaction did not overflow");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (m_dataConfirms[1].first), 0, "Wrong order of the pending transactions");
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms[1].second, IEEE_802_15_4_SUCCESS, "The first transaction was not acknowledged");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (m_dataConfirms[2].first), 1, "Wrong order of the pending transactions");
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms[2].second, IEEE_802_15_4_SUCCESS, "The second transaction was not acknowledged");
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 2, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_framePending.size (), 2, "Wrong number of received frames");
+  NS_TEST_ASSERT_MSG_EQ (m_framePending[0], true, "The first frame did not announce the second");
+  NS_TEST_ASSERT_MSG_EQ (m_framePending[1], false, "The last frame announced more data");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms.size (), 3, "Wrong number of poll confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms[0], MLMEPOLL_SUCCESS, "The first poll failed");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms[1], MLMEPOLL_SUCCESS, "The second poll failed");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms[2], MLMEPOLL_NO_DATA, "The third poll found data");
+  NS_TEST_ASSERT_MSG_EQ (m_coordinatorTxFrames, 5, "Wrong number of frames sent by the coordinator");
+  NS_TEST_ASSERT_MSG_LT (m_listenTime, MilliSeconds (100), "The device listened too long");
+
+  // The transactions expire after 10 unit periods of 15.36 ms, before the
+  // first poll.
+  RunScenario (10, false);
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms.size (), 3, "Wrong number of data confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms[1].second, IEEE_802_15_4_TRANSACTION_EXPIRED, "The first transaction did not expire");
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms[2].second, IEEE_802_15_4_TRANSACTION_EXPIRED, "The second transaction did not expire");
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 0, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms.size (), 3, "Wrong number of poll confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms[0], MLMEPOLL_NO_DATA, "The first poll found data");
+
+  // The overflow of a data request is confirmed as a poll, not as data.
+  RunScenario (0x01f4, true);
+  NS_TEST_ASSERT_MSG_EQ (m_dataConfirms.size (), 3, "Wrong number of data confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 2, "Wrong number of received packets");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms.size (), 4, "Wrong number of poll confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms[0], MLMEPOLL_TRANSACTION_OVERFLOW, "The second data request did not overflow");
+  NS_TEST_ASSERT_MSG_EQ (m_pollConfirms[1], MLMEPOLL_SUCCESS, "The first poll failed");
+}
+
+class LrWpanIndirectTestSuite : public TestSuite
+{
+public:
+  LrWpanIndirectTestSuite ();
+};
+
+LrWpanIndirectTestSuite::LrWpanIndirectTestSuite ()
+  : TestSuite ("lr-wpan-indirect", UNIT)
+{
+  AddTestCase (new LrWpanIndirectTestCase, TestCase::QUICK);
+}
+
+static LrWpanIndirectTestSuite g_lrWpanIndirectTestSuite;
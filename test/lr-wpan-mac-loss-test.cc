@@ -0,0 +1,202 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/double.h>
+#include <ns3/enum.h>
+#include <ns3/pointer.h>
+#include <ns3/simulator.h>
+#include <ns3/error-model.h>
+#include <ns3/lr-wpan-module.h>
+#include "lr-wpan-test-pair.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-mac-loss-test");
+
+class LrWpanGilbertElliottTestCase : public TestCase
+{
+public:
+  LrWpanGilbertElliottTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LrWpanGilbertElliottTestCase::LrWpanGilbertElliottTestCase ()
+  : TestCase ("Test the Gilbert-Elliott receive loss model")
+{
+}
+
+void
+LrWpanGilbertElliottTestCase::DoRun (void)
+{
+  Ptr<Packet> p = Create<Packet> (20);
+
+  // With certain transitions, the channel alternates between the states and
+  // every other packet is lost.
+  Ptr<LrWpanGilbertElliottErrorModel> em = CreateObject<LrWpanGilbertElliottErrorModel> ();
+  em->SetAttribute ("GoodToBad", DoubleValue (1.0));
+  em->SetAttribute ("BadToGood", DoubleValue (1.0));
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (em->IsCorrupt (p), (i % 2) == 1, "Wrong loss of packet " << i);
+    }
+  em->Reset ();
+  NS_TEST_ASSERT_MSG_EQ (em->IsBad (), false, "The channel is not good after a reset");
+
+  // The same stream gives the same bursts.
+  Ptr<LrWpanGilbertElliottErrorModel> em0 = CreateObject<LrWpanGilbertElliottErrorModel> ();
+  Ptr<LrWpanGilbertElliottErrorModel> em1 = CreateObject<LrWpanGilbertElliottErrorModel> ();
+  NS_TEST_ASSERT_MSG_EQ (em0->AssignStreams (7), 1, "Wrong number of assigned streams");
+  em1->AssignStreams (7);
+  uint32_t losses = 0;
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      bool corrupt = em0->IsCorrupt (p);
+      NS_TEST_ASSERT_MSG_EQ (em1->IsCorrupt (p), corrupt, "Different losses with the same stream");
+      losses += corrupt ? 1 : 0;
+    }
+  // The default model spends 1/11 of the time in the bad state.
+  NS_TEST_ASSERT_MSG_GT (losses, 0, "No packet lost");
+  NS_TEST_ASSERT_MSG_LT (losses, 300, "Too many packets lost");
+}
+
+class LrWpanMacReceiveLossTestCase : public TestCase
+{
+public:
+  LrWpanMacReceiveLossTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void DataIndication (McpsDataIndicationParams params, Ptr<Packet> p);
+  void RxDrop (Ptr<const Packet> p);
+  void RunScenario (Ptr<ErrorModel> em);
+
+  uint32_t m_rxPackets;
+  uint32_t m_rxDrops;
+};
+
+LrWpanMacReceiveLossTestCase::LrWpanMacReceiveLossTestCase ()
+  : TestCase ("Test the receive error model of the 802.15.4 MAC")
+{
+}
+
+void
+LrWpanMacReceiveLossTestCase::DataIndication (McpsDataIndicationParams params, Ptr<Packet> p)
+{
+  m_rxPackets++;
+}
+
+void
+LrWpanMacReceiveLossTestCase::RxDrop (Ptr<const Packet> p)
+{
+  m_rxDrops++;
+}
+
+void
+LrWpanMacReceiveLossTestCase::RunScenario (Ptr<ErrorModel> em)
+{
+  m_rxPackets = 0;
+  m_rxDrops = 0;
+
+  LrWpanTestPair pair;
+  Ptr<LrWpanNetDevice> dev0 = pair.dev0;
+  Ptr<LrWpanNetDevice> dev1 = pair.dev1;
+
+  dev1->GetMac ()->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+  dev1->GetMac ()->SetMcpsDataIndicationCallback (MakeCallback (&LrWpanMacReceiveLossTestCase::DataIndication, this));
+  dev1->GetMac ()->TraceConnectWithoutContext ("MacRxDrop", MakeCallback (&LrWpanMacReceiveLossTestCase::RxDrop, this));
+
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstAddr = Mac16Address ("00:02");
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      params.m_msduHandle = i;
+      Simulator::Schedule (Seconds (1.0 + i), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (20));
+    }
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+LrWpanMacReceiveLossTestCase::DoRun (void)
+{
+  // No losses by default.
+  RunScenario (0);
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 5, "Packets lost without an error model");
+  NS_TEST_ASSERT_MSG_EQ (m_rxDrops, 0, "Packets dropped without an error model");
+
+  // Every data frame is lost.
+  Ptr<RateErrorModel> em = CreateObject<RateErrorModel> ();
+  em->SetUnit (RateErrorModel::ERROR_UNIT_PACKET);
+  em->SetRate (1.0);
+  RunScenario (em);
+  NS_TEST_ASSERT_MSG_EQ (m_rxPackets, 0, "Packets received through the error model");
+  NS_TEST_ASSERT_MSG_EQ (m_rxDrops, 5, "Wrong number of dropped packets");
+}
+
+class LrWpanMacLossStreamsTestCase : public TestCase
+{
+public:
+  LrWpanMacLossStreamsTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LrWpanMacLossStreamsTestCase::LrWpanMacLossStreamsTestCase ()
+  : TestCase ("Test the streams assigned to the receive error model of the 802.15.4 MAC")
+{
+}
+
+void
+LrWpanMacLossStreamsTestCase::DoRun (void)
+{
+  // The MAC itself takes one stream, a BurstErrorModel two more.
+  Ptr<LrWpanMac> mac = CreateObject<LrWpanMac> ();
+  NS_TEST_ASSERT_MSG_EQ (mac->AssignStreams (0), 1, "Wrong number of streams without an error model");
+  mac->SetAttribute ("ReceiveErrorModel", PointerValue (CreateObject<RateErrorModel> ()));
+  NS_TEST_ASSERT_MSG_EQ (mac->AssignStreams (0), 2, "No stream assigned to the RateErrorModel");
+  mac->SetAttribute ("ReceiveErrorModel", PointerValue (CreateObject<BurstErrorModel> ()));
+  NS_TEST_ASSERT_MSG_EQ (mac->AssignStreams (0), 3, "No streams assigned to the BurstErrorModel");
+  mac->SetAttribute ("ReceiveErrorModel", PointerValue (CreateObject<LrWpanGilbertElliottErrorModel> ()));
+  NS_TEST_ASSERT_MSG_EQ (mac->AssignStreams (0), 2, "No stream assigned to the LrWpanGilbertElliottErrorModel");
+  mac->SetAttribute ("ReceiveErrorModel", PointerValue (CreateObject<ReceiveListErrorModel> ()));
+  NS_TEST_ASSERT_MSG_EQ (mac->AssignStreams (0), 1, "A stream assigned to a deterministic error model");
+  mac->Dispose ();
+}
+
+class LrWpanMacLossTestSuite : public TestSuite
+{
+public:
+  LrWpanMacLossTestSuite ();
+};
+
+LrWpanMacLossTestSuite::LrWpanMacLossTestSuite ()
+  : TestSuite ("lr-wpan-mac-loss", UNIT)
+{
+  AddTestCase (new LrWpanGilbertElliottTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanMacReceiveLossTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanMacLossStreamsTestCase, TestCase::QUICK);
+}
+
+static LrWpanMacLossTestSuite g_lrWpanMacLossTestSuite;
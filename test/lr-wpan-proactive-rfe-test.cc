@@ -0,0 +1,137 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/node.h>
+#include <ns3/nstime.h>
+#include <ns3/boolean.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <cmath>
+#include <string>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-proactive-rfe-test");
+
+class LrWpanProactiveRfeTestCase : public TestCase
+{
+public:
+  /**
+   * \param name the description of the test case
+   * \param proactive the ProactiveRequests of the sensor
+   */
+  LrWpanProactiveRfeTestCase (std::string name, bool proactive);
+
+private:
+  virtual void DoRun (void);
+  void EnergyTx (Ptr<const Packet> p, Time duration);
+
+  bool m_proactive;
+  uint32_t m_energyTx;
+  Time m_firstEnergyTx;
+};
+
+LrWpanProactiveRfeTestCase::LrWpanProactiveRfeTestCase (std::string name, bool proactive)
+  : TestCase (name),
+    m_proactive (proactive),
+    m_energyTx (0)
+{
+}
+
+void
+LrWpanProactiveRfeTestCase::EnergyTx (Ptr<const Packet> p, Time duration)
+{
+  if (m_energyTx++ == 0)
+    {
+      m_firstEnergyTx = Simulator::Now ();
+    }
+}
+
+void
+LrWpanProactiveRfeTestCase::DoRun (void)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  Ptr<Node> sensorNode = CreateObject<Node> ();
+  Ptr<LrWpanSensorNetDevice> sensor = CreateObject<LrWpanSensorNetDevice> ();
+  sensor->SetAddress (Mac16Address ("00:01"));
+  sensor->SetChannel (channel);
+  sensorNode->AddDevice (sensor);
+  sensor->GetPhy ()->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+  sensor->SetAttribute ("ProactiveRequests", BooleanValue (m_proactive));
+  sensor->SetAttribute ("UpdateInterval", TimeValue (MilliSeconds (100)));
+
+  // The random advance of the requests takes one stream beyond the ones of
+  // the device.
+  int64_t streams = sensor->AssignStreams (0);
+  NS_TEST_ASSERT_MSG_EQ (streams, CreateObject<LrWpanNetDevice> ()->AssignStreams (0) + 1, "The random advance was not assigned a stream");
+
+  // 2 mJ above the minimum threshold voltage, consumed at 1 mW: the
+  // sensor browns out after 2 s, and requests 0.5 to 0.6 s before.
+  double capacity = 36;
+  sensor->m_currentVoltage = std::sqrt (sensor->m_minThresholdVoltage * sensor->m_minThresholdVoltage + 2 * 2e-3 / capacity);
+  for (uint32_t i = 1; i <= 300; i++)
+    {
+      Simulator::Schedule (MilliSeconds (10 * i), &LrWpanSensorNetDevice::RfMacEnergyConsumtion, sensor, 1e-5);
+    }
+
+  Ptr<Node> edtNode = CreateObject<Node> ();
+  Ptr<LrWpanEdtNetDevice> edt = CreateObject<LrWpanEdtNetDevice> ();
+  edt->SetAddress (Mac16Address ("00:11"));
+  edt->SetChannel (channel);
+  edtNode->AddDevice (edt);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (Vector (1.0, 0, 0));
+  edt->GetPhy ()->SetMobility (mobility);
+  edt->GetMac ()->TraceConnectWithoutContext ("RfMacEnergyTx", MakeCallback (&LrWpanProactiveRfeTestCase::EnergyTx, this));
+
+  Simulator::Stop (Seconds (3.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  if (m_proactive)
+    {
+      NS_TEST_ASSERT_MSG_GT (m_energyTx, 0, "The sensor did not request energy");
+      NS_TEST_ASSERT_MSG_GT (m_firstEnergyTx, Seconds (1.0), "The sensor requested energy too early");
+      NS_TEST_ASSERT_MSG_LT (m_firstEnergyTx, Seconds (2.0), "The sensor requested energy after the brown-out");
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_energyTx, 0, "The sensor requested energy on its own");
+    }
+}
+
+class LrWpanProactiveRfeTestSuite : public TestSuite
+{
+public:
+  LrWpanProactiveRfeTestSuite ();
+};
+
+LrWpanProactiveRfeTestSuite::LrWpanProactiveRfeTestSuite ()
+  : TestSuite ("lr-wpan-proactive-rfe", UNIT)
+{
+  AddTestCase (new LrWpanProactiveRfeTestCase ("Test that a sensor requests energy ahead of its brown-out", true), TestCase::QUICK);
+  AddTestCase (new LrWpanProactiveRfeTestCase ("Test that a sensor only requests energy on demand by default", false), TestCase::QUICK);
+}
+
+static LrWpanProactiveRfeTestSuite g_lrWpanProactiveRfeTestSuite;
@@ -0,0 +1,246 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/node.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-probe-slot-test");
+
+class LrWpanProbeSlotMappingTestCase : public TestCase
+{
+public:
+  LrWpanProbeSlotMappingTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LrWpanProbeSlotMappingTestCase::LrWpanProbeSlotMappingTestCase ()
+  : TestCase ("Test the probe slots of the EDTs by phase")
+{
+}
+
+void
+LrWpanProbeSlotMappingTestCase::DoRun (void)
+{
+  // Two slots are the two phase groups.
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.0, 2)), 1, "Wrong slot in phase");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.25, 2)), 1, "Wrong slot in phase");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.3, 2)), 2, "Wrong slot out of phase");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.99, 2)), 2, "Wrong slot out of phase");
+
+  // With four slots, the EDTs out of phase are spread over three slots.
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.1, 4)), 1, "Wrong slot in phase");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.2, 4)), 2, "Wrong second slot");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.5, 4)), 3, "Wrong third slot");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (LrWpanMac::GetProbeSlot (0.95, 4)), 4, "Wrong last slot");
+
+  RfMacProbeTag tag;
+  tag.SetSelected (0x0005);
+  NS_TEST_ASSERT_MSG_EQ (tag.IsSelected (1), true, "Slot 1 not selected");
+  NS_TEST_ASSERT_MSG_EQ (tag.IsSelected (2), false, "Slot 2 selected");
+  NS_TEST_ASSERT_MSG_EQ (tag.IsSelected (3), true, "Slot 3 not selected");
+}
+
+class LrWpanProbeSlotSelectionTestCase : public TestCase
+{
+public:
+  LrWpanProbeSlotSelectionTestCase ();
+
+private:
+  virtual void DoRun (void);
+  static void EnergyTx (LrWpanProbeSlotSelectionTestCase *test, uint32_t edt, Ptr<const Packet> p, Time duration);
+  void ChargeCycle (double energy, Time chargingTime);
+
+  std::vector<uint32_t> m_energyTx;
+  uint32_t m_chargeCycles;
+};
+
+LrWpanProbeSlotSelectionTestCase::LrWpanProbeSlotSelectionTestCase ()
+  : TestCase ("Test that only the EDTs of the selected probe slots send the energy pulse"),
+    m_energyTx (2, 0),
+    m_chargeCycles (0)
+{
+}
+
+void
+LrWpanProbeSlotSelectionTestCase::EnergyTx (LrWpanProbeSlotSelectionTestCase *test, uint32_t edt, Ptr<const Packet> p, Time duration)
+{
+  test->m_energyTx[edt]++;
+}
+
+void
+LrWpanProbeSlotSelectionTestCase::ChargeCycle (double energy, Time chargingTime)
+{
+  m_chargeCycles++;
+}
+
+void
+LrWpanProbeSlotSelectionTestCase::DoRun (void)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  // Only the strongest probe slot is selected.
+  Ptr<Node> sensorNode = CreateObject<Node> ();
+  Ptr<LrWpanSensorNetDevice> sensor = CreateObject<LrWpanSensorNetDevice> ();
+  sensor->SetAddress (Mac16Address ("00:01"));
+  sensor->SetChannel (channel);
+  sensorNode->AddDevice (sensor);
+  sensor->GetPhy ()->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+  sensor->GetMac ()->SetAttribute ("ProbeSlotThreshold", DoubleValue (1.0));
+  sensor->GetMac ()->TraceConnectWithoutContext ("RfMacChargeCycle", MakeCallback (&LrWpanProbeSlotSelectionTestCase::ChargeCycle, this));
+
+  // The near EDT is at 7.1 wavelengths, in phase, and probes in slot 1. The
+  // far EDT is at 14.5 wavelengths and probes in slot 3 of 4.
+  const char *addresses[] = { "00:11", "00:12" };
+  double distances[] = { 7.1 * 0.145, 14.5 * 0.145 };
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<LrWpanEdtNetDevice> edt = CreateObject<LrWpanEdtNetDevice> ();
+      edt->SetAddress (Mac16Address (addresses[i]));
+      edt->SetChannel (channel);
+      node->AddDevice (edt);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (distances[i], 0, 0));
+      edt->GetPhy ()->SetMobility (mobility);
+      edt->GetMac ()->SetAttribute ("ProbeSlots", UintegerValue (4));
+      edt->GetMac ()->TraceConnectWithoutContext ("RfMacEnergyTx", MakeBoundCallback (&LrWpanProbeSlotSelectionTestCase::EnergyTx, this, i));
+    }
+
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::SendRfeForEnergy, sensor->GetMac ());
+
+  Simulator::Stop (Seconds (2.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (sensor->GetPhy ()->GetProbeSlots ()), 4, "Wrong number of probe slots");
+
+  Simulator::Destroy ();
+
+  // Both EDTs send a CFE, only the near one the energy pulse.
+  NS_TEST_ASSERT_MSG_EQ (m_energyTx[0], 2, "The EDT of the selected slot did not send the energy pulse");
+  NS_TEST_ASSERT_MSG_EQ (m_energyTx[1], 1, "The EDT of a slot which was not selected sent the energy pulse");
+  NS_TEST_ASSERT_MSG_EQ (m_chargeCycles, 1, "The sensor was not charged");
+}
+
+class LrWpanProbeSlotOutOfPhaseTestCase : public TestCase
+{
+public:
+  /**
+   * \param name the description of the test case
+   * \param policy select the EDT with the phase-aligned policy
+   */
+  LrWpanProbeSlotOutOfPhaseTestCase (std::string name, bool policy);
+
+private:
+  virtual void DoRun (void);
+  void EnergyTx (Ptr<const Packet> p, Time duration);
+  void ChargeCycle (double energy, Time chargingTime);
+
+  bool m_policy;
+  uint32_t m_energyTx;
+  uint32_t m_chargeCycles;
+};
+
+LrWpanProbeSlotOutOfPhaseTestCase::LrWpanProbeSlotOutOfPhaseTestCase (std::string name, bool policy)
+  : TestCase (name),
+    m_policy (policy),
+    m_energyTx (0),
+    m_chargeCycles (0)
+{
+}
+
+void
+LrWpanProbeSlotOutOfPhaseTestCase::EnergyTx (Ptr<const Packet> p, Time duration)
+{
+  m_energyTx++;
+}
+
+void
+LrWpanProbeSlotOutOfPhaseTestCase::ChargeCycle (double energy, Time chargingTime)
+{
+  m_chargeCycles++;
+}
+
+void
+LrWpanProbeSlotOutOfPhaseTestCase::DoRun (void)
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LogDistancePropagationLossModel> ());
+
+  Ptr<Node> sensorNode = CreateObject<Node> ();
+  Ptr<LrWpanSensorNetDevice> sensor = CreateObject<LrWpanSensorNetDevice> ();
+  sensor->SetAddress (Mac16Address ("00:01"));
+  sensor->SetChannel (channel);
+  sensorNode->AddDevice (sensor);
+  sensor->GetPhy ()->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+  sensor->GetMac ()->TraceConnectWithoutContext ("RfMacChargeCycle", MakeCallback (&LrWpanProbeSlotOutOfPhaseTestCase::ChargeCycle, this));
+
+  // The only EDT is at 7.5 wavelengths, out of phase, and probes in slot 2.
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LrWpanEdtNetDevice> edt = CreateObject<LrWpanEdtNetDevice> ();
+  edt->SetAddress (Mac16Address ("00:11"));
+  edt->SetChannel (channel);
+  node->AddDevice (edt);
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (Vector (7.5 * 0.145, 0, 0));
+  edt->GetPhy ()->SetMobility (mobility);
+  if (m_policy)
+    {
+      edt->GetMac ()->SetEdtSelectionPolicy (CreateObject<LrWpanPhaseAlignedEdtSelectionPolicy> ());
+    }
+  edt->GetMac ()->TraceConnectWithoutContext ("RfMacEnergyTx", MakeCallback (&LrWpanProbeSlotOutOfPhaseTestCase::EnergyTx, this));
+
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::SendRfeForEnergy, sensor->GetMac ());
+
+  Simulator::Stop (Seconds (2.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_energyTx, 2, "The EDT out of phase did not send the CFE and the energy pulse");
+  NS_TEST_ASSERT_MSG_EQ (m_chargeCycles, 1, "The sensor was not charged");
+}
+
+class LrWpanProbeSlotTestSuite : public TestSuite
+{
+public:
+  LrWpanProbeSlotTestSuite ();
+};
+
+LrWpanProbeSlotTestSuite::LrWpanProbeSlotTestSuite ()
+  : TestSuite ("lr-wpan-probe-slot", UNIT)
+{
+  AddTestCase (new LrWpanProbeSlotMappingTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanProbeSlotSelectionTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanProbeSlotOutOfPhaseTestCase ("Test that an EDT out of phase charges the sensor", false), TestCase::QUICK);
+  AddTestCase (new LrWpanProbeSlotOutOfPhaseTestCase ("Test that the strongest EDT out of phase charges the sensor with the phase-aligned policy", true), TestCase::QUICK);
+}
+
+static LrWpanProbeSlotTestSuite g_lrWpanProbeSlotTestSuite;
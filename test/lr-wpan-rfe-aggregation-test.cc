@@ -0,0 +1,190 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/node.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/propagation-loss-model.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-rfe-aggregation-test");
+
+class LrWpanRequesterTagTestCase : public TestCase
+{
+public:
+  LrWpanRequesterTagTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LrWpanRequesterTagTestCase::LrWpanRequesterTagTestCase ()
+  : TestCase ("Test the requester list of the multicast CFE")
+{
+}
+
+void
+LrWpanRequesterTagTestCase::DoRun (void)
+{
+  Ptr<Packet> p = Create<Packet> (0);
+  RfMacRequesterTag tag;
+  tag.AddRequester (Mac16Address ("00:01"));
+  tag.AddRequester (Mac16Address ("00:02"));
+  tag.AddRequester (Mac16Address ("00:03"));
+  p->AddPacketTag (tag);
+
+  RfMacRequesterTag received;
+  NS_TEST_ASSERT_MSG_EQ (p->PeekPacketTag (received), true, "No requester tag");
+  NS_TEST_ASSERT_MSG_EQ (received.GetRequesters ().size (), 3, "Wrong number of requesters");
+
+  uint32_t index = 0;
+  NS_TEST_ASSERT_MSG_EQ (received.GetIndex (Mac16Address ("00:03"), index), true, "Requester not listed");
+  NS_TEST_ASSERT_MSG_EQ (index, 2, "Wrong position of the requester");
+  NS_TEST_ASSERT_MSG_EQ (received.GetIndex (Mac16Address ("00:04"), index), false, "Unknown sensor listed");
+}
+
+class LrWpanRfeAggregationTestCase : public TestCase
+{
+public:
+  /**
+   * \param name the description of the test case
+   * \param wavelengths the distance of the second sensor, in wavelengths
+   * \param energyTx the expected number of CFEs and energy pulses
+   */
+  LrWpanRfeAggregationTestCase (std::string name, double wavelengths, uint32_t energyTx);
+
+private:
+  virtual void DoRun (void);
+  void EnergyTx (Ptr<const Packet> p, Time duration);
+  static void ChargeCycle (LrWpanRfeAggregationTestCase *test, uint32_t sensor, double energy, Time chargingTime);
+
+  double m_wavelengths;
+  uint32_t m_expectedEnergyTx;
+  uint32_t m_energyTx;
+  Time m_pulseDuration;
+  std::vector<uint32_t> m_chargeCycles;
+  std::vector<Time> m_chargingTimes;
+};
+
+LrWpanRfeAggregationTestCase::LrWpanRfeAggregationTestCase (std::string name, double wavelengths, uint32_t energyTx)
+  : TestCase (name),
+    m_wavelengths (wavelengths),
+    m_expectedEnergyTx (energyTx),
+    m_energyTx (0),
+    m_chargeCycles (2, 0),
+    m_chargingTimes (2)
+{
+}
+
+void
+LrWpanRfeAggregationTestCase::EnergyTx (Ptr<const Packet> p, Time duration)
+{
+  m_energyTx++;
+  m_pulseDuration = duration;
+}
+
+void
+LrWpanRfeAggregationTestCase::ChargeCycle (LrWpanRfeAggregationTestCase *test, uint32_t sensor, double energy, Time chargingTime)
+{
+  test->m_chargeCycles[sensor]++;
+  test->m_chargingTimes[sensor] = chargingTime;
+}
+
+void
+LrWpanRfeAggregationTestCase::DoRun (void)
+{
+  // The sensors reach the EDT, but not each other, so the second RFE is not
+  // suppressed by the first one.
+  Ptr<MatrixPropagationLossModel> loss = CreateObject<MatrixPropagationLossModel> ();
+  loss->SetDefaultLoss (1000);
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  channel->AddPropagationLossModel (loss);
+
+  Ptr<Node> edtNode = CreateObject<Node> ();
+  Ptr<LrWpanEdtNetDevice> edt = CreateObject<LrWpanEdtNetDevice> ();
+  edt->SetAddress (Mac16Address ("00:11"));
+  edt->SetChannel (channel);
+  edtNode->AddDevice (edt);
+  Ptr<ConstantPositionMobilityModel> edtMobility = CreateObject<ConstantPositionMobilityModel> ();
+  edt->GetPhy ()->SetMobility (edtMobility);
+  edt->GetMac ()->SetAttribute ("RfeAggregationWindow", TimeValue (MilliSeconds (1)));
+  edt->GetMac ()->TraceConnectWithoutContext ("RfMacEnergyTx", MakeCallback (&LrWpanRfeAggregationTestCase::EnergyTx, this));
+
+  // The first sensor is 7 wavelengths away, in phase with the EDT, at 40 dB,
+  // the second one at 46 dB.
+  const char *addresses[] = { "00:01", "00:02" };
+  Vector positions[] = { Vector (7 * 0.145, 0, 0), Vector (0, m_wavelengths * 0.145, 0) };
+  double losses[] = { 40, 46 };
+  std::vector<Ptr<LrWpanSensorNetDevice> > sensors;
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<Node> node = CreateObject<Node> ();
+      Ptr<LrWpanSensorNetDevice> sensor = CreateObject<LrWpanSensorNetDevice> ();
+      sensor->SetAddress (Mac16Address (addresses[i]));
+      sensor->SetChannel (channel);
+      node->AddDevice (sensor);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (positions[i]);
+      sensor->GetPhy ()->SetMobility (mobility);
+      loss->SetLoss (mobility, edtMobility, losses[i]);
+      sensor->GetMac ()->TraceConnectWithoutContext ("RfMacChargeCycle", MakeBoundCallback (&LrWpanRfeAggregationTestCase::ChargeCycle, this, i));
+      sensors.push_back (sensor);
+    }
+
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::SendRfeForEnergy, sensors[0]->GetMac ());
+  Simulator::Schedule (Seconds (1.0005), &LrWpanMac::SendRfeForEnergy, sensors[1]->GetMac ());
+
+  Simulator::Stop (Seconds (3.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_energyTx, m_expectedEnergyTx, "Wrong number of CFEs and energy pulses");
+  NS_TEST_ASSERT_MSG_EQ (m_chargeCycles[0], 1, "The first sensor was not charged");
+  NS_TEST_ASSERT_MSG_EQ (m_chargeCycles[1], 1, "The second sensor was not charged");
+  if (m_expectedEnergyTx == 2)
+    {
+      // One energy pulse, as long as the longest charging time.
+      NS_TEST_ASSERT_MSG_GT (m_chargingTimes[1], m_chargingTimes[0], "The far sensor needs a longer charge");
+      NS_TEST_ASSERT_MSG_EQ (m_pulseDuration, m_chargingTimes[1], "The energy pulse is not sized to the longest charging time");
+    }
+}
+
+class LrWpanRfeAggregationTestSuite : public TestSuite
+{
+public:
+  LrWpanRfeAggregationTestSuite ();
+};
+
+LrWpanRfeAggregationTestSuite::LrWpanRfeAggregationTestSuite ()
+  : TestSuite ("lr-wpan-rfe-aggregation", UNIT)
+{
+  AddTestCase (new LrWpanRequesterTagTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanRfeAggregationTestCase ("Test that one energy pulse answers the RFEs of an aggregation window", 7.0, 2), TestCase::QUICK);
+  // At 7.5 wavelengths the second sensor is out of phase, in probe slot 2,
+  // and gets its own CFE and energy pulse.
+  AddTestCase (new LrWpanRfeAggregationTestCase ("Test that the RFEs of different probe slots are answered apart", 7.5, 4), TestCase::QUICK);
+}
+
+static LrWpanRfeAggregationTestSuite g_lrWpanRfeAggregationTestSuite;
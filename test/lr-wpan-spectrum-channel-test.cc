@@ -0,0 +1,423 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/packet.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/mobility-module.h>
+#include <ns3/propagation-module.h>
+#include <ns3/mac16-address.h>
+#include <ns3/log.h>
+#include <ns3/boolean.h>
+#include <ns3/double.h>
+
+#include <cmath>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-spectrum-channel-test");
+
+/**
+ * A distance based propagation loss model, counting how often it is
+ * evaluated.
+ */
+class LrWpanCountingLossModel : public PropagationLossModel
+{
+public:
+  LrWpanCountingLossModel ()
+    : m_calls (0)
+  {
+  }
+  uint32_t GetCalls (void) const
+  {
+    return m_calls;
+  }
+  static double GetLoss (double distance)
+  {
+    return 40.0 + 20.0 * std::log10 (distance);
+  }
+
+private:
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+  {
+    m_calls++;
+    return txPowerDbm - GetLoss (a->GetDistanceFrom (b));
+  }
+  virtual int64_t DoAssignStreams (int64_t stream)
+  {
+    return 0;
+  }
+  mutable uint32_t m_calls;
+};
+
+class LrWpanSpectrumChannelTestCase : public TestCase
+{
+public:
+  LrWpanSpectrumChannelTestCase ();
+  virtual ~LrWpanSpectrumChannelTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void PathLoss (Ptr<const SpectrumPhy> txPhy, Ptr<const SpectrumPhy> rxPhy, double lossDb);
+
+  std::vector<double> m_pathLoss;
+};
+
+LrWpanSpectrumChannelTestCase::LrWpanSpectrumChannelTestCase ()
+  : TestCase ("Test the link budget cache of the LrWpanSpectrumChannel")
+{
+}
+
+LrWpanSpectrumChannelTestCase::~LrWpanSpectrumChannelTestCase ()
+{
+}
+
+void
+LrWpanSpectrumChannelTestCase::PathLoss (Ptr<const SpectrumPhy> txPhy, Ptr<const SpectrumPhy> rxPhy, double lossDb)
+{
+  m_pathLoss.push_back (lossDb);
+}
+
+void
+LrWpanSpectrumChannelTestCase::DoRun (void)
+{
+  Ptr<Node> n0 = CreateObject <Node> ();
+  Ptr<Node> n1 = CreateObject <Node> ();
+  Ptr<LrWpanNetDevice> dev0 = CreateObject<LrWpanNetDevice> ();
+  Ptr<LrWpanNetDevice> dev1 = CreateObject<LrWpanNetDevice> ();
+  dev0->SetAddress (Mac16Address ("00:01"));
+  dev1->SetAddress (Mac16Address ("00:02"));
+
+  Ptr<LrWpanSpectrumChannel> channel = CreateObject<LrWpanSpectrumChannel> ();
+  Ptr<LrWpanCountingLossModel> model = CreateObject<LrWpanCountingLossModel> ();
+  channel->AddPropagationLossModel (model);
+  channel->TraceConnectWithoutContext ("PathLoss", MakeCallback (&LrWpanSpectrumChannelTestCase::PathLoss, this));
+
+  dev0->SetChannel (channel);
+  dev1->SetChannel (channel);
+  n0->AddDevice (dev0);
+  n1->AddDevice (dev1);
+
+  Ptr<ConstantPositionMobilityModel> mob0 = CreateObject<ConstantPositionMobilityModel> ();
+  mob0->SetPosition (Vector (0, 0, 0));
+  dev0->GetPhy ()->SetMobility (mob0);
+  Ptr<ConstantPositionMobilityModel> mob1 = CreateObject<ConstantPositionMobilityModel> ();
+  mob1->SetPosition (Vector (10, 0, 0));
+  dev1->GetPhy ()->SetMobility (mob1);
+
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstPanId = 0;
+  params.m_dstAddr = Mac16Address ("00:02");
+  params.m_msduHandle = 0;
+  params.m_txOptions = 0;
+
+  // Two transmissions over the same link, then the receiver moves and the
+  // link is used again.
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (20));
+  Simulator::Schedule (Seconds (2.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (20));
+  Simulator::Schedule (Seconds (3.0), &ConstantPositionMobilityModel::SetPosition, mob1, Vector (20, 0, 0));
+  Simulator::Schedule (Seconds (4.0), &LrWpanMac::McpsDataRequest, dev0->GetMac (), params, Create<Packet> (20));
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_pathLoss.size (), 3, "Wrong number of transmissions");
+  NS_TEST_ASSERT_MSG_EQ (model->GetCalls (), 2, "The link budget was not cached, or not invalidated on movement");
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_pathLoss[0], LrWpanCountingLossModel::GetLoss (10), 1e-9, "Wrong path loss before movement");
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_pathLoss[1], LrWpanCountingLossModel::GetLoss (10), 1e-9, "Wrong cached path loss");
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_pathLoss[2], LrWpanCountingLossModel::GetLoss (20), 1e-9, "Wrong path loss after movement");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * A SpectrumPhy recording the PSDs of the received signals.
+ */
+class LrWpanPsdRecordingPhy : public SpectrumPhy
+{
+public:
+  LrWpanPsdRecordingPhy ()
+    : m_hold (false)
+  {
+  }
+  virtual void SetDevice (Ptr<NetDevice> d)
+  {
+  }
+  virtual Ptr<NetDevice> GetDevice (void) const
+  {
+    return 0;
+  }
+  virtual void SetMobility (Ptr<MobilityModel> m)
+  {
+    m_mobility = m;
+  }
+  virtual Ptr<MobilityModel> GetMobility (void)
+  {
+    return m_mobility;
+  }
+  virtual void SetChannel (Ptr<SpectrumChannel> c)
+  {
+  }
+  virtual Ptr<const SpectrumModel> GetRxSpectrumModel (void) const
+  {
+    return 0;
+  }
+  virtual Ptr<AntennaModel> GetRxAntenna (void)
+  {
+    return 0;
+  }
+  virtual void StartRx (Ptr<SpectrumSignalParameters> params)
+  {
+    m_psds.push_back (PeekPointer (params->psd));
+    m_powers.push_back (LrWpanSpectrumValueHelper::TotalAvgPower (params->psd, 11));
+    if (m_hold)
+      {
+        m_held.push_back (params);
+      }
+  }
+  /**
+   * Keep the received signals, like a reception in progress.
+   *
+   * \param hold true to keep the following signals, false to release them
+   */
+  void SetHold (bool hold)
+  {
+    m_hold = hold;
+    if (!hold)
+      {
+        m_held.clear ();
+      }
+  }
+
+  std::vector<const SpectrumValue *> m_psds;
+  std::vector<double> m_powers;
+
+private:
+  Ptr<MobilityModel> m_mobility;
+  bool m_hold;
+  std::vector<Ptr<SpectrumSignalParameters> > m_held;
+};
+
+class LrWpanSpectrumChannelRxPsdTestCase : public TestCase
+{
+public:
+  LrWpanSpectrumChannelRxPsdTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LrWpanSpectrumChannelRxPsdTestCase::LrWpanSpectrumChannelRxPsdTestCase ()
+  : TestCase ("Test the received PSD cache of the LrWpanSpectrumChannel")
+{
+}
+
+void
+LrWpanSpectrumChannelRxPsdTestCase::DoRun (void)
+{
+  Ptr<LrWpanSpectrumChannel> channel = CreateObject<LrWpanSpectrumChannel> ();
+  channel->AddPropagationLossModel (CreateObject<LrWpanCountingLossModel> ());
+
+  Ptr<LrWpanPsdRecordingPhy> txPhy = CreateObject<LrWpanPsdRecordingPhy> ();
+  txPhy->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+  Ptr<LrWpanPsdRecordingPhy> rxPhy = CreateObject<LrWpanPsdRecordingPhy> ();
+  Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+  mobility->SetPosition (Vector (10, 0, 0));
+  rxPhy->SetMobility (mobility);
+  channel->AddRx (txPhy);
+  channel->AddRx (rxPhy);
+
+  LrWpanSpectrumValueHelper psdHelper;
+  Ptr<SpectrumValue> psds[] = { psdHelper.CreateTxPowerSpectralDensity (0, 11),
+                                psdHelper.CreateTxPowerSpectralDensity (10, 11) };
+  // Two signals over the link, one received while the previous one is held,
+  // and one at a higher transmit power.
+  uint32_t powerIndex[] = { 0, 0, 0, 0, 1 };
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      Ptr<LrWpanSpectrumSignalParameters> params = Create<LrWpanSpectrumSignalParameters> ();
+      params->psd = psds[powerIndex[i]];
+      params->duration = MilliSeconds (1);
+      params->txPhy = txPhy;
+      params->packet = Create<Packet> (10);
+      Simulator::Schedule (Seconds (1.0 + i), &LrWpanSpectrumChannel::StartTx, channel, params);
+    }
+  Simulator::Schedule (Seconds (2.5), &LrWpanPsdRecordingPhy::SetHold, rxPhy, true);
+  Simulator::Schedule (Seconds (4.5), &LrWpanPsdRecordingPhy::SetHold, rxPhy, false);
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (rxPhy->m_psds.size (), 5, "Wrong number of received signals");
+  NS_TEST_ASSERT_MSG_EQ (txPhy->m_psds.size (), 0, "The transmitter received its own signal");
+  NS_TEST_ASSERT_MSG_EQ ((rxPhy->m_psds[1] == rxPhy->m_psds[0]), true, "The received PSD was not shared");
+  NS_TEST_ASSERT_MSG_EQ ((rxPhy->m_psds[2] == rxPhy->m_psds[0]), true, "The received PSD was not shared");
+  NS_TEST_ASSERT_MSG_EQ ((rxPhy->m_psds[3] != rxPhy->m_psds[2]), true, "The PSD of a held signal was shared");
+  double gain = std::pow (10.0, -LrWpanCountingLossModel::GetLoss (10) / 10.0);
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      double expected = LrWpanSpectrumValueHelper::TotalAvgPower (psds[powerIndex[i]], 11) * gain;
+      NS_TEST_ASSERT_MSG_EQ_TOL (rxPhy->m_powers[i], expected, expected * 1e-6, "Wrong received power");
+    }
+
+  Simulator::Destroy ();
+}
+
+class LrWpanSpectrumChannelCullingTestCase : public TestCase
+{
+public:
+  LrWpanSpectrumChannelCullingTestCase ();
+  virtual ~LrWpanSpectrumChannelCullingTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void PathLoss (Ptr<const SpectrumPhy> txPhy, Ptr<const SpectrumPhy> rxPhy, double lossDb);
+  void TxBegin (Ptr<const Packet> p);
+  void SampleFarField (void);
+
+  Ptr<LrWpanSpectrumChannel> m_channel;
+  std::vector<Ptr<LrWpanNetDevice> > m_devices;
+  std::vector<uint32_t> m_deliveries;
+  std::vector<double> m_txFarField;
+  std::vector<double> m_idleFarField;
+};
+
+LrWpanSpectrumChannelCullingTestCase::LrWpanSpectrumChannelCullingTestCase ()
+  : TestCase ("Test the receiver culling of the LrWpanSpectrumChannel")
+{
+}
+
+LrWpanSpectrumChannelCullingTestCase::~LrWpanSpectrumChannelCullingTestCase ()
+{
+}
+
+void
+LrWpanSpectrumChannelCullingTestCase::PathLoss (Ptr<const SpectrumPhy> txPhy, Ptr<const SpectrumPhy> rxPhy, double lossDb)
+{
+  for (uint32_t i = 0; i < m_devices.size (); i++)
+    {
+      if (m_devices[i]->GetPhy () == rxPhy)
+        {
+          m_deliveries[i]++;
+        }
+    }
+}
+
+void
+LrWpanSpectrumChannelCullingTestCase::TxBegin (Ptr<const Packet> p)
+{
+  for (uint32_t i = 0; i < m_devices.size (); i++)
+    {
+      m_txFarField[i] = m_channel->GetFarFieldPower (m_devices[i]->GetPhy (), 11);
+    }
+}
+
+void
+LrWpanSpectrumChannelCullingTestCase::SampleFarField (void)
+{
+  for (uint32_t i = 0; i < m_devices.size (); i++)
+    {
+      m_idleFarField[i] = m_channel->GetFarFieldPower (m_devices[i]->GetPhy (), 11);
+    }
+}
+
+void
+LrWpanSpectrumChannelCullingTestCase::DoRun (void)
+{
+  // With 0 dBm transmit power and a floor of -60 dBm, the cutoff radius of
+  // the loss model is 10 m. Device 1 is in range, device 2 is in a neighbor
+  // cell but out of range, device 3 is in a far cell of a neighbor block of
+  // 4 x 4 cells, device 4 is in a far block.
+  double positions[5] = { 0.0, 5.0, 15.0, 45.0, 100.0 };
+
+  m_channel = CreateObject<LrWpanSpectrumChannel> ();
+  m_channel->SetAttribute ("ReceiverCulling", BooleanValue (true));
+  m_channel->SetAttribute ("MaxTxPower", DoubleValue (0.0));
+  m_channel->SetAttribute ("RxPowerFloor", DoubleValue (-60.0));
+  m_channel->AddPropagationLossModel (CreateObject<LrWpanCountingLossModel> ());
+  m_channel->TraceConnectWithoutContext ("PathLoss", MakeCallback (&LrWpanSpectrumChannelCullingTestCase::PathLoss, this));
+
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      Ptr<Node> node = CreateObject <Node> ();
+      Ptr<LrWpanNetDevice> dev = CreateObject<LrWpanNetDevice> ();
+      dev->SetAddress (Mac16Address::Allocate ());
+      dev->SetChannel (m_channel);
+      node->AddDevice (dev);
+      Ptr<ConstantPositionMobilityModel> mob = CreateObject<ConstantPositionMobilityModel> ();
+      mob->SetPosition (Vector (positions[i], 0, 0));
+      dev->GetPhy ()->SetMobility (mob);
+      m_devices.push_back (dev);
+    }
+  m_deliveries.assign (5, 0);
+  m_txFarField.assign (5, 0.0);
+  m_idleFarField.assign (5, 0.0);
+  m_devices[0]->GetPhy ()->TraceConnectWithoutContext ("PhyTxBegin", MakeCallback (&LrWpanSpectrumChannelCullingTestCase::TxBegin, this));
+
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstPanId = 0;
+  params.m_dstAddr = Mac16Address ("ff:ff");
+  params.m_msduHandle = 0;
+  params.m_txOptions = 0;
+
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, m_devices[0]->GetMac (), params, Create<Packet> (20));
+  Simulator::Schedule (Seconds (2.0), &LrWpanSpectrumChannelCullingTestCase::SampleFarField, this);
+
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_channel->GetCutoffRadius (), 10.0, 1e-2, "Wrong cutoff radius");
+  NS_TEST_ASSERT_MSG_EQ (m_deliveries[1], 1, "Signal not delivered within the cutoff radius");
+  NS_TEST_ASSERT_MSG_EQ (m_deliveries[2], 1, "Link budget of the neighbor cell not evaluated");
+  NS_TEST_ASSERT_MSG_EQ (m_deliveries[3], 0, "Link budget of the far cell evaluated");
+  NS_TEST_ASSERT_MSG_EQ (m_deliveries[4], 0, "Link budget of the far block evaluated");
+  NS_TEST_ASSERT_MSG_EQ (m_txFarField[1], 0.0, "Far-field power for a delivered signal");
+  NS_TEST_ASSERT_MSG_GT (m_txFarField[2], 0.0, "No far-field power for the culled receiver");
+  NS_TEST_ASSERT_MSG_GT (m_txFarField[3], 0.0, "No far-field power for the far cell");
+  NS_TEST_ASSERT_MSG_GT (m_txFarField[4], 0.0, "No far-field power for the far block");
+  NS_TEST_ASSERT_MSG_GT (m_txFarField[2], m_txFarField[3], "Far-field power not decreasing with distance");
+  NS_TEST_ASSERT_MSG_GT (m_txFarField[3], m_txFarField[4], "Far-field power not decreasing with distance");
+  for (uint32_t i = 0; i < 5; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_idleFarField[i], 0.0, "Far-field power remaining after the transmission");
+    }
+
+  // A lower floor extends the cutoff radius to 100 m.
+  m_channel->SetAttribute ("RxPowerFloor", DoubleValue (-80.0));
+  NS_TEST_ASSERT_MSG_EQ_TOL (m_channel->GetCutoffRadius (), 100.0, 1e-2, "Cutoff radius not recomputed");
+
+  m_devices.clear ();
+  m_channel = 0;
+  Simulator::Destroy ();
+}
+
+// ==============================================================================
+class LrWpanSpectrumChannelTestSuite : public TestSuite
+{
+public:
+  LrWpanSpectrumChannelTestSuite ();
+};
+
+LrWpanSpectrumChannelTestSuite::LrWpanSpectrumChannelTestSuite ()
+  : TestSuite ("lr-wpan-spectrum-channel", UNIT)
+{
+  AddTestCase (new LrWpanSpectrumChannelTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanSpectrumChannelRxPsdTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanSpectrumChannelCullingTestCase, TestCase::QUICK);
+}
+
+static LrWpanSpectrumChannelTestSuite lrWpanSpectrumChannelTestSuite;
@@ -20,6 +20,7 @@
 #include <ns3/log.h>
 #include <ns3/test.h>
 #include <ns3/lr-wpan-spectrum-value-helper.h>
+#include <ns3/lr-wpan-channel-psd.h>
 #include <ns3/spectrum-value.h>
 
 #include <cmath>
@@ -60,7 +61,24 @@ LrWpanSpectrumValueHelperTestCase::DoRun (void)
           pwrWatts = pow (10.0, pwrdBm / 10.0) / 1000;
           // Test that average power calculation is within +/- 25% of expected
           NS_TEST_ASSERT_MSG_EQ_TOL (helper.TotalAvgPower (value, chan), pwrWatts, pwrWatts / 4.0, "Not equal for channel " << chan << " pwrdBm " << pwrdBm);
+
+          // The compact PSD has to find the channel and has to carry exactly
+          // the same power.
+          LrWpanChannelPsd compact = LrWpanChannelPsd::FromSpectrumValue (value);
+          NS_TEST_ASSERT_MSG_EQ (compact.GetChannel (), chan, "Wrong channel of compact PSD for channel " << chan);
+          NS_TEST_ASSERT_MSG_EQ (compact.TotalAvgPower (chan), helper.TotalAvgPower (value, chan), "Compact PSD power not equal for channel " << chan << " pwrdBm " << pwrdBm);
+          if (chan > 11)
+            {
+              NS_TEST_ASSERT_MSG_EQ (compact.TotalAvgPower (chan - 1), 0.0, "Compact PSD leaks into channel " << chan - 1);
+            }
+
+          // The shared PSD has to equal a newly created one, and has to be
+          // handed out only once per power and channel.
+          Ptr<const SpectrumValue> shared = helper.GetTxPowerSpectralDensity (pwrdBm, chan);
+          NS_TEST_ASSERT_MSG_EQ (helper.TotalAvgPower (shared, chan), helper.TotalAvgPower (value, chan), "Shared PSD power not equal for channel " << chan << " pwrdBm " << pwrdBm);
+          NS_TEST_ASSERT_MSG_EQ (shared, helper.GetTxPowerSpectralDensity (pwrdBm, chan), "Shared PSD not reused for channel " << chan << " pwrdBm " << pwrdBm);
         }
+      NS_TEST_ASSERT_MSG_EQ (helper.GetNoisePowerSpectralDensity (chan), helper.GetNoisePowerSpectralDensity (chan), "Shared noise PSD not reused for channel " << chan);
     }
 }
 
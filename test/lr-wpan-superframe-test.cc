@@ -0,0 +1,224 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/uinteger.h>
+#include <ns3/nstime.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include "lr-wpan-test-pair.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-superframe-test");
+
+class LrWpanBeaconHeaderTestCase : public TestCase
+{
+public:
+  LrWpanBeaconHeaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LrWpanBeaconHeaderTestCase::LrWpanBeaconHeaderTestCase ()
+  : TestCase ("Test the 802.15.4 beacon payload")
+{
+}
+
+void
+LrWpanBeaconHeaderTestCase::DoRun (void)
+{
+  LrWpanBeaconHeader beaconHdr;
+  beaconHdr.SetBeaconOrder (6);
+  beaconHdr.SetSuperframeOrder (4);
+  beaconHdr.SetFinalCapSlot (10);
+  beaconHdr.SetPanCoordinator (true);
+  LrWpanBeaconHeader::GtsDescriptor gts;
+  gts.m_address = Mac16Address ("00:02");
+  gts.m_startSlot = 14;
+  gts.m_length = 2;
+  beaconHdr.AddGts (gts);
+  gts.m_address = Mac16Address ("00:03");
+  gts.m_startSlot = 11;
+  gts.m_length = 3;
+  beaconHdr.AddGts (gts);
+
+  Ptr<Packet> p = Create<Packet> ();
+  p->AddHeader (beaconHdr);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 11, "Wrong beacon payload size");
+
+  LrWpanBeaconHeader receivedHdr;
+  p->RemoveHeader (receivedHdr);
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (receivedHdr.GetBeaconOrder ()), 6, "Wrong beacon order");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (receivedHdr.GetSuperframeOrder ()), 4, "Wrong superframe order");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (receivedHdr.GetFinalCapSlot ()), 10, "Wrong final CAP slot");
+  NS_TEST_ASSERT_MSG_EQ (receivedHdr.IsPanCoordinator (), true, "Wrong PAN coordinator flag");
+  NS_TEST_ASSERT_MSG_EQ (receivedHdr.GetGtsList ().size (), 2, "Wrong number of GTSs");
+  NS_TEST_ASSERT_MSG_EQ (receivedHdr.GetGtsList ()[1].m_address, Mac16Address ("00:03"), "Wrong GTS address");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (receivedHdr.GetGtsList ()[1].m_startSlot), 11, "Wrong GTS start slot");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (receivedHdr.GetGtsList ()[1].m_length), 3, "Wrong GTS length");
+}
+
+class LrWpanSuperframeTestCase : public TestCase
+{
+public:
+  LrWpanSuperframeTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CoordinatorTx (Ptr<const Packet> p);
+  void DeviceTx (Ptr<const Packet> p);
+  void DataConfirm (McpsDataConfirmParams params);
+  void CreateDevices (uint8_t beaconOrder, uint8_t superframeOrder);
+
+  Ptr<LrWpanNetDevice> m_coordinator;
+  Ptr<LrWpanNetDevice> m_device;
+  uint32_t m_beacons;
+  Time m_beaconTxTime;
+  Time m_dataTxTime;
+  std::vector<LrWpanMcpsDataConfirmStatus> m_confirms;
+};
+
+LrWpanSuperframeTestCase::LrWpanSuperframeTestCase ()
+  : TestCase ("Test the slotted CSMA-CA and the GTSs of the 802.15.4 MAC")
+{
+}
+
+void
+LrWpanSuperframeTestCase::CoordinatorTx (Ptr<const Packet> p)
+{
+  LrWpanMacHeader macHdr;
+  p->PeekHeader (macHdr);
+  if (macHdr.IsBeacon ())
+    {
+      m_beacons++;
+      m_beaconTxTime = Simulator::Now ();
+    }
+}
+
+void
+LrWpanSuperframeTestCase::DeviceTx (Ptr<const Packet> p)
+{
+  LrWpanMacHeader macHdr;
+  p->PeekHeader (macHdr);
+  if (macHdr.IsData ())
+    {
+      m_dataTxTime = Simulator::Now ();
+    }
+}
+
+void
+LrWpanSuperframeTestCase::DataConfirm (McpsDataConfirmParams params)
+{
+  m_confirms.push_back (params.m_status);
+}
+
+void
+LrWpanSuperframeTestCase::CreateDevices (uint8_t beaconOrder, uint8_t superframeOrder)
+{
+  m_beacons = 0;
+  m_beaconTxTime = Seconds (0);
+  m_dataTxTime = Seconds (0);
+  m_confirms.clear ();
+
+  LrWpanTestPair pair;
+  m_coordinator = pair.dev0;
+  m_device = pair.dev1;
+  m_coordinator->AssignStreams (0);
+  m_device->AssignStreams (10);
+
+  m_coordinator->GetMac ()->SetAttribute ("BeaconOrder", UintegerValue (beaconOrder));
+  m_coordinator->GetMac ()->SetAttribute ("SuperframeOrder", UintegerValue (superframeOrder));
+  m_coordinator->GetMac ()->TraceConnectWithoutContext ("MacTx", MakeCallback (&LrWpanSuperframeTestCase::CoordinatorTx, this));
+  m_device->GetMac ()->TraceConnectWithoutContext ("MacTx", MakeCallback (&LrWpanSuperframeTestCase::DeviceTx, this));
+  m_device->GetMac ()->SetMcpsDataConfirmCallback (MakeCallback (&LrWpanSuperframeTestCase::DataConfirm, this));
+}
+
+void
+LrWpanSuperframeTestCase::DoRun (void)
+{
+  // Slotted CSMA-CA: a beacon interval of about 983 ms with an active period
+  // of about 246 ms. The frame requested in the inactive period is sent in
+  // the CAP of the next superframe, on a backoff period boundary.
+  CreateDevices (6, 4);
+  McpsDataRequestParams params;
+  params.m_srcAddrMode = SHORT_ADDR;
+  params.m_dstAddrMode = SHORT_ADDR;
+  params.m_dstAddr = Mac16Address ("00:01");
+  params.m_msduHandle = 0;
+  params.m_txOptions = TX_OPTION_NONE;
+  Simulator::Schedule (Seconds (0.5), &LrWpanMac::McpsDataRequest, m_device->GetMac (), params, Create<Packet> (20));
+  Simulator::Stop (Seconds (1.5));
+  Simulator::Run ();
+
+  Time beaconInterval = m_coordinator->GetMac ()->GetBeaconInterval ();
+  NS_TEST_ASSERT_MSG_EQ (m_beacons, 2, "Wrong number of beacons");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms.size (), 1, "Wrong number of confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms[0], IEEE_802_15_4_SUCCESS, "The frame was not sent");
+  NS_TEST_ASSERT_MSG_GT (m_dataTxTime, beaconInterval, "The frame was sent in the inactive period");
+  NS_TEST_ASSERT_MSG_LT (m_dataTxTime, m_coordinator->GetMac ()->GetCapEnd (), "The frame was sent after the CAP");
+  int64_t offset = (m_dataTxTime - m_beaconTxTime).GetNanoSeconds () % 320000;
+  NS_TEST_ASSERT_MSG_EQ ((offset <= 1000 || offset >= 319000), true, "The frame was not sent on a backoff period boundary");
+  Simulator::Destroy ();
+
+  // GTS: the superframe has no inactive period, the last two of its 16 slots
+  // of 15.36 ms are the GTS of the device.
+  CreateDevices (4, 4);
+  Ptr<LrWpanMac> coordinatorMac = m_coordinator->GetMac ();
+  NS_TEST_ASSERT_MSG_EQ (coordinatorMac->AllocateGts (Mac16Address ("00:02"), 2), true, "The GTS was not allocated");
+  NS_TEST_ASSERT_MSG_EQ (coordinatorMac->AllocateGts (Mac16Address ("00:02"), 1), false, "A second GTS was allocated");
+  NS_TEST_ASSERT_MSG_EQ (coordinatorMac->AllocateGts (Mac16Address ("00:04"), 14), false, "The GTS left no CAP");
+  params.m_txOptions = TX_OPTION_GTS | TX_OPTION_ACK;
+  Simulator::Schedule (Seconds (0.1), &LrWpanMac::McpsDataRequest, m_device->GetMac (), params, Create<Packet> (20));
+  Simulator::Stop (Seconds (0.24));
+  Simulator::Run ();
+
+  Time slot = MicroSeconds (15360);
+  NS_TEST_ASSERT_MSG_EQ (m_confirms.size (), 1, "Wrong number of confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms[0], IEEE_802_15_4_SUCCESS, "The GTS frame was not acknowledged");
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (m_dataTxTime, m_beaconTxTime + 14 * slot, "The frame was sent before the GTS");
+  NS_TEST_ASSERT_MSG_LT (m_dataTxTime, m_beaconTxTime + 16 * slot, "The frame was sent after the GTS");
+  Simulator::Destroy ();
+
+  // A device without a GTS cannot use one.
+  CreateDevices (4, 4);
+  m_device->SetAddress (Mac16Address ("00:03"));
+  Simulator::Schedule (Seconds (0.1), &LrWpanMac::McpsDataRequest, m_device->GetMac (), params, Create<Packet> (20));
+  Simulator::Stop (Seconds (0.2));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_confirms.size (), 1, "Wrong number of confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_confirms[0], IEEE_802_15_4_INVALID_GTS, "The frame was accepted without a GTS");
+  Simulator::Destroy ();
+}
+
+class LrWpanSuperframeTestSuite : public TestSuite
+{
+public:
+  LrWpanSuperframeTestSuite ();
+};
+
+LrWpanSuperframeTestSuite::LrWpanSuperframeTestSuite ()
+  : TestSuite ("lr-wpan-superframe", UNIT)
+{
+  AddTestCase (new LrWpanBeaconHeaderTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanSuperframeTestCase, TestCase::QUICK);
+}
+
+static LrWpanSuperframeTestSuite g_lrWpanSuperframeTestSuite;
@@ -0,0 +1,46 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lr-wpan-test-pair.h"
+#include <ns3/node.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/constant-position-mobility-model.h>
+
+namespace ns3 {
+
+LrWpanTestPair::LrWpanTestPair ()
+{
+  Ptr<SingleModelSpectrumChannel> channel = CreateObject<SingleModelSpectrumChannel> ();
+  Ptr<Node> n0 = CreateObject<Node> ();
+  Ptr<Node> n1 = CreateObject<Node> ();
+  dev0 = CreateObject<LrWpanNetDevice> ();
+  dev1 = CreateObject<LrWpanNetDevice> ();
+  dev0->SetAddress (Mac16Address ("00:01"));
+  dev1->SetAddress (Mac16Address ("00:02"));
+  dev0->SetChannel (channel);
+  dev1->SetChannel (channel);
+  n0->AddDevice (dev0);
+  n1->AddDevice (dev1);
+
+  Ptr<ConstantPositionMobilityModel> mobility0 = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> mobility1 = CreateObject<ConstantPositionMobilityModel> ();
+  mobility1->SetPosition (Vector (5, 0, 0));
+  dev0->GetPhy ()->SetMobility (mobility0);
+  dev1->GetPhy ()->SetMobility (mobility1);
+}
+
+} // namespace ns3
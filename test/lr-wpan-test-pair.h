@@ -0,0 +1,41 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LR_WPAN_TEST_PAIR_H
+#define LR_WPAN_TEST_PAIR_H
+
+#include <ns3/ptr.h>
+
+namespace ns3 {
+
+class LrWpanNetDevice;
+
+/**
+ * Two LrWpanNetDevices on their own nodes, 5 m apart on a new
+ * SingleModelSpectrumChannel, as used by the MAC tests. The first one has
+ * the short address 00:01, the second one 00:02.
+ */
+struct LrWpanTestPair
+{
+  LrWpanTestPair ();
+
+  Ptr<LrWpanNetDevice> dev0; //!< The device at the origin, 00:01.
+  Ptr<LrWpanNetDevice> dev1; //!< The device 5 m away, 00:02.
+};
+
+} // namespace ns3
+
+#endif /* LR_WPAN_TEST_PAIR_H */
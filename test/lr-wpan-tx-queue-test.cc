@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/test.h>
+#include <ns3/log.h>
+#include <ns3/packet.h>
+#include <ns3/node.h>
+#include <ns3/enum.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/lr-wpan-module.h>
+#include <ns3/single-model-spectrum-channel.h>
+#include <ns3/constant-position-mobility-model.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("lr-wpan-tx-queue-test");
+
+class LrWpanTxQueueTestCase : public TestCase
+{
+public:
+  LrWpanTxQueueTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+LrWpanTxQueueTestCase::LrWpanTxQueueTestCase ()
+  : TestCase ("Test the 802.15.4 transmission queue ring buffer")
+{
+}
+
+void
+LrWpanTxQueueTestCase::DoRun (void)
+{
+  LrWpanTxQueue queue;
+  queue.SetCapacity (3);
+  NS_TEST_ASSERT_MSG_EQ (queue.IsEmpty (), true, "New queue not empty");
+
+  // Wrap around the end of the buffer.
+  queue.PushBack (0, Create<Packet> (10));
+  queue.PushBack (1, Create<Packet> (11));
+  queue.PopFront ();
+  queue.PushBack (2, Create<Packet> (12));
+  queue.PushBack (3, Create<Packet> (13));
+  NS_TEST_ASSERT_MSG_EQ (queue.IsFull (), true, "Queue not full");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (queue.Front ().txQMsduHandle), 1, "Wrong head");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (queue.Get (2).txQMsduHandle), 3, "Wrong tail");
+
+  // Remove from the middle, keeping the order.
+  queue.Remove (1);
+  NS_TEST_ASSERT_MSG_EQ (queue.GetSize (), 2, "Wrong size after removal");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (queue.Get (1).txQMsduHandle), 3, "Wrong order after removal");
+  NS_TEST_ASSERT_MSG_EQ (queue.Get (1).txQPkt->GetSize (), 13, "Wrong packet after removal");
+
+  // Grow the buffer with queued elements.
+  queue.SetCapacity (4);
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (queue.Front ().txQMsduHandle), 1, "Wrong head after resize");
+  NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (queue.Get (1).txQMsduHandle), 3, "Wrong tail after resize");
+
+  queue.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (queue.IsEmpty (), true, "Queue not empty after clear");
+}
+
+class LrWpanTxQueueOverflowTestCase : public TestCase
+{
+public:
+  LrWpanTxQueueOverflowTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void DataConfirm (McpsDataConfirmParams params);
+  void Overflow (Ptr<const Packet> p);
+  void RunScenario (LrWpanTxQueueDropPolicy policy);
+
+  std::vector<uint32_t> m_overflowHandles;
+  std::vector<uint32_t> m_sentHandles;
+  uint32_t m_overflowTraces;
+};
+
+LrWpanTxQueueOverflowTestCase::LrWpanTxQueueOverflowTestCase ()
+  : TestCase ("Test the overflow of the 802.15.4 MAC transmission queue")
+{
+}
+
+void
+LrWpanTxQueueOverflowTestCase::DataConfirm (McpsDataConfirmParams params)
+{
+  if (params.m_status == IEEE_802_15_4_TRANSACTION_OVERFLOW)
+    {
+      m_overflowHandles.push_back (params.m_msduHandle);
+    }
+  else if (params.m_status == IEEE_802_15_4_SUCCESS)
+    {
+      m_sentHandles.push_back (params.m_msduHandle);
+    }
+}
+
+void
+LrWpanTxQueueOverflowTestCase::Overflow (Ptr<const Packet> p)
+{
+  m_overflowTraces++;
+}
+
+void
+LrWpanTxQueueOverflowTestCase::RunScenario (LrWpanTxQueueDropPolicy policy)
+{
+  m_overflowHandles.clear ();
+  m_sentHandles.clear ();
+  m_overflowTraces = 0;
+
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LrWpanNetDevice> dev = CreateObject<LrWpanNetDevice> ();
+  dev->SetAddress (Mac16Address ("00:01"));
+  dev->SetChannel (CreateObject<SingleModelSpectrumChannel> ());
+  node->AddDevice (dev);
+  dev->GetPhy ()->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+
+  dev->GetMac ()->SetAttribute ("MaxQueueSize", UintegerValue (2));
+  dev->GetMac ()->SetAttribute ("QueueDropPolicy", EnumValue (policy));
+  dev->GetMac ()->SetMcpsDataConfirmCallback (MakeCallback (&LrWpanTxQueueOverflowTestCase::DataConfirm, this));
+  dev->GetMac ()->TraceConnectWithoutContext ("MacTxQueueOverflow", MakeCallback (&LrWpanTxQueueOverflowTestCase::Overflow, this));
+
+  // Four packets are requested at once. The first one is sent right away,
+  // the queue only has room for one more.
+  McpsDataRequestParams params;
+  params.m_dstAddr = Mac16Address ("00:02");
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      params.m_msduHandle = i;
+      Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, dev->GetMac (), params, Create<Packet> (20));
+    }
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+void
+LrWpanTxQueueOverflowTestCase::DoRun (void)
+{
+  // Tail drop: the two newest packets are dropped.
+  RunScenario (TX_QUEUE_TAIL_DROP);
+  NS_TEST_ASSERT_MSG_EQ (m_overflowTraces, 2, "Wrong number of overflow traces");
+  NS_TEST_ASSERT_MSG_EQ (m_overflowHandles.size (), 2, "Wrong number of overflow confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_overflowHandles[0], 2, "Wrong packet dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_overflowHandles[1], 3, "Wrong packet dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_sentHandles.size (), 2, "Wrong number of sent packets");
+
+  // Head drop: the oldest waiting packets are dropped, the packet being sent
+  // is kept.
+  RunScenario (TX_QUEUE_HEAD_DROP);
+  NS_TEST_ASSERT_MSG_EQ (m_overflowHandles.size (), 2, "Wrong number of overflow confirms");
+  NS_TEST_ASSERT_MSG_EQ (m_overflowHandles[0], 1, "Wrong packet dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_overflowHandles[1], 2, "Wrong packet dropped");
+  NS_TEST_ASSERT_MSG_EQ (m_sentHandles.size (), 2, "Wrong number of sent packets");
+  NS_TEST_ASSERT_MSG_EQ (m_sentHandles[0], 0, "Wrong packet sent");
+  NS_TEST_ASSERT_MSG_EQ (m_sentHandles[1], 3, "Wrong packet sent");
+}
+
+class LrWpanTxQueuePriorityTestCase : public TestCase
+{
+public:
+  LrWpanTxQueuePriorityTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Dequeue (Ptr<const Packet> p, LrWpanTxQueueClass txClass);
+
+  std::vector<LrWpanTxQueueClass> m_dequeued;
+};
+
+LrWpanTxQueuePriorityTestCase::LrWpanTxQueuePriorityTestCase ()
+  : TestCase ("Test the priority of energy requests in the 802.15.4 MAC transmission queue")
+{
+}
+
+void
+LrWpanTxQueuePriorityTestCase::Dequeue (Ptr<const Packet> p, LrWpanTxQueueClass txClass)
+{
+  m_dequeued.push_back (txClass);
+}
+
+void
+LrWpanTxQueuePriorityTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LrWpanNetDevice> dev = CreateObject<LrWpanNetDevice> ();
+  dev->SetAddress (Mac16Address ("00:01"));
+  dev->SetChannel (CreateObject<SingleModelSpectrumChannel> ());
+  node->AddDevice (dev);
+  dev->GetPhy ()->SetMobility (CreateObject<ConstantPositionMobilityModel> ());
+  dev->GetMac ()->TraceConnectWithoutContext ("MacTxClassDequeue", MakeCallback (&LrWpanTxQueuePriorityTestCase::Dequeue, this));
+
+  // Two data packets are backlogged when the energy request is issued. The
+  // first one is already being sent, the request has to go before the second.
+  McpsDataRequestParams params;
+  params.m_dstAddr = Mac16Address ("00:02");
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      params.m_msduHandle = i;
+      Simulator::Schedule (Seconds (1.0), &LrWpanMac::McpsDataRequest, dev->GetMac (), params, Create<Packet> (20));
+    }
+  Simulator::Schedule (Seconds (1.0), &LrWpanMac::SendRfeForEnergy, dev->GetMac ());
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // Without an energy transmitter answering, the MAC keeps waiting for a CFE
+  // after the request.
+  NS_TEST_ASSERT_MSG_EQ (m_dequeued.size (), 2, "Wrong number of dequeued packets");
+  NS_TEST_ASSERT_MSG_EQ (m_dequeued[0], TX_CLASS_BEST_EFFORT, "The packet being sent was preempted");
+  NS_TEST_ASSERT_MSG_EQ (m_dequeued[1], TX_CLASS_ENERGY, "The energy request did not go first");
+}
+
+class LrWpanTxQueueTestSuite : public TestSuite
+{
+public:
+  LrWpanTxQueueTestSuite ();
+};
+
+LrWpanTxQueueTestSuite::LrWpanTxQueueTestSuite ()
+  : TestSuite ("lr-wpan-tx-queue", UNIT)
+{
+  AddTestCase (new LrWpanTxQueueTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanTxQueueOverflowTestCase, TestCase::QUICK);
+  AddTestCase (new LrWpanTxQueuePriorityTestCase, TestCase::QUICK);
+}
+
+static LrWpanTxQueueTestSuite g_lrWpanTxQueueTestSuite;